@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Native MAVLink router: the same binary as the camera manager, run with
+# --router. Replaces mavproxy-router.service (configure-mavproxy-service.sh).
+SERVICE_NAME="mavlink-router.service"
+SERVICE_PATH="/etc/systemd/system/${SERVICE_NAME}"
+LEGACY_SERVICE_NAME="mavproxy-router.service"
+
+USER_NAME="pi"
+WORKDIR="/home/pi"
+
+ROUTER_BIN="/usr/local/bin/majestic_manager"
+ROUTER_CONFIG="/etc/mavlink_router.yaml"
+
+echo "Checking files..."
+if [[ ! -x "${ROUTER_BIN}" ]]; then
+  echo "ERROR: router binary not found or not executable: ${ROUTER_BIN}"
+  echo "Build it with 'make -C runcam host' and install runcam/majestic_manager_host there."
+  exit 1
+fi
+
+if [[ ! -f "${ROUTER_CONFIG}" ]]; then
+  echo "ERROR: router config not found: ${ROUTER_CONFIG}"
+  echo "Start from orange-pi/mavlink_router.yaml."
+  exit 1
+fi
+
+if systemctl list-unit-files "${LEGACY_SERVICE_NAME}" > /dev/null 2>&1; then
+  echo "Disabling ${LEGACY_SERVICE_NAME}..."
+  sudo systemctl disable --now "${LEGACY_SERVICE_NAME}" || true
+fi
+
+echo "Creating systemd service: ${SERVICE_PATH}"
+sudo tee "${SERVICE_PATH}" > /dev/null <<UNIT
+[Unit]
+Description=MAVLink telemetry router
+After=network-online.target
+Wants=network-online.target
+
+[Service]
+Type=simple
+User=${USER_NAME}
+WorkingDirectory=${WORKDIR}
+ExecStart=${ROUTER_BIN} --router ${ROUTER_CONFIG}
+ExecReload=/bin/kill -HUP \$MAINPID
+Restart=always
+RestartSec=3
+
+[Install]
+WantedBy=multi-user.target
+UNIT
+
+echo "Reloading systemd..."
+sudo systemctl daemon-reload
+
+echo "Enabling service..."
+sudo systemctl enable "${SERVICE_NAME}"
+
+echo "Restarting service..."
+sudo systemctl restart "${SERVICE_NAME}"
+
+echo
+echo "Service status:"
+sudo systemctl status "${SERVICE_NAME}" --no-pager -l || true
+
+echo
+echo "Recent logs:"
+sudo journalctl -u "${SERVICE_NAME}" -n 30 --no-pager || true
+
+echo
+echo "Done."
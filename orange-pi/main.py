@@ -20,11 +20,11 @@ SYSTEM_SOURCE = 2
 CROPS = [
     "0x0x3840x2160",
     "320x180x3520x1980",
-    "640x360x3200x1800"
+    "640x360x3200x1800",
     "960x540x2880x1620"
 ]
 CROP_INDEX_MIN = 0
-CROP_INDEX_MAX = len(CROPS)
+CROP_INDEX_MAX = len(CROPS) - 1
 CROP_INDEX_CURRENT = CROP_INDEX_MIN
 
 
@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include "adaptive_bitrate.h"
+
+void adaptive_bitrate_config_defaults(adaptive_bitrate_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->min_kbps = 512;
+    config->max_kbps = 4096;
+    config->step_kbps = 256;
+    config->decrease_factor = 0.7;
+    config->min_margin_db = 10;
+    config->txbuf_low = 40;
+    config->max_rx_errors = 5;
+    config->hold_ms = 2000;
+    config->recover_ms = 5000;
+}
+
+int adaptive_bitrate_init(adaptive_bitrate_t *controller, const adaptive_bitrate_config_t *config, uint32_t initial_kbps) {
+    if (config->min_kbps == 0 || config->min_kbps > config->max_kbps ||
+        config->decrease_factor <= 0.0 || config->decrease_factor >= 1.0 || config->step_kbps == 0) {
+        return -1;
+    }
+
+    memset(controller, 0, sizeof(*controller));
+    controller->config = *config;
+    controller->ceiling_kbps = config->max_kbps;
+    controller->bitrate_kbps = initial_kbps ? initial_kbps : config->max_kbps;
+    adaptive_bitrate_set_ceiling(controller, config->max_kbps);
+    controller->low_fps_active = config->low_fps > 0 && controller->bitrate_kbps < config->low_fps_below_kbps;
+    return 0;
+}
+
+static uint32_t clamp_kbps(const adaptive_bitrate_t *controller, uint32_t kbps) {
+    const uint32_t floor = controller->config.min_kbps;
+    const uint32_t ceiling = controller->ceiling_kbps > floor ? controller->ceiling_kbps : floor;
+
+    if (kbps < floor) {
+        return floor;
+    }
+
+    return kbps > ceiling ? ceiling : kbps;
+}
+
+void adaptive_bitrate_set_ceiling(adaptive_bitrate_t *controller, uint32_t ceiling_kbps) {
+    if (ceiling_kbps == 0 || ceiling_kbps > controller->config.max_kbps) {
+        ceiling_kbps = controller->config.max_kbps;
+    }
+
+    controller->ceiling_kbps = ceiling_kbps;
+    controller->bitrate_kbps = clamp_kbps(controller, controller->bitrate_kbps);
+}
+
+static bool link_degraded(adaptive_bitrate_t *controller, const adaptive_bitrate_sample_t *sample) {
+    const adaptive_bitrate_config_t *config = &controller->config;
+    const int32_t local_margin = (int32_t)sample->rssi - (int32_t)sample->noise;
+    const int32_t remote_margin = (int32_t)sample->remrssi - (int32_t)sample->remnoise;
+    const int32_t margin = local_margin < remote_margin ? local_margin : remote_margin;
+    uint16_t new_errors = 0;
+
+    if (controller->have_rx_errors) {
+        // uint16_t arithmetic handles the counter wrapping.
+        new_errors = (uint16_t)(sample->rxerrors - controller->last_rx_errors);
+    }
+
+    controller->last_rx_errors = sample->rxerrors;
+    controller->have_rx_errors = true;
+
+    return margin < config->min_margin_db ||
+        sample->txbuf < config->txbuf_low ||
+        new_errors > config->max_rx_errors;
+}
+
+// Flip the fps tier with one step of hysteresis so a bitrate hovering around
+// the threshold does not toggle fps (which costs a Majestic restart).
+static bool update_fps_tier(adaptive_bitrate_t *controller) {
+    const adaptive_bitrate_config_t *config = &controller->config;
+
+    if (config->low_fps == 0) {
+        return false;
+    }
+
+    if (!controller->low_fps_active && controller->bitrate_kbps < config->low_fps_below_kbps) {
+        controller->low_fps_active = true;
+        return true;
+    }
+
+    if (controller->low_fps_active && controller->bitrate_kbps >= config->low_fps_below_kbps + config->step_kbps) {
+        controller->low_fps_active = false;
+        return true;
+    }
+
+    return false;
+}
+
+int adaptive_bitrate_update(adaptive_bitrate_t *controller, const adaptive_bitrate_sample_t *sample, uint64_t now_ms) {
+    const adaptive_bitrate_config_t *config = &controller->config;
+    const bool degraded = link_degraded(controller, sample);
+
+    if (degraded) {
+        controller->healthy = false;
+    } else if (!controller->healthy) {
+        controller->healthy = true;
+        controller->healthy_since_ms = now_ms;
+    }
+
+    if (controller->last_change_ms != 0 && now_ms - controller->last_change_ms < config->hold_ms) {
+        return 0;
+    }
+
+    uint32_t target = controller->bitrate_kbps;
+
+    if (degraded) {
+        target = clamp_kbps(controller, (uint32_t)(controller->bitrate_kbps * config->decrease_factor));
+    } else if (now_ms - controller->healthy_since_ms >= config->recover_ms &&
+               now_ms - controller->last_change_ms >= config->recover_ms) {
+        target = clamp_kbps(controller, controller->bitrate_kbps + config->step_kbps);
+    }
+
+    if (target == controller->bitrate_kbps) {
+        return 0;
+    }
+
+    controller->bitrate_kbps = target;
+    controller->last_change_ms = now_ms;
+
+    int changed = ADAPTIVE_BITRATE_CHANGED;
+
+    if (update_fps_tier(controller)) {
+        changed |= ADAPTIVE_FPS_CHANGED;
+    }
+
+    return changed;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Tuning of the link-driven video bitrate controller. Decreases are
+ * multiplicative and fast, increases additive and only after the link has
+ * stayed healthy for `recover_ms`, so the rate backs off quickly and climbs
+ * back without oscillating.
+ */
+typedef struct adaptive_bitrate_config {
+    uint32_t min_kbps;
+    uint32_t max_kbps;
+    uint32_t step_kbps;         // additive increase per healthy period
+    double decrease_factor;     // multiplier applied on degradation, e.g. 0.7
+    int32_t min_margin_db;      // rssi - noise below this counts as degraded
+    uint8_t txbuf_low;          // free radio tx buffer (%) below this is congestion
+    uint32_t max_rx_errors;     // rxerrors growth per report tolerated
+    uint32_t hold_ms;           // minimum time between any two changes
+    uint32_t recover_ms;        // healthy time required before an increase
+    uint32_t low_fps;           // fps used below `low_fps_below_kbps` (0 disables)
+    uint32_t low_fps_below_kbps;
+} adaptive_bitrate_config_t;
+
+/**
+ * One RADIO_STATUS report. Signal values are in the radio's raw units; only
+ * their differences are used.
+ */
+typedef struct adaptive_bitrate_sample {
+    uint8_t rssi;
+    uint8_t remrssi;
+    uint8_t noise;
+    uint8_t remnoise;
+    uint8_t txbuf;
+    uint16_t rxerrors; // cumulative, wraps
+} adaptive_bitrate_sample_t;
+
+typedef struct adaptive_bitrate {
+    adaptive_bitrate_config_t config;
+    uint32_t ceiling_kbps;  // max_kbps or a lower limit set by the zoom profile
+    uint32_t bitrate_kbps;
+    bool low_fps_active;
+    bool have_rx_errors;
+    uint16_t last_rx_errors;
+    uint64_t last_change_ms;
+    uint64_t healthy_since_ms;
+    bool healthy;
+} adaptive_bitrate_t;
+
+/** Returned by adaptive_bitrate_update() when the bitrate should be applied. */
+#define ADAPTIVE_BITRATE_CHANGED 0x1
+/** Returned by adaptive_bitrate_update() when the fps tier flipped. */
+#define ADAPTIVE_FPS_CHANGED 0x2
+
+void adaptive_bitrate_config_defaults(adaptive_bitrate_config_t *config);
+
+/**
+ * @return 0 on success, -1 if the configuration is inconsistent.
+ */
+int adaptive_bitrate_init(adaptive_bitrate_t *controller, const adaptive_bitrate_config_t *config, uint32_t initial_kbps);
+
+/**
+ * Feed one link report taken at `now_ms` (any monotonic millisecond clock).
+ *
+ * @return bitmask of ADAPTIVE_BITRATE_CHANGED / ADAPTIVE_FPS_CHANGED, or 0
+ *         when nothing needs to be applied.
+ */
+int adaptive_bitrate_update(adaptive_bitrate_t *controller, const adaptive_bitrate_sample_t *sample, uint64_t now_ms);
+
+/**
+ * Lower (or restore) the upper bound, e.g. to the bitrate of the active
+ * zoom profile. The current bitrate is clamped immediately.
+ */
+void adaptive_bitrate_set_ceiling(adaptive_bitrate_t *controller, uint32_t ceiling_kbps);
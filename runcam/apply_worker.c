@@ -0,0 +1,391 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "apply_worker.h"
+#include "config_sync.h"
+#include "latency_trace.h"
+#include "majestic_apply.h"
+#include "manager_state.h"
+#include "spsc_queue.h"
+
+#define APPLY_REQUEST_CAPACITY 8
+#define APPLY_RESULT_CAPACITY 16
+
+typedef struct apply_request {
+    uint32_t first_sequence; // below `sequence` once requests were folded in
+    uint32_t sequence;
+    majestic_config_txn_t txn;
+    const char *restore_path; // replace the config with this file instead of applying `txn`
+    bool has_state; // save `state` once the batch is committed
+    manager_state_t state;
+} apply_request_t;
+
+static apply_request_t request_storage[APPLY_REQUEST_CAPACITY];
+static apply_result_t result_storage[APPLY_RESULT_CAPACITY];
+static spsc_queue_t request_queue;
+static spsc_queue_t result_queue;
+
+static int request_event_fd = -1;
+static int result_event_fd = -1;
+static pthread_t worker_thread;
+static atomic_bool stop_requested;
+static bool worker_running = false;
+static config_sync_t *flash_sync = NULL;
+static config_sync_t *state_sync = NULL;
+static manager_state_t saved_state;
+static bool has_saved_state = false;
+
+// Main-thread state: the next sequence number and a request that did not fit
+// into the queue yet. Because batches merge anyway, an overflowing request is
+// folded into this single deferred slot and pushed once space frees up.
+static uint32_t next_sequence = 1;
+static apply_request_t deferred_request;
+static bool has_deferred_request = false;
+
+static void signal_event(int fd) {
+    const uint64_t one = 1;
+
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+static void clear_event(int fd) {
+    uint64_t value = 0;
+
+    while (read(fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+// Fold `source` into `target`; keys staged later replace earlier values, and
+// so does a later state. Returns false if `target` has no room for a new key
+// or either side is a restore, which runs on its own.
+static bool merge_request(apply_request_t *target, const apply_request_t *source) {
+    majestic_config_txn_t merged = target->txn;
+
+    if (target->restore_path || source->restore_path) {
+        return false;
+    }
+
+    for (size_t i = 0; i < source->txn.change_count; ++i) {
+        if (majestic_config_set(&merged, source->txn.changes[i].key, source->txn.changes[i].value) != 0) {
+            return false;
+        }
+    }
+
+    target->txn = merged;
+
+    if (source->has_state) {
+        target->has_state = true;
+        target->state = source->state;
+    }
+
+    return true;
+}
+
+// Milliseconds until the earlier of the two flash syncs is due, -1 if none is.
+static int sync_timeout_ms(uint64_t now_ns) {
+    const int config_ms = flash_sync ? config_sync_timeout_ms(flash_sync, now_ns) : -1;
+    const int state_ms = state_sync ? config_sync_timeout_ms(state_sync, now_ns) : -1;
+
+    if (config_ms < 0 || (state_ms >= 0 && state_ms < config_ms)) {
+        return state_ms;
+    }
+
+    return config_ms;
+}
+
+static void flush_syncs(bool due_only) {
+    const uint64_t now_ns = latency_trace_now();
+
+    if (flash_sync && (!due_only || config_sync_timeout_ms(flash_sync, now_ns) == 0)) {
+        (void)config_sync_flush(flash_sync);
+    }
+
+    if (state_sync && (!due_only || config_sync_timeout_ms(state_sync, now_ns) == 0)) {
+        (void)config_sync_flush(state_sync);
+    }
+}
+
+// Block until the main thread signals a request. While written config is
+// waiting for its flash sync the wait is bounded, and a quiet period running
+// out writes it to flash here, off the main loop.
+static void wait_for_request(void) {
+    while (1) {
+        const int timeout_ms = sync_timeout_ms(latency_trace_now());
+
+        if (timeout_ms < 0) {
+            break;
+        }
+
+        struct pollfd pfd = { .fd = request_event_fd, .events = POLLIN, .revents = 0 };
+        const int ready = poll(&pfd, 1, timeout_ms);
+
+        if (ready > 0 || (ready < 0 && errno != EINTR)) {
+            break;
+        }
+
+        if (ready == 0) {
+            flush_syncs(true);
+        }
+    }
+
+    clear_event(request_event_fd);
+}
+
+// Keep the state of a committed batch in the working file (tmpfs), with the
+// flash copy following on the quiet-period schedule of the config.
+static void save_state(const manager_state_t *state) {
+    if (!state_sync || (has_saved_state && manager_state_equal(&saved_state, state))) {
+        return;
+    }
+
+    if (manager_state_save(state_sync->working_path, state) == 0) {
+        saved_state = *state;
+        has_saved_state = true;
+        config_sync_note_change(state_sync, latency_trace_now());
+    }
+}
+
+// Re-read the video1 settings after a batch that changed them, so the stream
+// the ground station is told about follows zoom profiles, adaptive bitrate,
+// commands and rollbacks.
+static void read_stream(const apply_request_t *request, apply_result_t *result) {
+    bool touched = request->restore_path != NULL;
+
+    for (size_t i = 0; i < request->txn.change_count && !touched; ++i) {
+        touched = strncmp(request->txn.changes[i].key, "video1.", 7) == 0;
+    }
+
+    if (result->status == 0 && touched) {
+        majestic_apply_read_stream(request->txn.config_path, &result->stream);
+        result->has_stream = true;
+    }
+}
+
+static void publish_result(const apply_result_t *result) {
+    // The result queue is twice the request queue and each result covers at
+    // least one request, so it only fills if the main loop stalls entirely.
+    if (!spsc_queue_push(&result_queue, result)) {
+        fprintf(stderr, "Apply result queue full; dropping result %u.\n", result->last_sequence);
+    }
+
+    signal_event(result_event_fd);
+}
+
+static void *worker_main(void *argument) {
+    (void)argument;
+
+    apply_request_t request;
+    bool has_carry = false;
+    apply_request_t carry;
+
+    while (!atomic_load(&stop_requested)) {
+        if (!has_carry) {
+            wait_for_request();
+        }
+
+        apply_request_t pending;
+        uint32_t first_sequence = 0;
+        uint32_t last_sequence = 0;
+        bool has_pending = false;
+
+        if (has_carry) {
+            pending = carry;
+            first_sequence = carry.first_sequence;
+            last_sequence = carry.sequence;
+            has_pending = true;
+            has_carry = false;
+        }
+
+        // Coalesce everything queued so far into one commit.
+        while (spsc_queue_pop(&request_queue, &request)) {
+            if (!has_pending) {
+                pending = request;
+                first_sequence = request.first_sequence;
+                has_pending = true;
+            } else if (!merge_request(&pending, &request)) {
+                carry = request;
+                has_carry = true;
+                break;
+            }
+
+            last_sequence = request.sequence;
+        }
+
+        if (!has_pending) {
+            continue;
+        }
+
+        apply_result_t result = {
+            .first_sequence = first_sequence,
+            .last_sequence = last_sequence,
+            .started_ns = latency_trace_now()
+        };
+
+        if (pending.restore_path) {
+            // A restored config is meant to survive a reboot, so it goes to
+            // flash now instead of after the quiet period.
+            result.status = majestic_config_restore(pending.txn.config_path, pending.restore_path);
+
+            if (result.status == 0 && flash_sync) {
+                config_sync_note_change(flash_sync, latency_trace_now());
+                (void)config_sync_flush(flash_sync);
+            }
+
+            read_stream(&pending, &result);
+            publish_result(&result);
+            continue;
+        }
+
+        result.status = majestic_apply(&pending.txn, &result.timing);
+
+        // majestic_apply() drops the values the config already held, so
+        // whatever is left was written (or at least attempted).
+        if (flash_sync && pending.txn.change_count > 0) {
+            config_sync_note_change(flash_sync, latency_trace_now());
+        }
+
+        if (result.status == 0 && pending.has_state) {
+            save_state(&pending.state);
+        }
+
+        read_stream(&pending, &result);
+        publish_result(&result);
+    }
+
+    flush_syncs(false);
+    return NULL;
+}
+
+int apply_worker_start(config_sync_t *sync, config_sync_t *state) {
+    if (spsc_queue_init(&request_queue, request_storage, sizeof(request_storage[0]), APPLY_REQUEST_CAPACITY) != 0 ||
+        spsc_queue_init(&result_queue, result_storage, sizeof(result_storage[0]), APPLY_RESULT_CAPACITY) != 0) {
+        return -1;
+    }
+
+    // The worker blocks on its eventfd; the main loop polls the result one.
+    request_event_fd = eventfd(0, EFD_CLOEXEC);
+    result_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (request_event_fd < 0 || result_event_fd < 0) {
+        fprintf(stderr, "eventfd failed: %s\n", strerror(errno));
+        apply_worker_stop();
+        return -1;
+    }
+
+    atomic_store(&stop_requested, false);
+    flash_sync = sync;
+    state_sync = state;
+    has_saved_state = state && manager_state_load(state->working_path, &saved_state) == 0;
+
+    const int error = pthread_create(&worker_thread, NULL, worker_main, NULL);
+
+    if (error != 0) {
+        fprintf(stderr, "Failed to start apply worker: %s\n", strerror(error));
+        apply_worker_stop();
+        return -1;
+    }
+
+    worker_running = true;
+    return 0;
+}
+
+void apply_worker_stop(void) {
+    if (worker_running) {
+        atomic_store(&stop_requested, true);
+        signal_event(request_event_fd);
+        pthread_join(worker_thread, NULL);
+        worker_running = false;
+    }
+
+    if (request_event_fd >= 0) {
+        close(request_event_fd);
+        request_event_fd = -1;
+    }
+
+    if (result_event_fd >= 0) {
+        close(result_event_fd);
+        result_event_fd = -1;
+    }
+}
+
+static bool flush_deferred(void) {
+    if (!has_deferred_request) {
+        return true;
+    }
+
+    if (!spsc_queue_push(&request_queue, &deferred_request)) {
+        return false;
+    }
+
+    has_deferred_request = false;
+    signal_event(request_event_fd);
+    return true;
+}
+
+static uint32_t submit_request(apply_request_t *request) {
+    request->first_sequence = next_sequence;
+    request->sequence = next_sequence++;
+
+    if (flush_deferred() && spsc_queue_push(&request_queue, request)) {
+        signal_event(request_event_fd);
+        return request->sequence;
+    }
+
+    // Queue full: the worker is busy and will merge everything anyway, so keep
+    // folding into the deferred slot until the next result frees space.
+    if (!has_deferred_request) {
+        deferred_request = *request;
+        has_deferred_request = true;
+    } else if (merge_request(&deferred_request, request)) {
+        deferred_request.sequence = request->sequence;
+    } else {
+        fprintf(stderr, "Apply backlog full; dropping request %u.\n", request->sequence);
+        return 0;
+    }
+
+    return request->sequence;
+}
+
+uint32_t apply_worker_submit(const majestic_config_txn_t *txn) {
+    return apply_worker_submit_state(txn, NULL);
+}
+
+uint32_t apply_worker_submit_state(const majestic_config_txn_t *txn, const manager_state_t *state) {
+    apply_request_t request = {
+        .txn = *txn,
+        .has_state = state != NULL
+    };
+
+    if (state) {
+        request.state = *state;
+    }
+
+    return submit_request(&request);
+}
+
+uint32_t apply_worker_submit_restore(const char *config_path, const char *source_path) {
+    apply_request_t request = {
+        .restore_path = source_path
+    };
+
+    majestic_config_begin(&request.txn, config_path);
+    return submit_request(&request);
+}
+
+int apply_worker_result_fd(void) {
+    return result_event_fd;
+}
+
+bool apply_worker_poll_result(apply_result_t *result) {
+    clear_event(result_event_fd);
+    (void)flush_deferred();
+    return spsc_queue_pop(&result_queue, result);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config_sync.h"
+#include "majestic_apply.h"
+#include "majestic_config.h"
+#include "manager_state.h"
+
+/**
+ * Outcome of one coalesced apply. Every request with a sequence number in
+ * [first_sequence, last_sequence] was folded into this single commit.
+ */
+typedef struct apply_result {
+    uint32_t first_sequence;
+    uint32_t last_sequence;
+    int status; // 0 on success, -1 on failure
+    uint64_t started_ns; // CLOCK_MONOTONIC time the worker picked the batch up
+    majestic_apply_timing_t timing;
+    bool has_stream; // `stream` holds the settings Majestic runs on after this batch
+    majestic_stream_settings_t stream;
+} apply_result_t;
+
+/**
+ * Start the worker thread that owns config writes and Majestic reloads.
+ * Must be called after majestic_apply_init() and with the signals the main
+ * loop consumes already blocked, so the worker inherits that mask.
+ *
+ * @param sync Optional; the worker notes every config write in it and runs
+ *             the flash sync once the config has been quiet for the sync
+ *             period, and once more when it stops.
+ * @param state Optional; states passed to apply_worker_submit_state() are
+ *              written to its working path once their batch is committed
+ *              and synced to flash the same way.
+ *
+ * @return 0 on success, -1 on failure (details logged to stderr).
+ */
+int apply_worker_start(config_sync_t *sync, config_sync_t *state);
+
+/**
+ * Stop and join the worker, letting any in-flight apply and a pending flash
+ * sync finish first.
+ */
+void apply_worker_stop(void);
+
+/**
+ * Queue a config batch (main thread only). Batches still waiting when the
+ * worker wakes up are merged, later values winning, and committed together,
+ * so a burst of zoom steps costs one apply of the final target.
+ *
+ * @return sequence number identifying the request in apply_result_t, 0 if
+ *         the backlog was full and the batch could not be merged into it.
+ */
+uint32_t apply_worker_submit(const majestic_config_txn_t *txn);
+
+/**
+ * Like apply_worker_submit(), and save `state` once the batch carrying it
+ * has been applied. Merged batches keep the newest state; a failed batch
+ * saves none.
+ */
+uint32_t apply_worker_submit_state(const majestic_config_txn_t *txn, const manager_state_t *state);
+
+/**
+ * Queue a replacement of the whole config with the file at `source_path`
+ * (main thread only), e.g. a known good copy. It runs in order with the
+ * batches around it, never merged with them, so no other write can interleave
+ * with it, and goes to flash right away. `source_path` must stay valid until
+ * the result arrives.
+ *
+ * @return sequence number identifying the request in apply_result_t, 0 if
+ *         the backlog was full; submit it again later.
+ */
+uint32_t apply_worker_submit_restore(const char *config_path, const char *source_path);
+
+/**
+ * Descriptor that becomes readable when results are available.
+ */
+int apply_worker_result_fd(void);
+
+/**
+ * Fetch the next completed result (main thread only). Also retries any
+ * submission that found the request queue full.
+ *
+ * @return false when no result is pending.
+ */
+bool apply_worker_poll_result(apply_result_t *result);
@@ -0,0 +1,169 @@
+// Microbenchmark: stock mavlink_parse_char versus the memchr frame scanner on
+// a synthetic flight-controller stream dominated by telemetry the manager
+// does not subscribe to. Build and run with `make bench`.
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../mavlink_scanner.h"
+#include "../ring_buffer.h"
+
+#define STREAM_SIZE (8u * 1024u * 1024u)
+#define READ_CHUNK 64u // bytes per read(2) at high baud with VMIN=1
+#define ROUNDS 5
+
+static uint8_t *stream;
+static size_t stream_length;
+
+static size_t append(const mavlink_message_t *message) {
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t length = mavlink_msg_to_send_buffer(buffer, message);
+
+    if (stream_length + length > STREAM_SIZE) {
+        return 0;
+    }
+
+    memcpy(stream + stream_length, buffer, length);
+    stream_length += length;
+    return length;
+}
+
+// Roughly what an ArduPilot FC streams at SR rates of 10-50 Hz, with the
+// occasional STATUSTEXT and RADIO_STATUS the manager actually handles.
+static size_t build_stream(void) {
+    mavlink_message_t message;
+    size_t wanted = 0;
+    uint32_t tick = 0;
+
+    stream = malloc(STREAM_SIZE);
+
+    if (!stream) {
+        return 0;
+    }
+
+    while (true) {
+        mavlink_msg_attitude_pack(1, 1, &message, tick, 0.1f, 0.2f, 0.3f, 0.01f, 0.02f, 0.03f);
+        if (!append(&message)) break;
+        mavlink_msg_global_position_int_pack(1, 1, &message, tick, 473977420, 85455940, 500000, 20000, 100, -50, 10, 18000);
+        if (!append(&message)) break;
+        mavlink_msg_gps_raw_int_pack(1, 1, &message, tick, 3, 473977420, 85455940, 500000, 100, 120, 1500, 18000, 14,
+                                     0, 0, 0, 0, 0, 0);
+        if (!append(&message)) break;
+        mavlink_msg_vfr_hud_pack(1, 1, &message, 15.0f, 14.0f, 180, 55, 500.0f, 0.5f);
+        if (!append(&message)) break;
+
+        if (tick % 10 == 0) {
+            mavlink_msg_radio_status_pack(3, 68, &message, 180, 170, 90, 40, 45, 0, 0);
+            if (!append(&message)) break;
+            ++wanted;
+        }
+
+        if (tick % 50 == 0) {
+            mavlink_msg_statustext_pack(1, 1, &message, MAV_SEVERITY_INFO, "zoom_in", 0, 0);
+            if (!append(&message)) break;
+            ++wanted;
+        }
+
+        ++tick;
+    }
+
+    return wanted;
+}
+
+static bool is_wanted(uint32_t msgid, void *context) {
+    (void)context;
+    return msgid == MAVLINK_MSG_ID_STATUSTEXT || msgid == MAVLINK_MSG_ID_RADIO_STATUS;
+}
+
+static void count_message(const mavlink_message_t *message, void *context) {
+    (void)message;
+    ++*(size_t *)context;
+}
+
+static double now_seconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static size_t run_stock(void) {
+    mavlink_status_t status;
+    mavlink_message_t message;
+    size_t delivered = 0;
+
+    memset(&status, 0, sizeof(status));
+
+    for (size_t i = 0; i < stream_length; ++i) {
+        if (mavlink_parse_char(MAVLINK_COMM_1, stream[i], &message, &status) &&
+            is_wanted(message.msgid, NULL)) {
+            count_message(&message, &delivered);
+        }
+    }
+
+    return delivered;
+}
+
+// Mirrors matek_receive(): chunked reads into a ring, then linearize + scan.
+static size_t run_scanner(void) {
+    static uint8_t storage[1024];
+    ring_buffer_t ring;
+    mavlink_scanner_t scanner;
+    size_t delivered = 0;
+
+    ring_buffer_init(&ring, storage, sizeof(storage));
+    mavlink_scanner_init(&scanner, is_wanted, count_message, &delivered);
+
+    for (size_t offset = 0; offset < stream_length; offset += READ_CHUNK) {
+        const size_t chunk = stream_length - offset < READ_CHUNK ? stream_length - offset : READ_CHUNK;
+
+        ring_buffer_write(&ring, stream + offset, chunk);
+
+        const uint8_t *data = ring_buffer_linearize(&ring);
+        ring_buffer_consume(&ring, mavlink_scanner_feed(&scanner, data, ring_buffer_size(&ring)));
+    }
+
+    return delivered;
+}
+
+static void report(const char *name, size_t (*run)(void), size_t expected) {
+    double best = 1e9;
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        const double start = now_seconds();
+        const size_t delivered = run();
+        const double elapsed = now_seconds() - start;
+
+        if (delivered != expected) {
+            fprintf(stderr, "%s delivered %zu messages, expected %zu\n", name, delivered, expected);
+            exit(EXIT_FAILURE);
+        }
+
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    printf("%-8s %8.1f MB/s %7.2f ns/byte\n",
+           name, (double)stream_length / best / 1e6, best * 1e9 / (double)stream_length);
+}
+
+int main(void) {
+    const size_t wanted = build_stream();
+
+    if (wanted == 0) {
+        fprintf(stderr, "Failed to build the benchmark stream.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu bytes, %zu wanted messages\n", stream_length, wanted);
+    report("stock", run_stock, wanted);
+    report("scanner", run_scanner, wanted);
+
+    free(stream);
+    return EXIT_SUCCESS;
+}
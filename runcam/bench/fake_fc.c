@@ -0,0 +1,501 @@
+// Simulated flight controller for benchmarking majestic_manager on a
+// development machine. It creates a pty standing in for the FC UART, starts
+// stub_majestic and the manager against a scratch Majestic config, replays
+// telemetry at a fixed frame rate and sends zoom commands, then reports
+// command-to-ack latency percentiles and the manager's CPU time per message.
+//
+//   fake_fc [--manager PATH] [--stub PATH] [--duration S] [--telemetry-hz N]
+//           [--command-hz N] [--reload]
+//
+// Acks for SET_CAMERA_ZOOM are only sent once the crop has been applied, so
+// the latency covers parse, dispatch, config write and the Majestic update.
+// --reload leaves the stub's HTTP port closed, so every apply takes the
+// SIGHUP reload path instead of the runtime API, and turns on the manager's
+// RTSP probe against the stub so the reload video gap is measured too. The
+// stub takes 50 ms to "restart" on every reload.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../mavlink_include.h"
+
+#define MAX_SAMPLES 65536
+#define STUB_PORT 18080
+#define STUB_RTSP_PORT 18554
+
+typedef struct options {
+    const char *manager;
+    const char *stub;
+    double duration_s;
+    unsigned telemetry_hz;
+    unsigned command_hz;
+    bool reload;
+} options_t;
+
+static char work_dir[] = "/tmp/majestic_bench.XXXXXX";
+static int master_fd = -1;
+static double latencies_ms[MAX_SAMPLES];
+static size_t latency_count = 0;
+static double pending_sent[MAX_SAMPLES]; // FIFO of command send times
+static size_t pending_head = 0;
+static size_t pending_tail = 0;
+static unsigned long acks_failed = 0;
+static bool heartbeat_seen = false;
+
+static double now_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+static void work_path(char *out, size_t out_size, const char *name) {
+    snprintf(out, out_size, "%s/%s", work_dir, name);
+}
+
+static int write_text(const char *name, const char *text) {
+    char path[256];
+    work_path(path, sizeof(path), name);
+
+    FILE *file = fopen(path, "w");
+
+    if (!file) {
+        fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fputs(text, file);
+    fclose(file);
+    return 0;
+}
+
+static int prepare_work_dir(const options_t *options) {
+    char serial_path[256];
+    char majestic_path[256];
+    char stats_path[256];
+    char text[1024];
+
+    if (!mkdtemp(work_dir)) {
+        fprintf(stderr, "mkdtemp failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    work_path(serial_path, sizeof(serial_path), "ttyFC");
+    work_path(majestic_path, sizeof(majestic_path), "majestic.yaml");
+    work_path(stats_path, sizeof(stats_path), "stats.sock");
+
+    snprintf(text, sizeof(text),
+             "system:\n"
+             "  webPort: %d\n"
+             "video0:\n"
+             "  size: 3840x2160\n"
+             "video1:\n"
+             "  size: 1920x1080\n"
+             "  fps: 60\n"
+             "  bitrate: 4096\n"
+             "  crop: 0x0x1920x1080\n"
+             "rtsp:\n"
+             "  port: %d\n",
+             STUB_PORT, STUB_RTSP_PORT);
+
+    if (write_text("majestic.yaml", text) != 0) {
+        return -1;
+    }
+
+    snprintf(text, sizeof(text),
+             "majestic:\n"
+             "  config: %s\n"
+             "serial:\n"
+             "  device: %s\n"
+             "  baud: 921600\n"
+             "stats:\n"
+             "  socket: %s\n"
+             "probe:\n"
+             "  enabled: %s\n",
+             majestic_path, serial_path, stats_path, options->reload ? "true" : "false");
+
+    if (write_text("manager.yaml", text) != 0) {
+        return -1;
+    }
+
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0 ||
+        symlink(ptsname(master_fd), serial_path) != 0) {
+        fprintf(stderr, "Cannot set up the FC pty: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static void remove_work_dir(void) {
+    static const char *const names[] = { "ttyFC", "majestic.yaml", "manager.yaml", "manager.log", "stats.sock" };
+    char path[256];
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        work_path(path, sizeof(path), names[i]);
+        unlink(path);
+    }
+
+    rmdir(work_dir);
+}
+
+static pid_t spawn(char *const argv[], const char *log_name) {
+    const pid_t pid = fork();
+
+    if (pid == 0) {
+        if (log_name) {
+            char path[256];
+            work_path(path, sizeof(path), log_name);
+
+            const int log_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+            if (log_fd >= 0) {
+                dup2(log_fd, STDERR_FILENO);
+                dup2(log_fd, STDOUT_FILENO);
+                close(log_fd);
+            }
+        }
+
+        execv(argv[0], argv);
+        fprintf(stderr, "Cannot exec %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+
+    return pid;
+}
+
+// utime + stime of a process in milliseconds.
+static double cpu_time_ms(pid_t pid) {
+    char path[64];
+    char line[1024];
+    unsigned long user_ticks = 0;
+    unsigned long system_ticks = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+
+    FILE *file = fopen(path, "r");
+
+    if (!file) {
+        return 0.0;
+    }
+
+    const bool read_ok = fgets(line, sizeof(line), file) != NULL;
+    fclose(file);
+
+    const char *fields = read_ok ? strrchr(line, ')') : NULL;
+
+    if (!fields || sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                          &user_ticks, &system_ticks) != 2) {
+        return 0.0;
+    }
+
+    return (double)(user_ticks + system_ticks) * 1000.0 / (double)sysconf(_SC_CLK_TCK);
+}
+
+// Print the manager's per-stage latency histograms from its stats socket.
+static void print_manager_stats(void) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    char report[2048];
+    size_t length = 0;
+    ssize_t n;
+
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s/stats.sock", work_dir);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    while (length + 1 < sizeof(report) && (n = read(fd, report + length, sizeof(report) - 1 - length)) > 0) {
+        length += (size_t)n;
+    }
+
+    report[length] = '\0';
+    close(fd);
+    printf("manager stages:\n%s", report);
+}
+
+static bool send_message(const mavlink_message_t *message) {
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t length = mavlink_msg_to_send_buffer(buffer, message);
+
+    return write(master_fd, buffer, length) == (ssize_t)length;
+}
+
+// Cycle through the high-rate telemetry an autopilot streams.
+static bool send_telemetry(uint32_t index) {
+    mavlink_message_t message;
+    const uint32_t time_ms = index;
+
+    switch (index % 4) {
+    case 0:
+        mavlink_msg_attitude_pack(1, 1, &message, time_ms, 0.1f, 0.2f, 0.3f, 0.01f, 0.02f, 0.03f);
+        break;
+    case 1:
+        mavlink_msg_global_position_int_pack(1, 1, &message, time_ms, 473977420, 85455940, 500000, 20000,
+                                             100, -50, 10, 18000);
+        break;
+    case 2:
+        mavlink_msg_gps_raw_int_pack(1, 1, &message, time_ms, 3, 473977420, 85455940, 500000, 100, 120, 1500,
+                                     18000, 14, 0, 0, 0, 0, 0, 0);
+        break;
+    default:
+        mavlink_msg_vfr_hud_pack(1, 1, &message, 15.0f, 14.0f, 180, 55, 500.0f, 0.5f);
+        break;
+    }
+
+    return send_message(&message);
+}
+
+static bool send_zoom_step(int direction) {
+    mavlink_message_t message;
+
+    mavlink_msg_command_long_pack(255, 190, &message, 2, MAV_COMP_ID_CAMERA, MAV_CMD_SET_CAMERA_ZOOM, 0,
+                                  ZOOM_TYPE_STEP, (float)direction, 0, 0, 0, 0, 0);
+
+    if (!send_message(&message)) {
+        return false;
+    }
+
+    pending_sent[pending_tail++ % MAX_SAMPLES] = now_ms();
+    return true;
+}
+
+static void handle_incoming(void) {
+    static mavlink_status_t status;
+    uint8_t buffer[512];
+    mavlink_message_t message;
+    ssize_t n;
+
+    memset(&message, 0, sizeof(message));
+
+    while ((n = read(master_fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            if (!mavlink_parse_char(MAVLINK_COMM_1, buffer[i], &message, &status)) {
+                continue;
+            }
+
+            if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+                heartbeat_seen = true;
+            } else if (message.msgid == MAVLINK_MSG_ID_COMMAND_ACK &&
+                       mavlink_msg_command_ack_get_command(&message) == MAV_CMD_SET_CAMERA_ZOOM &&
+                       pending_head < pending_tail) {
+                const double sent = pending_sent[pending_head++ % MAX_SAMPLES];
+
+                if (mavlink_msg_command_ack_get_result(&message) != MAV_RESULT_ACCEPTED) {
+                    ++acks_failed;
+                } else if (latency_count < MAX_SAMPLES) {
+                    latencies_ms[latency_count++] = now_ms() - sent;
+                }
+            }
+        }
+    }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(double fraction) {
+    size_t index = (size_t)(fraction * (double)(latency_count - 1) + 0.5);
+    return latencies_ms[index < latency_count ? index : latency_count - 1];
+}
+
+static bool wait_for_heartbeat(double timeout_ms) {
+    const double deadline = now_ms() + timeout_ms;
+
+    while (!heartbeat_seen && now_ms() < deadline) {
+        struct pollfd poll_fd = { .fd = master_fd, .events = POLLIN, .revents = 0 };
+
+        if (poll(&poll_fd, 1, 50) > 0) {
+            handle_incoming();
+        }
+    }
+
+    return heartbeat_seen;
+}
+
+static int parse_options(int argc, char **argv, options_t *options) {
+    static const struct option long_options[] = {
+        { "manager", required_argument, NULL, 'm' },
+        { "stub", required_argument, NULL, 's' },
+        { "duration", required_argument, NULL, 'd' },
+        { "telemetry-hz", required_argument, NULL, 't' },
+        { "command-hz", required_argument, NULL, 'c' },
+        { "reload", no_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int option;
+
+    *options = (options_t){
+        .manager = "./majestic_manager_host",
+        .stub = "./bench/stub_majestic",
+        .duration_s = 10.0,
+        .telemetry_hz = 500,
+        .command_hz = 5,
+        .reload = false
+    };
+
+    while ((option = getopt_long(argc, argv, "m:s:d:t:c:r", long_options, NULL)) != -1) {
+        switch (option) {
+        case 'm': options->manager = optarg; break;
+        case 's': options->stub = optarg; break;
+        case 'd': options->duration_s = atof(optarg); break;
+        case 't': options->telemetry_hz = (unsigned)atoi(optarg); break;
+        case 'c': options->command_hz = (unsigned)atoi(optarg); break;
+        case 'r': options->reload = true; break;
+        default:
+            fprintf(stderr,
+                    "usage: %s [--manager PATH] [--stub PATH] [--duration S] "
+                    "[--telemetry-hz N] [--command-hz N] [--reload]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (options->command_hz == 0 || options->duration_s <= 0.0) {
+        fprintf(stderr, "--command-hz and --duration must be positive\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    options_t options;
+    char port_argument[16];
+    char rtsp_argument[16];
+    char manager_config[256];
+
+    if (parse_options(argc, argv, &options) != 0 || prepare_work_dir(&options) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    snprintf(port_argument, sizeof(port_argument), "%d", STUB_PORT);
+    snprintf(rtsp_argument, sizeof(rtsp_argument), "%d", STUB_RTSP_PORT);
+    work_path(manager_config, sizeof(manager_config), "manager.yaml");
+
+    char *stub_argv[] = {
+        (char *)options.stub, "--rtsp-port", rtsp_argument, "--reload-ms", "50", "--port", port_argument, NULL
+    };
+    char *manager_argv[] = { (char *)options.manager, manager_config, NULL };
+
+    if (options.reload) {
+        stub_argv[5] = NULL;
+    }
+
+    const pid_t stub_pid = spawn(stub_argv, NULL);
+    usleep(100000);
+    const pid_t manager_pid = spawn(manager_argv, "manager.log");
+    int exit_status = EXIT_FAILURE;
+
+    if (!wait_for_heartbeat(5000.0)) {
+        fprintf(stderr, "No heartbeat from the manager; see %s/manager.log\n", work_dir);
+        goto out;
+    }
+
+    // Let the startup apply settle before measuring.
+    usleep(200000);
+    handle_incoming();
+    pending_head = pending_tail = 0;
+
+    const double cpu_start = cpu_time_ms(manager_pid);
+    const double start = now_ms();
+    const double end = start + options.duration_s * 1000.0;
+    const double command_interval = 1000.0 / options.command_hz;
+    double next_command = start;
+    unsigned long telemetry_sent = 0;
+    unsigned long telemetry_dropped = 0;
+    unsigned long commands_sent = 0;
+    int direction = 1;
+
+    for (double now = start; now < end; now = now_ms()) {
+        const unsigned long telemetry_due = (unsigned long)((now - start) * options.telemetry_hz / 1000.0);
+
+        while (telemetry_sent + telemetry_dropped < telemetry_due) {
+            if (send_telemetry((uint32_t)(telemetry_sent + telemetry_dropped))) {
+                ++telemetry_sent;
+            } else {
+                ++telemetry_dropped;
+            }
+        }
+
+        if (now >= next_command) {
+            if (send_zoom_step(direction)) {
+                ++commands_sent;
+                direction = -direction;
+            }
+
+            next_command += command_interval;
+        }
+
+        struct pollfd poll_fd = { .fd = master_fd, .events = POLLIN, .revents = 0 };
+
+        if (poll(&poll_fd, 1, 1) > 0) {
+            handle_incoming();
+        }
+    }
+
+    // Give in-flight applies a moment to be acknowledged.
+    for (double drain_end = now_ms() + 1000.0; pending_head < pending_tail && now_ms() < drain_end;) {
+        struct pollfd poll_fd = { .fd = master_fd, .events = POLLIN, .revents = 0 };
+
+        if (poll(&poll_fd, 1, 10) > 0) {
+            handle_incoming();
+        }
+    }
+
+    const double elapsed_s = (now_ms() - start) / 1000.0;
+    const double cpu_ms = cpu_time_ms(manager_pid) - cpu_start;
+    const unsigned long messages = telemetry_sent + commands_sent;
+
+    printf("telemetry:   %lu frames (%.0f/s), %lu dropped on a full pty\n",
+           telemetry_sent, (double)telemetry_sent / elapsed_s, telemetry_dropped);
+    printf("commands:    %lu sent, %zu acked, %lu failed, %zu unanswered\n",
+           commands_sent, latency_count, acks_failed, pending_tail - pending_head);
+
+    if (latency_count > 0) {
+        qsort(latencies_ms, latency_count, sizeof(latencies_ms[0]), compare_doubles);
+        printf("ack latency: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+               percentile(0.50), percentile(0.90), percentile(0.99), latencies_ms[latency_count - 1]);
+    }
+
+    printf("manager cpu: %.0f ms over %.1f s (%.2f%%), %.2f us/message\n",
+           cpu_ms, elapsed_s, cpu_ms / (elapsed_s * 10.0), messages ? cpu_ms * 1000.0 / (double)messages : 0.0);
+    print_manager_stats();
+    fflush(stdout);
+    exit_status = latency_count > 0 && acks_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+out:
+    kill(manager_pid, SIGTERM);
+    waitpid(manager_pid, NULL, 0);
+    kill(stub_pid, SIGTERM);
+    waitpid(stub_pid, NULL, 0);
+
+    if (exit_status == EXIT_SUCCESS) {
+        remove_work_dir();
+    } else {
+        fprintf(stderr, "Kept %s for inspection.\n", work_dir);
+    }
+
+    return exit_status;
+}
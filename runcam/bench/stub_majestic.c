@@ -0,0 +1,267 @@
+// Stand-in for Majestic on a development machine. It names itself
+// "majestic" so the manager's process lookup finds it, counts SIGHUP
+// reloads (optionally taking --reload-ms to "restart"), and answers
+// /api/v1/set requests on a keep-alive HTTP port like the real web server.
+// With --rtsp-port it also answers RTSP OPTIONS/DESCRIBE, which stalls while
+// a reload is "restarting", for the manager's stream probe.
+//
+//   stub_majestic [--port N] [--rtsp-port N] [--reload-ms N]
+//
+// Without --port no HTTP server runs, which forces the manager onto its
+// SIGHUP reload path.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 8
+
+typedef struct client {
+    int fd;
+    bool rtsp;
+    char buffer[4096];
+    size_t length;
+} client_t;
+
+static client_t clients[MAX_CLIENTS];
+static unsigned long http_requests = 0;
+static unsigned long reloads = 0;
+static unsigned long rtsp_requests = 0;
+
+static const char SDP[] =
+    "v=0\r\no=- 1 1 IN IP4 127.0.0.1\r\ns=Majestic\r\nt=0 0\r\nm=video 0 RTP/AVP 96\r\na=rtpmap:96 H265/90000\r\n";
+
+// OPTIONS gets the method list, anything else the SDP.
+static int format_rtsp_response(const char *request, char *response, size_t size) {
+    const char *cseq = strstr(request, "CSeq: ");
+    const unsigned sequence = cseq ? (unsigned)strtoul(cseq + 6, NULL, 10) : 0;
+
+    ++rtsp_requests;
+
+    if (strncmp(request, "OPTIONS ", 8) == 0) {
+        return snprintf(response, size, "RTSP/1.0 200 OK\r\nCSeq: %u\r\nPublic: OPTIONS, DESCRIBE\r\n\r\n", sequence);
+    }
+
+    return snprintf(response, size,
+                    "RTSP/1.0 200 OK\r\nCSeq: %u\r\nContent-Type: application/sdp\r\nContent-Length: %zu\r\n\r\n%s",
+                    sequence, sizeof(SDP) - 1, SDP);
+}
+
+static int open_listener(int port) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    const int one = 1;
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+    };
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        fprintf(stderr, "stub_majestic: cannot listen on %d: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void drop_client(client_t *client) {
+    close(client->fd);
+    client->fd = -1;
+    client->length = 0;
+}
+
+// Answer every complete request in the buffer; bodies are never sent to us.
+static void serve_client(client_t *client) {
+    const ssize_t n = read(client->fd, client->buffer + client->length, sizeof(client->buffer) - client->length);
+
+    if (n <= 0) {
+        drop_client(client);
+        return;
+    }
+
+    client->length += (size_t)n;
+
+    char *end;
+
+    while ((end = memmem(client->buffer, client->length, "\r\n\r\n", 4)) != NULL) {
+        static const char HTTP_RESPONSE[] =
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\n\r\nOK";
+        const size_t request_length = (size_t)(end - client->buffer) + 4;
+        char response[512];
+        int response_length = (int)sizeof(HTTP_RESPONSE) - 1;
+
+        if (client->rtsp) {
+            *end = '\0';
+            response_length = format_rtsp_response(client->buffer, response, sizeof(response));
+        } else {
+            memcpy(response, HTTP_RESPONSE, sizeof(HTTP_RESPONSE));
+            ++http_requests;
+        }
+
+        if (write(client->fd, response, (size_t)response_length) != (ssize_t)response_length) {
+            drop_client(client);
+            return;
+        }
+
+        memmove(client->buffer, client->buffer + request_length, client->length - request_length);
+        client->length -= request_length;
+    }
+
+    if (client->length == sizeof(client->buffer)) {
+        drop_client(client);
+    }
+}
+
+static void close_rtsp(int *rtsp_fd) {
+    if (*rtsp_fd < 0) {
+        return;
+    }
+
+    close(*rtsp_fd);
+    *rtsp_fd = -1;
+
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients[i].fd >= 0 && clients[i].rtsp) {
+            drop_client(&clients[i]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        { "port", required_argument, NULL, 'p' },
+        { "rtsp-port", required_argument, NULL, 't' },
+        { "reload-ms", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int port = 0;
+    int rtsp_port = 0;
+    int reload_ms = 0;
+    int option;
+
+    while ((option = getopt_long(argc, argv, "p:t:r:", options, NULL)) != -1) {
+        switch (option) {
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 't':
+            rtsp_port = atoi(optarg);
+            break;
+        case 'r':
+            reload_ms = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [--port N] [--rtsp-port N] [--reload-ms N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    prctl(PR_SET_NAME, "majestic", 0, 0, 0);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+
+    const int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    const int listen_fd = port > 0 ? open_listener(port) : -1;
+    int rtsp_fd = rtsp_port > 0 ? open_listener(rtsp_port) : -1;
+
+    if (signal_fd < 0 || (port > 0 && listen_fd < 0) || (rtsp_port > 0 && rtsp_fd < 0)) {
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        clients[i].fd = -1;
+    }
+
+    bool running = true;
+
+    while (running) {
+        struct pollfd fds[3 + MAX_CLIENTS];
+        size_t count = 0;
+
+        fds[count++] = (struct pollfd){ .fd = signal_fd, .events = POLLIN };
+        fds[count++] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        fds[count++] = (struct pollfd){ .fd = rtsp_fd, .events = POLLIN };
+
+        for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+            fds[count++] = (struct pollfd){ .fd = clients[i].fd, .events = POLLIN };
+        }
+
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+
+            if (read(signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+                if (info.ssi_signo == SIGHUP) {
+                    ++reloads;
+
+                    if (reload_ms > 0) {
+                        const struct timespec pause = { reload_ms / 1000, (long)(reload_ms % 1000) * 1000000L };
+
+                        // Like the real restart, the stream is gone meanwhile.
+                        close_rtsp(&rtsp_fd);
+                        nanosleep(&pause, NULL);
+                        rtsp_fd = rtsp_port > 0 ? open_listener(rtsp_port) : -1;
+                    }
+                } else {
+                    running = false;
+                }
+            }
+        }
+
+        for (size_t listener = 1; listener <= 2; ++listener) {
+            if (!(fds[listener].revents & POLLIN)) {
+                continue;
+            }
+
+            const int fd = accept4(fds[listener].fd, NULL, NULL, SOCK_CLOEXEC);
+
+            for (size_t i = 0; fd >= 0 && i <= MAX_CLIENTS; ++i) {
+                if (i == MAX_CLIENTS) {
+                    close(fd);
+                } else if (clients[i].fd < 0) {
+                    clients[i].fd = fd;
+                    clients[i].rtsp = listener == 2;
+                    break;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+            if (clients[i].fd >= 0 && (fds[3 + i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                serve_client(&clients[i]);
+            }
+        }
+    }
+
+    printf("stub_majestic: %lu HTTP requests, %lu RTSP requests, %lu reloads\n", http_requests, rtsp_requests, reloads);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,641 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "camera_protocol.h"
+#include "image_capture.h"
+#include "latency_trace.h"
+#include "majestic_apply.h"
+#include "majestic_config.h"
+#include "matek_mavlink.h"
+
+#define CAMERA_MAX_PENDING_ACKS 8
+
+static const char *const CAMERA_VENDOR = "RunCam";
+static const char *const CAMERA_MODEL = "OpenIPC Majestic";
+static const char *const STREAM_NAME = "video1";
+static const uint8_t STREAM_ID = 1;
+
+// A zoom command waiting for the apply worker before it can be acknowledged.
+typedef struct pending_ack {
+    uint16_t command;
+    uint8_t target_system;
+    uint8_t target_component;
+    uint32_t sequence;
+    bool in_use;
+} pending_ack_t;
+
+// Geometry advertised in CAMERA_INFORMATION / VIDEO_STREAM_INFORMATION.
+typedef struct stream_geometry {
+    uint16_t sensor_width;
+    uint16_t sensor_height;
+    uint16_t stream_width;
+    uint16_t stream_height;
+    float framerate;
+    uint32_t bitrate_bps;
+    uint8_t encoding; // VIDEO_STREAM_ENCODING
+    uint16_t rtsp_port;
+} stream_geometry_t;
+
+static camera_zoom_ops_t zoom;
+static stream_geometry_t geometry;
+static pending_ack_t pending_acks[CAMERA_MAX_PENDING_ACKS];
+static int link_fd = -1;
+
+// Still capture, driven by MAV_CMD_IMAGE_START_CAPTURE/STOP_CAPTURE.
+static bool capture_enabled = false;
+static bool capture_active = false;
+static float capture_interval_s = 0.0f;
+static uint32_t capture_remaining = 0; // shots left in the sequence, 0 without a limit
+static int32_t images_captured = 0;
+static uint32_t last_single_capture = 0; // sequence number of the last single shot
+
+static uint32_t boot_time_ms(void) {
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        return 0;
+    }
+
+    return (uint32_t)((uint64_t)now.tv_sec * 1000ULL + (uint64_t)now.tv_nsec / 1000000ULL);
+}
+
+static void read_size(const char *config_path, const char *key, uint16_t *width, uint16_t *height) {
+    char value[32];
+    unsigned parsed_width = 0;
+    unsigned parsed_height = 0;
+
+    if (majestic_config_get(config_path, key, value, sizeof(value)) == 0 &&
+        sscanf(value, "%ux%u", &parsed_width, &parsed_height) == 2 &&
+        parsed_width <= UINT16_MAX && parsed_height <= UINT16_MAX) {
+        *width = (uint16_t)parsed_width;
+        *height = (uint16_t)parsed_height;
+    }
+}
+
+static unsigned long read_number(const char *config_path, const char *key, unsigned long fallback) {
+    char value[32];
+
+    if (majestic_config_get(config_path, key, value, sizeof(value)) != 0) {
+        return fallback;
+    }
+
+    char *end = NULL;
+    const unsigned long parsed = strtoul(value, &end, 10);
+    return end && *end == '\0' ? parsed : fallback;
+}
+
+static uint8_t stream_encoding(const char *codec) {
+    if (strcasecmp(codec, "h264") == 0 || strcasecmp(codec, "avc") == 0) {
+        return VIDEO_STREAM_ENCODING_H264;
+    }
+
+    if (strcasecmp(codec, "h265") == 0 || strcasecmp(codec, "hevc") == 0) {
+        return VIDEO_STREAM_ENCODING_H265;
+    }
+
+    return VIDEO_STREAM_ENCODING_UNKNOWN;
+}
+
+static void update_stream(const majestic_stream_settings_t *stream) {
+    geometry.stream_width = stream->width;
+    geometry.stream_height = stream->height;
+    geometry.framerate = (float)stream->fps;
+    geometry.bitrate_bps = stream->bitrate_kbps * 1000U;
+    geometry.encoding = stream_encoding(stream->codec);
+}
+
+static void load_geometry(const char *config_path) {
+    majestic_stream_settings_t stream;
+
+    geometry.sensor_width = 0;
+    geometry.sensor_height = 0;
+
+    read_size(config_path, "video0.size", &geometry.sensor_width, &geometry.sensor_height);
+    majestic_apply_read_stream(config_path, &stream);
+    update_stream(&stream);
+    geometry.rtsp_port = (uint16_t)read_number(config_path, "rtsp.port", 554);
+}
+
+static void send_packed(const mavlink_message_t *message) {
+    if (link_fd >= 0) {
+        (void)matek_send_message(link_fd, message);
+    }
+}
+
+static void send_ack(uint16_t command, uint8_t result, uint8_t target_system, uint8_t target_component) {
+    mavlink_message_t message;
+
+    mavlink_msg_command_ack_pack(
+        matek_system_id(),
+        matek_component_id(),
+        &message,
+        command,
+        result,
+        0,
+        0,
+        target_system,
+        target_component);
+    send_packed(&message);
+}
+
+static void send_camera_information(void) {
+    uint8_t vendor[32] = { 0 };
+    uint8_t model[32] = { 0 };
+    mavlink_message_t message;
+
+    memcpy(vendor, CAMERA_VENDOR, strlen(CAMERA_VENDOR));
+    memcpy(model, CAMERA_MODEL, strlen(CAMERA_MODEL));
+
+    mavlink_msg_camera_information_pack(
+        matek_system_id(),
+        matek_component_id(),
+        &message,
+        boot_time_ms(),
+        vendor,
+        model,
+        0,
+        NAN,
+        NAN,
+        NAN,
+        geometry.sensor_width,
+        geometry.sensor_height,
+        0,
+        CAMERA_CAP_FLAGS_HAS_VIDEO_STREAM | CAMERA_CAP_FLAGS_HAS_BASIC_ZOOM |
+            (capture_enabled ? CAMERA_CAP_FLAGS_CAPTURE_IMAGE | CAMERA_CAP_FLAGS_CAN_CAPTURE_IMAGE_IN_VIDEO_MODE : 0),
+        0,
+        "",
+        0,
+        0);
+    send_packed(&message);
+}
+
+// The RTSP URI needs an address ground stations can reach; use the first
+// non-loopback IPv4 address of the camera.
+static void build_stream_uri(char *uri, size_t uri_size) {
+    char address[INET_ADDRSTRLEN] = "0.0.0.0";
+    struct ifaddrs *interfaces = NULL;
+
+    if (getifaddrs(&interfaces) == 0) {
+        for (const struct ifaddrs *entry = interfaces; entry; entry = entry->ifa_next) {
+            if (!entry->ifa_addr || entry->ifa_addr->sa_family != AF_INET) {
+                continue;
+            }
+
+            const struct sockaddr_in *ipv4 = (const struct sockaddr_in *)entry->ifa_addr;
+
+            if (ntohl(ipv4->sin_addr.s_addr) >> 24 == 127) {
+                continue;
+            }
+
+            inet_ntop(AF_INET, &ipv4->sin_addr, address, sizeof(address));
+            break;
+        }
+
+        freeifaddrs(interfaces);
+    }
+
+    snprintf(uri, uri_size, "rtsp://%s:%u/stream=1", address, geometry.rtsp_port);
+}
+
+static void send_video_stream_information(void) {
+    char uri[160];
+    mavlink_message_t message;
+
+    build_stream_uri(uri, sizeof(uri));
+
+    mavlink_msg_video_stream_information_pack(
+        matek_system_id(),
+        matek_component_id(),
+        &message,
+        STREAM_ID,
+        1,
+        VIDEO_STREAM_TYPE_RTSP,
+        VIDEO_STREAM_STATUS_FLAGS_RUNNING,
+        geometry.framerate,
+        geometry.stream_width,
+        geometry.stream_height,
+        geometry.bitrate_bps,
+        0,
+        0,
+        STREAM_NAME,
+        uri,
+        geometry.encoding,
+        0);
+    send_packed(&message);
+}
+
+static void send_camera_settings(void) {
+    mavlink_message_t message;
+
+    mavlink_msg_camera_settings_pack(
+        matek_system_id(),
+        matek_component_id(),
+        &message,
+        boot_time_ms(),
+        CAMERA_MODE_VIDEO,
+        zoom.level ? zoom.level(zoom.context) : NAN,
+        NAN,
+        0);
+    send_packed(&message);
+}
+
+static void send_camera_capture_status(void) {
+    mavlink_message_t message;
+    const uint8_t image_status = !capture_active ? 0 : capture_interval_s > 0.0f ? 3 : 1;
+
+    mavlink_msg_camera_capture_status_pack(
+        matek_system_id(),
+        matek_component_id(),
+        &message,
+        boot_time_ms(),
+        image_status,
+        0,
+        capture_active ? capture_interval_s : 0.0f,
+        0,
+        NAN,
+        images_captured,
+        0);
+    send_packed(&message);
+}
+
+static bool has_free_ack_slot(void) {
+    for (size_t i = 0; i < CAMERA_MAX_PENDING_ACKS; ++i) {
+        if (!pending_acks[i].in_use) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool remember_pending_ack(uint16_t command, uint8_t target_system, uint8_t target_component, uint32_t sequence) {
+    for (size_t i = 0; i < CAMERA_MAX_PENDING_ACKS; ++i) {
+        if (!pending_acks[i].in_use) {
+            pending_acks[i].command = command;
+            pending_acks[i].target_system = target_system;
+            pending_acks[i].target_component = target_component;
+            pending_acks[i].sequence = sequence;
+            pending_acks[i].in_use = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Answer MAV_CMD_REQUEST_MESSAGE and its legacy per-message equivalents.
+static uint8_t handle_message_request(uint32_t msgid) {
+    switch (msgid) {
+    case MAVLINK_MSG_ID_CAMERA_INFORMATION:
+    case MAVLINK_MSG_ID_VIDEO_STREAM_INFORMATION:
+    case MAVLINK_MSG_ID_CAMERA_SETTINGS:
+        return MAV_RESULT_ACCEPTED;
+    case MAVLINK_MSG_ID_CAMERA_CAPTURE_STATUS:
+        return capture_enabled ? MAV_RESULT_ACCEPTED : MAV_RESULT_DENIED;
+    default:
+        return MAV_RESULT_DENIED;
+    }
+}
+
+static void send_requested_message(uint32_t msgid) {
+    switch (msgid) {
+    case MAVLINK_MSG_ID_CAMERA_INFORMATION:
+        send_camera_information();
+        break;
+    case MAVLINK_MSG_ID_VIDEO_STREAM_INFORMATION:
+        send_video_stream_information();
+        break;
+    case MAVLINK_MSG_ID_CAMERA_SETTINGS:
+        send_camera_settings();
+        break;
+    case MAVLINK_MSG_ID_CAMERA_CAPTURE_STATUS:
+        send_camera_capture_status();
+        break;
+    default:
+        break;
+    }
+}
+
+static void handle_set_zoom(uint16_t command, float zoom_type, float value, uint8_t sender_system, uint8_t sender_component) {
+    const uint64_t decoded_ns = latency_trace_now();
+    uint32_t sequence = 0;
+    int queued = -1;
+
+    if (!isfinite(zoom_type) || !isfinite(value)) {
+        send_ack(command, MAV_RESULT_DENIED, sender_system, sender_component);
+        return;
+    }
+
+    const int type = (int)zoom_type;
+
+    if (type != ZOOM_TYPE_STEP && type != ZOOM_TYPE_CONTINUOUS && type != ZOOM_TYPE_RANGE) {
+        send_ack(command, MAV_RESULT_UNSUPPORTED, sender_system, sender_component);
+        return;
+    }
+
+    // Without a slot the final ack could not be sent, so refuse before
+    // queuing anything; the sender retries.
+    if (!has_free_ack_slot()) {
+        send_ack(command, MAV_RESULT_TEMPORARILY_REJECTED, sender_system, sender_component);
+        return;
+    }
+
+    switch (type) {
+    case ZOOM_TYPE_STEP:
+    case ZOOM_TYPE_CONTINUOUS:
+        // Continuous zoom has no motor to drive here; treat its direction
+        // as a single step and a stop (0) as a no-op.
+        queued = value > 0.0f ? zoom.step(1, &sequence, zoom.context)
+               : value < 0.0f ? zoom.step(-1, &sequence, zoom.context)
+               : 0;
+        break;
+    case ZOOM_TYPE_RANGE:
+        queued = value >= 0.0f && value <= 100.0f ? zoom.set_range(value, &sequence, zoom.context) : -1;
+        break;
+    }
+
+    if (queued == CAMERA_ZOOM_BUSY) {
+        send_ack(command, MAV_RESULT_TEMPORARILY_REJECTED, sender_system, sender_component);
+        return;
+    }
+
+    if (queued < 0) {
+        send_ack(command, MAV_RESULT_DENIED, sender_system, sender_component);
+        return;
+    }
+
+    // A zoom that needed no change is done already.
+    if (queued == 0) {
+        send_ack(command, MAV_RESULT_ACCEPTED, sender_system, sender_component);
+        send_camera_settings();
+        return;
+    }
+
+    // Nothing else touches the slots in between, so the free one is still there.
+    (void)remember_pending_ack(command, sender_system, sender_component, sequence);
+    latency_trace_command(sequence, matek_receive_time_ns(), decoded_ns);
+}
+
+// param2 is the interval in seconds, param3 the number of shots (0 until
+// stopped) and param4 the sequence number of a single shot, which makes a
+// retransmitted command harmless.
+static uint8_t handle_start_capture(const float params[7]) {
+    const float interval_s = params[1];
+    const float count = params[2];
+    const float sequence = params[3];
+
+    if (!capture_enabled) {
+        return MAV_RESULT_UNSUPPORTED;
+    }
+
+    if (!isfinite(interval_s) || !isfinite(count) || interval_s < 0.0f || interval_s > 3600.0f ||
+        count < 0.0f || count > 100000.0f) {
+        return MAV_RESULT_DENIED;
+    }
+
+    const uint32_t shots = (uint32_t)count;
+
+    if (shots == 1 && isfinite(sequence) && sequence >= 1.0f) {
+        if ((uint32_t)sequence == last_single_capture) {
+            return MAV_RESULT_ACCEPTED;
+        }
+
+        last_single_capture = (uint32_t)sequence;
+    }
+
+    if (image_capture_request((uint32_t)lroundf(interval_s * 1000.0f), shots) != 0) {
+        return MAV_RESULT_TEMPORARILY_REJECTED;
+    }
+
+    capture_active = true;
+    capture_interval_s = interval_s;
+    capture_remaining = shots;
+    return MAV_RESULT_ACCEPTED;
+}
+
+static uint8_t handle_stop_capture(void) {
+    if (!capture_enabled) {
+        return MAV_RESULT_UNSUPPORTED;
+    }
+
+    if (image_capture_cancel() != 0) {
+        return MAV_RESULT_TEMPORARILY_REJECTED;
+    }
+
+    capture_active = false;
+    return MAV_RESULT_ACCEPTED;
+}
+
+static void handle_command(
+    uint16_t command,
+    const float params[7],
+    uint8_t target_system,
+    uint8_t target_component,
+    uint8_t sender_system,
+    uint8_t sender_component) {
+
+    if ((target_system != 0 && target_system != matek_system_id()) ||
+        (target_component != MAV_COMP_ID_ALL && target_component != matek_component_id())) {
+        return;
+    }
+
+    uint32_t requested = 0;
+
+    switch (command) {
+    case MAV_CMD_SET_CAMERA_ZOOM:
+        handle_set_zoom(command, params[0], params[1], sender_system, sender_component);
+        return;
+    case MAV_CMD_REQUEST_MESSAGE:
+        requested = params[0] >= 0.0f ? (uint32_t)params[0] : 0;
+        break;
+    case MAV_CMD_REQUEST_CAMERA_INFORMATION:
+        requested = MAVLINK_MSG_ID_CAMERA_INFORMATION;
+        break;
+    case MAV_CMD_REQUEST_CAMERA_SETTINGS:
+        requested = MAVLINK_MSG_ID_CAMERA_SETTINGS;
+        break;
+    case MAV_CMD_REQUEST_VIDEO_STREAM_INFORMATION:
+        requested = MAVLINK_MSG_ID_VIDEO_STREAM_INFORMATION;
+        break;
+    case MAV_CMD_REQUEST_CAMERA_CAPTURE_STATUS:
+        requested = MAVLINK_MSG_ID_CAMERA_CAPTURE_STATUS;
+        break;
+    case MAV_CMD_IMAGE_START_CAPTURE:
+        send_ack(command, handle_start_capture(params), sender_system, sender_component);
+        return;
+    case MAV_CMD_IMAGE_STOP_CAPTURE:
+        send_ack(command, handle_stop_capture(), sender_system, sender_component);
+        return;
+    default:
+        // A broadcast command is most likely meant for the autopilot, whose
+        // ack a GCS could mistake ours for; only answer what was sent to us.
+        if (target_component == matek_component_id()) {
+            send_ack(command, MAV_RESULT_UNSUPPORTED, sender_system, sender_component);
+        }
+        return;
+    }
+
+    // The ack goes out first, as the camera protocol expects.
+    const uint8_t result = handle_message_request(requested);
+    send_ack(command, result, sender_system, sender_component);
+
+    if (result == MAV_RESULT_ACCEPTED) {
+        send_requested_message(requested);
+    }
+}
+
+static void handle_command_long(const mavlink_message_t *message, void *context) {
+    mavlink_command_long_t decoded;
+    (void)context;
+
+    mavlink_msg_command_long_decode(message, &decoded);
+
+    const float params[7] = {
+        decoded.param1, decoded.param2, decoded.param3, decoded.param4,
+        decoded.param5, decoded.param6, decoded.param7
+    };
+
+    handle_command(decoded.command, params, decoded.target_system, decoded.target_component, message->sysid, message->compid);
+}
+
+static void handle_command_int(const mavlink_message_t *message, void *context) {
+    mavlink_command_int_t decoded;
+    (void)context;
+
+    mavlink_msg_command_int_decode(message, &decoded);
+
+    const float params[7] = {
+        decoded.param1, decoded.param2, decoded.param3, decoded.param4,
+        (float)decoded.x, (float)decoded.y, decoded.z
+    };
+
+    handle_command(decoded.command, params, decoded.target_system, decoded.target_component, message->sysid, message->compid);
+}
+
+int camera_protocol_init(const char *config_path, const camera_zoom_ops_t *zoom_ops) {
+    zoom = *zoom_ops;
+    memset(pending_acks, 0, sizeof(pending_acks));
+    load_geometry(config_path);
+
+    if (matek_register_handler(MAVLINK_MSG_ID_COMMAND_LONG, handle_command_long, NULL) != 0 ||
+        matek_register_handler(MAVLINK_MSG_ID_COMMAND_INT, handle_command_int, NULL) != 0) {
+        fprintf(stderr, "Unable to register camera protocol handlers.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// The receive loop keeps the latest vehicle state for the next shot.
+static void handle_global_position(const mavlink_message_t *message, void *context) {
+    mavlink_global_position_int_t position;
+    (void)context;
+
+    mavlink_msg_global_position_int_decode(message, &position);
+    image_capture_set_position(position.lat, position.lon, position.alt, position.relative_alt);
+}
+
+static void handle_attitude(const mavlink_message_t *message, void *context) {
+    mavlink_attitude_t attitude;
+    (void)context;
+
+    mavlink_msg_attitude_decode(message, &attitude);
+    image_capture_set_attitude(attitude.roll, attitude.pitch, attitude.yaw);
+}
+
+static void handle_system_time(const mavlink_message_t *message, void *context) {
+    mavlink_system_time_t system_time;
+    (void)context;
+
+    mavlink_msg_system_time_decode(message, &system_time);
+
+    // Autopilots send 0 until they have a GPS fix.
+    if (system_time.time_unix_usec != 0) {
+        image_capture_set_time(system_time.time_unix_usec, matek_receive_time_ns());
+    }
+}
+
+int camera_protocol_enable_capture(void) {
+    if (matek_register_handler(MAVLINK_MSG_ID_GLOBAL_POSITION_INT, handle_global_position, NULL) != 0 ||
+        matek_register_handler(MAVLINK_MSG_ID_ATTITUDE, handle_attitude, NULL) != 0 ||
+        matek_register_handler(MAVLINK_MSG_ID_SYSTEM_TIME, handle_system_time, NULL) != 0) {
+        fprintf(stderr, "Unable to register geotag handlers.\n");
+        return -1;
+    }
+
+    capture_enabled = true;
+    return 0;
+}
+
+void camera_protocol_set_link(int fd) {
+    link_fd = fd;
+}
+
+void camera_protocol_complete(uint32_t last_sequence, int status, const majestic_stream_settings_t *stream) {
+    bool acknowledged = false;
+
+    if (stream) {
+        update_stream(stream);
+    }
+
+    for (size_t i = 0; i < CAMERA_MAX_PENDING_ACKS; ++i) {
+        pending_ack_t *pending = &pending_acks[i];
+
+        if (!pending->in_use || pending->sequence > last_sequence) {
+            continue;
+        }
+
+        send_ack(pending->command, status == 0 ? MAV_RESULT_ACCEPTED : MAV_RESULT_FAILED,
+                 pending->target_system, pending->target_component);
+        pending->in_use = false;
+        acknowledged = true;
+    }
+
+    if (acknowledged && status == 0) {
+        send_camera_settings();
+    }
+}
+
+void camera_protocol_image_captured(const image_capture_result_t *result) {
+    const image_geotag_t *geotag = &result->geotag;
+    float q[4] = { NAN, NAN, NAN, NAN };
+    mavlink_message_t message;
+
+    if (geotag->has_attitude) {
+        mavlink_euler_to_quaternion(geotag->roll, geotag->pitch, geotag->yaw, q);
+    }
+
+    mavlink_msg_camera_image_captured_pack(
+        matek_system_id(),
+        matek_component_id(),
+        &message,
+        (uint32_t)(result->requested_ns / 1000000ULL),
+        geotag->time_utc_us,
+        0,
+        geotag->lat,
+        geotag->lon,
+        geotag->alt_mm,
+        geotag->relative_alt_mm,
+        q,
+        result->index,
+        result->status == 0 ? 1 : 0,
+        result->file);
+    send_packed(&message);
+
+    if (result->status == 0) {
+        ++images_captured;
+    }
+
+    if (capture_active && capture_remaining > 0 && --capture_remaining == 0) {
+        capture_active = false;
+    }
+}
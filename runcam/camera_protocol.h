@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "image_capture.h"
+#include "majestic_apply.h"
+
+/** Returned by a zoom request the apply backlog has no room for right now. */
+#define CAMERA_ZOOM_BUSY (-2)
+
+/**
+ * Zoom hooks the camera protocol drives. Request functions return 1 when a
+ * change was queued (with its apply sequence in `*sequence`), 0 when the
+ * camera is already at the requested zoom, -1 if the request is invalid and
+ * CAMERA_ZOOM_BUSY if it could not be queued yet.
+ */
+typedef struct camera_zoom_ops {
+    int (*step)(int direction, uint32_t *sequence, void *context);
+    int (*set_range)(float percent, uint32_t *sequence, void *context);
+    // Current zoom as a percentage of the full range (0..100).
+    float (*level)(void *context);
+    void *context;
+} camera_zoom_ops_t;
+
+/**
+ * Register COMMAND_LONG/COMMAND_INT handlers and read the stream geometry from
+ * the Majestic config. Call before the apply worker starts, since it reads
+ * the config on the calling thread.
+ *
+ * @return 0 on success, -1 if the handlers could not be registered.
+ */
+int camera_protocol_init(const char *config_path, const camera_zoom_ops_t *zoom_ops);
+
+/**
+ * Answer MAV_CMD_IMAGE_START_CAPTURE/STOP_CAPTURE through image_capture and
+ * cache GLOBAL_POSITION_INT, ATTITUDE and SYSTEM_TIME for the geotags. Call
+ * once image_capture_start() succeeded.
+ *
+ * @return 0 on success, -1 if the handlers could not be registered.
+ */
+int camera_protocol_enable_capture(void);
+
+/**
+ * Set the link replies go out on (-1 while disconnected).
+ */
+void camera_protocol_set_link(int fd);
+
+/**
+ * Acknowledge every pending zoom command whose apply sequence is covered by
+ * a finished worker batch, and report the new zoom with CAMERA_SETTINGS.
+ *
+ * @param stream Optional; the video1 settings after the batch, advertised
+ *               from now on in VIDEO_STREAM_INFORMATION.
+ */
+void camera_protocol_complete(uint32_t last_sequence, int status, const majestic_stream_settings_t *stream);
+
+/**
+ * Report a finished shot with CAMERA_IMAGE_CAPTURED.
+ */
+void camera_protocol_image_captured(const image_capture_result_t *result);
@@ -0,0 +1,152 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "command_registry.h"
+
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *c = (const unsigned char *)name; *c; ++c) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static void add_builtin(command_registry_t *registry, const char *name, command_kind_t kind, size_t min_args) {
+    command_t command;
+
+    memset(&command, 0, sizeof(command));
+    snprintf(command.name, sizeof(command.name), "%s", name);
+    command.kind = kind;
+    command.min_args = min_args;
+    (void)command_registry_add(registry, &command);
+}
+
+void command_registry_init(command_registry_t *registry) {
+    memset(registry, 0, sizeof(*registry));
+    add_builtin(registry, "zoom_in", COMMAND_ZOOM_IN, 0);
+    add_builtin(registry, "zoom_out", COMMAND_ZOOM_OUT, 0);
+    add_builtin(registry, "zoom", COMMAND_ZOOM, 1);
+    add_builtin(registry, "set", COMMAND_SET, 2);
+}
+
+// Argument number of a "$1".."$4" reference, or 0 for a literal value.
+static size_t argument_reference(const char *value) {
+    if (value[0] == '$' && value[1] >= '1' && value[1] <= '0' + COMMAND_MAX_ARGS && value[2] == '\0') {
+        return (size_t)(value[1] - '0');
+    }
+
+    return 0;
+}
+
+int command_registry_add(command_registry_t *registry, const command_t *command) {
+    if (command->name[0] == '\0' || strpbrk(command->name, " \t\r\n")) {
+        fprintf(stderr, "Ignoring command with an invalid name \"%s\".\n", command->name);
+        return -1;
+    }
+
+    if (command_registry_find(registry, command->name)) {
+        fprintf(stderr, "Ignoring duplicate command %s.\n", command->name);
+        return -1;
+    }
+
+    if (registry->count >= COMMAND_REGISTRY_MAX_COMMANDS) {
+        fprintf(stderr, "Ignoring command %s: at most %d commands.\n", command->name, COMMAND_REGISTRY_MAX_COMMANDS);
+        return -1;
+    }
+
+    command_t *const added = &registry->commands[registry->count];
+    *added = *command;
+
+    for (size_t i = 0; i < added->change_count; ++i) {
+        const size_t reference = argument_reference(added->changes[i].value);
+
+        if (reference > added->min_args) {
+            added->min_args = reference;
+        }
+    }
+
+    uint32_t slot = hash_name(added->name) & (COMMAND_REGISTRY_SLOTS - 1);
+
+    while (registry->slots[slot] != 0) {
+        slot = (slot + 1) & (COMMAND_REGISTRY_SLOTS - 1);
+    }
+
+    registry->slots[slot] = (uint8_t)(registry->count + 1);
+    ++registry->count;
+    return 0;
+}
+
+const command_t *command_registry_find(const command_registry_t *registry, const char *name) {
+    uint32_t slot = hash_name(name) & (COMMAND_REGISTRY_SLOTS - 1);
+
+    while (registry->slots[slot] != 0) {
+        const command_t *command = &registry->commands[registry->slots[slot] - 1];
+
+        if (strcmp(command->name, name) == 0) {
+            return command;
+        }
+
+        slot = (slot + 1) & (COMMAND_REGISTRY_SLOTS - 1);
+    }
+
+    return NULL;
+}
+
+int command_parse(const char *text, command_call_t *call) {
+    size_t words = 0;
+    char *cursor = call->text;
+
+    snprintf(call->text, sizeof(call->text), "%s", text);
+    call->name = NULL;
+    call->arg_count = 0;
+
+    while (*cursor) {
+        while (isspace((unsigned char)*cursor)) {
+            *cursor++ = '\0';
+        }
+
+        if (*cursor == '\0') {
+            break;
+        }
+
+        if (words == 0) {
+            call->name = cursor;
+        } else if (words <= COMMAND_MAX_ARGS) {
+            call->args[call->arg_count++] = cursor;
+        } else {
+            return -1;
+        }
+
+        ++words;
+
+        while (*cursor && !isspace((unsigned char)*cursor)) {
+            ++cursor;
+        }
+    }
+
+    return call->name ? 0 : -1;
+}
+
+int command_stage_changes(const command_t *command, const command_call_t *call, majestic_config_txn_t *txn) {
+    if (call->arg_count < command->min_args) {
+        fprintf(stderr, "Command %s needs %zu argument(s).\n", command->name, command->min_args);
+        return -1;
+    }
+
+    for (size_t i = 0; i < command->change_count; ++i) {
+        const majestic_config_change_t *change = &command->changes[i];
+        const size_t reference = argument_reference(change->value);
+        const char *value = reference ? call->args[reference - 1] : change->value;
+
+        if (majestic_config_set(txn, change->key, value) != 0) {
+            fprintf(stderr, "Command %s: cannot stage %s=%s.\n", command->name, change->key, value);
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "majestic_config.h"
+
+#define COMMAND_REGISTRY_MAX_COMMANDS 32
+#define COMMAND_REGISTRY_SLOTS 64 // hash slots, a power of two above twice the commands
+#define COMMAND_NAME_MAX_LEN 32
+#define COMMAND_MAX_CHANGES 8
+#define COMMAND_MAX_ARGS 4
+#define COMMAND_TEXT_MAX_LEN 256
+
+typedef enum command_kind {
+    COMMAND_CHANGES,  // stage the command's key/value list
+    COMMAND_ZOOM_IN,  // one zoom step in
+    COMMAND_ZOOM_OUT, // one zoom step out
+    COMMAND_ZOOM,     // "zoom <factor>"
+    COMMAND_SET       // "set <key> <value>"
+} command_kind_t;
+
+/**
+ * One named command. For COMMAND_CHANGES every value may be a literal or an
+ * argument reference "$1".."$4" filled in from the command text.
+ */
+typedef struct command {
+    char name[COMMAND_NAME_MAX_LEN];
+    command_kind_t kind;
+    majestic_config_change_t changes[COMMAND_MAX_CHANGES];
+    size_t change_count;
+    size_t min_args; // arguments the command needs
+} command_t;
+
+/**
+ * Command table with a precomputed open-addressing hash index (FNV-1a,
+ * linear probing), so a lookup is one hash and usually one compare.
+ */
+typedef struct command_registry {
+    command_t commands[COMMAND_REGISTRY_MAX_COMMANDS];
+    size_t count;
+    uint8_t slots[COMMAND_REGISTRY_SLOTS]; // command index + 1, 0 when empty
+} command_registry_t;
+
+/**
+ * A command line split into words: "set video1.bitrate 800" has the name
+ * "set" and the arguments "video1.bitrate" and "800".
+ */
+typedef struct command_call {
+    char text[COMMAND_TEXT_MAX_LEN]; // words, NUL-separated
+    const char *name;
+    const char *args[COMMAND_MAX_ARGS];
+    size_t arg_count;
+} command_call_t;
+
+/**
+ * Empty the registry and add the built-in commands: zoom_in, zoom_out,
+ * zoom <factor> and set <key> <value>.
+ */
+void command_registry_init(command_registry_t *registry);
+
+/**
+ * Add a command. Names are unique, so a command cannot replace a built-in.
+ *
+ * @return 0 on success, -1 if the name is taken or invalid or the table is
+ *         full (details logged to stderr).
+ */
+int command_registry_add(command_registry_t *registry, const command_t *command);
+
+/**
+ * @return the command called `name`, or NULL.
+ */
+const command_t *command_registry_find(const command_registry_t *registry, const char *name);
+
+/**
+ * Split `text` at whitespace into a command name and up to
+ * COMMAND_MAX_ARGS arguments.
+ *
+ * @return 0 on success, -1 for blank text or too many words.
+ */
+int command_parse(const char *text, command_call_t *call);
+
+/**
+ * Stage the changes of a COMMAND_CHANGES command, substituting argument
+ * references from `call`.
+ *
+ * @return 0 on success, -1 if an argument is missing or the batch is full.
+ */
+int command_stage_changes(const command_t *command, const command_call_t *call, majestic_config_txn_t *txn);
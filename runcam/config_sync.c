@@ -0,0 +1,258 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config_sync.h"
+
+#define COPY_CHUNK_SIZE 4096
+#define RETRY_DELAY_NS 1000000000ULL
+
+// Read up to `size` bytes, stopping early only at end of file.
+static ssize_t read_full(int fd, char *buffer, size_t size) {
+    size_t total = 0;
+
+    while (total < size) {
+        const ssize_t bytes = read(fd, buffer + total, size - total);
+
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes < 0) {
+            return -1;
+        }
+
+        if (bytes == 0) {
+            break;
+        }
+
+        total += (size_t)bytes;
+    }
+
+    return (ssize_t)total;
+}
+
+static bool write_full(int fd, const char *buffer, size_t length) {
+    size_t written = 0;
+
+    while (written < length) {
+        const ssize_t bytes = write(fd, buffer + written, length - written);
+
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes <= 0) {
+            return false;
+        }
+
+        written += (size_t)bytes;
+    }
+
+    return true;
+}
+
+// True when both files exist and hold the same bytes.
+static bool same_contents(const char *a_path, const char *b_path) {
+    char a[COPY_CHUNK_SIZE];
+    char b[COPY_CHUNK_SIZE];
+    const int a_fd = open(a_path, O_RDONLY | O_CLOEXEC);
+    const int b_fd = a_fd >= 0 ? open(b_path, O_RDONLY | O_CLOEXEC) : -1;
+    bool same = b_fd >= 0;
+
+    while (same) {
+        const ssize_t a_length = read_full(a_fd, a, sizeof(a));
+        const ssize_t b_length = read_full(b_fd, b, sizeof(b));
+
+        if (a_length < 0 || a_length != b_length || memcmp(a, b, (size_t)a_length) != 0) {
+            same = false;
+        } else if (a_length == 0) {
+            break;
+        }
+    }
+
+    if (a_fd >= 0) {
+        close(a_fd);
+    }
+
+    if (b_fd >= 0) {
+        close(b_fd);
+    }
+
+    return same;
+}
+
+// fsync(2) the directory holding `path` so a rename inside it is durable.
+static bool sync_parent_directory(const char *path) {
+    char directory[CONFIG_SYNC_PATH_MAX];
+    const char *slash = strrchr(path, '/');
+
+    if (!slash) {
+        snprintf(directory, sizeof(directory), ".");
+    } else if (slash == path) {
+        snprintf(directory, sizeof(directory), "/");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - path), path);
+    }
+
+    const int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+int config_sync_copy(const char *source, const char *target, bool durable) {
+    char temp[CONFIG_SYNC_PATH_MAX + 8];
+    char buffer[COPY_CHUNK_SIZE];
+    struct stat info;
+    const int in_fd = open(source, O_RDONLY | O_CLOEXEC);
+
+    if (in_fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", source, strerror(errno));
+        return -1;
+    }
+
+    snprintf(temp, sizeof(temp), "%s.tmp", target);
+
+    const mode_t mode = fstat(in_fd, &info) == 0 ? (info.st_mode & 07777) : 0644;
+    const int out_fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+
+    if (out_fd < 0) {
+        fprintf(stderr, "Failed to open %s for writing: %s\n", temp, strerror(errno));
+        close(in_fd);
+        return -1;
+    }
+
+    bool ok = true;
+
+    while (ok) {
+        const ssize_t length = read_full(in_fd, buffer, sizeof(buffer));
+
+        if (length <= 0) {
+            ok = length == 0;
+            break;
+        }
+
+        ok = write_full(out_fd, buffer, (size_t)length);
+    }
+
+    if (ok && durable) {
+        ok = fsync(out_fd) == 0;
+    }
+
+    if (close(out_fd) != 0) {
+        ok = false;
+    }
+
+    close(in_fd);
+
+    if (!ok || rename(temp, target) != 0) {
+        fprintf(stderr, "Failed to copy %s to %s: %s\n", source, target, strerror(errno));
+        unlink(temp);
+        return -1;
+    }
+
+    if (durable && !sync_parent_directory(target)) {
+        fprintf(stderr, "Failed to sync the directory of %s: %s\n", target, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int sync_in_place(const char *path) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+
+    if (!ok || !sync_parent_directory(path)) {
+        fprintf(stderr, "Failed to sync %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int config_sync_init(config_sync_t *sync, const char *working_path, const char *flash_path, uint32_t quiet_ms) {
+    memset(sync, 0, sizeof(*sync));
+    sync->quiet_ns = (uint64_t)quiet_ms * 1000000ULL;
+
+    if (snprintf(sync->working_path, sizeof(sync->working_path), "%s", working_path) >= (int)sizeof(sync->working_path) ||
+        snprintf(sync->flash_path, sizeof(sync->flash_path), "%s", flash_path) >= (int)sizeof(sync->flash_path)) {
+        fprintf(stderr, "Config path too long: %s / %s\n", working_path, flash_path);
+        return -1;
+    }
+
+    // Nothing to seed from yet: the first sync creates the flash copy.
+    if (sync->flash_path[0] == '\0' || access(sync->working_path, F_OK) == 0 ||
+        access(sync->flash_path, F_OK) != 0) {
+        return 0;
+    }
+
+    fprintf(stderr, "Seeding %s from %s.\n", sync->working_path, sync->flash_path);
+    return config_sync_copy(sync->flash_path, sync->working_path, false);
+}
+
+void config_sync_note_change(config_sync_t *sync, uint64_t now_ns) {
+    sync->dirty = true;
+    sync->last_change_ns = now_ns;
+    ++sync->stats.changes;
+}
+
+int config_sync_timeout_ms(const config_sync_t *sync, uint64_t now_ns) {
+    if (!sync->dirty) {
+        return -1;
+    }
+
+    const uint64_t due_ns = sync->last_change_ns + sync->quiet_ns;
+
+    if (now_ns >= due_ns) {
+        return 0;
+    }
+
+    // Round up so the wait never ends just short of the deadline.
+    return (int)((due_ns - now_ns + 999999ULL) / 1000000ULL);
+}
+
+// Keep a failed sync pending, but push it out so a broken flash does not turn
+// into a busy retry loop.
+static int retry_later(config_sync_t *sync) {
+    sync->last_change_ns += sync->quiet_ns > RETRY_DELAY_NS ? sync->quiet_ns : RETRY_DELAY_NS;
+    return -1;
+}
+
+int config_sync_flush(config_sync_t *sync) {
+    if (!sync->dirty) {
+        return 0;
+    }
+
+    if (sync->flash_path[0] == '\0') {
+        if (sync_in_place(sync->working_path) != 0) {
+            return retry_later(sync);
+        }
+    } else if (same_contents(sync->working_path, sync->flash_path)) {
+        ++sync->stats.unchanged;
+        sync->dirty = false;
+        return 0;
+    } else if (config_sync_copy(sync->working_path, sync->flash_path, true) != 0) {
+        return retry_later(sync);
+    }
+
+    ++sync->stats.flash_writes;
+    sync->dirty = false;
+    return 0;
+}
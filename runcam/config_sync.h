@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CONFIG_SYNC_PATH_MAX 256
+
+/**
+ * Deferred flash persistence for the Majestic config. The apply path keeps
+ * rewriting the working copy (ideally on tmpfs, which is what Majestic reads);
+ * this only records that it changed. Once no change has arrived for the quiet
+ * period, or on shutdown, the working copy is written to flash once, however
+ * many changes piled up in between.
+ */
+typedef struct config_sync {
+    char working_path[CONFIG_SYNC_PATH_MAX];
+    char flash_path[CONFIG_SYNC_PATH_MAX]; // empty: the working copy is the flash copy
+    uint64_t quiet_ns;
+    uint64_t last_change_ns; // CLOCK_MONOTONIC time of the newest unsynced change
+    bool dirty;
+    struct {
+        uint64_t changes;      // config writes noted
+        uint64_t flash_writes; // syncs that reached flash
+        uint64_t unchanged;    // syncs skipped because flash already matched
+    } stats;
+} config_sync_t;
+
+/**
+ * Set up syncing of `working_path` to `flash_path`. When the working copy
+ * does not exist yet (tmpfs after a reboot) it is seeded from the flash copy,
+ * if there is one.
+ * With an empty `flash_path` a sync is an fsync(2) of the working copy.
+ *
+ * @return 0 on success, -1 if a path is too long or seeding failed (details
+ *         logged to stderr).
+ */
+int config_sync_init(config_sync_t *sync, const char *working_path, const char *flash_path, uint32_t quiet_ms);
+
+/**
+ * Record that the working copy was rewritten at `now_ns`.
+ */
+void config_sync_note_change(config_sync_t *sync, uint64_t now_ns);
+
+/**
+ * @return milliseconds until a sync is due (0 when due now), or -1 when
+ *         there is nothing to sync.
+ */
+int config_sync_timeout_ms(const config_sync_t *sync, uint64_t now_ns);
+
+/**
+ * Write the working copy to flash if anything changed since the last sync.
+ * The flash copy is replaced through a temporary file, fsync(2) and rename(2),
+ * and skipped when its bytes already match. A failed sync stays pending.
+ *
+ * @return 0 on success or when clean, -1 on error (details logged to stderr).
+ */
+int config_sync_flush(config_sync_t *sync);
+
+/**
+ * Replace `target` with a copy of `source` through "<target>.tmp" and
+ * rename(2). `durable` adds the fsync(2) calls needed for the copy to survive
+ * a power cut.
+ *
+ * @return 0 on success, -1 on error (details logged to stderr).
+ */
+int config_sync_copy(const char *source, const char *target, bool durable);
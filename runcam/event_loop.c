@@ -0,0 +1,148 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "event_loop.h"
+
+void event_loop_init(event_loop_t *loop) {
+    memset(loop, 0, sizeof(*loop));
+}
+
+int event_loop_add(event_loop_t *loop, int fd, short events, event_loop_callback_t callback, void *context) {
+    if (fd < 0 || !callback || loop->source_count >= EVENT_LOOP_MAX_SOURCES) {
+        return -1;
+    }
+
+    event_loop_source_t *source = &loop->sources[loop->source_count++];
+    source->fd = fd;
+    source->events = events;
+    source->callback = callback;
+    source->context = context;
+    return 0;
+}
+
+void event_loop_modify(event_loop_t *loop, int fd, short events) {
+    for (size_t i = 0; i < loop->source_count; ++i) {
+        if (loop->sources[i].fd == fd) {
+            loop->sources[i].events = events;
+            return;
+        }
+    }
+}
+
+void event_loop_remove(event_loop_t *loop, int fd) {
+    // Only mark the slot here; event_loop_run() compacts the table once the
+    // current dispatch pass is over so callbacks may remove themselves safely.
+    for (size_t i = 0; i < loop->source_count; ++i) {
+        if (loop->sources[i].fd == fd) {
+            loop->sources[i].fd = -1;
+        }
+    }
+}
+
+static void compact_sources(event_loop_t *loop) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < loop->source_count; ++i) {
+        if (loop->sources[i].fd >= 0) {
+            loop->sources[kept++] = loop->sources[i];
+        }
+    }
+
+    loop->source_count = kept;
+}
+
+int event_loop_run(event_loop_t *loop) {
+    struct pollfd fds[EVENT_LOOP_MAX_SOURCES];
+
+    loop->running = true;
+
+    while (loop->running) {
+        compact_sources(loop);
+
+        const size_t count = loop->source_count;
+
+        for (size_t i = 0; i < count; ++i) {
+            fds[i].fd = loop->sources[i].fd;
+            fds[i].events = loop->sources[i].events;
+            fds[i].revents = 0;
+        }
+
+        // No timeout: every periodic duty is a timerfd, so the process sleeps
+        // in the kernel until there is actual work to do.
+        const int ready = poll(fds, count, -1);
+
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            fprintf(stderr, "poll failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        for (size_t i = 0; i < count && loop->running; ++i) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+
+            const event_loop_source_t source = loop->sources[i];
+
+            if (source.fd != fds[i].fd) {
+                // Removed by an earlier callback in this pass.
+                continue;
+            }
+
+            source.callback(source.fd, fds[i].revents, source.context);
+        }
+    }
+
+    compact_sources(loop);
+    return 0;
+}
+
+void event_loop_stop(event_loop_t *loop) {
+    loop->running = false;
+}
+
+int event_loop_create_timer(uint64_t interval_ms) {
+    const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (fd < 0) {
+        fprintf(stderr, "timerfd_create failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    const struct itimerspec spec = {
+        .it_interval = {
+            .tv_sec = (time_t)(interval_ms / 1000ULL),
+            .tv_nsec = (long)(interval_ms % 1000ULL) * 1000000L
+        },
+        .it_value = {
+            .tv_sec = 0,
+            .tv_nsec = 1
+        }
+    };
+
+    if (timerfd_settime(fd, 0, &spec, NULL) != 0) {
+        fprintf(stderr, "timerfd_settime failed: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+uint64_t event_loop_drain_timer(int timer_fd) {
+    uint64_t expirations = 0;
+
+    if (read(timer_fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) {
+        return 0;
+    }
+
+    return expirations;
+}
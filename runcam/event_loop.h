@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EVENT_LOOP_MAX_SOURCES 16
+
+/**
+ * Callback invoked when a registered descriptor becomes ready.
+ *
+ * @param fd      Descriptor that triggered the wakeup.
+ * @param revents poll(2) revents mask reported for the descriptor.
+ * @param context Opaque pointer supplied at registration time.
+ */
+typedef void (*event_loop_callback_t)(int fd, short revents, void *context);
+
+typedef struct event_loop_source {
+    int fd;
+    short events;
+    event_loop_callback_t callback;
+    void *context;
+} event_loop_source_t;
+
+typedef struct event_loop {
+    event_loop_source_t sources[EVENT_LOOP_MAX_SOURCES];
+    size_t source_count;
+    bool running;
+} event_loop_t;
+
+void event_loop_init(event_loop_t *loop);
+
+/**
+ * Watch a descriptor for the given poll(2) events.
+ *
+ * @return 0 on success, -1 when the source table is full.
+ */
+int event_loop_add(event_loop_t *loop, int fd, short events, event_loop_callback_t callback, void *context);
+
+/**
+ * Change the poll(2) events watched for an already registered descriptor.
+ */
+void event_loop_modify(event_loop_t *loop, int fd, short events);
+
+void event_loop_remove(event_loop_t *loop, int fd);
+
+/**
+ * Block in poll(2) and dispatch callbacks until event_loop_stop() is called.
+ *
+ * @return 0 when stopped cleanly, -1 if poll(2) failed.
+ */
+int event_loop_run(event_loop_t *loop);
+
+void event_loop_stop(event_loop_t *loop);
+
+/**
+ * Create a periodic CLOCK_MONOTONIC timerfd. The first expiration fires
+ * immediately so callers can emit their first tick without a special case.
+ *
+ * @return timer descriptor, or -1 on error (details logged to stderr).
+ */
+int event_loop_create_timer(uint64_t interval_ms);
+
+/**
+ * Read and discard the expiration counter of a timerfd.
+ *
+ * @return number of expirations since the last read (0 if none).
+ */
+uint64_t event_loop_drain_timer(int timer_fd);
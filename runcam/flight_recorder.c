@@ -0,0 +1,406 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "flight_recorder.h"
+
+#define HEADER_SIZE 64
+#define MIN_CAPACITY 4096
+
+// How long the far side must stay silent before a finished replay hangs up.
+static const int REPLAY_QUIET_MS = 500;
+
+_Static_assert(sizeof(flight_recorder_header_t) <= HEADER_SIZE, "recorder header outgrew its slot");
+
+static uint64_t align8(uint64_t value) {
+    return (value + 7u) & ~(uint64_t)7u;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static bool header_valid(const flight_recorder_header_t *header, size_t file_size) {
+    return memcmp(header->magic, FLIGHT_RECORDER_MAGIC, sizeof(header->magic)) == 0 &&
+           header->version == FLIGHT_RECORDER_VERSION &&
+           header->header_size == HEADER_SIZE &&
+           header->capacity >= MIN_CAPACITY &&
+           header->capacity % 8 == 0 &&
+           header->header_size + header->capacity == file_size &&
+           header->head <= header->tail &&
+           header->tail - header->head <= header->capacity;
+}
+
+static int map_file(flight_recorder_t *recorder, int fd, size_t size, bool writable) {
+    void *map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "mmap of flight recorder failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    recorder->fd = fd;
+    recorder->map = map;
+    recorder->map_size = size;
+    recorder->header = map;
+    recorder->data = recorder->map + HEADER_SIZE;
+    recorder->writable = writable;
+    return 0;
+}
+
+int flight_recorder_open(flight_recorder_t *recorder, const char *path, size_t capacity) {
+    memset(recorder, 0, sizeof(*recorder));
+    recorder->fd = -1;
+    capacity &= ~(size_t)7u;
+
+    if (capacity < MIN_CAPACITY) {
+        fprintf(stderr, "Flight recorder size must be at least %d bytes.\n", MIN_CAPACITY);
+        return -1;
+    }
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat info;
+
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "Unable to open flight recorder %s: %s\n", path, strerror(errno));
+
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    const size_t size = HEADER_SIZE + capacity;
+    const bool resized = (size_t)info.st_size != size;
+
+    // Allocate the whole file up front so appends never hit SIGBUS on tmpfs.
+    if (resized) {
+        const int error = ftruncate(fd, (off_t)size) != 0 ? errno : posix_fallocate(fd, 0, (off_t)size);
+
+        if (error != 0) {
+            fprintf(stderr, "Unable to size flight recorder %s: %s\n", path, strerror(error));
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (map_file(recorder, fd, size, true) != 0) {
+        close(fd);
+        recorder->fd = -1;
+        return -1;
+    }
+
+    if (!header_valid(recorder->header, size)) {
+        flight_recorder_header_t *header = recorder->header;
+
+        memset(header, 0, HEADER_SIZE);
+        memcpy(header->magic, FLIGHT_RECORDER_MAGIC, sizeof(header->magic));
+        header->version = FLIGHT_RECORDER_VERSION;
+        header->header_size = HEADER_SIZE;
+        header->capacity = capacity;
+    }
+
+    return 0;
+}
+
+int flight_recorder_open_readonly(flight_recorder_t *recorder, const char *path) {
+    memset(recorder, 0, sizeof(*recorder));
+    recorder->fd = -1;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        fprintf(stderr, "Unable to open flight recorder %s: %s\n", path, strerror(errno));
+
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    if ((size_t)info.st_size < HEADER_SIZE + MIN_CAPACITY || map_file(recorder, fd, (size_t)info.st_size, false) != 0) {
+        fprintf(stderr, "%s is not a flight recorder file.\n", path);
+        close(fd);
+        recorder->fd = -1;
+        return -1;
+    }
+
+    if (!header_valid(recorder->header, recorder->map_size)) {
+        fprintf(stderr, "%s is not a flight recorder file.\n", path);
+        flight_recorder_close(recorder);
+        return -1;
+    }
+
+    return 0;
+}
+
+void flight_recorder_close(flight_recorder_t *recorder) {
+    if (recorder->map) {
+        if (recorder->writable) {
+            (void)msync(recorder->map, recorder->map_size, MS_SYNC);
+        }
+
+        munmap(recorder->map, recorder->map_size);
+        recorder->map = NULL;
+        recorder->header = NULL;
+        recorder->data = NULL;
+    }
+
+    if (recorder->fd >= 0) {
+        close(recorder->fd);
+        recorder->fd = -1;
+    }
+}
+
+// Bytes occupied by the record (or implicit padding) at `position`.
+static uint64_t record_span(const flight_recorder_t *recorder, uint64_t position) {
+    const uint64_t capacity = recorder->header->capacity;
+    const uint64_t offset = position % capacity;
+    const uint64_t remaining = capacity - offset;
+
+    if (remaining < sizeof(flight_recorder_record_t)) {
+        return remaining;
+    }
+
+    const flight_recorder_record_t *record = (const flight_recorder_record_t *)(recorder->data + offset);
+
+    if (record->flags & FLIGHT_RECORDER_PAD) {
+        return remaining;
+    }
+
+    return sizeof(*record) + align8(record->length);
+}
+
+void flight_recorder_append(flight_recorder_t *recorder, uint64_t timestamp_ns, const uint8_t *data, size_t length) {
+    if (!recorder->map || !recorder->writable) {
+        return;
+    }
+
+    flight_recorder_header_t *header = recorder->header;
+    const uint64_t capacity = header->capacity;
+    const size_t max_length = (size_t)(capacity / 4) - sizeof(flight_recorder_record_t);
+
+    if (length > max_length) {
+        length = max_length;
+    }
+
+    const uint64_t need = sizeof(flight_recorder_record_t) + align8(length);
+    const uint64_t remaining = capacity - header->tail % capacity;
+    const uint64_t skip = remaining < need ? remaining : 0;
+    uint64_t head = header->head;
+
+    while (head < header->tail && header->tail + skip + need - head > capacity) {
+        head += record_span(recorder, head);
+    }
+
+    // Publish the eviction before overwriting and the new tail only after the
+    // record is complete, so a reader of the live file never sees a torn one.
+    __atomic_store_n(&header->head, head, __ATOMIC_RELEASE);
+
+    uint64_t tail = header->tail;
+
+    if (skip > 0) {
+        if (skip >= sizeof(flight_recorder_record_t)) {
+            const flight_recorder_record_t pad = { .timestamp_ns = timestamp_ns, .length = 0, .flags = FLIGHT_RECORDER_PAD };
+            memcpy(recorder->data + tail % capacity, &pad, sizeof(pad));
+        }
+
+        tail += skip;
+    }
+
+    const flight_recorder_record_t record = {
+        .timestamp_ns = timestamp_ns,
+        .length = (uint32_t)length,
+        .flags = 0
+    };
+    uint8_t *slot = recorder->data + tail % capacity;
+
+    memcpy(slot, &record, sizeof(record));
+    memcpy(slot + sizeof(record), data, length);
+    header->records++;
+    __atomic_store_n(&header->tail, tail + need, __ATOMIC_RELEASE);
+}
+
+uint64_t flight_recorder_first(const flight_recorder_t *recorder) {
+    return recorder->header->head;
+}
+
+bool flight_recorder_next(const flight_recorder_t *recorder, uint64_t *position,
+                          uint64_t *timestamp_ns, const uint8_t **data, size_t *length) {
+    const uint64_t capacity = recorder->header->capacity;
+    const uint64_t tail = __atomic_load_n(&recorder->header->tail, __ATOMIC_ACQUIRE);
+
+    while (*position < tail) {
+        const uint64_t offset = *position % capacity;
+        const uint64_t remaining = capacity - offset;
+
+        if (remaining < sizeof(flight_recorder_record_t)) {
+            *position += remaining;
+            continue;
+        }
+
+        const flight_recorder_record_t *record = (const flight_recorder_record_t *)(recorder->data + offset);
+
+        if (record->flags & FLIGHT_RECORDER_PAD) {
+            *position += remaining;
+            continue;
+        }
+
+        if (sizeof(*record) + (uint64_t)record->length > remaining) {
+            return false; // damaged file; stop rather than read past the area
+        }
+
+        *timestamp_ns = record->timestamp_ns;
+        *data = recorder->data + offset + sizeof(*record);
+        *length = record->length;
+        *position += sizeof(*record) + align8(record->length);
+        return true;
+    }
+
+    return false;
+}
+
+static void discard_input(int fd) {
+    uint8_t buffer[4096];
+
+    while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+    }
+}
+
+// Sleep until `due_ns`, swallowing whatever the far side writes meanwhile.
+static void wait_until(int fd, uint64_t due_ns) {
+    uint64_t now;
+
+    while ((now = monotonic_ns()) < due_ns) {
+        const uint64_t delay = due_ns - now;
+        const struct timespec timeout = {
+            .tv_sec = (time_t)(delay / 1000000000ULL),
+            .tv_nsec = (long)(delay % 1000000000ULL)
+        };
+        struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+
+        if (ppoll(&pfd, 1, &timeout, NULL) > 0) {
+            if (pfd.revents & (POLLHUP | POLLERR)) {
+                return;
+            }
+
+            discard_input(fd);
+        }
+    }
+}
+
+static int write_chunk(int fd, const uint8_t *data, size_t length) {
+    while (length > 0) {
+        const ssize_t written = send(fd, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (written > 0) {
+            data += written;
+            length -= (size_t)written;
+            continue;
+        }
+
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+
+        // The reader is behind; keep draining its output so neither side stalls.
+        struct pollfd pfd = { .fd = fd, .events = POLLIN | POLLOUT, .revents = 0 };
+
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            return -1;
+        }
+
+        if (pfd.revents & (POLLHUP | POLLERR)) {
+            return -1;
+        }
+
+        if (pfd.revents & POLLIN) {
+            discard_input(fd);
+        }
+    }
+
+    return 0;
+}
+
+static void *replay_main(void *arg) {
+    flight_recorder_replay_t *replay = arg;
+    uint64_t position = flight_recorder_first(&replay->recorder);
+    uint64_t timestamp_ns = 0;
+    uint64_t first_ns = 0;
+    const uint8_t *data = NULL;
+    size_t length = 0;
+    const uint64_t started_ns = monotonic_ns();
+
+    while (flight_recorder_next(&replay->recorder, &position, &timestamp_ns, &data, &length)) {
+        if (replay->stats.chunks == 0) {
+            first_ns = timestamp_ns;
+        }
+
+        if (replay->speed > 0.0 && timestamp_ns > first_ns) {
+            wait_until(replay->fd, started_ns + (uint64_t)((double)(timestamp_ns - first_ns) / replay->speed));
+        }
+
+        if (write_chunk(replay->fd, data, length) != 0) {
+            fprintf(stderr, "Replay target closed early.\n");
+            break;
+        }
+
+        replay->stats.chunks++;
+        replay->stats.bytes += length;
+        replay->stats.recorded_ns = timestamp_ns - first_ns;
+    }
+
+    replay->stats.elapsed_ns = monotonic_ns() - started_ns;
+
+    // Let the reader finish what is in flight (acks, reloads) before hanging up.
+    struct pollfd pfd = { .fd = replay->fd, .events = POLLIN, .revents = 0 };
+
+    while (poll(&pfd, 1, REPLAY_QUIET_MS) > 0 && !(pfd.revents & (POLLHUP | POLLERR))) {
+        discard_input(replay->fd);
+    }
+
+    close(replay->fd);
+    replay->fd = -1;
+    return NULL;
+}
+
+int flight_recorder_replay_start(flight_recorder_replay_t *replay, const char *path, double speed, int fd) {
+    memset(replay, 0, sizeof(*replay));
+    replay->fd = fd;
+    replay->speed = speed;
+
+    if (flight_recorder_open_readonly(&replay->recorder, path) != 0) {
+        return -1;
+    }
+
+    const int result = pthread_create(&replay->thread, NULL, replay_main, replay);
+
+    if (result != 0) {
+        fprintf(stderr, "Unable to start replay thread: %s\n", strerror(result));
+        flight_recorder_close(&replay->recorder);
+        return -1;
+    }
+
+    return 0;
+}
+
+void flight_recorder_replay_join(flight_recorder_replay_t *replay) {
+    pthread_join(replay->thread, NULL);
+    flight_recorder_close(&replay->recorder);
+}
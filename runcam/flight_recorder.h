@@ -0,0 +1,122 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLIGHT_RECORDER_MAGIC "MMFLTREC"
+#define FLIGHT_RECORDER_VERSION 1
+
+/**
+ * On-disk header at the start of a recorder file. Positions are logical byte
+ * offsets into the data area that only grow; the physical offset is the
+ * position modulo `capacity`. Records live in [head, tail).
+ */
+typedef struct flight_recorder_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size; // offset of the data area
+    uint64_t capacity;    // bytes in the data area
+    uint64_t head;        // oldest record still present
+    uint64_t tail;        // where the next record goes
+    uint64_t records;     // records ever written (including evicted ones)
+} flight_recorder_header_t;
+
+/**
+ * Record header inside the data area, followed by `length` bytes padded to a
+ * multiple of 8. A record never wraps: the space left at the end of the area
+ * is skipped with a FLIGHT_RECORDER_PAD record (or implicitly when it is too
+ * small for even a record header).
+ */
+typedef struct flight_recorder_record {
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC time of the read
+    uint32_t length;
+    uint32_t flags;
+} flight_recorder_record_t;
+
+#define FLIGHT_RECORDER_PAD 1u
+
+/**
+ * Fixed-size ring of raw link chunks in a shared file mapping. Appending is a
+ * memcpy into the mapping: no syscall per chunk, and the page cache keeps the
+ * data if the manager crashes. Reopening an existing file of the same size
+ * keeps appending after what is already there.
+ */
+typedef struct flight_recorder {
+    int fd;
+    uint8_t *map;
+    size_t map_size;
+    flight_recorder_header_t *header;
+    uint8_t *data;
+    bool writable;
+} flight_recorder_t;
+
+/**
+ * Open (or create) a recorder file with a data area of `capacity` bytes.
+ *
+ * @return 0 on success, -1 on error (details logged to stderr).
+ */
+int flight_recorder_open(flight_recorder_t *recorder, const char *path, size_t capacity);
+
+/**
+ * Map an existing recorder file read-only, e.g. for replay.
+ *
+ * @return 0 on success, -1 if the file is missing or not a recorder file.
+ */
+int flight_recorder_open_readonly(flight_recorder_t *recorder, const char *path);
+
+/**
+ * msync(2) and unmap. Safe to call on a recorder that failed to open.
+ */
+void flight_recorder_close(flight_recorder_t *recorder);
+
+/**
+ * Append one chunk, evicting the oldest records as needed. Chunks larger
+ * than a quarter of the ring are truncated so one burst cannot wipe it.
+ */
+void flight_recorder_append(flight_recorder_t *recorder, uint64_t timestamp_ns, const uint8_t *data, size_t length);
+
+/**
+ * Walk the records from oldest to newest. Start with `*position` set to
+ * flight_recorder_first().
+ *
+ * @return true with the record's fields filled in, false past the newest one.
+ */
+bool flight_recorder_next(const flight_recorder_t *recorder, uint64_t *position,
+                          uint64_t *timestamp_ns, const uint8_t **data, size_t *length);
+
+uint64_t flight_recorder_first(const flight_recorder_t *recorder);
+
+typedef struct flight_recorder_replay_stats {
+    uint64_t chunks;
+    uint64_t bytes;
+    uint64_t recorded_ns; // span of the recorded timestamps
+    uint64_t elapsed_ns;  // wall time the replay took
+} flight_recorder_replay_stats_t;
+
+/**
+ * Background replay of a recorder file into a descriptor (one end of a
+ * socketpair standing in for the UART). Chunks are written with their
+ * recorded spacing divided by `speed`; a speed of 0 writes them back to back.
+ * Whatever the other side writes is read and discarded. Once every chunk is
+ * out and the other side has been quiet for a moment the descriptor is
+ * closed, which the reader sees as a hangup.
+ */
+typedef struct flight_recorder_replay {
+    pthread_t thread;
+    flight_recorder_t recorder;
+    int fd;
+    double speed;
+    flight_recorder_replay_stats_t stats;
+} flight_recorder_replay_t;
+
+/**
+ * @return 0 when the replay thread is running, -1 on error (details logged).
+ */
+int flight_recorder_replay_start(flight_recorder_replay_t *replay, const char *path, double speed, int fd);
+
+/**
+ * Wait for the replay to finish and release it.
+ */
+void flight_recorder_replay_join(flight_recorder_replay_t *replay);
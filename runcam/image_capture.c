@@ -0,0 +1,759 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "image_capture.h"
+#include "latency_trace.h"
+#include "majestic_config.h"
+#include "majestic_http.h"
+#include "spsc_queue.h"
+
+#define NS_PER_MS 1000000ULL
+#define CAPTURE_SLOTS 2
+#define CAPTURE_REQUEST_CAPACITY 8
+#define CAPTURE_RESULT_CAPACITY 16
+#define MAX_FILE_NUMBER 99999
+
+static const char *const MAJESTIC_HTTP_HOST = "127.0.0.1";
+static const uint16_t DEFAULT_WEB_PORT = 80;
+static const char *const DEFAULT_DIRECTORY = "/mnt/mmcblk0p1";
+// A 4K JPEG at full quality takes Majestic well over a second at worst.
+static const int HTTP_TIMEOUT_MS = 3000;
+static const char *const EXIF_MAKE = "RunCam";
+static const char *const EXIF_MODEL = "OpenIPC Majestic";
+
+// Main thread to fetch thread: start a sequence, or cancel the running one.
+typedef struct capture_request {
+    bool cancel;
+    uint32_t interval_ms;
+    uint32_t count;
+} capture_request_t;
+
+// Fetch thread to writer thread: one shot in a slot. The file is
+// slots[slot][offset .. offset + length).
+typedef struct capture_shot {
+    unsigned slot;
+    size_t offset;
+    size_t length;
+    image_capture_result_t result;
+    char directory[IMAGE_CAPTURE_PATH_MAX];
+} capture_shot_t;
+
+static image_capture_config_t capture_config;
+static majestic_http_conn_t http_conn;
+static char directory_pattern[IMAGE_CAPTURE_PATH_MAX];
+static uint8_t *slots[CAPTURE_SLOTS];
+
+static capture_request_t request_storage[CAPTURE_REQUEST_CAPACITY];
+static capture_shot_t shot_storage[CAPTURE_SLOTS];
+static image_capture_result_t result_storage[CAPTURE_RESULT_CAPACITY];
+static spsc_queue_t request_queue;
+static spsc_queue_t shot_queue;
+static spsc_queue_t result_queue;
+
+static int request_event_fd = -1;
+static int shot_event_fd = -1;
+static int free_slot_fd = -1; // semaphore counting slots the fetcher may fill
+static int result_event_fd = -1;
+static pthread_t fetch_thread;
+static pthread_t write_thread;
+static bool fetch_running = false;
+static bool write_running = false;
+static atomic_bool fetch_stop;
+static atomic_bool write_stop;
+
+// Written by the main thread's message handlers, read once per shot.
+static pthread_mutex_t geotag_lock = PTHREAD_MUTEX_INITIALIZER;
+static image_geotag_t latest_geotag;
+static uint64_t time_unix_us = 0;
+static uint64_t time_received_ns = 0;
+
+void image_capture_config_defaults(image_capture_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    snprintf(config->target, sizeof(config->target), "%s", "/image.jpg");
+    config->buffer_size = 6 * 1024 * 1024;
+    config->sync_ms = 1000;
+}
+
+typedef struct exif_writer {
+    uint8_t *tiff; // TIFF header; IFD offsets are relative to it
+    size_t size;
+    size_t entry;  // next IFD entry
+    size_t data;   // next free byte for values longer than four bytes
+    bool overflow;
+} exif_writer_t;
+
+typedef struct exif_rational {
+    uint32_t numerator;
+    uint32_t denominator;
+} exif_rational_t;
+
+enum {
+    EXIF_BYTE = 1,
+    EXIF_ASCII = 2,
+    EXIF_LONG = 4,
+    EXIF_RATIONAL = 5
+};
+
+static void put16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *out, uint32_t value) {
+    put16(out, (uint16_t)value);
+    put16(out + 2, (uint16_t)(value >> 16));
+}
+
+// Lay out an IFD of `count` entries at `offset`, its long values right after.
+static void exif_begin_ifd(exif_writer_t *writer, size_t offset, uint16_t count) {
+    writer->entry = offset + 2;
+    writer->data = writer->entry + (size_t)count * 12 + 4;
+
+    if (writer->data > writer->size) {
+        writer->overflow = true;
+        return;
+    }
+
+    put16(writer->tiff + offset, count);
+    put32(writer->tiff + writer->entry + (size_t)count * 12, 0); // no next IFD
+}
+
+// `value` is already in the file's (little-endian) byte order.
+static void exif_add(exif_writer_t *writer, uint16_t tag, uint16_t type, uint32_t count, const uint8_t *value,
+                     size_t length) {
+    if (writer->overflow) {
+        return;
+    }
+
+    uint8_t *entry = writer->tiff + writer->entry;
+
+    put16(entry, tag);
+    put16(entry + 2, type);
+    put32(entry + 4, count);
+    memset(entry + 8, 0, 4);
+    writer->entry += 12;
+
+    if (length <= 4) {
+        memcpy(entry + 8, value, length);
+        return;
+    }
+
+    writer->data += writer->data & 1; // values start on a word boundary
+
+    if (writer->data + length > writer->size) {
+        writer->overflow = true;
+        return;
+    }
+
+    memcpy(writer->tiff + writer->data, value, length);
+    put32(entry + 8, (uint32_t)writer->data);
+    writer->data += length;
+}
+
+static void exif_add_ascii(exif_writer_t *writer, uint16_t tag, const char *text) {
+    const size_t length = strlen(text) + 1;
+
+    exif_add(writer, tag, EXIF_ASCII, (uint32_t)length, (const uint8_t *)text, length);
+}
+
+static void exif_add_rationals(exif_writer_t *writer, uint16_t tag, const exif_rational_t *values, size_t count) {
+    uint8_t encoded[3 * 8];
+
+    for (size_t i = 0; i < count; ++i) {
+        put32(encoded + i * 8, values[i].numerator);
+        put32(encoded + i * 8 + 4, values[i].denominator);
+    }
+
+    exif_add(writer, tag, EXIF_RATIONAL, (uint32_t)count, encoded, count * 8);
+}
+
+// degE7 to degrees, minutes and seconds to 1e-4".
+static void to_dms(int32_t value_e7, exif_rational_t dms[3]) {
+    const uint32_t magnitude = value_e7 < 0 ? (uint32_t)(-(int64_t)value_e7) : (uint32_t)value_e7;
+    const uint64_t minutes_e7 = (uint64_t)(magnitude % 10000000U) * 60U;
+    const uint64_t seconds_e7 = (minutes_e7 % 10000000U) * 60U;
+
+    dms[0] = (exif_rational_t){ magnitude / 10000000U, 1 };
+    dms[1] = (exif_rational_t){ (uint32_t)(minutes_e7 / 10000000U), 1 };
+    dms[2] = (exif_rational_t){ (uint32_t)(seconds_e7 / 1000U), 10000 };
+}
+
+static double heading_degrees(float yaw) {
+    const double degrees = fmod((double)yaw * 180.0 / M_PI + 360.0, 360.0);
+
+    return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+static void write_gps_ifd(exif_writer_t *writer, size_t offset, const image_geotag_t *geotag, const struct tm *utc) {
+    static const uint8_t VERSION[4] = { 2, 3, 0, 0 };
+    const uint16_t count = (uint16_t)(1 + (geotag->has_position ? 6 : 0) + (utc ? 2 : 0) +
+                                      (geotag->has_attitude ? 2 : 0));
+
+    exif_begin_ifd(writer, offset, count);
+    exif_add(writer, 0x0000, EXIF_BYTE, 4, VERSION, sizeof(VERSION)); // GPSVersionID
+
+    if (geotag->has_position) {
+        exif_rational_t dms[3];
+        const uint8_t below_sea_level = geotag->alt_mm < 0 ? 1 : 0;
+        const exif_rational_t altitude = {
+            geotag->alt_mm < 0 ? (uint32_t)(-(int64_t)geotag->alt_mm) : (uint32_t)geotag->alt_mm, 1000
+        };
+
+        exif_add_ascii(writer, 0x0001, geotag->lat < 0 ? "S" : "N"); // GPSLatitudeRef
+        to_dms(geotag->lat, dms);
+        exif_add_rationals(writer, 0x0002, dms, 3);                  // GPSLatitude
+        exif_add_ascii(writer, 0x0003, geotag->lon < 0 ? "W" : "E"); // GPSLongitudeRef
+        to_dms(geotag->lon, dms);
+        exif_add_rationals(writer, 0x0004, dms, 3);                  // GPSLongitude
+        exif_add(writer, 0x0005, EXIF_BYTE, 1, &below_sea_level, 1); // GPSAltitudeRef
+        exif_add_rationals(writer, 0x0006, &altitude, 1);            // GPSAltitude
+    }
+
+    if (utc) {
+        const exif_rational_t stamp[3] = {
+            { (uint32_t)utc->tm_hour, 1 }, { (uint32_t)utc->tm_min, 1 }, { (uint32_t)utc->tm_sec, 1 }
+        };
+
+        exif_add_rationals(writer, 0x0007, stamp, 3); // GPSTimeStamp
+    }
+
+    if (geotag->has_attitude) {
+        const exif_rational_t direction = { (uint32_t)lround(heading_degrees(geotag->yaw) * 100.0), 100 };
+
+        exif_add_ascii(writer, 0x0010, "T");               // GPSImgDirectionRef: true north
+        exif_add_rationals(writer, 0x0011, &direction, 1); // GPSImgDirection
+    }
+
+    if (utc) {
+        char date[11];
+
+        strftime(date, sizeof(date), "%Y:%m:%d", utc);
+        exif_add_ascii(writer, 0x001D, date); // GPSDateStamp
+    }
+}
+
+static void write_ifd0(exif_writer_t *writer, size_t offset, const image_geotag_t *geotag, const struct tm *utc,
+                       size_t gps_offset) {
+    const uint16_t count = (uint16_t)(2 + (geotag->has_attitude ? 1 : 0) + (utc ? 1 : 0) + (gps_offset ? 1 : 0));
+
+    exif_begin_ifd(writer, offset, count);
+
+    if (geotag->has_attitude) {
+        char description[96];
+
+        snprintf(description, sizeof(description), "roll=%.1f pitch=%.1f yaw=%.1f",
+                 (double)geotag->roll * 180.0 / M_PI, (double)geotag->pitch * 180.0 / M_PI,
+                 heading_degrees(geotag->yaw));
+        exif_add_ascii(writer, 0x010E, description); // ImageDescription
+    }
+
+    exif_add_ascii(writer, 0x010F, EXIF_MAKE);  // Make
+    exif_add_ascii(writer, 0x0110, EXIF_MODEL); // Model
+
+    if (utc) {
+        char stamp[20];
+
+        strftime(stamp, sizeof(stamp), "%Y:%m:%d %H:%M:%S", utc);
+        exif_add_ascii(writer, 0x0132, stamp); // DateTime
+    }
+
+    if (gps_offset) {
+        uint8_t pointer[4];
+
+        put32(pointer, (uint32_t)gps_offset);
+        exif_add(writer, 0x8825, EXIF_LONG, 1, pointer, sizeof(pointer)); // GPSInfo
+    }
+}
+
+size_t image_capture_build_exif(const image_geotag_t *geotag, uint8_t *out, size_t out_size) {
+    static const uint8_t HEADER[10] = { 0xFF, 0xE1, 0, 0, 'E', 'x', 'i', 'f', 0, 0 };
+    struct tm utc_storage;
+    const struct tm *utc = NULL;
+
+    if (out_size < sizeof(HEADER) + 8) {
+        return 0;
+    }
+
+    if (geotag->time_utc_us != 0) {
+        const time_t seconds = (time_t)(geotag->time_utc_us / 1000000ULL);
+        utc = gmtime_r(&seconds, &utc_storage);
+    }
+
+    exif_writer_t writer = {
+        .tiff = out + sizeof(HEADER),
+        .size = out_size - sizeof(HEADER) < 0xFFFF - 8 ? out_size - sizeof(HEADER) : 0xFFFF - 8,
+    };
+
+    memcpy(out, HEADER, sizeof(HEADER));
+    memcpy(writer.tiff, "II*\0", 4);
+
+    // The GPS IFD goes first so IFD0 can point at it.
+    size_t gps_offset = 0;
+    size_t ifd0_offset = 8;
+
+    if (geotag->has_position || geotag->has_attitude || utc) {
+        gps_offset = 8;
+        write_gps_ifd(&writer, gps_offset, geotag, utc);
+        ifd0_offset = writer.data + (writer.data & 1);
+    }
+
+    if (!writer.overflow) {
+        write_ifd0(&writer, ifd0_offset, geotag, utc, gps_offset);
+    }
+
+    if (writer.overflow) {
+        return 0;
+    }
+
+    put32(writer.tiff + 4, (uint32_t)ifd0_offset);
+
+    const size_t length = sizeof(HEADER) + writer.data;
+    out[2] = (uint8_t)((length - 2) >> 8);
+    out[3] = (uint8_t)(length - 2);
+    return length;
+}
+
+static void signal_event(int fd, uint64_t count) {
+    while (write(fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+}
+
+static void clear_event(int fd) {
+    uint64_t value = 0;
+
+    while (read(fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+// Returns false on timeout.
+static bool wait_readable(int fd, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+    int ready;
+
+    do {
+        ready = poll(&pfd, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+
+    return ready != 0;
+}
+
+static image_geotag_t snapshot_geotag(uint64_t now_ns) {
+    pthread_mutex_lock(&geotag_lock);
+    image_geotag_t geotag = latest_geotag;
+
+    if (time_unix_us != 0) {
+        geotag.time_utc_us = time_unix_us + (now_ns - time_received_ns) / 1000ULL;
+    }
+
+    pthread_mutex_unlock(&geotag_lock);
+    return geotag;
+}
+
+static void resolve_directory(char *out, size_t out_size) {
+    const time_t now = time(NULL);
+    struct tm local;
+
+    if (!localtime_r(&now, &local) || strftime(out, out_size, directory_pattern, &local) == 0) {
+        snprintf(out, out_size, "%s", directory_pattern);
+    }
+
+    if (mkdir(out, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Unable to create %s: %s\n", out, strerror(errno));
+    }
+}
+
+// Fetch one JPEG into `slot` and hand it to the writer. Majestic answers from
+// the encoder's latest frame, so the geotag is taken just before asking.
+static void shoot(unsigned slot, int32_t index, const char *directory) {
+    uint8_t *buffer = slots[slot];
+    capture_shot_t shot = {
+        .slot = slot,
+        .result = {
+            .index = index,
+            .status = -1,
+            .requested_ns = latency_trace_now()
+        }
+    };
+    size_t length = 0;
+
+    shot.result.geotag = snapshot_geotag(shot.result.requested_ns);
+    snprintf(shot.directory, sizeof(shot.directory), "%s", directory);
+
+    const int status = majestic_http_fetch(&http_conn, capture_config.target, buffer + IMAGE_CAPTURE_EXIF_RESERVE,
+                                           capture_config.buffer_size, &length);
+    shot.result.fetched_ns = latency_trace_now();
+
+    if (status == 200 && length >= 4 && buffer[IMAGE_CAPTURE_EXIF_RESERVE] == 0xFF &&
+        buffer[IMAGE_CAPTURE_EXIF_RESERVE + 1] == 0xD8) {
+        uint8_t exif[IMAGE_CAPTURE_EXIF_RESERVE - 2];
+        const size_t exif_length = image_capture_build_exif(&shot.result.geotag, exif, sizeof(exif));
+
+        // Move SOI in front of the new APP1 segment; the image stays put.
+        shot.offset = IMAGE_CAPTURE_EXIF_RESERVE - exif_length;
+        buffer[shot.offset] = 0xFF;
+        buffer[shot.offset + 1] = 0xD8;
+        memcpy(buffer + shot.offset + 2, exif, exif_length);
+        shot.length = exif_length + length;
+        shot.result.status = 0;
+    } else if (status >= 0) {
+        fprintf(stderr, "Snapshot %s answered %d without a JPEG.\n", capture_config.target, status);
+    }
+
+    // The queue holds as many shots as there are slots, so this always fits.
+    (void)spsc_queue_push(&shot_queue, &shot);
+    signal_event(shot_event_fd, 1);
+}
+
+static void *fetch_main(void *argument) {
+    capture_request_t request;
+    char directory[IMAGE_CAPTURE_PATH_MAX] = "";
+    bool active = false;
+    uint32_t interval_ms = 0;
+    uint32_t remaining = 0; // 0 shoots until cancelled
+    uint64_t next_shot_ns = 0;
+    int32_t index = 0;
+    unsigned slot = 0;
+    (void)argument;
+
+    while (!atomic_load(&fetch_stop)) {
+        const uint64_t now_ns = latency_trace_now();
+
+        if (!active || now_ns < next_shot_ns) {
+            const int timeout_ms = active ? (int)((next_shot_ns - now_ns + NS_PER_MS - 1) / NS_PER_MS) : -1;
+
+            if (wait_readable(request_event_fd, timeout_ms)) {
+                clear_event(request_event_fd);
+            }
+        }
+
+        while (spsc_queue_pop(&request_queue, &request)) {
+            active = !request.cancel;
+
+            if (active) {
+                interval_ms = request.interval_ms;
+                remaining = request.count;
+                next_shot_ns = latency_trace_now();
+                resolve_directory(directory, sizeof(directory));
+            }
+        }
+
+        if (!active || atomic_load(&fetch_stop) || latency_trace_now() < next_shot_ns) {
+            continue;
+        }
+
+        // Taking a slot blocks only while both still wait for the card.
+        clear_event(free_slot_fd);
+        shoot(slot, index++, directory);
+        slot = (slot + 1) % CAPTURE_SLOTS;
+
+        if (remaining > 0 && --remaining == 0) {
+            active = false;
+        }
+
+        // A late shot delays the next one rather than causing a catch-up burst.
+        const uint64_t after_ns = latency_trace_now();
+        next_shot_ns += (uint64_t)interval_ms * NS_PER_MS;
+
+        if (next_shot_ns < after_ns) {
+            next_shot_ns = after_ns;
+        }
+    }
+
+    return NULL;
+}
+
+static int write_all(int fd, const uint8_t *data, size_t length) {
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        data += written;
+        length -= (size_t)written;
+    }
+
+    return 0;
+}
+
+// Write a shot to the next free IMG_<n>.jpg. Writeback is started but not
+// waited for; the card is synced once shooting pauses.
+static int write_shot(capture_shot_t *shot, uint32_t *file_number) {
+    char path[IMAGE_CAPTURE_PATH_MAX + 16];
+    int fd = -1;
+
+    while (*file_number <= MAX_FILE_NUMBER) {
+        snprintf(path, sizeof(path), "%s/IMG_%05u.jpg", shot->directory, *file_number);
+        fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+        if (fd >= 0 || errno != EEXIST) {
+            break;
+        }
+
+        ++*file_number;
+    }
+
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    ++*file_number;
+
+    if (write_all(fd, slots[shot->slot] + shot->offset, shot->length) != 0) {
+        fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    (void)sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    close(fd);
+    snprintf(shot->result.file, sizeof(shot->result.file), "%.*s", (int)sizeof(shot->result.file) - 1, path);
+    shot->result.size = shot->length;
+    return 0;
+}
+
+static void sync_card(const char *directory) {
+    const int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0 || syncfs(fd) != 0) {
+        fprintf(stderr, "Unable to sync %s: %s\n", directory, strerror(errno));
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+static void *write_main(void *argument) {
+    capture_shot_t shot;
+    char unsynced[IMAGE_CAPTURE_PATH_MAX] = ""; // directory written since the last sync
+    uint32_t file_number = 0;
+    (void)argument;
+
+    while (1) {
+        if (!wait_readable(shot_event_fd, unsynced[0] != '\0' ? (int)capture_config.sync_ms : -1)) {
+            sync_card(unsynced);
+            unsynced[0] = '\0';
+            continue;
+        }
+
+        clear_event(shot_event_fd);
+
+        while (spsc_queue_pop(&shot_queue, &shot)) {
+            if (shot.result.status == 0) {
+                shot.result.status = write_shot(&shot, &file_number);
+            }
+
+            // The slot can take the next JPEG while the result travels on.
+            signal_event(free_slot_fd, 1);
+            shot.result.written_ns = latency_trace_now();
+
+            if (shot.result.status == 0) {
+                snprintf(unsynced, sizeof(unsynced), "%s", shot.directory);
+            }
+
+            if (!spsc_queue_push(&result_queue, &shot.result)) {
+                fprintf(stderr, "Capture result queue full; dropping image %d.\n", (int)shot.result.index);
+            }
+
+            signal_event(result_event_fd, 1);
+        }
+
+        if (atomic_load(&write_stop)) {
+            break;
+        }
+    }
+
+    if (unsynced[0] != '\0') {
+        sync_card(unsynced);
+    }
+
+    return NULL;
+}
+
+static uint16_t read_port(const char *config_path) {
+    char value[16];
+
+    if (majestic_config_get(config_path, "system.webPort", value, sizeof(value)) == 0) {
+        char *end = NULL;
+        const unsigned long parsed = strtoul(value, &end, 10);
+
+        if (end && *end == '\0' && parsed > 0 && parsed <= 65535) {
+            return (uint16_t)parsed;
+        }
+    }
+
+    return DEFAULT_WEB_PORT;
+}
+
+int image_capture_start(const image_capture_config_t *config, const char *majestic_config_path) {
+    capture_config = *config;
+
+    if (capture_config.path[0] != '\0') {
+        snprintf(directory_pattern, sizeof(directory_pattern), "%s", capture_config.path);
+    } else if (majestic_config_get(majestic_config_path, "records.path", directory_pattern,
+                                   sizeof(directory_pattern)) != 0 || directory_pattern[0] == '\0') {
+        snprintf(directory_pattern, sizeof(directory_pattern), "%s", DEFAULT_DIRECTORY);
+    }
+
+    majestic_http_init(&http_conn, MAJESTIC_HTTP_HOST, read_port(majestic_config_path), HTTP_TIMEOUT_MS);
+
+    if (spsc_queue_init(&request_queue, request_storage, sizeof(request_storage[0]), CAPTURE_REQUEST_CAPACITY) != 0 ||
+        spsc_queue_init(&shot_queue, shot_storage, sizeof(shot_storage[0]), CAPTURE_SLOTS) != 0 ||
+        spsc_queue_init(&result_queue, result_storage, sizeof(result_storage[0]), CAPTURE_RESULT_CAPACITY) != 0) {
+        return -1;
+    }
+
+    // Allocated once; shooting itself never touches the heap.
+    for (size_t i = 0; i < CAPTURE_SLOTS; ++i) {
+        slots[i] = malloc(IMAGE_CAPTURE_EXIF_RESERVE + (size_t)capture_config.buffer_size);
+
+        if (!slots[i]) {
+            fprintf(stderr, "Unable to allocate %u byte capture buffers.\n", capture_config.buffer_size);
+            image_capture_stop();
+            return -1;
+        }
+    }
+
+    request_event_fd = eventfd(0, EFD_CLOEXEC);
+    shot_event_fd = eventfd(0, EFD_CLOEXEC);
+    free_slot_fd = eventfd(CAPTURE_SLOTS, EFD_CLOEXEC | EFD_SEMAPHORE);
+    result_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (request_event_fd < 0 || shot_event_fd < 0 || free_slot_fd < 0 || result_event_fd < 0) {
+        fprintf(stderr, "eventfd failed: %s\n", strerror(errno));
+        image_capture_stop();
+        return -1;
+    }
+
+    atomic_store(&fetch_stop, false);
+    atomic_store(&write_stop, false);
+
+    int error = pthread_create(&write_thread, NULL, write_main, NULL);
+    write_running = error == 0;
+
+    if (error == 0) {
+        error = pthread_create(&fetch_thread, NULL, fetch_main, NULL);
+        fetch_running = error == 0;
+    }
+
+    if (error != 0) {
+        fprintf(stderr, "Failed to start image capture: %s\n", strerror(error));
+        image_capture_stop();
+        return -1;
+    }
+
+    return 0;
+}
+
+void image_capture_stop(void) {
+    // The fetcher goes first so every shot it took reaches the writer.
+    if (fetch_running) {
+        atomic_store(&fetch_stop, true);
+        signal_event(request_event_fd, 1);
+        pthread_join(fetch_thread, NULL);
+        fetch_running = false;
+    }
+
+    if (write_running) {
+        atomic_store(&write_stop, true);
+        signal_event(shot_event_fd, 1);
+        pthread_join(write_thread, NULL);
+        write_running = false;
+    }
+
+    int *const fds[] = { &request_event_fd, &shot_event_fd, &free_slot_fd, &result_event_fd };
+
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+        if (*fds[i] >= 0) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+
+    for (size_t i = 0; i < CAPTURE_SLOTS; ++i) {
+        free(slots[i]);
+        slots[i] = NULL;
+    }
+
+    majestic_http_close(&http_conn);
+}
+
+static int submit(const capture_request_t *request) {
+    if (request_event_fd < 0 || !spsc_queue_push(&request_queue, request)) {
+        return -1;
+    }
+
+    signal_event(request_event_fd, 1);
+    return 0;
+}
+
+int image_capture_request(uint32_t interval_ms, uint32_t count) {
+    const capture_request_t request = {
+        .cancel = false,
+        .interval_ms = interval_ms,
+        .count = count
+    };
+
+    return submit(&request);
+}
+
+int image_capture_cancel(void) {
+    const capture_request_t request = { .cancel = true };
+
+    return submit(&request);
+}
+
+void image_capture_set_position(int32_t lat, int32_t lon, int32_t alt_mm, int32_t relative_alt_mm) {
+    pthread_mutex_lock(&geotag_lock);
+    latest_geotag.has_position = true;
+    latest_geotag.lat = lat;
+    latest_geotag.lon = lon;
+    latest_geotag.alt_mm = alt_mm;
+    latest_geotag.relative_alt_mm = relative_alt_mm;
+    pthread_mutex_unlock(&geotag_lock);
+}
+
+void image_capture_set_attitude(float roll, float pitch, float yaw) {
+    pthread_mutex_lock(&geotag_lock);
+    latest_geotag.has_attitude = true;
+    latest_geotag.roll = roll;
+    latest_geotag.pitch = pitch;
+    latest_geotag.yaw = yaw;
+    pthread_mutex_unlock(&geotag_lock);
+}
+
+void image_capture_set_time(uint64_t unix_us, uint64_t received_ns) {
+    pthread_mutex_lock(&geotag_lock);
+    time_unix_us = unix_us;
+    time_received_ns = received_ns;
+    pthread_mutex_unlock(&geotag_lock);
+}
+
+int image_capture_result_fd(void) {
+    return result_event_fd;
+}
+
+bool image_capture_poll_result(image_capture_result_t *result) {
+    clear_event(result_event_fd);
+    return spsc_queue_pop(&result_queue, result);
+}
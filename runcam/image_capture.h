@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IMAGE_CAPTURE_PATH_MAX 256
+#define IMAGE_CAPTURE_TARGET_MAX 128
+#define IMAGE_CAPTURE_FILE_MAX 205 // CAMERA_IMAGE_CAPTURED.file_url
+// Room kept in front of every JPEG for the EXIF segment, so it is spliced in
+// without moving the image.
+#define IMAGE_CAPTURE_EXIF_RESERVE 512
+
+typedef struct image_capture_config {
+    char path[IMAGE_CAPTURE_PATH_MAX]; // strftime pattern of the directory, empty for Majestic's records.path
+    char target[IMAGE_CAPTURE_TARGET_MAX]; // Majestic snapshot URL
+    uint32_t buffer_size; // largest JPEG accepted, bytes (two such buffers are allocated)
+    uint32_t sync_ms;     // quiet time after the last write before the card is synced
+} image_capture_config_t;
+
+void image_capture_config_defaults(image_capture_config_t *config);
+
+/**
+ * Vehicle state stamped into a photo. Angles are radians, as in ATTITUDE.
+ */
+typedef struct image_geotag {
+    bool has_position;
+    int32_t lat;             // degE7
+    int32_t lon;             // degE7
+    int32_t alt_mm;          // above mean sea level
+    int32_t relative_alt_mm; // above home
+    bool has_attitude;
+    float roll;
+    float pitch;
+    float yaw;
+    uint64_t time_utc_us;    // 0 while the autopilot has not sent SYSTEM_TIME
+} image_geotag_t;
+
+/**
+ * One finished shot, successful or not, in capture order.
+ */
+typedef struct image_capture_result {
+    int32_t index;         // counts every shot since start, failed ones included
+    int status;            // 0 when the file was written, -1 otherwise
+    image_geotag_t geotag;
+    size_t size;           // bytes written, EXIF included
+    uint64_t requested_ns; // CLOCK_MONOTONIC time the snapshot was requested
+    uint64_t fetched_ns;   // JPEG received from Majestic
+    uint64_t written_ns;   // file closed
+    char file[IMAGE_CAPTURE_FILE_MAX];
+} image_capture_result_t;
+
+/**
+ * Build an EXIF APP1 segment (marker included) carrying the camera identity,
+ * the GPS position and the heading, with roll/pitch/yaw in the image
+ * description. Fields the geotag lacks are left out.
+ *
+ * @return segment length, or 0 if `out_size` is too small.
+ */
+size_t image_capture_build_exif(const image_geotag_t *geotag, uint8_t *out, size_t out_size);
+
+/**
+ * Allocate the two JPEG buffers and start the fetch and writer threads. The
+ * web port (`system.webPort`) and, without `config->path`, `records.path`
+ * are read from the Majestic config. Must be called with the signals the main
+ * loop consumes already blocked.
+ *
+ * @return 0 on success, -1 on failure (details logged to stderr).
+ */
+int image_capture_start(const image_capture_config_t *config, const char *majestic_config_path);
+
+/**
+ * Finish the shot in progress, write what was fetched, sync the card and
+ * join both threads.
+ */
+void image_capture_stop(void);
+
+/**
+ * Start a capture sequence (main thread only), replacing any running one:
+ * `count` shots (0 until image_capture_cancel()) spaced `interval_ms` apart.
+ * An interval of 0 shoots back to back, as fast as Majestic encodes.
+ *
+ * @return 0 on success, -1 if the request queue is full.
+ */
+int image_capture_request(uint32_t interval_ms, uint32_t count);
+
+/**
+ * End the running sequence after the shot in progress (main thread only).
+ */
+int image_capture_cancel(void);
+
+/**
+ * Latest vehicle state, stamped into the following shots (main thread only).
+ */
+void image_capture_set_position(int32_t lat, int32_t lon, int32_t alt_mm, int32_t relative_alt_mm);
+void image_capture_set_attitude(float roll, float pitch, float yaw);
+void image_capture_set_time(uint64_t unix_us, uint64_t received_ns);
+
+/**
+ * Descriptor that becomes readable when results are available.
+ */
+int image_capture_result_fd(void);
+
+/**
+ * Fetch the next finished shot (main thread only).
+ *
+ * @return false when no result is pending.
+ */
+bool image_capture_poll_result(image_capture_result_t *result);
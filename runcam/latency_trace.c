@@ -0,0 +1,186 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "latency_trace.h"
+
+#define MAX_TRACED_COMMANDS 16
+
+typedef struct traced_command {
+    uint32_t sequence;
+    uint64_t received_ns;
+    uint64_t decoded_ns;
+    bool in_use;
+} traced_command_t;
+
+static const char *const STAGE_NAMES[LATENCY_STAGE_COUNT] = {
+    "decode",
+    "queue",
+    "write",
+    "signal",
+    "ready",
+    "ack",
+    "total"
+};
+
+static latency_histogram_t histograms[LATENCY_STAGE_COUNT];
+static latency_histogram_t gap_histogram; // signal -> stream served, probed reloads only
+static traced_command_t traced[MAX_TRACED_COMMANDS];
+static uint32_t reloads = 0;
+
+const char *latency_stage_name(latency_stage_t stage) {
+    return stage < LATENCY_STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+void latency_histogram_record(latency_histogram_t *histogram, uint64_t duration_ns) {
+    const uint64_t duration_us = duration_ns / 1000ULL;
+    size_t bucket = 0;
+
+    while (bucket + 1 < LATENCY_HISTOGRAM_BUCKETS && duration_us >= (1ULL << bucket)) {
+        ++bucket;
+    }
+
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->sum_us += duration_us;
+
+    if (duration_us > histogram->max_us) {
+        histogram->max_us = duration_us;
+    }
+}
+
+uint64_t latency_histogram_percentile_us(const latency_histogram_t *histogram, double quantile) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = (uint64_t)(quantile * (double)histogram->count + 0.5);
+    uint64_t seen = 0;
+
+    for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; ++bucket) {
+        seen += histogram->buckets[bucket];
+
+        if (seen >= rank && seen > 0) {
+            // The last bucket is open-ended; report the observed maximum.
+            const uint64_t bound = bucket + 1 < LATENCY_HISTOGRAM_BUCKETS ? (1ULL << bucket) : histogram->max_us;
+            return bound < histogram->max_us ? bound : histogram->max_us;
+        }
+    }
+
+    return histogram->max_us;
+}
+
+void latency_trace_command(uint32_t sequence, uint64_t received_ns, uint64_t decoded_ns) {
+    traced_command_t *slot = &traced[0];
+
+    // Reuse a free slot, or overwrite the oldest one if commands pile up.
+    for (size_t i = 0; i < MAX_TRACED_COMMANDS; ++i) {
+        if (!traced[i].in_use) {
+            slot = &traced[i];
+            break;
+        }
+
+        if (traced[i].sequence < slot->sequence) {
+            slot = &traced[i];
+        }
+    }
+
+    slot->sequence = sequence;
+    slot->received_ns = received_ns;
+    slot->decoded_ns = decoded_ns;
+    slot->in_use = true;
+}
+
+static void record_interval_to(latency_histogram_t *histogram, uint64_t start_ns, uint64_t end_ns) {
+    if (start_ns != 0 && end_ns >= start_ns) {
+        latency_histogram_record(histogram, end_ns - start_ns);
+    }
+}
+
+static void record_interval(latency_stage_t stage, uint64_t start_ns, uint64_t end_ns) {
+    record_interval_to(&histograms[stage], start_ns, end_ns);
+}
+
+void latency_trace_complete(
+    uint32_t first_sequence,
+    uint32_t last_sequence,
+    uint64_t started_ns,
+    const majestic_apply_timing_t *timing,
+    uint64_t acked_ns) {
+    record_interval(LATENCY_STAGE_WRITE, started_ns, timing->written_ns);
+    record_interval(LATENCY_STAGE_SIGNAL, timing->written_ns, timing->signalled_ns);
+    record_interval(LATENCY_STAGE_READY, timing->signalled_ns, timing->ready_ns);
+
+    if (timing->reloaded) {
+        ++reloads;
+    }
+
+    if (timing->reloaded && timing->probed) {
+        record_interval_to(&gap_histogram, timing->signalled_ns, timing->ready_ns);
+    }
+
+    for (size_t i = 0; i < MAX_TRACED_COMMANDS; ++i) {
+        traced_command_t *command = &traced[i];
+
+        if (!command->in_use || command->sequence < first_sequence || command->sequence > last_sequence) {
+            continue;
+        }
+
+        record_interval(LATENCY_STAGE_DECODE, command->received_ns, command->decoded_ns);
+        record_interval(LATENCY_STAGE_QUEUE, command->decoded_ns, started_ns);
+        record_interval(LATENCY_STAGE_ACK, timing->ready_ns ? timing->ready_ns : timing->written_ns, acked_ns);
+        record_interval(LATENCY_STAGE_TOTAL, command->received_ns, acked_ns);
+        command->in_use = false;
+    }
+}
+
+const latency_histogram_t *latency_trace_histogram(latency_stage_t stage) {
+    return &histograms[stage];
+}
+
+const latency_histogram_t *latency_trace_gap_histogram(void) {
+    return &gap_histogram;
+}
+
+uint32_t latency_trace_reloads(void) {
+    return reloads;
+}
+
+size_t latency_trace_format(char *out, size_t out_size) {
+    size_t length = 0;
+
+    if (out_size == 0) {
+        return 0;
+    }
+
+    out[0] = '\0';
+
+    // The stages, then the video gap of probed reloads.
+    for (size_t stage = 0; stage <= LATENCY_STAGE_COUNT && length < out_size; ++stage) {
+        const latency_histogram_t *histogram = stage < LATENCY_STAGE_COUNT ? &histograms[stage] : &gap_histogram;
+        const int written = snprintf(
+            out + length,
+            out_size - length,
+            "%-6s count=%u mean_us=%llu p50_us=%llu p90_us=%llu p99_us=%llu max_us=%llu\n",
+            stage < LATENCY_STAGE_COUNT ? STAGE_NAMES[stage] : "gap",
+            histogram->count,
+            histogram->count ? (unsigned long long)(histogram->sum_us / histogram->count) : 0ULL,
+            (unsigned long long)latency_histogram_percentile_us(histogram, 0.50),
+            (unsigned long long)latency_histogram_percentile_us(histogram, 0.90),
+            (unsigned long long)latency_histogram_percentile_us(histogram, 0.99),
+            (unsigned long long)histogram->max_us);
+
+        if (written < 0) {
+            break;
+        }
+
+        length += (size_t)written;
+    }
+
+    if (length < out_size) {
+        const int written = snprintf(out + length, out_size - length, "reloads=%u\n", reloads);
+        length += written > 0 ? (size_t)written : 0;
+    }
+
+    return length < out_size ? length : out_size - 1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "majestic_apply.h"
+
+#define LATENCY_HISTOGRAM_BUCKETS 24
+
+/**
+ * Intervals between the timestamps taken along a zoom command's path:
+ * bytes received -> decoded -> picked up by the apply worker -> config
+ * written -> Majestic signalled (HTTP push or SIGHUP) -> Majestic ready ->
+ * COMMAND_ACK sent. TOTAL spans received to ack.
+ */
+typedef enum latency_stage {
+    LATENCY_STAGE_DECODE,
+    LATENCY_STAGE_QUEUE,
+    LATENCY_STAGE_WRITE,
+    LATENCY_STAGE_SIGNAL,
+    LATENCY_STAGE_READY,
+    LATENCY_STAGE_ACK,
+    LATENCY_STAGE_TOTAL,
+    LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+/**
+ * Fixed-size log2 histogram of microsecond latencies: bucket i counts
+ * samples below 2^i us, the last bucket everything slower.
+ */
+typedef struct latency_histogram {
+    uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+} latency_histogram_t;
+
+static inline uint64_t latency_trace_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+const char *latency_stage_name(latency_stage_t stage);
+
+void latency_histogram_record(latency_histogram_t *histogram, uint64_t duration_ns);
+
+/**
+ * Upper bound of the bucket holding the given quantile (0..1), in us.
+ */
+uint64_t latency_histogram_percentile_us(const latency_histogram_t *histogram, double quantile);
+
+/**
+ * Remember when a zoom command that queued apply `sequence` arrived and was
+ * decoded (main thread).
+ */
+void latency_trace_command(uint32_t sequence, uint64_t received_ns, uint64_t decoded_ns);
+
+/**
+ * Record a finished apply batch. Apply stages are recorded once per batch;
+ * command stages once for every traced command the batch covered.
+ */
+void latency_trace_complete(
+    uint32_t first_sequence,
+    uint32_t last_sequence,
+    uint64_t started_ns,
+    const majestic_apply_timing_t *timing,
+    uint64_t acked_ns);
+
+const latency_histogram_t *latency_trace_histogram(latency_stage_t stage);
+
+/**
+ * Video gap of reloads checked by the stream probe: SIGHUP delivered until
+ * the RTSP stream was served again.
+ */
+const latency_histogram_t *latency_trace_gap_histogram(void);
+
+/** Number of batches that needed a Majestic reload. */
+uint32_t latency_trace_reloads(void);
+
+/**
+ * Render every histogram as text for the local stats socket.
+ *
+ * @return length written (truncated to `out_size - 1`).
+ */
+size_t latency_trace_format(char *out, size_t out_size);
@@ -0,0 +1,260 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency_trace.h"
+#include "majestic_apply.h"
+#include "majestic_http.h"
+#include "majestic_process.h"
+
+static const char *const MAJESTIC_HTTP_HOST = "127.0.0.1";
+static const char *const MAJESTIC_SET_PATH = "/api/v1/set?";
+static const uint16_t DEFAULT_WEB_PORT = 80;
+static const uint16_t DEFAULT_RTSP_PORT = 554;
+static const int HTTP_TIMEOUT_MS = 500;
+
+typedef struct key_class_entry {
+    const char *key; // exact key, or a section prefix ending in '.'
+    majestic_apply_class_t apply_class;
+} key_class_entry_t;
+
+// Keys Majestic accepts at runtime. Anything not listed here is assumed to
+// need a pipeline restart, which is always safe if slower.
+static const key_class_entry_t KEY_CLASSES[] = {
+    { "image.", MAJESTIC_APPLY_RUNTIME },
+    { "osd.", MAJESTIC_APPLY_RUNTIME },
+    { "isp.exposure", MAJESTIC_APPLY_RUNTIME },
+    { "video0.bitrate", MAJESTIC_APPLY_RUNTIME },
+    { "video0.crop", MAJESTIC_APPLY_RUNTIME },
+    { "video1.bitrate", MAJESTIC_APPLY_RUNTIME },
+    { "video1.crop", MAJESTIC_APPLY_RUNTIME },
+};
+
+// Keys the `set` STATUSTEXT command may change. Every key a batch touches
+// stays in the config cache's fixed table of watched keys, so arbitrary ones
+// from the link are refused instead. The crop belongs to the zoom, and the
+// stream size is what the zoom crops are computed from.
+static const char *const SETTABLE_KEYS[] = {
+    "image.contrast",
+    "image.flip",
+    "image.hue",
+    "image.luminance",
+    "image.mirror",
+    "image.saturation",
+    "isp.exposure",
+    "nightMode.colorToGray",
+    "video0.bitrate",
+    "video0.fps",
+    "video1.bitrate",
+    "video1.codec",
+    "video1.fps",
+    "video1.gopSize",
+    "video1.rcMode",
+};
+
+static majestic_http_conn_t http_conn;
+static bool http_ready = false;
+static uint16_t rtsp_port = 0;
+static stream_probe_t stream_probe;
+static bool probe_enabled = false;
+
+static uint16_t read_port(const char *config_path, const char *key_path, uint16_t fallback) {
+    char port_value[16];
+
+    if (majestic_config_get(config_path, key_path, port_value, sizeof(port_value)) == 0) {
+        char *end = NULL;
+        const unsigned long parsed = strtoul(port_value, &end, 10);
+
+        if (end && *end == '\0' && parsed > 0 && parsed <= 65535) {
+            return (uint16_t)parsed;
+        }
+    }
+
+    return fallback;
+}
+
+static uint32_t read_count(const char *config_path, const char *key_path) {
+    char value[16];
+
+    if (majestic_config_get(config_path, key_path, value, sizeof(value)) == 0) {
+        char *end = NULL;
+        const unsigned long parsed = strtoul(value, &end, 10);
+
+        if (end && *end == '\0' && parsed <= UINT32_MAX) {
+            return (uint32_t)parsed;
+        }
+    }
+
+    return 0;
+}
+
+void majestic_apply_init(const char *config_path) {
+    majestic_http_init(&http_conn, MAJESTIC_HTTP_HOST, read_port(config_path, "system.webPort", DEFAULT_WEB_PORT),
+                       HTTP_TIMEOUT_MS);
+    http_ready = true;
+    rtsp_port = read_port(config_path, "rtsp.port", DEFAULT_RTSP_PORT);
+}
+
+void majestic_apply_enable_probe(const stream_probe_config_t *config) {
+    stream_probe_init(&stream_probe, config, MAJESTIC_HTTP_HOST, rtsp_port);
+    probe_enabled = true;
+}
+
+majestic_apply_class_t majestic_apply_classify(const char *key_path) {
+    for (size_t i = 0; i < sizeof(KEY_CLASSES) / sizeof(KEY_CLASSES[0]); ++i) {
+        const char *key = KEY_CLASSES[i].key;
+        const size_t length = strlen(key);
+        const bool is_prefix = key[length - 1] == '.';
+
+        if (is_prefix ? strncmp(key_path, key, length) == 0 : strcmp(key_path, key) == 0) {
+            return KEY_CLASSES[i].apply_class;
+        }
+    }
+
+    return MAJESTIC_APPLY_RESTART;
+}
+
+bool majestic_apply_settable(const char *key_path) {
+    for (size_t i = 0; i < sizeof(SETTABLE_KEYS) / sizeof(SETTABLE_KEYS[0]); ++i) {
+        if (strcmp(key_path, SETTABLE_KEYS[i]) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int append_text(char *out, size_t out_size, const char *text) {
+    const size_t length = strlen(out);
+    const size_t text_length = strlen(text);
+
+    if (length + text_length >= out_size) {
+        return -1;
+    }
+
+    memcpy(out + length, text, text_length + 1);
+    return 0;
+}
+
+// Push every change in one request: /api/v1/set?video1.crop=...&video1.bitrate=...
+static int push_runtime(const majestic_config_txn_t *txn, majestic_apply_timing_t *timing) {
+    char target[768];
+
+    snprintf(target, sizeof(target), "%s", MAJESTIC_SET_PATH);
+
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        if ((i > 0 && append_text(target, sizeof(target), "&") != 0) ||
+            majestic_http_append_encoded(target, sizeof(target), txn->changes[i].key) != 0 ||
+            append_text(target, sizeof(target), "=") != 0 ||
+            majestic_http_append_encoded(target, sizeof(target), txn->changes[i].value) != 0) {
+            fprintf(stderr, "Runtime update request is too long.\n");
+            return -1;
+        }
+    }
+
+    timing->signalled_ns = latency_trace_now();
+    const int status = majestic_http_get(&http_conn, target, NULL, 0);
+    timing->ready_ns = latency_trace_now();
+
+    if (status < 200 || status >= 300) {
+        if (status > 0) {
+            fprintf(stderr, "Majestic rejected runtime update (HTTP %d).\n", status);
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+int majestic_apply(majestic_config_txn_t *txn, majestic_apply_timing_t *timing) {
+    majestic_apply_timing_t local_timing;
+
+    if (!timing) {
+        timing = &local_timing;
+    }
+
+    memset(timing, 0, sizeof(*timing));
+
+    // Values Majestic already has need neither a write nor a restart; this
+    // makes re-applying the current state (at startup, after SIGHUP) free.
+    (void)majestic_config_drop_unchanged(txn);
+
+    if (txn->change_count == 0) {
+        timing->written_ns = latency_trace_now();
+        return 0;
+    }
+
+    // The YAML file is always updated so a later restart keeps the values.
+    if (majestic_config_commit(txn) != 0) {
+        fprintf(stderr, "Failed to update Majestic configuration.\n");
+        return -1;
+    }
+
+    timing->written_ns = latency_trace_now();
+
+    bool needs_restart = !http_ready;
+
+    for (size_t i = 0; i < txn->change_count && !needs_restart; ++i) {
+        needs_restart = majestic_apply_classify(txn->changes[i].key) == MAJESTIC_APPLY_RESTART;
+    }
+
+    if (!needs_restart) {
+        if (push_runtime(txn, timing) == 0) {
+            return 0;
+        }
+
+        fprintf(stderr, "Runtime update failed; falling back to a Majestic reload.\n");
+    }
+
+    timing->reloaded = true;
+
+    if (reload_majestic_process(&timing->signalled_ns) != 0) {
+        fprintf(stderr, "Failed to reload Majestic after updating configuration.\n");
+        return -1;
+    }
+
+    // The process is back at once after a SIGHUP; the stream is what the
+    // next change has to wait for.
+    if (probe_enabled) {
+        const int probed = stream_probe_wait(&stream_probe, timing->signalled_ns, &timing->ready_ns);
+
+        if (probed < 0) {
+            return -1;
+        }
+
+        // Without an observed outage, ready_ns is no measure of the gap.
+        timing->probed = probed == 0;
+        return 0;
+    }
+
+    timing->ready_ns = latency_trace_now();
+    return 0;
+}
+
+void majestic_apply_read_stream(const char *config_path, majestic_stream_settings_t *stream) {
+    char size[32];
+    unsigned width = 0;
+    unsigned height = 0;
+
+    memset(stream, 0, sizeof(*stream));
+
+    if (majestic_config_get(config_path, "video1.size", size, sizeof(size)) == 0 &&
+        sscanf(size, "%ux%u", &width, &height) == 2 && width <= UINT16_MAX && height <= UINT16_MAX) {
+        stream->width = (uint16_t)width;
+        stream->height = (uint16_t)height;
+    }
+
+    stream->fps = read_count(config_path, "video1.fps");
+    stream->bitrate_kbps = read_count(config_path, "video1.bitrate");
+
+    if (majestic_config_get(config_path, "video1.codec", stream->codec, sizeof(stream->codec)) != 0) {
+        stream->codec[0] = '\0';
+    }
+}
+
+void majestic_apply_shutdown(void) {
+    if (http_ready) {
+        majestic_http_close(&http_conn);
+    }
+}
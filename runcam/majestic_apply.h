@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "majestic_config.h"
+#include "stream_probe.h"
+
+typedef enum majestic_apply_class {
+    // Majestic picks the key up at runtime through its HTTP API.
+    MAJESTIC_APPLY_RUNTIME,
+    // The key only takes effect after a SIGHUP pipeline restart.
+    MAJESTIC_APPLY_RESTART
+} majestic_apply_class_t;
+
+/**
+ * CLOCK_MONOTONIC timestamps (ns) taken while a batch is applied. Stages that
+ * did not run stay 0.
+ */
+typedef struct majestic_apply_timing {
+    uint64_t written_ns;   // YAML committed
+    uint64_t signalled_ns; // runtime request sent or SIGHUP delivered
+    uint64_t ready_ns;     // runtime request answered or Majestic running (or streaming) again
+    bool reloaded;         // the batch needed a SIGHUP reload
+    bool probed;           // ready_ns is when the RTSP stream served again after dropping
+} majestic_apply_timing_t;
+
+/**
+ * The video1 stream as the Majestic config describes it, for advertising it
+ * to ground stations. Fields whose key is missing or unreadable stay 0 ("").
+ */
+typedef struct majestic_stream_settings {
+    uint16_t width;
+    uint16_t height;
+    uint32_t fps;
+    uint32_t bitrate_kbps;
+    char codec[16]; // video1.codec as written, e.g. "h265"
+} majestic_stream_settings_t;
+
+/**
+ * Prepare the apply backends for the given Majestic config. The HTTP port is
+ * read from `system.webPort` (80 when absent).
+ */
+void majestic_apply_init(const char *config_path);
+
+/**
+ * After every reload, hold the apply path until the RTSP stream is served
+ * again (port `rtsp.port` of the Majestic config, 554 when absent) instead of
+ * only until a Majestic process exists. Call after majestic_apply_init().
+ */
+void majestic_apply_enable_probe(const stream_probe_config_t *config);
+
+/**
+ * Look up how a dotted key has to be applied.
+ */
+majestic_apply_class_t majestic_apply_classify(const char *key_path);
+
+/**
+ * Whether the `set <key> <value>` command may change a dotted key.
+ */
+bool majestic_apply_settable(const char *key_path);
+
+/**
+ * Persist a config batch and apply it through the cheapest path: nothing for
+ * values the config already holds, a single request over the persistent HTTP
+ * connection when every remaining key is runtime changeable, otherwise (or if
+ * the HTTP push fails) one SIGHUP reload.
+ *
+ * @param timing Optional; receives the stage timestamps of this apply.
+ * @return 0 on success, -1 on failure (details logged to stderr).
+ */
+int majestic_apply(majestic_config_txn_t *txn, majestic_apply_timing_t *timing);
+
+/**
+ * Read the video1 stream settings from the config. Call from the thread that
+ * applies batches, since it shares their config cache.
+ */
+void majestic_apply_read_stream(const char *config_path, majestic_stream_settings_t *stream);
+
+void majestic_apply_shutdown(void);
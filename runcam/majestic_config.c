@@ -1,12 +1,58 @@
+#define _GNU_SOURCE
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
 
 #include "third_party/libyaml-0.2.5/include/yaml.h"
 
 #include "majestic_config.h"
 
+#define CONFIG_CACHE_CAPACITY 32768
+#define CONFIG_MAX_WATCHED_KEYS 32
+#define CONFIG_MAX_DEPTH 8
+
+// Byte range of one watched scalar value inside the cached file contents.
+typedef struct config_span {
+    char key[MAJESTIC_CONFIG_KEY_MAX_LEN]; // dotted path, e.g. "video1.crop"
+    size_t start;
+    size_t end;
+    bool found;
+    bool patchable;
+} config_span_t;
+
+typedef struct index_frame {
+    char key[MAJESTIC_CONFIG_KEY_MAX_LEN];
+} index_frame_t;
+
+// In-memory copy of the Majestic config plus the offsets of watched keys, so a
+// value change is a splice and one write instead of a parse/emit round trip.
+static struct {
+    char path[PATH_MAX];
+    char data[CONFIG_CACHE_CAPACITY];
+    size_t length;
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+    bool valid;
+    config_span_t spans[CONFIG_MAX_WATCHED_KEYS];
+    size_t span_count;
+} config_cache;
+
+// Set when the config lives on flash with no working copy in front of it.
+static bool durable_writes = false;
+
 static int node_to_id(const yaml_document_t *document, const yaml_node_t *node) {
     if (!document || !node || document->nodes.start == NULL) {
         return 0;
@@ -32,45 +78,69 @@ static int create_scalar(yaml_document_t *document, const char *value) {
         YAML_PLAIN_SCALAR_STYLE);
 }
 
-static int ensure_child_mapping(
-    yaml_document_t *document,
-    yaml_node_t *parent_node,
-    int parent_id,
-    const char *key,
-    yaml_node_t **out_node) {
+// Nodes live in one array that grows as nodes are added, so the helpers below
+// pass node ids and look nodes up again after every addition: a node pointer
+// taken before yaml_document_add_*() may point into freed memory.
+static yaml_node_t *get_mapping(yaml_document_t *document, int node_id) {
+    yaml_node_t *node = yaml_document_get_node(document, node_id);
 
-    if (!document || !parent_node || parent_node->type != YAML_MAPPING_NODE) {
-        return 0;
+    return node && node->type == YAML_MAPPING_NODE ? node : NULL;
+}
+
+// Index of the pair whose key is `key`, or -1.
+static int find_pair(yaml_document_t *document, int mapping_id, const char *key) {
+    yaml_node_t *mapping_node = get_mapping(document, mapping_id);
+
+    if (!mapping_node) {
+        return -1;
     }
 
-    yaml_node_pair_t *pair = parent_node->data.mapping.pairs.start;
+    const yaml_node_pair_t *start = mapping_node->data.mapping.pairs.start;
 
-    while (pair && pair < parent_node->data.mapping.pairs.top) {
-        yaml_node_t *key_node = yaml_document_get_node(document, pair->key);
+    for (const yaml_node_pair_t *pair = start; pair && pair < mapping_node->data.mapping.pairs.top; ++pair) {
+        if (scalar_matches(yaml_document_get_node(document, pair->key), key)) {
+            return (int)(pair - start);
+        }
+    }
 
-        if (scalar_matches(key_node, key)) {
-            yaml_node_t *value_node = yaml_document_get_node(document, pair->value);
+    return -1;
+}
 
-            if (value_node && value_node->type == YAML_MAPPING_NODE) {
-                *out_node = value_node;
-                return pair->value;
-            }
+static bool set_pair_value(yaml_document_t *document, int mapping_id, int pair_index, int value_id) {
+    yaml_node_t *mapping_node = get_mapping(document, mapping_id);
 
-            const int new_mapping_id = yaml_document_add_mapping(
-                document,
-                (const yaml_char_t *)YAML_DEFAULT_MAPPING_TAG,
-                YAML_BLOCK_MAPPING_STYLE);
+    if (!mapping_node) {
+        return false;
+    }
 
-            if (new_mapping_id == 0) {
-                return 0;
-            }
+    mapping_node->data.mapping.pairs.start[pair_index].value = value_id;
+    return true;
+}
+
+static int ensure_child_mapping(yaml_document_t *document, int parent_id, const char *key) {
+    if (!get_mapping(document, parent_id)) {
+        return 0;
+    }
+
+    const int pair_index = find_pair(document, parent_id, key);
+
+    if (pair_index >= 0) {
+        const int value_id = get_mapping(document, parent_id)->data.mapping.pairs.start[pair_index].value;
+
+        if (get_mapping(document, value_id)) {
+            return value_id;
+        }
+
+        const int new_mapping_id = yaml_document_add_mapping(
+            document,
+            (const yaml_char_t *)YAML_DEFAULT_MAPPING_TAG,
+            YAML_BLOCK_MAPPING_STYLE);
 
-            pair->value = new_mapping_id;
-            *out_node = yaml_document_get_node(document, new_mapping_id);
-            return new_mapping_id;
+        if (new_mapping_id == 0 || !set_pair_value(document, parent_id, pair_index, new_mapping_id)) {
+            return 0;
         }
 
-        pair++;
+        return new_mapping_id;
     }
 
     const int key_node_id = create_scalar(document, key);
@@ -87,18 +157,11 @@ static int ensure_child_mapping(
         return 0;
     }
 
-    *out_node = yaml_document_get_node(document, value_node_id);
     return value_node_id;
 }
 
-static bool set_mapping_scalar(
-    yaml_document_t *document,
-    yaml_node_t *mapping_node,
-    int mapping_id,
-    const char *key,
-    const char *value) {
-
-    if (!document || !mapping_node || mapping_node->type != YAML_MAPPING_NODE) {
+static bool set_mapping_scalar(yaml_document_t *document, int mapping_id, const char *key, const char *value) {
+    if (!get_mapping(document, mapping_id)) {
         return false;
     }
 
@@ -108,17 +171,10 @@ static bool set_mapping_scalar(
         return false;
     }
 
-    yaml_node_pair_t *pair = mapping_node->data.mapping.pairs.start;
-
-    while (pair && pair < mapping_node->data.mapping.pairs.top) {
-        yaml_node_t *key_node = yaml_document_get_node(document, pair->key);
+    const int pair_index = find_pair(document, mapping_id, key);
 
-        if (scalar_matches(key_node, key)) {
-            pair->value = new_scalar_id;
-            return true;
-        }
-
-        pair++;
+    if (pair_index >= 0) {
+        return set_pair_value(document, mapping_id, pair_index, new_scalar_id);
     }
 
     const int key_node_id = create_scalar(document, key);
@@ -130,15 +186,46 @@ static bool set_mapping_scalar(
     return yaml_document_append_mapping_pair(document, mapping_id, key_node_id, new_scalar_id);
 }
 
-static bool reload_document(
-    const char *config_path,
-    yaml_document_t *document,
-    yaml_node_t **root_node,
-    int *root_id) {
+// libyaml stream handlers on a plain descriptor: stdio would malloc a FILE
+// and its buffer on every round trip.
+static int read_handler(void *data, unsigned char *buffer, size_t size, size_t *size_read) {
+    const int fd = *(const int *)data;
+    ssize_t bytes;
+
+    do {
+        bytes = read(fd, buffer, size);
+    } while (bytes < 0 && errno == EINTR);
+
+    *size_read = bytes > 0 ? (size_t)bytes : 0;
+    return bytes >= 0;
+}
+
+static int write_handler(void *data, unsigned char *buffer, size_t size) {
+    const int fd = *(const int *)data;
+    size_t written = 0;
+
+    while (written < size) {
+        const ssize_t bytes = write(fd, buffer + written, size - written);
+
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes <= 0) {
+            return 0;
+        }
+
+        written += (size_t)bytes;
+    }
+
+    return 1;
+}
+
+static bool reload_document(const char *config_path, yaml_document_t *document) {
 
-    FILE *input = fopen(config_path, "rb");
+    int input = open(config_path, O_RDONLY | O_CLOEXEC);
 
-    if (!input) {
+    if (input < 0) {
         if (errno == ENOENT) {
             fprintf(stderr, "%s does not exist; skipping update.\n", config_path);
         } else {
@@ -151,11 +238,11 @@ static bool reload_document(
 
     if (!yaml_parser_initialize(&parser)) {
         fprintf(stderr, "Failed to initialize YAML parser.\n");
-        fclose(input);
+        close(input);
         return false;
     }
 
-    yaml_parser_set_input_file(&parser, input);
+    yaml_parser_set_input(&parser, read_handler, &input);
 
     if (!yaml_parser_load(&parser, document)) {
         fprintf(stderr, "YAML parser error while reading %s: %s (line %zu)\n",
@@ -163,30 +250,119 @@ static bool reload_document(
                 parser.problem ? parser.problem : "unknown",
                 (size_t)parser.problem_mark.line + 1);
         yaml_parser_delete(&parser);
-        fclose(input);
+        close(input);
         return false;
     }
 
     yaml_parser_delete(&parser);
-    fclose(input);
+    close(input);
 
-    *root_node = yaml_document_get_root_node(document);
+    const yaml_node_t *root_node = yaml_document_get_root_node(document);
 
-    if (!*root_node || (*root_node)->type != YAML_MAPPING_NODE) {
+    if (!root_node || root_node->type != YAML_MAPPING_NODE) {
         fprintf(stderr, "Unexpected Majestic YAML structure. Expected mapping root.\n");
         yaml_document_delete(document);
         return false;
     }
 
-    *root_id = node_to_id(document, *root_node);
+    return true;
+}
+
+// Open a uniquely named temporary file next to the file `config_path`
+// resolves to, so renaming it over the target replaces the file behind a
+// symlink, not the link, and no other writer can share it.
+static int open_replacement(const char *config_path, char *target, size_t target_size, char *temp, size_t temp_size) {
+    char resolved[PATH_MAX];
+    struct stat info;
+    mode_t mode = 0644;
+
+    if (!realpath(config_path, resolved)) {
+        snprintf(resolved, sizeof(resolved), "%s", config_path);
+    }
+
+    if (snprintf(target, target_size, "%s", resolved) >= (int)target_size ||
+        snprintf(temp, temp_size, "%s.XXXXXX", resolved) >= (int)temp_size) {
+        fprintf(stderr, "Config path too long: %s\n", config_path);
+        return -1;
+    }
+
+    if (stat(target, &info) == 0) {
+        mode = info.st_mode & 07777;
+    }
+
+    const int fd = mkostemp(temp, O_CLOEXEC);
+
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create %s: %s\n", temp, strerror(errno));
+        return -1;
+    }
+
+    // mkostemp() creates the file 0600; keep the permissions of the target.
+    if (fchmod(fd, mode) != 0) {
+        fprintf(stderr, "Failed to set the mode of %s: %s\n", temp, strerror(errno));
+        close(fd);
+        unlink(temp);
+        return -1;
+    }
+
+    return fd;
+}
+
+// fsync(2) the replacement before it is renamed into place, when writes have
+// to be durable. Closes `fd` either way.
+static bool finish_replacement(int fd, bool written) {
+    if (written && durable_writes && fsync(fd) != 0) {
+        written = false;
+    }
+
+    return close(fd) == 0 && written;
+}
+
+// fsync(2) the directory holding `target` so the rename itself is durable.
+static void sync_directory(const char *target) {
+    char directory[PATH_MAX];
+    const char *slash = strrchr(target, '/');
+
+    if (slash) {
+        // Keep the slash, so "/majestic.yaml" syncs "/".
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - target) + 1, target);
+    } else {
+        snprintf(directory, sizeof(directory), ".");
+    }
+
+    const int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0 || fsync(fd) != 0) {
+        fprintf(stderr, "Failed to sync the directory of %s: %s\n", target, strerror(errno));
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+// Rename a fully written replacement into place, so readers see either the
+// old or the new file and never a torn one. Removes it on failure.
+static bool install_replacement(bool written, const char *temp, const char *target) {
+    if (!written || rename(temp, target) != 0) {
+        fprintf(stderr, "Failed to replace %s: %s\n", target, strerror(errno));
+        unlink(temp);
+        return false;
+    }
+
+    if (durable_writes) {
+        sync_directory(target);
+    }
+
     return true;
 }
 
 static bool persist_document(const char *config_path, yaml_document_t *document) {
-    FILE *output = fopen(config_path, "wb");
+    char target[PATH_MAX];
+    char temp[PATH_MAX];
+    int output = open_replacement(config_path, target, sizeof(target), temp, sizeof(temp));
 
-    if (!output) {
-        fprintf(stderr, "Failed to open %s for writing: %s\n", config_path, strerror(errno));
+    if (output < 0) {
         return false;
     }
 
@@ -194,65 +370,662 @@ static bool persist_document(const char *config_path, yaml_document_t *document)
 
     if (!yaml_emitter_initialize(&emitter)) {
         fprintf(stderr, "Failed to initialize YAML emitter.\n");
-        fclose(output);
-        return false;
+        close(output);
+        return install_replacement(false, temp, target);
     }
 
-    yaml_emitter_set_output_file(&emitter, output);
+    yaml_emitter_set_output(&emitter, write_handler, &output);
+    bool ok = true;
 
     if (!yaml_emitter_open(&emitter)) {
         fprintf(stderr, "Failed to open YAML stream for writing %s.\n", config_path);
-        yaml_emitter_delete(&emitter);
-        fclose(output);
+        ok = false;
+    } else if (!yaml_emitter_dump(&emitter, document)) {
+        fprintf(stderr, "Failed to emit YAML document to %s.\n", config_path);
+        ok = false;
+    } else if (!yaml_emitter_close(&emitter)) {
+        fprintf(stderr, "Failed to finalize YAML stream for %s.\n", config_path);
+        ok = false;
+    }
+
+    yaml_emitter_delete(&emitter);
+    ok = finish_replacement(output, ok);
+
+    return install_replacement(ok, temp, target);
+}
+
+// Walk a dotted key path ("video1.crop"), creating intermediate mappings as
+// needed, and set the final segment to a plain scalar.
+static bool set_document_value(yaml_document_t *document, const char *key_path, const char *value) {
+    char segment[MAJESTIC_CONFIG_KEY_MAX_LEN];
+    yaml_node_t *root_node = yaml_document_get_root_node(document);
+    int mapping_id = node_to_id(document, root_node);
+    const char *cursor = key_path;
+
+    while (1) {
+        const char *dot = strchr(cursor, '.');
+
+        if (!dot) {
+            return set_mapping_scalar(document, mapping_id, cursor, value);
+        }
+
+        const size_t length = (size_t)(dot - cursor);
+
+        if (length == 0 || length >= sizeof(segment)) {
+            return false;
+        }
+
+        memcpy(segment, cursor, length);
+        segment[length] = '\0';
+
+        mapping_id = ensure_child_mapping(document, mapping_id, segment);
+
+        if (mapping_id == 0) {
+            return false;
+        }
+
+        cursor = dot + 1;
+    }
+}
+
+// Full libyaml round trip: load the DOM once, apply every change and emit the
+// whole file once. Only used when the offset index cannot patch in place.
+static int commit_via_document(const majestic_config_txn_t *txn) {
+    yaml_document_t document;
+
+    if (!reload_document(txn->config_path, &document)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        const majestic_config_change_t *change = &txn->changes[i];
+
+        if (!set_document_value(&document, change->key, change->value)) {
+            fprintf(stderr, "Failed to set %s inside %s.\n", change->key, txn->config_path);
+            yaml_document_delete(&document);
+            return -1;
+        }
+    }
+
+    if (!persist_document(txn->config_path, &document)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static bool same_mtime(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+static void remember_fingerprint(const struct stat *info) {
+    config_cache.device = info->st_dev;
+    config_cache.inode = info->st_ino;
+    config_cache.size = info->st_size;
+    config_cache.mtime = info->st_mtim;
+}
+
+// The cached bytes are trusted only while the file still has the inode, size
+// and mtime we last wrote or read; anything else means an external edit.
+static bool cache_is_fresh(const char *config_path) {
+    if (!config_cache.valid || strcmp(config_cache.path, config_path) != 0) {
         return false;
     }
 
-    if (!yaml_emitter_dump(&emitter, document)) {
-        fprintf(stderr, "Failed to emit YAML document to %s.\n", config_path);
-        yaml_emitter_delete(&emitter);
-        fclose(output);
+    struct stat info;
+
+    if (stat(config_path, &info) != 0) {
         return false;
     }
 
-    if (!yaml_emitter_close(&emitter)) {
-        fprintf(stderr, "Failed to finalize YAML stream for %s.\n", config_path);
-        yaml_emitter_delete(&emitter);
-        fclose(output);
+    return info.st_dev == config_cache.device &&
+           info.st_ino == config_cache.inode &&
+           info.st_size == config_cache.size &&
+           same_mtime(&info.st_mtim, &config_cache.mtime);
+}
+
+static config_span_t *find_span(const char *key_path) {
+    for (size_t i = 0; i < config_cache.span_count; ++i) {
+        if (strcmp(config_cache.spans[i].key, key_path) == 0) {
+            return &config_cache.spans[i];
+        }
+    }
+
+    return NULL;
+}
+
+static size_t build_key_path(const index_frame_t *stack, size_t depth, char *out, size_t out_size) {
+    size_t length = 0;
+
+    for (size_t i = 0; i < depth; ++i) {
+        const int written = snprintf(out + length, out_size - length, "%s%s", i == 0 ? "" : ".", stack[i].key);
+
+        if (written < 0 || (size_t)written >= out_size - length) {
+            return 0;
+        }
+
+        length += (size_t)written;
+    }
+
+    return length;
+}
+
+static void record_span(const index_frame_t *stack, size_t depth, const yaml_event_t *event) {
+    char key_path[MAJESTIC_CONFIG_KEY_MAX_LEN];
+
+    if (build_key_path(stack, depth, key_path, sizeof(key_path)) == 0) {
+        return;
+    }
+
+    config_span_t *span = find_span(key_path);
+
+    if (!span) {
+        return;
+    }
+
+    const size_t start = event->start_mark.index;
+    const size_t end = event->end_mark.index;
+    const size_t value_length = event->data.scalar.length;
+
+    // libyaml marks count characters, not bytes, so only trust spans that
+    // map back onto the exact scalar bytes (always true for ASCII files).
+    span->found = true;
+    span->patchable = event->data.scalar.style == YAML_PLAIN_SCALAR_STYLE &&
+                      end >= start &&
+                      end <= config_cache.length &&
+                      end - start == value_length &&
+                      memcmp(config_cache.data + start, event->data.scalar.value, value_length) == 0;
+    span->start = start;
+    span->end = end;
+}
+
+// Stream the cached bytes through the libyaml event parser (no DOM) and note
+// the byte span of every watched key.
+static bool index_cache(void) {
+    yaml_parser_t parser;
+    index_frame_t stack[CONFIG_MAX_DEPTH];
+    size_t depth = 0;
+    bool in_mapping[CONFIG_MAX_DEPTH + 1] = { false };
+    bool expect_key[CONFIG_MAX_DEPTH + 1] = { false };
+    // Number of open collections; sequences and over-deep mappings are
+    // skipped because watched keys only name nested mapping entries.
+    size_t nesting = 0;
+    bool done = false;
+    bool ok = true;
+
+    for (size_t i = 0; i < config_cache.span_count; ++i) {
+        config_cache.spans[i].found = false;
+        config_cache.spans[i].patchable = false;
+    }
+
+    if (!yaml_parser_initialize(&parser)) {
+        fprintf(stderr, "Failed to initialize YAML parser.\n");
         return false;
     }
 
-    yaml_emitter_delete(&emitter);
-    fclose(output);
+    yaml_parser_set_input_string(&parser, (const unsigned char *)config_cache.data, config_cache.length);
+
+    while (!done) {
+        yaml_event_t event;
+
+        if (!yaml_parser_parse(&parser, &event)) {
+            ok = false;
+            break;
+        }
+
+        switch (event.type) {
+        case YAML_MAPPING_START_EVENT:
+            if (nesting < CONFIG_MAX_DEPTH) {
+                nesting++;
+                in_mapping[nesting] = depth + 1 == nesting;
+                expect_key[nesting] = true;
+            } else {
+                ok = false;
+                done = true;
+            }
+            break;
+        case YAML_SEQUENCE_START_EVENT:
+            if (nesting < CONFIG_MAX_DEPTH) {
+                nesting++;
+                in_mapping[nesting] = false;
+            } else {
+                ok = false;
+                done = true;
+            }
+            break;
+        case YAML_MAPPING_END_EVENT:
+        case YAML_SEQUENCE_END_EVENT:
+            if (nesting > 0) {
+                nesting--;
+            }
+
+            // The closed collection was the value of the parent's pending key.
+            if (nesting > 0 && in_mapping[nesting] && !expect_key[nesting]) {
+                if (depth == nesting) {
+                    depth--;
+                }
+                expect_key[nesting] = true;
+            }
+            break;
+        case YAML_ALIAS_EVENT:
+        case YAML_SCALAR_EVENT:
+            if (nesting == 0 || !in_mapping[nesting]) {
+                break;
+            }
+
+            if (event.type == YAML_ALIAS_EVENT) {
+                if (!expect_key[nesting] && depth == nesting) {
+                    depth--;
+                }
+                expect_key[nesting] = !expect_key[nesting];
+                break;
+            }
+
+            if (expect_key[nesting]) {
+                const size_t key_length = event.data.scalar.length;
+
+                if (key_length < MAJESTIC_CONFIG_KEY_MAX_LEN && depth + 1 == nesting) {
+                    memcpy(stack[depth].key, event.data.scalar.value, key_length);
+                    stack[depth].key[key_length] = '\0';
+                    depth++;
+                }
+                expect_key[nesting] = false;
+            } else {
+                if (depth == nesting) {
+                    record_span(stack, depth, &event);
+                    depth--;
+                }
+                expect_key[nesting] = true;
+            }
+            break;
+        case YAML_STREAM_END_EVENT:
+            done = true;
+            break;
+        default:
+            break;
+        }
+
+        yaml_event_delete(&event);
+    }
+
+    yaml_parser_delete(&parser);
+    return ok;
+}
+
+static bool load_cache(const char *config_path) {
+    config_cache.valid = false;
+
+    const size_t path_length = strlen(config_path);
+
+    if (path_length >= sizeof(config_cache.path)) {
+        return false;
+    }
+
+    const int fd = open(config_path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size < 0 || (size_t)info.st_size >= sizeof(config_cache.data)) {
+        close(fd);
+        return false;
+    }
+
+    size_t total = 0;
+
+    while (total < (size_t)info.st_size) {
+        const ssize_t bytes_read = read(fd, config_cache.data + total, (size_t)info.st_size - total);
+
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (bytes_read <= 0) {
+            close(fd);
+            return false;
+        }
+
+        total += (size_t)bytes_read;
+    }
+
+    close(fd);
+
+    memcpy(config_cache.path, config_path, path_length + 1);
+    config_cache.length = total;
+    remember_fingerprint(&info);
+
+    if (!index_cache()) {
+        return false;
+    }
+
+    config_cache.valid = true;
     return true;
 }
 
-int majestic_config_set_crop(const char *config_path, const char *crop_value) {
-    yaml_document_t document;
-    yaml_node_t *root_node = NULL;
-    int root_id = 0;
+// Values written through the fast path must stay plain scalars that YAML reads
+// back verbatim, otherwise the document path takes care of quoting.
+static bool is_plain_safe(const char *value) {
+    if (!value || value[0] == '\0' || value[0] == '-' || value[0] == '.') {
+        return false;
+    }
+
+    for (const char *c = value; *c; ++c) {
+        if (!isalnum((unsigned char)*c) && *c != '.' && *c != '_' && *c != '-' && *c != '/') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool write_span(int fd, size_t offset, size_t length) {
+    size_t written = 0;
+
+    while (written < length) {
+        const ssize_t result = pwrite(fd, config_cache.data + offset + written, length - written, (off_t)(offset + written));
+
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (result <= 0) {
+            return false;
+        }
+
+        written += (size_t)result;
+    }
+
+    return true;
+}
+
+// Replace the bytes of one span inside the cached buffer and shift the spans
+// that follow it. Nothing touches the file here.
+static void splice_span(config_span_t *span, const char *value) {
+    const size_t new_length = strlen(value);
+    const size_t old_length = span->end - span->start;
+    const size_t tail_length = config_cache.length - span->end;
+
+    memmove(config_cache.data + span->start + new_length, config_cache.data + span->end, tail_length);
+    memcpy(config_cache.data + span->start, value, new_length);
+    config_cache.length = config_cache.length - old_length + new_length;
+
+    for (size_t i = 0; i < config_cache.span_count; ++i) {
+        config_span_t *other = &config_cache.spans[i];
+
+        if (other != span && other->found && other->start >= span->end) {
+            other->start = other->start - old_length + new_length;
+            other->end = other->end - old_length + new_length;
+        }
+    }
+
+    span->end = span->start + new_length;
+}
+
+// Write the whole cached buffer to a replacement file and rename it over the
+// config. The file is a few KiB, so writing all of it costs about the same as
+// a partial pwrite() and a crash can no longer leave half an edit behind.
+static int write_cache(void) {
+    char target[PATH_MAX];
+    char temp[PATH_MAX];
+    struct stat info;
+    const int fd = open_replacement(config_cache.path, target, sizeof(target), temp, sizeof(temp));
+
+    if (fd < 0) {
+        config_cache.valid = false;
+        return -1;
+    }
+
+    bool ok = write_span(fd, 0, config_cache.length) && fstat(fd, &info) == 0;
+    ok = finish_replacement(fd, ok);
+
+    if (!install_replacement(ok, temp, target)) {
+        config_cache.valid = false;
+        return -1;
+    }
+
+    remember_fingerprint(&info);
+    return 0;
+}
+
+static int watch_key(const char *key_path) {
+    if (find_span(key_path)) {
+        return 0;
+    }
+
+    if (strlen(key_path) >= MAJESTIC_CONFIG_KEY_MAX_LEN || config_cache.span_count >= CONFIG_MAX_WATCHED_KEYS) {
+        return -1;
+    }
+
+    config_span_t *span = &config_cache.spans[config_cache.span_count++];
+    memset(span, 0, sizeof(*span));
+    strcpy(span->key, key_path);
+
+    // The new key has no span yet; force a re-index on next use.
+    config_cache.valid = false;
+    return 0;
+}
+
+int majestic_config_watch_key(const char *key_path) {
+    if (!key_path || key_path[0] == '\0') {
+        return -1;
+    }
+
+    return watch_key(key_path);
+}
+
+// Try to apply the whole transaction through the offset index.
+//
+// @return 0 when patched, 1 when the caller must use the document path,
+//         -1 on a write error.
+static int commit_in_place(const majestic_config_txn_t *txn) {
+    config_span_t *spans[MAJESTIC_CONFIG_TXN_MAX_CHANGES];
+    size_t new_length = 0;
 
-    if (!reload_document(config_path, &document, &root_node, &root_id)) {
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        if (watch_key(txn->changes[i].key) != 0 || !is_plain_safe(txn->changes[i].value)) {
+            return 1;
+        }
+    }
+
+    if (!cache_is_fresh(txn->config_path) && !load_cache(txn->config_path)) {
+        return 1;
+    }
+
+    new_length = config_cache.length;
+
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        spans[i] = find_span(txn->changes[i].key);
+
+        if (!spans[i] || !spans[i]->found || !spans[i]->patchable) {
+            return 1;
+        }
+
+        new_length = new_length - (spans[i]->end - spans[i]->start) + strlen(txn->changes[i].value);
+    }
+
+    if (new_length >= sizeof(config_cache.data)) {
+        return 1;
+    }
+
+    bool any_changed = false;
+
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        config_span_t *span = spans[i];
+        const char *value = txn->changes[i].value;
+        const size_t value_length = strlen(value);
+
+        if (span->end - span->start == value_length &&
+            memcmp(config_cache.data + span->start, value, value_length) == 0) {
+            continue;
+        }
+
+        splice_span(span, value);
+        any_changed = true;
+    }
+
+    if (!any_changed) {
+        return 0;
+    }
+
+    // Every change lands with one write and one rename.
+    return write_cache();
+}
+
+int majestic_config_get(const char *config_path, const char *key_path, char *out, size_t out_size) {
+    if (!key_path || !out || out_size == 0 || watch_key(key_path) != 0) {
+        return -1;
+    }
+
+    if (!cache_is_fresh(config_path) && !load_cache(config_path)) {
+        return -1;
+    }
+
+    const config_span_t *span = find_span(key_path);
+
+    if (!span || !span->found || !span->patchable || span->end - span->start >= out_size) {
+        return -1;
+    }
+
+    memcpy(out, config_cache.data + span->start, span->end - span->start);
+    out[span->end - span->start] = '\0';
+    return 0;
+}
+
+// "4096" and "4096.0", or "1" and "1.00", hold the same number.
+static bool same_value(const char *current, const char *wanted) {
+    if (strcmp(current, wanted) == 0) {
+        return true;
+    }
+
+    char *current_end = NULL;
+    char *wanted_end = NULL;
+    const double current_number = strtod(current, &current_end);
+    const double wanted_number = strtod(wanted, &wanted_end);
+
+    return current_end != current && *current_end == '\0' &&
+           wanted_end != wanted && *wanted_end == '\0' &&
+           current_number == wanted_number;
+}
+
+size_t majestic_config_drop_unchanged(majestic_config_txn_t *txn) {
+    char current[MAJESTIC_CONFIG_VALUE_MAX_LEN];
+    size_t kept = 0;
+
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        const majestic_config_change_t *change = &txn->changes[i];
+
+        if (majestic_config_get(txn->config_path, change->key, current, sizeof(current)) == 0 &&
+            same_value(current, change->value)) {
+            continue;
+        }
+
+        if (kept != i) {
+            txn->changes[kept] = *change;
+        }
+
+        ++kept;
+    }
+
+    const size_t dropped = txn->change_count - kept;
+    txn->change_count = kept;
+    return dropped;
+}
+
+void majestic_config_set_durable(bool durable) {
+    durable_writes = durable;
+}
+
+void majestic_config_begin(majestic_config_txn_t *txn, const char *config_path) {
+    txn->config_path = config_path;
+    txn->change_count = 0;
+}
+
+int majestic_config_set(majestic_config_txn_t *txn, const char *key_path, const char *value) {
+    if (!key_path || !value ||
+        strlen(key_path) >= MAJESTIC_CONFIG_KEY_MAX_LEN ||
+        strlen(value) >= MAJESTIC_CONFIG_VALUE_MAX_LEN) {
+        return -1;
+    }
+
+    majestic_config_change_t *change = NULL;
+
+    // Setting the same key twice keeps only the last value.
+    for (size_t i = 0; i < txn->change_count; ++i) {
+        if (strcmp(txn->changes[i].key, key_path) == 0) {
+            change = &txn->changes[i];
+            break;
+        }
+    }
+
+    if (!change) {
+        if (txn->change_count >= MAJESTIC_CONFIG_TXN_MAX_CHANGES) {
+            return -1;
+        }
+
+        change = &txn->changes[txn->change_count++];
+        strcpy(change->key, key_path);
+    }
+
+    strcpy(change->value, value);
+    return 0;
+}
+
+int majestic_config_commit(majestic_config_txn_t *txn) {
+    if (txn->change_count == 0) {
+        return 0;
+    }
+
+    const int result = commit_in_place(txn);
+
+    if (result <= 0) {
+        return result;
+    }
+
+    if (commit_via_document(txn) != 0) {
         return -1;
     }
 
-    yaml_node_t *video_node = NULL;
-    const int video_id = ensure_child_mapping(&document, root_node, root_id, "video1", &video_node);
+    // The emitter reformats the whole file, so every span has moved.
+    (void)load_cache(txn->config_path);
+    return 0;
+}
+
+int majestic_config_restore(const char *config_path, const char *source_path) {
+    const size_t path_length = strlen(config_path);
 
-    if (video_id == 0 || !video_node) {
-        fprintf(stderr, "Failed to ensure video1 section inside %s.\n", config_path);
-        yaml_document_delete(&document);
+    if (path_length >= sizeof(config_cache.path)) {
+        fprintf(stderr, "Config path too long: %s\n", config_path);
         return -1;
     }
 
-    if (!set_mapping_scalar(&document, video_node, video_id, "crop", crop_value)) {
-        fprintf(stderr, "Failed to set crop field inside %s.\n", config_path);
-        yaml_document_delete(&document);
+    // Indexing the copy on the way in also rejects one that is not YAML.
+    if (!load_cache(source_path)) {
+        fprintf(stderr, "Failed to read %s as a Majestic config.\n", source_path);
         return -1;
     }
 
-    if (!persist_document(config_path, &document)) {
+    config_cache.valid = false;
+    memcpy(config_cache.path, config_path, path_length + 1);
+
+    if (write_cache() != 0) {
         return -1;
     }
 
+    (void)load_cache(config_path);
     return 0;
 }
+
+int majestic_config_set_crop(const char *config_path, const char *crop_value) {
+    majestic_config_txn_t txn;
+
+    majestic_config_begin(&txn, config_path);
+
+    if (majestic_config_set(&txn, "video1.crop", crop_value) != 0) {
+        return -1;
+    }
+
+    return majestic_config_commit(&txn);
+}
@@ -1,7 +1,85 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MAJESTIC_CONFIG_TXN_MAX_CHANGES 16
+#define MAJESTIC_CONFIG_KEY_MAX_LEN 64
+#define MAJESTIC_CONFIG_VALUE_MAX_LEN 64
+
+typedef struct majestic_config_change {
+    char key[MAJESTIC_CONFIG_KEY_MAX_LEN];     // dotted path, e.g. "video1.bitrate"
+    char value[MAJESTIC_CONFIG_VALUE_MAX_LEN];
+} majestic_config_change_t;
+
+/**
+ * A batch of key changes that is committed with a single parse (if any) and a
+ * single write. Callers trigger one Majestic reload per successful commit.
+ */
+typedef struct majestic_config_txn {
+    const char *config_path;
+    majestic_config_change_t changes[MAJESTIC_CONFIG_TXN_MAX_CHANGES];
+    size_t change_count;
+} majestic_config_txn_t;
+
+/**
+ * Make every config replacement durable before it is renamed into place:
+ * fsync(2) the new file first and its directory after. Needed when the
+ * config is written straight to flash; a tmpfs working copy skips it.
+ */
+void majestic_config_set_durable(bool durable);
+
+/**
+ * Start an empty transaction against the given Majestic YAML config.
+ */
+void majestic_config_begin(majestic_config_txn_t *txn, const char *config_path);
+
+/**
+ * Stage `key_path = value` (e.g., "isp.exposure" = "8"). Staging the same key
+ * again replaces the earlier value. Missing intermediate mappings are created
+ * on commit.
+ *
+ * @return 0 on success, -1 if the key/value is too long or the batch is full.
+ */
+int majestic_config_set(majestic_config_txn_t *txn, const char *key_path, const char *value);
+
+/**
+ * Remove staged changes whose value the config already holds (same text, or
+ * the same number), so a batch that changes nothing costs no write and no
+ * reload. Keys that are missing or not plain scalars are kept.
+ *
+ * @return number of changes removed.
+ */
+size_t majestic_config_drop_unchanged(majestic_config_txn_t *txn);
+
+/**
+ * Apply every staged change with one atomic replace of the file. Values are
+ * spliced via the offset index when possible; otherwise the document is
+ * loaded once, updated through the libyaml DOM and emitted once.
+ *
+ * @return 0 on success, -1 on error (details logged to stderr).
+ */
+int majestic_config_commit(majestic_config_txn_t *txn);
+
+/**
+ * Replace the whole config with the contents of `source_path` (e.g. a known
+ * good copy), through the same temporary file and rename(2) as a commit, so a
+ * symlinked config keeps its link. The copy must parse as YAML.
+ *
+ * @return 0 on success, -1 on error (details logged to stderr).
+ */
+int majestic_config_restore(const char *config_path, const char *source_path);
+
 /**
  * Update (or create) the `video1.crop` entry inside the Majestic YAML config.
+ * Shorthand for a one-change transaction.
+ *
+ * The file is read and indexed once; while its inode, size and mtime stay as
+ * we left them, updates splice the new value into the cached bytes. External
+ * edits trigger a re-index, and a missing key falls back to a full libyaml
+ * load/emit. Either way the result goes to a temporary file that is renamed
+ * over the config (or the file a symlink points to), so a crash or power cut
+ * leaves the old or the new config, never a mix.
  *
  * @param config_path Absolute path to /etc/majestic.yaml (or override).
  * @param crop_value  New crop string (e.g., "0x0x1920x1080").
@@ -9,3 +87,21 @@
  * @return 0 on success, -1 on error (details logged to stderr).
  */
 int majestic_config_set_crop(const char *config_path, const char *crop_value);
+
+/**
+ * Read a plain scalar (e.g., "system.webPort") from the Majestic YAML config
+ * through the same offset index the update path uses.
+ *
+ * @return 0 on success, -1 if the key is missing, not a plain scalar or does
+ *         not fit into `out`.
+ */
+int majestic_config_get(const char *config_path, const char *key_path, char *out, size_t out_size);
+
+/**
+ * Track the byte span of another dotted key (e.g., "video1.bitrate") so later
+ * updates to it can be patched in place instead of re-emitting the document.
+ * `video1.crop` is watched implicitly by majestic_config_set_crop().
+ *
+ * @return 0 on success, -1 if the key is too long or the watch table is full.
+ */
+int majestic_config_watch_key(const char *key_path);
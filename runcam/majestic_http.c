@@ -0,0 +1,480 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "majestic_http.h"
+
+typedef struct http_body_sink {
+    char *data;
+    size_t size;
+    size_t length;
+    bool binary;    // no NUL terminator; the whole size holds body bytes
+    bool truncated; // the body did not fit
+} http_body_sink_t;
+
+void majestic_http_init(majestic_http_conn_t *conn, const char *host, uint16_t port, int timeout_ms) {
+    memset(conn, 0, sizeof(*conn));
+    snprintf(conn->host, sizeof(conn->host), "%s", host);
+    conn->port = port;
+    conn->timeout_ms = timeout_ms;
+    conn->fd = -1;
+}
+
+void majestic_http_close(majestic_http_conn_t *conn) {
+    if (conn->fd >= 0) {
+        close(conn->fd);
+    }
+
+    conn->fd = -1;
+    conn->buffer_start = 0;
+    conn->buffer_end = 0;
+}
+
+static bool wait_for(int fd, short events, int timeout_ms) {
+    struct pollfd pfd = {
+        .fd = fd,
+        .events = events,
+        .revents = 0
+    };
+
+    int ready;
+
+    do {
+        ready = poll(&pfd, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready == 0) {
+        errno = ETIMEDOUT;
+    }
+
+    return ready > 0;
+}
+
+static int connect_socket(majestic_http_conn_t *conn) {
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(conn->port);
+
+    if (inet_pton(AF_INET, conn->host, &address.sin_addr) != 1) {
+        fprintf(stderr, "Invalid Majestic HTTP host %s.\n", conn->host);
+        return -1;
+    }
+
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create HTTP socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    // Requests are tiny and latency-bound; never let Nagle hold them back.
+    const int enabled = 1;
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+
+    if (connect(fd, (const struct sockaddr *)&address, sizeof(address)) != 0) {
+        int error = errno;
+        socklen_t error_length = sizeof(error);
+
+        if (error != EINPROGRESS ||
+            !wait_for(fd, POLLOUT, conn->timeout_ms) ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0 ||
+            error != 0) {
+            fprintf(stderr, "Unable to connect to Majestic at %s:%u: %s\n",
+                    conn->host, conn->port, strerror(error != EINPROGRESS ? error : errno));
+            close(fd);
+            return -1;
+        }
+    }
+
+    conn->fd = fd;
+    conn->buffer_start = 0;
+    conn->buffer_end = 0;
+    return 0;
+}
+
+static int send_all(majestic_http_conn_t *conn, const char *data, size_t length) {
+    size_t offset = 0;
+
+    while (offset < length) {
+        const ssize_t sent = send(conn->fd, data + offset, length - offset, MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN && wait_for(conn->fd, POLLOUT, conn->timeout_ms)) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        offset += (size_t)sent;
+    }
+
+    return 0;
+}
+
+// Receive into `data`, waiting up to the timeout while nothing is there.
+// Returns bytes received, 0 on orderly shutdown, -1 on error or timeout.
+static ssize_t receive(majestic_http_conn_t *conn, char *data, size_t size) {
+    while (1) {
+        const ssize_t received = recv(conn->fd, data, size, 0);
+
+        if (received >= 0) {
+            return received;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EAGAIN || !wait_for(conn->fd, POLLIN, conn->timeout_ms)) {
+            return -1;
+        }
+    }
+}
+
+// Pull more bytes into the connection buffer, compacting consumed space first.
+// Returns bytes received, 0 on orderly shutdown, -1 on error or timeout.
+static ssize_t fill_buffer(majestic_http_conn_t *conn) {
+    if (conn->buffer_start > 0) {
+        memmove(conn->buffer, conn->buffer + conn->buffer_start, conn->buffer_end - conn->buffer_start);
+        conn->buffer_end -= conn->buffer_start;
+        conn->buffer_start = 0;
+    }
+
+    if (conn->buffer_end >= sizeof(conn->buffer)) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    const ssize_t received = receive(conn, conn->buffer + conn->buffer_end, sizeof(conn->buffer) - conn->buffer_end);
+
+    if (received > 0) {
+        conn->buffer_end += (size_t)received;
+    }
+
+    return received;
+}
+
+// Copy one CRLF-terminated line (without the terminator) out of the buffer.
+static int read_line(majestic_http_conn_t *conn, char *line, size_t line_size) {
+    while (1) {
+        const char *start = conn->buffer + conn->buffer_start;
+        const size_t available = conn->buffer_end - conn->buffer_start;
+        const char *newline = memchr(start, '\n', available);
+
+        if (newline) {
+            size_t length = (size_t)(newline - start);
+            conn->buffer_start += length + 1;
+
+            if (length > 0 && start[length - 1] == '\r') {
+                length--;
+            }
+
+            if (length >= line_size) {
+                length = line_size - 1;
+            }
+
+            memcpy(line, start, length);
+            line[length] = '\0';
+            return 0;
+        }
+
+        if (fill_buffer(conn) <= 0) {
+            return -1;
+        }
+    }
+}
+
+static size_t sink_room(const http_body_sink_t *sink) {
+    if (!sink->data || sink->size == 0) {
+        return 0;
+    }
+
+    return sink->size - (sink->binary ? 0 : 1) - sink->length;
+}
+
+static void sink_append(http_body_sink_t *sink, const char *data, size_t length) {
+    if (!sink->data || sink->size == 0) {
+        return;
+    }
+
+    const size_t room = sink_room(sink);
+    const size_t copied = length < room ? length : room;
+
+    memcpy(sink->data + sink->length, data, copied);
+    sink->length += copied;
+    sink->truncated |= copied < length;
+
+    if (!sink->binary) {
+        sink->data[sink->length] = '\0';
+    }
+}
+
+// Consume exactly `length` body bytes, or everything until EOF if `to_eof`.
+static int read_body(majestic_http_conn_t *conn, size_t length, bool to_eof, http_body_sink_t *sink) {
+    size_t remaining = length;
+
+    while (to_eof || remaining > 0) {
+        const size_t room = sink_room(sink);
+
+        // Once the buffered bytes are used up, a large body (a JPEG) is
+        // received straight into the sink instead of 2 KiB at a time.
+        if (conn->buffer_start == conn->buffer_end && sink->binary && room > 0 && (to_eof || remaining > 0)) {
+            const ssize_t received = receive(conn, sink->data + sink->length,
+                                             !to_eof && remaining < room ? remaining : room);
+
+            if (received == 0 && to_eof) {
+                return 0;
+            }
+
+            if (received <= 0) {
+                return -1;
+            }
+
+            sink->length += (size_t)received;
+            remaining -= to_eof ? 0 : (size_t)received;
+            continue;
+        }
+
+        if (conn->buffer_start == conn->buffer_end) {
+            const ssize_t received = fill_buffer(conn);
+
+            if (received == 0 && to_eof) {
+                return 0;
+            }
+
+            if (received <= 0) {
+                return -1;
+            }
+        }
+
+        size_t chunk = conn->buffer_end - conn->buffer_start;
+
+        if (!to_eof && chunk > remaining) {
+            chunk = remaining;
+        }
+
+        sink_append(sink, conn->buffer + conn->buffer_start, chunk);
+        conn->buffer_start += chunk;
+        remaining -= to_eof ? 0 : chunk;
+    }
+
+    return 0;
+}
+
+static int read_chunked_body(majestic_http_conn_t *conn, http_body_sink_t *sink) {
+    char line[128];
+
+    while (1) {
+        if (read_line(conn, line, sizeof(line)) != 0) {
+            return -1;
+        }
+
+        const size_t chunk_length = (size_t)strtoul(line, NULL, 16);
+
+        if (chunk_length == 0) {
+            // Skip optional trailers up to the terminating blank line.
+            do {
+                if (read_line(conn, line, sizeof(line)) != 0) {
+                    return -1;
+                }
+            } while (line[0] != '\0');
+
+            return 0;
+        }
+
+        if (read_body(conn, chunk_length, false, sink) != 0 || read_line(conn, line, sizeof(line)) != 0) {
+            return -1;
+        }
+    }
+}
+
+// Read one full response. `*received_any` tells the caller whether a failure
+// happened before the server sent anything (i.e., a stale keep-alive socket).
+static int read_response(majestic_http_conn_t *conn, http_body_sink_t *sink, bool *received_any) {
+    char line[256];
+
+    *received_any = false;
+
+    if (read_line(conn, line, sizeof(line)) != 0) {
+        return -1;
+    }
+
+    *received_any = true;
+
+    int status = 0;
+
+    if (sscanf(line, "HTTP/%*d.%*d %d", &status) != 1) {
+        fprintf(stderr, "Malformed HTTP status line from Majestic: %s\n", line);
+        return -1;
+    }
+
+    size_t content_length = 0;
+    bool has_length = false;
+    bool chunked = false;
+    bool close_after = false;
+
+    while (1) {
+        if (read_line(conn, line, sizeof(line)) != 0) {
+            return -1;
+        }
+
+        if (line[0] == '\0') {
+            break;
+        }
+
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_length = (size_t)strtoul(line + 15, NULL, 10);
+            has_length = true;
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0 && strcasestr(line + 18, "chunked")) {
+            chunked = true;
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strcasestr(line + 11, "close")) {
+            close_after = true;
+        }
+    }
+
+    int result = 0;
+
+    if (chunked) {
+        result = read_chunked_body(conn, sink);
+    } else if (has_length) {
+        result = read_body(conn, content_length, false, sink);
+    } else {
+        result = read_body(conn, 0, true, sink);
+        close_after = true;
+    }
+
+    if (result != 0) {
+        return -1;
+    }
+
+    if (close_after) {
+        majestic_http_close(conn);
+    }
+
+    return status;
+}
+
+static int perform_get(majestic_http_conn_t *conn, const char *target, http_body_sink_t *sink) {
+    char request[1024];
+    const int request_length = snprintf(
+        request,
+        sizeof(request),
+        "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n",
+        target,
+        conn->host);
+
+    if (request_length <= 0 || (size_t)request_length >= sizeof(request)) {
+        fprintf(stderr, "HTTP request for %s is too long.\n", target);
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const bool reused = conn->fd >= 0;
+
+        if (!reused && connect_socket(conn) != 0) {
+            return -1;
+        }
+
+        sink->length = 0;
+        sink->truncated = false;
+
+        if (sink->data && sink->size > 0 && !sink->binary) {
+            sink->data[0] = '\0';
+        }
+
+        bool received_any = false;
+        int status = -1;
+
+        if (send_all(conn, request, (size_t)request_length) == 0) {
+            status = read_response(conn, sink, &received_any);
+        }
+
+        if (status >= 0) {
+            return status;
+        }
+
+        const int error = errno;
+        majestic_http_close(conn);
+
+        // A keep-alive socket may have been closed by Majestic while idle;
+        // that shows up as a failure before any response byte. Retry once.
+        if (reused && !received_any) {
+            continue;
+        }
+
+        fprintf(stderr, "HTTP request %s to Majestic failed: %s\n", target, strerror(error));
+        return -1;
+    }
+
+    return -1;
+}
+
+int majestic_http_get(majestic_http_conn_t *conn, const char *target, char *body, size_t body_size) {
+    http_body_sink_t sink = {
+        .data = body,
+        .size = body_size
+    };
+
+    return perform_get(conn, target, &sink);
+}
+
+int majestic_http_fetch(majestic_http_conn_t *conn, const char *target, void *body, size_t body_size, size_t *length) {
+    http_body_sink_t sink = {
+        .data = body,
+        .size = body_size,
+        .binary = true
+    };
+
+    const int status = perform_get(conn, target, &sink);
+    *length = sink.length;
+
+    if (status >= 0 && sink.truncated) {
+        fprintf(stderr, "HTTP response to %s is larger than %zu bytes.\n", target, body_size);
+        return -1;
+    }
+
+    return status;
+}
+
+int majestic_http_append_encoded(char *out, size_t out_size, const char *value) {
+    static const char HEX[] = "0123456789ABCDEF";
+    size_t length = strlen(out);
+
+    for (const char *c = value; *c; ++c) {
+        const unsigned char ch = (unsigned char)*c;
+        const bool unreserved = isalnum(ch) || ch == '-' || ch == '_' || ch == '.' || ch == '~';
+
+        if (length + (unreserved ? 1 : 3) >= out_size) {
+            return -1;
+        }
+
+        if (unreserved) {
+            out[length++] = (char)ch;
+        } else {
+            out[length++] = '%';
+            out[length++] = HEX[ch >> 4];
+            out[length++] = HEX[ch & 0x0F];
+        }
+    }
+
+    out[length] = '\0';
+    return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAJESTIC_HTTP_BUFFER_SIZE 2048
+
+/**
+ * Persistent HTTP/1.1 keep-alive connection to Majestic's local web server.
+ * The socket is opened lazily and reused across requests; a request that hits
+ * a connection the server already closed is retried once on a fresh socket.
+ */
+typedef struct majestic_http_conn {
+    char host[64];
+    uint16_t port;
+    int timeout_ms;
+    int fd;
+    char buffer[MAJESTIC_HTTP_BUFFER_SIZE];
+    size_t buffer_start; // first unread byte in buffer
+    size_t buffer_end;   // one past the last received byte
+} majestic_http_conn_t;
+
+void majestic_http_init(majestic_http_conn_t *conn, const char *host, uint16_t port, int timeout_ms);
+
+void majestic_http_close(majestic_http_conn_t *conn);
+
+/**
+ * Issue `GET target` and read the complete response. The body is discarded
+ * unless `body`/`body_size` are provided, in which case up to `body_size - 1`
+ * bytes are copied and NUL-terminated.
+ *
+ * @return HTTP status code, or -1 on a transport error (details logged).
+ */
+int majestic_http_get(majestic_http_conn_t *conn, const char *target, char *body, size_t body_size);
+
+/**
+ * Issue `GET target` and store the binary body in `body`. Body bytes beyond
+ * what the connection already buffered are received straight into `body`.
+ *
+ * @param length Receives the number of body bytes stored.
+ * @return HTTP status code, or -1 on a transport error or a body larger than
+ *         `body_size` (details logged).
+ */
+int majestic_http_fetch(majestic_http_conn_t *conn, const char *target, void *body, size_t body_size, size_t *length);
+
+/**
+ * Append `value` to `out` with URL percent-encoding.
+ *
+ * @return 0 on success, -1 if `out` is too small.
+ */
+int majestic_http_append_encoded(char *out, size_t out_size, const char *value);
@@ -1,127 +1,1252 @@
 #define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "adaptive_bitrate.h"
+#include "apply_worker.h"
+#include "camera_protocol.h"
+#include "command_registry.h"
+#include "config_sync.h"
+#include "event_loop.h"
+#include "flight_recorder.h"
+#include "image_capture.h"
+#include "latency_trace.h"
 #include "matek_mavlink.h"
+#include "memory_stats.h"
+#include "majestic_apply.h"
 #include "majestic_config.h"
-#include "majestic_process.h"
-
-static const char *const CROPS[] = {
-    "0x0x1920x1080",
-    "480x270x960x540",
-    "720x405x480x270",
-    "840x472x240x135",
-};
-
-static const char *const DEFAULT_MAJESTIC_CONFIG = "/etc/majestic.yaml";
-static size_t current_crop_index = 0;
-static const size_t CROP_INDEX_MIN = 0;
-static const size_t CROP_INDEX_MAX = sizeof(CROPS) / sizeof(CROPS[0]) - 1;
-static const struct timespec RECONNECT_DELAY = {
-    .tv_sec = 1,
-    .tv_nsec = 0
-};
-
-static int apply_crop_index(size_t new_index) {
-    if (new_index > CROP_INDEX_MAX) {
-        return -1;
+#include "majestic_supervisor.h"
+#include "manager_config.h"
+#include "manager_state.h"
+#include "mavlink_router.h"
+#include "osd_feed.h"
+#include "stats_socket.h"
+#include "statustext_assembler.h"
+#include "yaml_arena.h"
+#include "zoom.h"
+
+static const char *const DEFAULT_MANAGER_CONFIG = "/etc/majestic_manager.yaml";
+static const int RECONNECT_DELAY_MS = 1000;
+static const uint64_t HEARTBEAT_INTERVAL_MS = 1000;
+static const uint64_t SUPERVISOR_INTERVAL_MS = 100;
+// Frame assumed for crops when the Majestic config names no video size.
+static const uint32_t FALLBACK_FRAME_WIDTH = 1920;
+static const uint32_t FALLBACK_FRAME_HEIGHT = 1080;
+
+static manager_config_t manager_config;
+static zoom_engine_t zoom_engine;
+static double current_zoom = 1.0;
+static double applied_zoom = 1.0;
+// Encoder profile of the queued target and of the last successful apply;
+// -1 is the baseline below all profiles, PROFILE_UNKNOWN forces a rewrite.
+#define PROFILE_UNKNOWN (-2)
+static int current_profile = PROFILE_UNKNOWN;
+static int applied_profile = PROFILE_UNKNOWN;
+static encoder_profile_t baseline_profile = { .min_qp = -1, .max_qp = -1 }; // video1 encoder keys before any profile
+static bool adaptive_enabled = false;
+static adaptive_bitrate_t adaptive;
+static uint32_t normal_fps = 0; // fps restored when the adaptive low-fps tier ends
+static uint32_t zoom_sequence = 0;
+static uint32_t rollback_sequence = 0; // restore of the good config in the worker, 0 if none
+// A rollback put back a config whose crop and encoder keys we did not write,
+// so the next zoom request is applied even if it matches current_zoom.
+static bool zoom_stale = false;
+static flight_recorder_t recorder = { .fd = -1 };
+static config_sync_t config_sync;
+static config_sync_t state_sync;
+static bool saving_state = false; // zoom.state is set
+static statustext_assembler_t statustext_assembler;
+static majestic_supervisor_t supervisor;
+static bool supervising = false; // Majestic runs as our child
+static bool capturing = false;   // MAV_CMD_IMAGE_START_CAPTURE is served
+static bool osd_feeding = false;  // telemetry goes to Majestic's OSD
+
+typedef struct manager_options {
+    const char *config_path;
+    bool router;             // --router: forward MAVLink only
+    const char *replay_path; // --replay: feed a recorder file instead of the UART
+    double replay_speed;     // --speed: 1 is real time, 0 as fast as possible
+} manager_options_t;
+
+typedef struct manager_session {
+    event_loop_t loop;
+    int matek_fd;
+    bool shutdown_requested;
+} manager_session_t;
+
+static bool same_zoom(double a, double b) {
+    return fabs(a - b) < 1e-3;
+}
+
+// Stage every encoder key of profile `index` (-1: below all profiles), with
+// the baseline filling in what the profile omits.
+// With adaptive bitrate on, the profile bitrate becomes the controller's
+// ceiling and the controller's (possibly lower) rate and fps tier are used.
+static int stage_profile(majestic_config_txn_t *txn, int index) {
+    encoder_profile_t resolved;
+
+    manager_config_resolve_profile(&manager_config, index, &baseline_profile, &resolved);
+
+    if (resolved.fps > 0) {
+        normal_fps = resolved.fps;
+    }
+
+    if (adaptive_enabled) {
+        adaptive_bitrate_set_ceiling(&adaptive, index >= 0 ? manager_config.profiles[index].bitrate : 0);
+        resolved.bitrate = adaptive.bitrate_kbps;
+
+        if (resolved.fps > 0 && adaptive.low_fps_active) {
+            resolved.fps = adaptive.config.low_fps;
+        }
     }
 
-    if (majestic_config_set_crop(DEFAULT_MAJESTIC_CONFIG, CROPS[new_index]) != 0) {
-        fprintf(stderr, "Failed to update Majestic crop to %s\n", CROPS[new_index]);
+    return manager_config_stage_profile(txn, &resolved);
+}
+
+// Hand the crop change to the apply worker; the I/O loop never blocks on
+// config writes or Majestic reloads. current_zoom tracks the target so quick
+// successive zoom steps build on each other and coalesce in the worker.
+// Crossing into another encoder profile stages its keys in the same
+// transaction, so the crop and the encoder change land in one write.
+// Returns 0 when queued, -1 on failure and CAMERA_ZOOM_BUSY when the worker
+// backlog had no room; only a queued zoom moves current_zoom.
+static int apply_zoom(double factor) {
+    const double clamped = zoom_clamp(&zoom_engine, factor);
+    const zoom_rect_t rect = zoom_compute(&zoom_engine, clamped, 0.0, 0.0);
+    const int profile = manager_config_select_profile(&manager_config, clamped);
+    // Staging a profile moves the adaptive ceiling; undone if nothing is queued.
+    const adaptive_bitrate_t previous_adaptive = adaptive;
+    const uint32_t previous_normal_fps = normal_fps;
+    char crop[48];
+
+    zoom_format_crop(&rect, crop, sizeof(crop));
+
+    majestic_config_txn_t txn;
+    majestic_config_begin(&txn, manager_config.majestic_config_path);
+
+    if (majestic_config_set(&txn, "video1.crop", crop) != 0) {
+        fprintf(stderr, "Failed to stage Majestic crop %s\n", crop);
         return -1;
     }
 
-    if (reload_majestic_process() != 0) {
-        fprintf(stderr, "Failed to reload Majestic after updating crop.\n");
+    if (manager_config.profile_count > 0 && profile != current_profile && stage_profile(&txn, profile) != 0) {
+        fprintf(stderr, "Failed to stage encoder profile for %.2fx\n", clamped);
+        adaptive = previous_adaptive;
+        normal_fps = previous_normal_fps;
         return -1;
     }
 
-    current_crop_index = new_index;
+    // Saved by the worker once Majestic has accepted the zoom.
+    const manager_state_t state = {
+        .zoom = clamped,
+        .has_baseline = manager_config.profile_count > 0,
+        .baseline = baseline_profile
+    };
+    const uint32_t sequence = apply_worker_submit_state(&txn, saving_state ? &state : NULL);
+
+    if (sequence == 0) {
+        adaptive = previous_adaptive;
+        normal_fps = previous_normal_fps;
+        return CAMERA_ZOOM_BUSY;
+    }
+
+    zoom_sequence = sequence;
+    zoom_stale = false;
+    current_zoom = clamped;
+    current_profile = profile;
     return 0;
 }
 
-static void handle_statustext(const char *text) {
-    if (strcmp(text, "zoom_in") == 0) {
-        if (current_crop_index < CROP_INDEX_MAX) {
-            (void)apply_crop_index(current_crop_index + 1);
+// Queue a zoom change unless the target already matches.
+// Returns 1 when queued, 0 for a no-op, -1 on failure and CAMERA_ZOOM_BUSY
+// when the worker backlog is full.
+static int request_zoom(double factor, uint32_t *sequence) {
+    const double clamped = zoom_clamp(&zoom_engine, factor);
+
+    if (same_zoom(clamped, current_zoom) && !zoom_stale) {
+        return 0;
+    }
+
+    const int applied = apply_zoom(clamped);
+
+    if (applied != 0) {
+        return applied;
+    }
+
+    if (sequence) {
+        *sequence = zoom_sequence;
+    }
+
+    return 1;
+}
+
+// Run a command line received as STATUSTEXT, e.g. "zoom 2.5" or
+// "set video1.bitrate 800". Unknown commands are ignored: the flight
+// controller also forwards its own status messages.
+static void handle_command(const char *text) {
+    command_call_t call;
+    majestic_config_txn_t txn;
+
+    if (command_parse(text, &call) != 0) {
+        return;
+    }
+
+    const command_t *command = command_registry_find(&manager_config.commands, call.name);
+
+    if (!command) {
+        return;
+    }
+
+    if (call.arg_count < command->min_args) {
+        fprintf(stderr, "Command %s needs %zu argument(s).\n", command->name, command->min_args);
+        return;
+    }
+
+    switch (command->kind) {
+    case COMMAND_ZOOM_IN:
+        (void)request_zoom(current_zoom * zoom_engine.step_factor, NULL);
+        return;
+    case COMMAND_ZOOM_OUT:
+        (void)request_zoom(current_zoom / zoom_engine.step_factor, NULL);
+        return;
+    case COMMAND_ZOOM: {
+        char *end = NULL;
+        const double factor = strtod(call.args[0], &end);
+
+        if (end == call.args[0] || *end != '\0' || !(factor > 0.0)) {
+            fprintf(stderr, "Invalid zoom factor %s.\n", call.args[0]);
+            return;
         }
+
+        (void)request_zoom(factor, NULL);
         return;
     }
+    case COMMAND_SET:
+        if (!majestic_apply_settable(call.args[0])) {
+            fprintf(stderr, "Key %s cannot be set by command.\n", call.args[0]);
+            return;
+        }
+
+        majestic_config_begin(&txn, manager_config.majestic_config_path);
 
-    if (strcmp(text, "zoom_out") == 0) {
-        if (current_crop_index > CROP_INDEX_MIN) {
-            (void)apply_crop_index(current_crop_index - 1);
+        if (majestic_config_set(&txn, call.args[0], call.args[1]) != 0) {
+            fprintf(stderr, "Cannot set %s=%s.\n", call.args[0], call.args[1]);
+            return;
+        }
+        break;
+    case COMMAND_CHANGES:
+        majestic_config_begin(&txn, manager_config.majestic_config_path);
+
+        if (command_stage_changes(command, &call, &txn) != 0) {
+            return;
         }
+        break;
     }
+
+    fprintf(stderr, "Running command %s.\n", command->name);
+    (void)apply_worker_submit(&txn);
 }
 
-static uint64_t monotonic_now_ms(void) {
-    struct timespec now;
+static int zoom_step(int direction, uint32_t *sequence, void *context) {
+    (void)context;
 
-    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
-        return 0;
+    const double factor = direction > 0
+        ? current_zoom * zoom_engine.step_factor
+        : current_zoom / zoom_engine.step_factor;
+
+    return request_zoom(factor, sequence);
+}
+
+static int zoom_set_range(float percent, uint32_t *sequence, void *context) {
+    (void)context;
+
+    // Large jumps go straight to the target in a single apply.
+    return request_zoom(zoom_factor_from_percent(&zoom_engine, percent), sequence);
+}
+
+static float zoom_level(void *context) {
+    (void)context;
+    return (float)zoom_percent_from_factor(&zoom_engine, current_zoom);
+}
+
+// Crops are expressed in the video1 stream frame; fall back to the sensor
+// frame (video0.size) if the stream size is not set.
+static int init_zoom_engine(void) {
+    const char *const majestic_config = manager_config.majestic_config_path;
+    uint32_t frame_width = FALLBACK_FRAME_WIDTH;
+    uint32_t frame_height = FALLBACK_FRAME_HEIGHT;
+    uint32_t sensor_width = 0;
+    uint32_t sensor_height = 0;
+    char value[32];
+
+    if (majestic_config_get(majestic_config, "video0.size", value, sizeof(value)) == 0) {
+        (void)zoom_parse_size(value, &sensor_width, &sensor_height);
     }
 
+    if (majestic_config_get(majestic_config, "video1.size", value, sizeof(value)) != 0 ||
+        zoom_parse_size(value, &frame_width, &frame_height) != 0) {
+        if (sensor_width > 0) {
+            frame_width = sensor_width;
+            frame_height = sensor_height;
+        }
+    }
+
+    if (zoom_engine_init(
+            &zoom_engine,
+            frame_width,
+            frame_height,
+            manager_config.zoom.max,
+            manager_config.zoom.step,
+            manager_config.zoom.alignment) != 0) {
+        fprintf(stderr, "Invalid zoom settings (max=%g step=%g alignment=%u) for %ux%u.\n",
+                manager_config.zoom.max, manager_config.zoom.step, manager_config.zoom.alignment,
+                frame_width, frame_height);
+        return -1;
+    }
+
+    fprintf(stderr, "Zoom frame %ux%u (sensor %ux%u), up to %gx in %gx steps.\n",
+            frame_width, frame_height, sensor_width, sensor_height,
+            zoom_engine.max_factor, zoom_engine.step_factor);
+    return 0;
+}
+
+static void init_adaptive_bitrate(void) {
+    const char *const majestic_config = manager_config.majestic_config_path;
+    char value[32];
+    uint32_t initial_kbps = 0;
+
+    if (!manager_config.adaptive.enabled) {
+        return;
+    }
+
+    if (majestic_config_get(majestic_config, "video1.bitrate", value, sizeof(value)) == 0) {
+        initial_kbps = (uint32_t)strtoul(value, NULL, 10);
+    }
+
+    if (majestic_config_get(majestic_config, "video1.fps", value, sizeof(value)) == 0) {
+        normal_fps = (uint32_t)strtoul(value, NULL, 10);
+    }
+
+    if (adaptive_bitrate_init(&adaptive, &manager_config.adaptive.controller, initial_kbps) != 0) {
+        fprintf(stderr, "Invalid adaptive bitrate settings; keeping a fixed bitrate.\n");
+        return;
+    }
+
+    adaptive_enabled = true;
+    fprintf(stderr, "Adaptive bitrate %u..%u kbps, starting at %u kbps.\n",
+            adaptive.config.min_kbps, adaptive.config.max_kbps, adaptive.bitrate_kbps);
+}
+
+// Zoom to start from: the saved one if any, clamped to the current limits.
+// Also settles the profile baseline: the saved one, or else what the
+// Majestic config holds now, before any profile has touched it. Reads the
+// Majestic config, so it runs before the worker owns it.
+static double restore_zoom_state(void) {
+    manager_state_t state = { .zoom = 1.0 };
+
+    if (saving_state && manager_state_load(manager_config.zoom.state_path, &state) == 0) {
+        fprintf(stderr, "Restoring zoom %.2fx.\n", state.zoom);
+    }
+
+    if (state.has_baseline) {
+        baseline_profile = state.baseline;
+    } else if (manager_config.profile_count > 0 &&
+               manager_config_read_baseline(manager_config.majestic_config_path, &baseline_profile) != 0) {
+        fprintf(stderr, "No video1 encoder settings in %s; profiles cannot restore them.\n",
+                manager_config.majestic_config_path);
+    }
+
+    return zoom_clamp(&zoom_engine, state.zoom);
+}
+
+// The supervisor asks for the good config back after a crash loop. The
+// restore runs in the worker, in order with every other config write.
+static void request_rollback(void) {
+    if (supervisor.rollback_pending && rollback_sequence == 0) {
+        rollback_sequence = apply_worker_submit_restore(manager_config.majestic_config_path, supervisor.good_path);
+    }
+}
+
+// The restored config holds whatever crop and encoder keys it was saved with,
+// so nothing we applied can be assumed any more. A zoom queued behind the
+// restore was staged against the old profile and is staged again in full.
+static void finish_rollback(const apply_result_t *result) {
+    rollback_sequence = 0;
+    majestic_supervisor_rollback_done(&supervisor, result->status == 0);
+
+    if (result->status != 0) {
+        return;
+    }
+
+    applied_profile = PROFILE_UNKNOWN;
+    current_profile = PROFILE_UNKNOWN;
+    zoom_stale = true;
+
+    if (zoom_sequence > result->last_sequence) {
+        (void)apply_zoom(current_zoom);
+    }
+}
+
+static void handle_apply_results(int fd, short revents, void *context) {
+    apply_result_t result;
+    (void)fd;
+    (void)revents;
+    (void)context;
+
+    while (apply_worker_poll_result(&result)) {
+        camera_protocol_complete(result.last_sequence, result.status, result.has_stream ? &result.stream : NULL);
+        latency_trace_complete(
+            result.first_sequence, result.last_sequence, result.started_ns, &result.timing, latency_trace_now());
+
+        if (rollback_sequence != 0 && rollback_sequence == result.last_sequence) {
+            finish_rollback(&result);
+            continue;
+        }
+
+        // Only the batch holding the newest crop settles the zoom. Earlier
+        // ones were superseded, and batches of other keys (adaptive bitrate,
+        // commands) say nothing about it.
+        if (zoom_sequence < result.first_sequence || zoom_sequence > result.last_sequence) {
+            continue;
+        }
+
+        if (result.status == 0) {
+            applied_zoom = current_zoom;
+            applied_profile = current_profile;
+            fprintf(stderr, "Applied zoom %.2fx.\n", applied_zoom);
+        } else {
+            fprintf(stderr, "Failed to apply zoom %.2fx; staying at %.2fx.\n", current_zoom, applied_zoom);
+            current_zoom = applied_zoom;
+            current_profile = applied_profile;
+        }
+    }
+}
+
+static void handle_capture_results(int fd, short revents, void *context) {
+    image_capture_result_t result;
+    (void)fd;
+    (void)revents;
+    (void)context;
+
+    while (image_capture_poll_result(&result)) {
+        if (result.status == 0) {
+            fprintf(stderr, "Captured %s (%zu bytes, fetch %.1f ms, write %.1f ms).\n", result.file, result.size,
+                    (double)(result.fetched_ns - result.requested_ns) / 1e6,
+                    (double)(result.written_ns - result.fetched_ns) / 1e6);
+        } else {
+            fprintf(stderr, "Image %d failed.\n", (int)result.index);
+        }
+
+        camera_protocol_image_captured(&result);
+    }
+}
+
+static void enable_majestic_osd(void) {
+    majestic_config_txn_t txn;
+    majestic_config_begin(&txn, manager_config.majestic_config_path);
+
+    if (majestic_config_set(&txn, "osd.enabled", "true") != 0) {
+        fprintf(stderr, "Cannot enable the Majestic OSD.\n");
+        return;
+    }
+
+    (void)apply_worker_submit(&txn);
+}
+
+static void handle_osd_timer(int fd, short revents, void *context) {
+    (void)revents;
+    (void)context;
+
+    if (event_loop_drain_timer(fd) != 0) {
+        (void)osd_feed_tick(latency_trace_now());
+    }
+}
+
+static void handle_statustext_message(const mavlink_message_t *message, void *context) {
+    matek_statustext_t msg;
+    char text[STATUSTEXT_ASSEMBLER_MAX_LEN + 1];
+    (void)context;
+
+    matek_decode_statustext(message, &msg);
+    fprintf(stderr, "STATUSTEXT (severity=%u id=%u chunk=%u): %s\n", msg.severity, msg.id, msg.chunk_seq, msg.text);
+
+    if (statustext_assembler_push(&statustext_assembler, message->sysid, message->compid, &msg,
+                                  latency_trace_now(), text)) {
+        handle_command(text);
+    }
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
     return (uint64_t)now.tv_sec * 1000ULL + (uint64_t)now.tv_nsec / 1000000ULL;
 }
 
-static void event_loop(int fd) {
-    const uint64_t interval_ms = 1000;
-    uint64_t next_emit_ms = 0;
+// Bitrate changes are runtime keys pushed over HTTP; only an fps tier flip
+// needs a Majestic restart, and the controller's hysteresis keeps those rare.
+static void handle_radio_status_message(const mavlink_message_t *message, void *context) {
+    mavlink_radio_status_t status;
+    (void)context;
+
+    mavlink_msg_radio_status_decode(message, &status);
+
+    const adaptive_bitrate_sample_t sample = {
+        .rssi = status.rssi,
+        .remrssi = status.remrssi,
+        .noise = status.noise,
+        .remnoise = status.remnoise,
+        .txbuf = status.txbuf,
+        .rxerrors = status.rxerrors
+    };
+    // The controller only moves on once its change is queued; otherwise the
+    // next report would see a rate Majestic never got as the current one.
+    const adaptive_bitrate_t previous = adaptive;
+    const int changed = adaptive_bitrate_update(&adaptive, &sample, monotonic_ms());
+
+    if (changed == 0) {
+        return;
+    }
+
+    majestic_config_txn_t txn;
+    majestic_config_begin(&txn, manager_config.majestic_config_path);
+
+    int staged = manager_config_stage_number(&txn, "video1.bitrate", "%.0f", adaptive.bitrate_kbps);
+
+    if ((changed & ADAPTIVE_FPS_CHANGED) && normal_fps > 0) {
+        const uint32_t fps = adaptive.low_fps_active ? adaptive.config.low_fps : normal_fps;
+        staged |= manager_config_stage_number(&txn, "video1.fps", "%.0f", fps);
+    }
+
+    if (staged != 0) {
+        fprintf(stderr, "Failed to stage adaptive bitrate change.\n");
+        adaptive = previous;
+        return;
+    }
+
+    if (apply_worker_submit(&txn) == 0) {
+        adaptive = previous;
+        return;
+    }
+
+    fprintf(stderr, "Link rssi=%u/%u noise=%u/%u txbuf=%u%%: video1 bitrate %u kbps%s.\n",
+            status.rssi, status.remrssi, status.noise, status.remnoise, status.txbuf,
+            adaptive.bitrate_kbps, adaptive.low_fps_active ? " (low fps)" : "");
+}
+
+static void handle_matek_ready(int fd, short revents, void *context) {
+    manager_session_t *session = context;
+    const bool closed = (revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+
+    if (!closed && (revents & POLLOUT) && matek_flush(fd) != 0) {
+        event_loop_stop(&session->loop);
+        return;
+    }
+
+    // The descriptor is non-blocking, so matek_receive() drains the kernel
+    // buffer and dispatches every frame in the same wakeup its bytes arrive in.
+    // Bytes can arrive together with a hangup (the end of a replay, a USB
+    // adapter pulled), so they are read before the hangup ends the session;
+    // once it has, nothing is left for a later wakeup to pick up.
+    if ((revents & POLLIN) && !(revents & POLLNVAL)) {
+        int received;
+
+        do {
+            received = matek_receive(fd);
+        } while (closed && received > 0);
+
+        if (received < 0) {
+            event_loop_stop(&session->loop);
+            return;
+        }
+    }
+
+    if (closed) {
+        fprintf(stderr, "Matek link reported an error condition.\n");
+        event_loop_stop(&session->loop);
+    }
+}
+
+// Watch for writability only while output is queued; otherwise a writable
+// UART would wake poll(2) continuously.
+static void handle_matek_output(int fd, bool pending, void *context) {
+    manager_session_t *session = context;
+
+    event_loop_modify(&session->loop, fd, pending ? (POLLIN | POLLOUT) : POLLIN);
+}
+
+// NAMED_VALUE names are exactly 10 bytes on the wire, NUL-padded.
+static void pad_name(char padded[10], const char *name) {
+    const size_t length = strlen(name);
+
+    memset(padded, 0, 10);
+    memcpy(padded, name, length < 10 ? length : 10);
+}
+
+static int send_named_float(int fd, uint32_t time_boot_ms, const char *name, float value) {
+    mavlink_message_t message;
+    char padded[10];
+
+    pad_name(padded, name);
+    mavlink_msg_named_value_float_pack(
+        matek_system_id(), matek_component_id(), &message, time_boot_ms, padded, value);
+    return matek_send_message(fd, &message);
+}
+
+static int send_named_int(int fd, uint32_t time_boot_ms, const char *name, int32_t value) {
+    mavlink_message_t message;
+    char padded[10];
+
+    pad_name(padded, name);
+    mavlink_msg_named_value_int_pack(
+        matek_system_id(), matek_component_id(), &message, time_boot_ms, padded, value);
+    return matek_send_message(fd, &message);
+}
+
+// Publish p50/p99 (ms) of every stage that gained samples since the last
+// export as NAMED_VALUE_FLOAT "<stage>_p50"/"<stage>_p99", plus the command
+// and reload counters and memory use, so a ground station can graph them in
+// flight.
+static void export_latency_stats(int fd) {
+    static uint32_t exported_counts[LATENCY_STAGE_COUNT];
+    const uint32_t time_boot_ms = (uint32_t)monotonic_ms();
+    char name[16];
+
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+        const latency_histogram_t *histogram = latency_trace_histogram((latency_stage_t)stage);
+
+        if (histogram->count == exported_counts[stage]) {
+            continue;
+        }
+
+        exported_counts[stage] = histogram->count;
+        snprintf(name, sizeof(name), "%s_p50", latency_stage_name((latency_stage_t)stage));
+        (void)send_named_float(fd, time_boot_ms, name,
+                               (float)latency_histogram_percentile_us(histogram, 0.50) / 1000.0f);
+        snprintf(name, sizeof(name), "%s_p99", latency_stage_name((latency_stage_t)stage));
+        (void)send_named_float(fd, time_boot_ms, name,
+                               (float)latency_histogram_percentile_us(histogram, 0.99) / 1000.0f);
+    }
+
+    static uint32_t exported_gaps;
+    const latency_histogram_t *gaps = latency_trace_gap_histogram();
+
+    if (gaps->count != exported_gaps) {
+        exported_gaps = gaps->count;
+        (void)send_named_float(fd, time_boot_ms, "gap_p50", (float)latency_histogram_percentile_us(gaps, 0.50) / 1000.0f);
+        (void)send_named_float(fd, time_boot_ms, "gap_max", (float)gaps->max_us / 1000.0f);
+    }
+
+    (void)send_named_int(fd, time_boot_ms, "zoom_cmds",
+                         (int32_t)latency_trace_histogram(LATENCY_STAGE_TOTAL)->count);
+    (void)send_named_int(fd, time_boot_ms, "reloads", (int32_t)latency_trace_reloads());
+
+    memory_stats_t memory;
+    memory_stats_read(&memory);
+    (void)send_named_int(fd, time_boot_ms, "rss_kb", (int32_t)memory.rss_kb);
+    (void)send_named_int(fd, time_boot_ms, "rss_peak", (int32_t)memory.peak_rss_kb);
+    (void)send_named_int(fd, time_boot_ms, "yaml_peak", (int32_t)memory.yaml.peak);
+
+    if (supervising) {
+        (void)send_named_int(fd, time_boot_ms, "mj_exits", (int32_t)supervisor.stats.exits);
+        (void)send_named_int(fd, time_boot_ms, "mj_down_ms",
+                             (int32_t)(supervisor.stats.last_downtime_ns / 1000000ULL));
+    }
+
+    if (osd_feeding) {
+        osd_feed_stats_t osd;
+        osd_feed_get_stats(&osd);
+        (void)send_named_int(fd, time_boot_ms, "osd_sent", (int32_t)osd.sent);
+        (void)send_named_int(fd, time_boot_ms, "osd_fail", (int32_t)osd.failed);
+    }
+}
+
+static void handle_stats_timer(int fd, short revents, void *context) {
+    manager_session_t *session = context;
+    (void)revents;
+
+    if (event_loop_drain_timer(fd) != 0) {
+        export_latency_stats(session->matek_fd);
+    }
+}
+
+static void handle_stats_socket(int fd, short revents, void *context) {
+    (void)revents;
+    (void)context;
+    stats_socket_serve(fd);
+}
+
+static void handle_heartbeat_timer(int fd, short revents, void *context) {
+    manager_session_t *session = context;
+    (void)revents;
+
+    if (event_loop_drain_timer(fd) == 0) {
+        return;
+    }
+
+    if (send_heartbeat(session->matek_fd) != 0) {
+        event_loop_stop(&session->loop);
+    }
+}
+
+static void handle_supervisor_timer(int fd, short revents, void *context) {
+    (void)revents;
+    (void)context;
+
+    if (event_loop_drain_timer(fd) != 0) {
+        request_rollback();
+        majestic_supervisor_tick(&supervisor, latency_trace_now());
+    }
+}
+
+static size_t format_report(char *out, size_t out_size, void *context) {
+    size_t length = 0;
+    (void)context;
+
+    if (supervising) {
+        length += majestic_supervisor_format(&supervisor, out, out_size);
+    }
+
+    if (osd_feeding && length + 1 < out_size) {
+        length += osd_feed_format(out + length, out_size - length);
+    }
+
+    return length;
+}
+
+// Returns true when the signal asks the manager to shut down.
+static bool handle_signal(int signal_fd) {
+    struct signalfd_siginfo info;
+
+    while (read(signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if (info.ssi_signo == SIGCHLD) {
+            // Restart right away when the exit allows it, not on the next tick.
+            majestic_supervisor_reap(&supervisor, latency_trace_now());
+            request_rollback();
+            majestic_supervisor_tick(&supervisor, latency_trace_now());
+            continue;
+        }
+
+        if (info.ssi_signo == SIGHUP) {
+            fprintf(stderr, "SIGHUP received; re-applying zoom %.2fx.\n", current_zoom);
+            current_profile = PROFILE_UNKNOWN;
+            (void)apply_zoom(current_zoom);
+            continue;
+        }
+
+        fprintf(stderr, "Signal %u received; shutting down.\n", info.ssi_signo);
+        return true;
+    }
+
+    return false;
+}
+
+static void handle_signal_readable(int fd, short revents, void *context) {
+    manager_session_t *session = context;
+    (void)revents;
+
+    if (handle_signal(fd)) {
+        session->shutdown_requested = true;
+        event_loop_stop(&session->loop);
+    }
+}
+
+static bool event_loop(int matek_fd, int signal_fd, int stats_socket_fd) {
+    manager_session_t session = {
+        .matek_fd = matek_fd,
+        .shutdown_requested = false
+    };
+
+    event_loop_init(&session.loop);
+
+    const int heartbeat_fd = event_loop_create_timer(HEARTBEAT_INTERVAL_MS);
+
+    if (heartbeat_fd < 0) {
+        return false;
+    }
+
+    const int stats_fd = manager_config.stats.interval_ms > 0
+        ? event_loop_create_timer(manager_config.stats.interval_ms)
+        : -1;
+    const int supervisor_fd = supervising ? event_loop_create_timer(SUPERVISOR_INTERVAL_MS) : -1;
+    const int osd_fd = osd_feeding ? event_loop_create_timer(manager_config.osd.settings.interval_ms) : -1;
+
+    if (event_loop_add(&session.loop, matek_fd, POLLIN, handle_matek_ready, &session) != 0 ||
+        event_loop_add(&session.loop, heartbeat_fd, POLLIN, handle_heartbeat_timer, &session) != 0 ||
+        event_loop_add(&session.loop, signal_fd, POLLIN, handle_signal_readable, &session) != 0 ||
+        event_loop_add(&session.loop, apply_worker_result_fd(), POLLIN, handle_apply_results, &session) != 0 ||
+        (stats_fd >= 0 && event_loop_add(&session.loop, stats_fd, POLLIN, handle_stats_timer, &session) != 0) ||
+        (supervisor_fd >= 0 &&
+         event_loop_add(&session.loop, supervisor_fd, POLLIN, handle_supervisor_timer, &session) != 0) ||
+        (osd_fd >= 0 && event_loop_add(&session.loop, osd_fd, POLLIN, handle_osd_timer, &session) != 0) ||
+        (capturing &&
+         event_loop_add(&session.loop, image_capture_result_fd(), POLLIN, handle_capture_results, &session) != 0) ||
+        (stats_socket_fd >= 0 &&
+         event_loop_add(&session.loop, stats_socket_fd, POLLIN, handle_stats_socket, &session) != 0)) {
+        fprintf(stderr, "Unable to register Matek session descriptors.\n");
+        close(heartbeat_fd);
+
+        if (stats_fd >= 0) {
+            close(stats_fd);
+        }
+
+        if (supervisor_fd >= 0) {
+            close(supervisor_fd);
+        }
+
+        if (osd_fd >= 0) {
+            close(osd_fd);
+        }
+
+        return false;
+    }
+
+    matek_set_output_hook(handle_matek_output, &session);
+    camera_protocol_set_link(matek_fd);
+    (void)event_loop_run(&session.loop);
+    camera_protocol_set_link(-1);
+    matek_set_output_hook(NULL, NULL);
+    close(heartbeat_fd);
+
+    if (stats_fd >= 0) {
+        close(stats_fd);
+    }
+
+    if (supervisor_fd >= 0) {
+        close(supervisor_fd);
+    }
+
+    if (osd_fd >= 0) {
+        close(osd_fd);
+    }
+
+    return session.shutdown_requested;
+}
+
+// Sleep between reconnect attempts while still reacting to signals promptly.
+static bool wait_for_reconnect(int signal_fd) {
+    struct pollfd pfd = {
+        .fd = signal_fd,
+        .events = POLLIN,
+        .revents = 0
+    };
+
+    const int timeout_ms = supervising ? (int)SUPERVISOR_INTERVAL_MS : RECONNECT_DELAY_MS;
+
+    for (int waited_ms = 0; waited_ms < RECONNECT_DELAY_MS; waited_ms += timeout_ms) {
+        if (poll(&pfd, 1, timeout_ms) > 0 && handle_signal(signal_fd)) {
+            return true;
+        }
+
+        if (supervising) {
+            // Majestic stays down until a rollback lands, link or no link.
+            if (rollback_sequence != 0) {
+                handle_apply_results(apply_worker_result_fd(), POLLIN, NULL);
+            }
+
+            request_rollback();
+            majestic_supervisor_tick(&supervisor, latency_trace_now());
+        }
+    }
+
+    return false;
+}
+
+// `child_exits` adds SIGCHLD, which only the supervisor consumes.
+static int create_signal_fd(bool child_exits) {
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+
+    if (child_exits) {
+        sigaddset(&mask, SIGCHLD);
+    }
+
+    // Signals are consumed through the signalfd only, never via async handlers.
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) != 0) {
+        fprintf(stderr, "sigprocmask failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    const int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (fd < 0) {
+        fprintf(stderr, "signalfd failed: %s\n", strerror(errno));
+    }
+
+    return fd;
+}
+
+typedef struct router_session {
+    event_loop_t loop;
+    mavlink_router_t *router;
+    bool shutdown_requested;
+} router_session_t;
+
+// SIGHUP prints the router counters; anything else shuts the router down.
+static void handle_router_signal(int fd, short revents, void *context) {
+    router_session_t *session = context;
+    struct signalfd_siginfo info;
+    (void)revents;
+
+    while (read(fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if (info.ssi_signo == SIGHUP) {
+            mavlink_router_report(session->router, stderr);
+            continue;
+        }
+
+        fprintf(stderr, "Signal %u received; shutting down.\n", info.ssi_signo);
+        session->shutdown_requested = true;
+        event_loop_stop(&session->loop);
+    }
+}
+
+static bool wait_for_router_reconnect(int signal_fd, router_session_t *session) {
+    struct pollfd pfd = {
+        .fd = signal_fd,
+        .events = POLLIN,
+        .revents = 0
+    };
+
+    if (poll(&pfd, 1, RECONNECT_DELAY_MS) > 0) {
+        handle_router_signal(signal_fd, pfd.revents, session);
+    }
+
+    return session->shutdown_requested;
+}
+
+// Router mode: forward MAVLink between the configured endpoints and nothing
+// else. Reopens every endpoint when a UART disappears, like the Matek loop.
+static int run_router(int signal_fd) {
+    static mavlink_router_t router;
+
+    if (manager_config.router.endpoint_count < 2) {
+        fprintf(stderr, "Router mode needs at least two router.endpoints.\n");
+        return EXIT_FAILURE;
+    }
 
     while (1) {
-        const uint64_t now_ms = monotonic_now_ms();
+        router_session_t session = {
+            .router = &router,
+            .shutdown_requested = false
+        };
 
-        if (next_emit_ms == 0 || now_ms >= next_emit_ms) {
-            if (send_heartbeat(fd) != 0) {
-                return;
+        if (mavlink_router_open(&router, manager_config.router.endpoints, manager_config.router.endpoint_count) != 0) {
+            fprintf(stderr, "Router endpoints unavailable; retrying...\n");
+
+            if (wait_for_router_reconnect(signal_fd, &session)) {
+                break;
             }
-            next_emit_ms = now_ms + interval_ms;
+            continue;
         }
 
-        matek_statustext_t msg;
-        const int statustext_result = receive_statustext(fd, &msg);
-        if (statustext_result < 0) {
-            return;
+        event_loop_init(&session.loop);
+
+        if (mavlink_router_attach(&router, &session.loop) != 0 ||
+            event_loop_add(&session.loop, signal_fd, POLLIN, handle_router_signal, &session) != 0) {
+            fprintf(stderr, "Unable to register router descriptors.\n");
+            mavlink_router_close(&router);
+            return EXIT_FAILURE;
         }
 
-        if (statustext_result > 0) {
-            fprintf(stderr, "STATUSTEXT (severity=%u id=%u chunk=%u): %s\n", msg.severity, msg.id, msg.chunk_seq, msg.text);
-            handle_statustext(msg.text);
+        (void)event_loop_run(&session.loop);
+        mavlink_router_report(&router, stderr);
+        mavlink_router_close(&router);
+
+        if (session.shutdown_requested) {
+            break;
         }
 
-        const struct timespec sleep_time = {
-            .tv_sec = 0,
-            .tv_nsec = 10 * 1000 * 1000
-        };
+        fprintf(stderr, "Router loop exited; reopening endpoints...\n");
+
+        if (wait_for_router_reconnect(signal_fd, &session)) {
+            break;
+        }
+    }
+
+    close(signal_fd);
+    return EXIT_SUCCESS;
+}
+
+static void record_link_chunk(const uint8_t *data, size_t length, uint64_t received_ns, void *context) {
+    flight_recorder_append(context, received_ns, data, length);
+}
+
+static void open_recorder(void) {
+    if (manager_config.recorder.path[0] == '\0' || manager_config.recorder.size == 0) {
+        return;
+    }
 
-        nanosleep(&sleep_time, NULL);
+    if (flight_recorder_open(&recorder, manager_config.recorder.path, manager_config.recorder.size) != 0) {
+        fprintf(stderr, "Continuing without the flight recorder.\n");
+        return;
+    }
+
+    matek_set_receive_hook(record_link_chunk, &recorder);
+}
+
+// Run the session against a recorder file instead of the UART: a replay
+// thread plays the recorded chunks into one end of a socketpair and the usual
+// Matek loop reads the other, so the whole receive and apply path is exercised.
+static void replay_link(const manager_options_t *options, int signal_fd, int stats_socket_fd) {
+    static flight_recorder_replay_t replay;
+    int pair[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) != 0) {
+        fprintf(stderr, "socketpair failed: %s\n", strerror(errno));
+        return;
     }
+
+    if (flight_recorder_replay_start(&replay, options->replay_path, options->replay_speed, pair[1]) != 0) {
+        close(pair[0]);
+        close(pair[1]);
+        return;
+    }
+
+    (void)event_loop(pair[0], signal_fd, stats_socket_fd);
+    close(pair[0]);
+    flight_recorder_replay_join(&replay);
+
+    char report[1024];
+
+    fprintf(stderr, "Replayed %llu chunks (%llu bytes) spanning %.3f s in %.3f s.\n",
+            (unsigned long long)replay.stats.chunks,
+            (unsigned long long)replay.stats.bytes,
+            (double)replay.stats.recorded_ns / 1e9,
+            (double)replay.stats.elapsed_ns / 1e9);
+    latency_trace_format(report, sizeof(report));
+    fputs(report, stderr);
 }
 
-int main(void) {
-    if (apply_crop_index(0) != 0) {
+static int parse_options(int argc, char **argv, manager_options_t *options) {
+    options->config_path = DEFAULT_MANAGER_CONFIG;
+    options->router = false;
+    options->replay_path = NULL;
+    options->replay_speed = 1.0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--router") == 0) {
+            options->router = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            options->replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            char *end = NULL;
+
+            options->replay_speed = strtod(argv[++i], &end);
+
+            if (!end || *end != '\0' || options->replay_speed < 0.0) {
+                return -1;
+            }
+        } else if (argv[i][0] == '-') {
+            return -1;
+        } else {
+            options->config_path = argv[i];
+        }
+    }
+
+    return options->router && options->replay_path ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    manager_options_t options;
+
+    if (parse_options(argc, argv, &options) != 0) {
+        fprintf(stderr, "usage: %s [--router | --replay FILE [--speed N]] [config]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // All YAML work from here on, startup included, runs in the static arena.
+    yaml_arena_install();
+
+    if (manager_config_load(options.config_path, &manager_config) != 0) {
+        fprintf(stderr, "Continuing with default manager settings.\n");
+    }
+
+    supervising = manager_config.supervisor.enabled && !options.router && !options.replay_path;
+
+    const int signal_fd = create_signal_fd(supervising);
+
+    if (signal_fd < 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (options.router) {
+        return run_router(signal_fd);
+    }
+
+    statustext_assembler_init(&statustext_assembler);
+
+    if (matek_register_handler(MAVLINK_MSG_ID_STATUSTEXT, handle_statustext_message, NULL) != 0) {
+        fprintf(stderr, "Unable to register STATUSTEXT handler.\n");
+        return EXIT_FAILURE;
+    }
+
+    const camera_zoom_ops_t zoom_ops = {
+        .step = zoom_step,
+        .set_range = zoom_set_range,
+        .level = zoom_level,
+        .context = NULL
+    };
+
+    // Seeds a tmpfs working copy from flash, so it has to run first.
+    if (config_sync_init(&config_sync, manager_config.majestic_config_path,
+                         manager_config.majestic_flash_path, manager_config.majestic_sync_delay_ms) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // Without a working copy in front of it, every write lands on flash and
+    // has to survive a power cut on its own.
+    majestic_config_set_durable(manager_config.majestic_flash_path[0] == '\0');
+
+    // The zoom state lives on tmpfs too; the worker saves it after each
+    // applied zoom and its flash copy follows the same quiet period.
+    saving_state = manager_config.zoom.state_path[0] != '\0' &&
+                   config_sync_init(&state_sync, manager_config.zoom.state_path, manager_config.zoom.state_flash_path,
+                                    manager_config.majestic_sync_delay_ms) == 0;
+
+    // Started before the worker: taking over a Majestic we did not start uses
+    // the same process lookup the worker relies on for reloads.
+    if (supervising) {
+        if (majestic_supervisor_init(&supervisor, &manager_config.supervisor.settings,
+                                     manager_config.majestic_config_path) != 0) {
+            return EXIT_FAILURE;
+        }
+
+        (void)majestic_supervisor_start(&supervisor, latency_trace_now());
+    }
+
+    // These read the Majestic config, so they run before the worker owns it.
+    majestic_apply_init(manager_config.majestic_config_path);
+
+    if (manager_config.probe.enabled) {
+        majestic_apply_enable_probe(&manager_config.probe.settings);
+    }
+
+    if (init_zoom_engine() != 0 ||
+        camera_protocol_init(manager_config.majestic_config_path, &zoom_ops) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    init_adaptive_bitrate();
+    const double start_zoom = restore_zoom_state();
+
+    // Reads the web port and records.path, so it also runs before the worker.
+    if (manager_config.capture.enabled &&
+        image_capture_start(&manager_config.capture.settings, manager_config.majestic_config_path) == 0) {
+        capturing = camera_protocol_enable_capture() == 0;
+
+        if (!capturing) {
+            image_capture_stop();
+        }
+    }
+
+    if (manager_config.osd.enabled) {
+        osd_feeding = osd_feed_start(&manager_config.osd.settings, manager_config.majestic_config_path) == 0;
+
+        if (!osd_feeding) {
+            osd_feed_stop();
+        }
+    }
+
+    if (supervising || osd_feeding) {
+        stats_socket_set_report_hook(format_report, NULL);
+    }
+
+    if (adaptive_enabled &&
+        matek_register_handler(MAVLINK_MSG_ID_RADIO_STATUS, handle_radio_status_message, NULL) != 0) {
+        fprintf(stderr, "Unable to register RADIO_STATUS handler.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (apply_worker_start(&config_sync, saving_state ? &state_sync : NULL) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // Majestic only draws runtime OSD text while osd.enabled is on. Pruned
+    // like every other batch, so this writes the config at most once.
+    if (osd_feeding) {
+        enable_majestic_osd();
+    }
+
+    const int stats_socket_fd = manager_config.stats.socket_path[0] != '\0'
+        ? stats_socket_open(manager_config.stats.socket_path)
+        : -1;
+
+    // Values the Majestic config already holds are pruned, so restarting at
+    // the zoom it was left at touches neither the file nor the encoder.
+    if (apply_zoom(start_zoom) != 0) {
         fprintf(stderr, "Unable to prime Majestic configuration.\n");
     }
 
+    if (options.replay_path) {
+        replay_link(&options, signal_fd, stats_socket_fd);
+    } else {
+        open_recorder();
+    }
+
     // Stay alive even if the Matek link is missing or drops later by retrying forever.
-    while (1) {
-        const int matek_fd = open_matek_device();
+    while (!options.replay_path) {
+        const int matek_fd = open_matek_device(manager_config.serial.device, manager_config.serial.baud);
 
         if (matek_fd < 0) {
             fprintf(stderr, "Matek device unavailable; retrying...\n");
-            nanosleep(&RECONNECT_DELAY, NULL);
+
+            if (wait_for_reconnect(signal_fd)) {
+                break;
+            }
             continue;
         }
 
-        event_loop(matek_fd);
-        fprintf(stderr, "Matek loop exited; reconnecting...\n");
+        const bool shutdown_requested = event_loop(matek_fd, signal_fd, stats_socket_fd);
         close(matek_fd);
-        nanosleep(&RECONNECT_DELAY, NULL);
+
+        if (shutdown_requested) {
+            break;
+        }
+
+        fprintf(stderr, "Matek loop exited; reconnecting...\n");
+
+        if (wait_for_reconnect(signal_fd)) {
+            break;
+        }
+    }
+
+    stats_socket_close(stats_socket_fd, manager_config.stats.socket_path);
+    matek_set_receive_hook(NULL, NULL);
+    flight_recorder_close(&recorder);
+
+    if (capturing) {
+        image_capture_stop();
+    }
+
+    if (osd_feeding) {
+        osd_feed_stop();
+    }
+
+    apply_worker_stop();
+    majestic_apply_shutdown();
+    fprintf(stderr, "Config writes: %llu, flash syncs: %llu.\n",
+            (unsigned long long)config_sync.stats.changes, (unsigned long long)config_sync.stats.flash_writes);
+
+    if (supervising) {
+        majestic_supervisor_stop(&supervisor);
+        fprintf(stderr, "Majestic exits: %u, rollbacks: %u, downtime: %.3f s.\n", supervisor.stats.exits,
+                supervisor.stats.rollbacks, (double)supervisor.stats.total_downtime_ns / 1e9);
     }
+    close(signal_fd);
+    return EXIT_SUCCESS;
 }
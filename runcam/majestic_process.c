@@ -1,173 +1,206 @@
 #define _GNU_SOURCE
 #include <ctype.h>
-#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
-#include <sys/wait.h>
-#include <time.h>
 #include <unistd.h>
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
 #endif
 
+#include "latency_trace.h"
 #include "majestic_process.h"
 
 static const char *const MAJESTIC_PROCESS_NAME = "majestic";
 
-static uint64_t monotonic_now_ms(void) {
-    struct timespec now;
-
-    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
-        return 0;
-    }
-
-    return (uint64_t)now.tv_sec * 1000ULL + (uint64_t)now.tv_nsec / 1000000ULL;
+// Cached identity of the running Majestic process. The /proc walk only runs
+// when this cache is empty or the pidfd reports that the process has exited.
+static pid_t majestic_pid = 0;
+static int majestic_pidfd = -1;
+
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
 }
 
-// Spawn a short-lived child to run the command and return its status.
-static int run_command(const char *const *argv) {
-    pid_t pid = fork();
-
-    if (pid < 0) {
-        fprintf(stderr, "Failed to fork for %s: %s\n", argv[0], strerror(errno));
-        return -1;
-    }
+static bool comm_matches(const char *pid_name) {
+    char comm_path[PATH_MAX];
+    const int written = snprintf(comm_path, sizeof(comm_path), "/proc/%s/comm", pid_name);
 
-    if (pid == 0) {
-        execvp(argv[0], (char *const *)argv);
-        const int exit_code = errno == ENOENT ? 127 : 126;
-        _exit(exit_code);
+    if (written <= 0 || (size_t)written >= sizeof(comm_path)) {
+        return false;
     }
 
-    int status = 0;
+    const int fd = open(comm_path, O_RDONLY | O_CLOEXEC);
 
-    if (waitpid(pid, &status, 0) < 0) {
-        fprintf(stderr, "Failed to wait for %s: %s\n", argv[0], strerror(errno));
-        return -1;
+    if (fd < 0) {
+        return false;
     }
 
-    if (WIFEXITED(status)) {
-        const int exit_code = WEXITSTATUS(status);
-
-        if (exit_code == 0) {
-            return 0;
-        }
+    char buffer[256];
+    const ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    bool matches = false;
 
-        if (exit_code == 127) {
-            return -2;
-        }
+    if (length > 0) {
+        buffer[length] = '\0';
+        buffer[strcspn(buffer, "\n")] = '\0';
+        matches = strcmp(buffer, MAJESTIC_PROCESS_NAME) == 0;
     }
 
-    return -1;
+    close(fd);
+    return matches;
 }
 
-// Scan /proc to see if a process with the given comm name exists.
-static bool is_majestic_running(void) {
-    DIR *proc_dir = opendir("/proc");
+static bool pid_is_majestic(pid_t pid) {
+    char pid_name[24];
+
+    snprintf(pid_name, sizeof(pid_name), "%d", (int)pid);
+    return comm_matches(pid_name);
+}
 
-    if (!proc_dir) {
+// Layout of the records getdents64(2) returns.
+typedef struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} linux_dirent64_t;
+
+// Scan /proc for a process with the Majestic comm name. Reads the directory
+// with getdents64(2) into a static buffer; opendir(3) would malloc.
+static pid_t scan_for_majestic(void) {
+    static uint64_t entries[1024]; // 8 KiB, aligned for the records
+    const int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (proc_fd < 0) {
         fprintf(stderr, "Unable to open /proc: %s\n", strerror(errno));
-        return false;
+        return 0;
     }
 
-    struct dirent *entry = NULL;
+    pid_t found = 0;
+    long length;
 
-    while ((entry = readdir(proc_dir)) != NULL) {
-        if (!isdigit((unsigned char)entry->d_name[0])) {
-            continue;
-        }
+    while (found == 0 && (length = syscall(SYS_getdents64, proc_fd, entries, sizeof(entries))) > 0) {
+        for (long offset = 0; offset < length && found == 0;) {
+            const linux_dirent64_t *entry = (const linux_dirent64_t *)((const char *)entries + offset);
 
-        char comm_path[PATH_MAX];
-        const int written = snprintf(
-            comm_path,
-            sizeof(comm_path),
-            "/proc/%s/comm",
-            entry->d_name);
+            if (isdigit((unsigned char)entry->d_name[0]) && comm_matches(entry->d_name)) {
+                found = (pid_t)strtol(entry->d_name, NULL, 10);
+            }
 
-        if (written <= 0 || (size_t)written >= sizeof(comm_path)) {
-            continue;
+            offset += entry->d_reclen;
         }
+    }
 
-        FILE *comm = fopen(comm_path, "r");
+    close(proc_fd);
+    return found;
+}
 
-        if (!comm) {
-            continue;
-        }
+static void forget_majestic(void) {
+    if (majestic_pidfd >= 0) {
+        close(majestic_pidfd);
+    }
 
-        char buffer[256];
+    majestic_pidfd = -1;
+    majestic_pid = 0;
+}
 
-        if (fgets(buffer, sizeof(buffer), comm) != NULL) {
-            buffer[strcspn(buffer, "\n")] = '\0';
+static void track_majestic(pid_t pid) {
+    forget_majestic();
+    majestic_pid = pid;
 
-            if (strcmp(buffer, MAJESTIC_PROCESS_NAME) == 0) {
-                fclose(comm);
-                closedir(proc_dir);
-                return true;
-            }
-        }
+    // Kernels without pidfd_open (< 5.3) leave majestic_pidfd at -1 and fall
+    // back to kill(pid, 0) plus a single comm read, which still avoids walking
+    // all of /proc on every check.
+    majestic_pidfd = open_pidfd(pid);
 
-        fclose(comm);
+    if (majestic_pidfd >= 0 && !pid_is_majestic(pid)) {
+        // The pid was recycled between the scan and pidfd_open().
+        forget_majestic();
     }
-
-    closedir(proc_dir);
-    return false;
 }
 
-static bool wait_for_majestic_running(uint64_t timeout_ms) {
-    const uint64_t start_ms = monotonic_now_ms();
-    while (1) {
-        if (is_majestic_running()) {
-            return true;
-        }
+static bool cached_majestic_alive(void) {
+    if (majestic_pid <= 0) {
+        return false;
+    }
 
-        if (timeout_ms > 0) {
-            const uint64_t now_ms = monotonic_now_ms();
+    if (majestic_pidfd >= 0) {
+        struct pollfd pfd = {
+            .fd = majestic_pidfd,
+            .events = POLLIN,
+            .revents = 0
+        };
 
-            if (now_ms >= start_ms && now_ms - start_ms >= timeout_ms) {
-                break;
-            }
-        }
+        // A pidfd turns readable exactly when the process exits.
+        return poll(&pfd, 1, 0) == 0;
+    }
 
-        const struct timespec sleep_time = {
-            .tv_sec = 0,
-            .tv_nsec = 100 * 1000 * 1000
-        };
+    if (kill(majestic_pid, 0) != 0 && errno != EPERM) {
+        return false;
+    }
 
-        nanosleep(&sleep_time, NULL);
+    return pid_is_majestic(majestic_pid);
+}
+
+static pid_t find_majestic(void) {
+    if (cached_majestic_alive()) {
+        return majestic_pid;
     }
 
-    return false;
+    forget_majestic();
+
+    const pid_t pid = scan_for_majestic();
+
+    if (pid > 0) {
+        track_majestic(pid);
+    }
+
+    return majestic_pid;
 }
 
-int reload_majestic_process(void) {
-    // Ask Majestic to reload its configuration via SIGHUP.
-    static const char *const hup_command[] = { "killall", "-1", MAJESTIC_PROCESS_NAME, NULL };
+pid_t majestic_process_find(void) {
+    return find_majestic();
+}
 
-    const int status = run_command(hup_command);
+int reload_majestic_process(uint64_t *signalled_ns) {
+    const pid_t pid = find_majestic();
 
-    if (status == -2) {
-        fprintf(stderr, "killall command not available; cannot reload Majestic.\n");
+    if (pid <= 0) {
+        fprintf(stderr, "Majestic is not running; cannot reload it.\n");
         return -1;
     }
 
-    if (status != 0) {
-        fprintf(stderr, "Unable to signal Majestic.\n");
+    // Ask Majestic to reload its configuration via SIGHUP.
+    if (kill(pid, SIGHUP) != 0) {
+        fprintf(stderr, "Unable to signal Majestic (pid %d): %s\n", (int)pid, strerror(errno));
+        forget_majestic();
         return -1;
     }
 
-    fprintf(stderr, "Majestic reload (SIGHUP) succeeded.\n");
-
-    if (!wait_for_majestic_running(5000)) {
-        fprintf(stderr, "Majestic did not start after configuration update.\n");
-        return -1;
+    if (signalled_ns) {
+        *signalled_ns = latency_trace_now();
     }
 
+    // Majestic reloads inside the same process, so there is nothing to wait
+    // for here: should it die instead, the pidfd turns readable and the next
+    // lookup rescans /proc. When the stream matters, the caller probes it.
+    fprintf(stderr, "Majestic reload (SIGHUP) succeeded.\n");
     return 0;
 }
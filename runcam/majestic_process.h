@@ -1,8 +1,18 @@
 #pragma once
 
+#include <stdint.h>
+#include <sys/types.h>
+
 /**
  * Reload the Majestic process so configuration changes take effect.
  *
+ * @param signalled_ns Optional; receives the CLOCK_MONOTONIC time (ns) the
+ *                     SIGHUP was delivered.
  * @return 0 on success, -1 on failure (details logged to stderr).
  */
-int reload_majestic_process(void);
+int reload_majestic_process(uint64_t *signalled_ns);
+
+/**
+ * @return pid of the running Majestic process, or 0 when none is found.
+ */
+pid_t majestic_process_find(void);
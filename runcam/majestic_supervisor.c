@@ -0,0 +1,281 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config_sync.h"
+#include "majestic_process.h"
+#include "majestic_supervisor.h"
+
+extern char **environ;
+
+#define NS_PER_MS 1000000ULL
+#define STOP_TIMEOUT_MS 2000
+#define STOP_POLL_NS (20L * 1000L * 1000L)
+
+void majestic_supervisor_config_defaults(majestic_supervisor_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    snprintf(config->command, sizeof(config->command), "%s", "/usr/bin/majestic");
+    config->stable_ms = 10000;
+    config->min_backoff_ms = 500;
+    config->max_backoff_ms = 30000;
+    config->rollback_after = 3;
+}
+
+static bool same_file(const struct stat *a, const struct stat *b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+int majestic_supervisor_init(majestic_supervisor_t *supervisor, const majestic_supervisor_config_t *config,
+                             const char *config_path) {
+    memset(supervisor, 0, sizeof(*supervisor));
+    supervisor->config = *config;
+
+    if (snprintf(supervisor->config_path, sizeof(supervisor->config_path), "%s", config_path) >= (int)sizeof(supervisor->config_path)) {
+        fprintf(stderr, "Config path too long: %s\n", config_path);
+        return -1;
+    }
+
+    snprintf(supervisor->good_path, sizeof(supervisor->good_path), "%s.good", config_path);
+
+    // A good config saved by an earlier manager run is still a safe fallback.
+    supervisor->good_saved = access(supervisor->good_path, R_OK) == 0;
+    return 0;
+}
+
+static bool sleep_until_gone(pid_t pid, bool child) {
+    const struct timespec pause = {
+        .tv_sec = 0,
+        .tv_nsec = STOP_POLL_NS
+    };
+
+    for (long waited_ns = 0; waited_ns < STOP_TIMEOUT_MS * (long)NS_PER_MS; waited_ns += STOP_POLL_NS) {
+        if (child ? waitpid(pid, NULL, WNOHANG) == pid : kill(pid, 0) != 0) {
+            return true;
+        }
+
+        nanosleep(&pause, NULL);
+    }
+
+    return false;
+}
+
+// Majestic started by the init scripts cannot be waited for, so it is
+// replaced by a child of ours.
+static void take_over(void) {
+    const pid_t pid = majestic_process_find();
+
+    if (pid <= 0) {
+        return;
+    }
+
+    fprintf(stderr, "Stopping Majestic (pid %d) started outside the manager.\n", (int)pid);
+
+    if (kill(pid, SIGTERM) == 0 && !sleep_until_gone(pid, false)) {
+        (void)kill(pid, SIGKILL);
+        (void)sleep_until_gone(pid, false);
+    }
+}
+
+static void schedule_restart(majestic_supervisor_t *supervisor, uint64_t now_ns, uint32_t delay_ms) {
+    supervisor->restart_at_ns = now_ns + (uint64_t)delay_ms * NS_PER_MS;
+}
+
+int majestic_supervisor_start(majestic_supervisor_t *supervisor, uint64_t now_ns) {
+    posix_spawnattr_t attributes;
+    sigset_t empty;
+    sigset_t all;
+    char *argv[] = { supervisor->config.command, NULL };
+    pid_t pid = 0;
+
+    if (supervisor->stats.starts == 0 && supervisor->stats.exits == 0) {
+        take_over();
+    }
+
+    // The manager blocks the signals it reads through its signalfd; Majestic
+    // needs SIGHUP and SIGTERM delivered normally.
+    sigemptyset(&empty);
+    sigfillset(&all);
+
+    int error = posix_spawnattr_init(&attributes);
+
+    if (error == 0) {
+        (void)posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+        (void)posix_spawnattr_setsigmask(&attributes, &empty);
+        (void)posix_spawnattr_setsigdefault(&attributes, &all);
+        error = posix_spawn(&pid, supervisor->config.command, NULL, &attributes, argv, environ);
+        posix_spawnattr_destroy(&attributes);
+    }
+
+    if (error != 0) {
+        fprintf(stderr, "Unable to start %s: %s\n", supervisor->config.command, strerror(error));
+
+        if (supervisor->down_since_ns == 0) {
+            supervisor->down_since_ns = now_ns;
+        }
+
+        schedule_restart(supervisor, now_ns, supervisor->config.max_backoff_ms);
+        return -1;
+    }
+
+    if (supervisor->down_since_ns != 0) {
+        const uint64_t downtime_ns = now_ns - supervisor->down_since_ns;
+
+        supervisor->stats.last_downtime_ns = downtime_ns;
+        supervisor->stats.total_downtime_ns += downtime_ns;
+
+        if (downtime_ns > supervisor->stats.max_downtime_ns) {
+            supervisor->stats.max_downtime_ns = downtime_ns;
+        }
+
+        fprintf(stderr, "Majestic restarted (pid %d) after %.3f s down.\n", (int)pid, (double)downtime_ns / 1e9);
+    } else {
+        fprintf(stderr, "Majestic started (pid %d).\n", (int)pid);
+    }
+
+    supervisor->pid = pid;
+    supervisor->started_ns = now_ns;
+    supervisor->down_since_ns = 0;
+    supervisor->seen_since_ns = now_ns;
+    ++supervisor->stats.starts;
+    return 0;
+}
+
+void majestic_supervisor_reap(majestic_supervisor_t *supervisor, uint64_t now_ns) {
+    int status = 0;
+
+    if (supervisor->pid <= 0 || waitpid(supervisor->pid, &status, WNOHANG) != supervisor->pid) {
+        return;
+    }
+
+    const uint64_t uptime_ns = now_ns - supervisor->started_ns;
+
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "Majestic (pid %d) killed by signal %d after %.3f s.\n",
+                (int)supervisor->pid, WTERMSIG(status), (double)uptime_ns / 1e9);
+    } else {
+        fprintf(stderr, "Majestic (pid %d) exited with status %d after %.3f s.\n",
+                (int)supervisor->pid, WEXITSTATUS(status), (double)uptime_ns / 1e9);
+    }
+
+    supervisor->pid = 0;
+    supervisor->down_since_ns = now_ns;
+    ++supervisor->stats.exits;
+
+    // A crash after a healthy run is most likely a one-off: restart at once.
+    if (uptime_ns >= (uint64_t)supervisor->config.stable_ms * NS_PER_MS) {
+        supervisor->quick_exits = 0;
+        supervisor->backoff_ms = 0;
+        schedule_restart(supervisor, now_ns, 0);
+        return;
+    }
+
+    ++supervisor->quick_exits;
+
+    if (supervisor->backoff_ms == 0) {
+        supervisor->backoff_ms = supervisor->config.min_backoff_ms;
+    } else if (supervisor->backoff_ms < supervisor->config.max_backoff_ms / 2) {
+        supervisor->backoff_ms *= 2;
+    } else {
+        supervisor->backoff_ms = supervisor->config.max_backoff_ms;
+    }
+
+    if (supervisor->config.rollback_after > 0 && supervisor->quick_exits >= supervisor->config.rollback_after &&
+        supervisor->good_saved && !supervisor->rolled_back && !supervisor->rollback_pending) {
+        fprintf(stderr, "Majestic keeps exiting; restoring %s.\n", supervisor->good_path);
+        supervisor->rollback_pending = true;
+    }
+
+    schedule_restart(supervisor, now_ns, supervisor->backoff_ms);
+}
+
+// Once Majestic has run for stable_ms on a config that has not changed for
+// stable_ms either, keep a copy of that config as the good one.
+static void save_good_config(majestic_supervisor_t *supervisor, uint64_t now_ns) {
+    const uint64_t stable_ns = (uint64_t)supervisor->config.stable_ms * NS_PER_MS;
+    struct stat info;
+
+    if (stat(supervisor->config_path, &info) != 0) {
+        return;
+    }
+
+    if (!same_file(&info, &supervisor->seen)) {
+        supervisor->seen = info;
+        supervisor->seen_since_ns = now_ns;
+    }
+
+    if (now_ns - supervisor->started_ns < stable_ns || now_ns - supervisor->seen_since_ns < stable_ns) {
+        return;
+    }
+
+    supervisor->rolled_back = false;
+    supervisor->backoff_ms = 0;
+
+    if (supervisor->good_saved && same_file(&supervisor->seen, &supervisor->good_source)) {
+        return;
+    }
+
+    if (config_sync_copy(supervisor->config_path, supervisor->good_path, false) == 0) {
+        supervisor->good_source = supervisor->seen;
+        supervisor->good_saved = true;
+    }
+}
+
+void majestic_supervisor_tick(majestic_supervisor_t *supervisor, uint64_t now_ns) {
+    if (supervisor->pid > 0) {
+        save_good_config(supervisor, now_ns);
+        return;
+    }
+
+    // Respawning before the good config is back would only crash again.
+    if (now_ns >= supervisor->restart_at_ns && !supervisor->rollback_pending) {
+        (void)majestic_supervisor_start(supervisor, now_ns);
+    }
+}
+
+void majestic_supervisor_rollback_done(majestic_supervisor_t *supervisor, bool restored) {
+    supervisor->rollback_pending = false;
+
+    if (restored) {
+        supervisor->rolled_back = true;
+        ++supervisor->stats.rollbacks;
+    }
+}
+
+void majestic_supervisor_stop(majestic_supervisor_t *supervisor) {
+    if (supervisor->pid <= 0) {
+        return;
+    }
+
+    fprintf(stderr, "Stopping Majestic (pid %d).\n", (int)supervisor->pid);
+
+    if (kill(supervisor->pid, SIGTERM) != 0 || !sleep_until_gone(supervisor->pid, true)) {
+        (void)kill(supervisor->pid, SIGKILL);
+        (void)waitpid(supervisor->pid, NULL, 0);
+    }
+
+    supervisor->pid = 0;
+}
+
+size_t majestic_supervisor_format(const majestic_supervisor_t *supervisor, char *out, size_t out_size) {
+    const int written = snprintf(out, out_size,
+                                 "majestic pid=%d starts=%u exits=%u rollbacks=%u downtime_last_ms=%llu "
+                                 "downtime_max_ms=%llu downtime_total_ms=%llu\n",
+                                 (int)supervisor->pid, supervisor->stats.starts, supervisor->stats.exits,
+                                 supervisor->stats.rollbacks,
+                                 (unsigned long long)(supervisor->stats.last_downtime_ns / NS_PER_MS),
+                                 (unsigned long long)(supervisor->stats.max_downtime_ns / NS_PER_MS),
+                                 (unsigned long long)(supervisor->stats.total_downtime_ns / NS_PER_MS));
+
+    if (written < 0) {
+        return 0;
+    }
+
+    return (size_t)written < out_size ? (size_t)written : out_size - 1;
+}
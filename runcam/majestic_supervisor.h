@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MAJESTIC_SUPERVISOR_PATH_MAX 256
+
+typedef struct majestic_supervisor_config {
+    char command[MAJESTIC_SUPERVISOR_PATH_MAX]; // Majestic binary
+    uint32_t stable_ms;      // uptime (and config age) after which a run counts as healthy
+    uint32_t min_backoff_ms; // restart delay after the first quick exit, doubled per further one
+    uint32_t max_backoff_ms;
+    uint32_t rollback_after; // quick exits in a row before the last good config returns, 0 never
+} majestic_supervisor_config_t;
+
+void majestic_supervisor_config_defaults(majestic_supervisor_config_t *config);
+
+/**
+ * Runs Majestic as a child of the manager, so an exit is seen through
+ * SIGCHLD the moment it happens instead of after Majestic's own watchdog.
+ * A run that lasted `stable_ms` is restarted at once; quick exits in a row
+ * back off exponentially, and after `rollback_after` of them the config that
+ * last kept Majestic up for `stable_ms` is due back: `rollback_pending` is
+ * set and restarts wait until the owner of the config writes has restored
+ * `good_path` and called majestic_supervisor_rollback_done(). Downtime is
+ * measured from the exit to the respawn.
+ */
+typedef struct majestic_supervisor {
+    majestic_supervisor_config_t config;
+    char config_path[MAJESTIC_SUPERVISOR_PATH_MAX]; // working config Majestic reads
+    char good_path[MAJESTIC_SUPERVISOR_PATH_MAX + 8]; // "<config_path>.good"
+    pid_t pid;               // running child, 0 while down
+    uint64_t started_ns;     // CLOCK_MONOTONIC spawn time of the running child
+    uint64_t down_since_ns;  // exit time while down
+    uint64_t restart_at_ns;  // respawn due time while down
+    uint32_t backoff_ms;     // delay used for the last quick exit
+    uint32_t quick_exits;    // exits in a row before stable_ms of uptime
+    bool rolled_back;        // the good config was restored since the last healthy run
+    bool rollback_pending;   // the good config is due back; restarts wait for it
+    bool good_saved;         // good_path holds a config Majestic ran on
+    struct stat good_source; // config_path as it was when last saved
+    struct stat seen;        // config_path as last observed
+    uint64_t seen_since_ns;  // when `seen` was first observed
+    struct {
+        uint32_t starts;
+        uint32_t exits;
+        uint32_t rollbacks;
+        uint64_t last_downtime_ns;
+        uint64_t max_downtime_ns;
+        uint64_t total_downtime_ns;
+    } stats;
+} majestic_supervisor_t;
+
+/**
+ * @return 0 on success, -1 if a path is too long (details logged to stderr).
+ */
+int majestic_supervisor_init(majestic_supervisor_t *supervisor, const majestic_supervisor_config_t *config,
+                             const char *config_path);
+
+/**
+ * Spawn Majestic. On the first start a Majestic that is not our child (e.g.
+ * started by the init scripts) is terminated first. The child starts with an
+ * empty signal mask, whatever the manager blocks for its signalfd.
+ *
+ * @return 0 on success, -1 if the spawn failed (details logged to stderr;
+ *         a restart is scheduled).
+ */
+int majestic_supervisor_start(majestic_supervisor_t *supervisor, uint64_t now_ns);
+
+/**
+ * Collect an exited child without blocking. Call on SIGCHLD. Schedules the
+ * restart and, after too many quick exits, sets `rollback_pending`.
+ */
+void majestic_supervisor_reap(majestic_supervisor_t *supervisor, uint64_t now_ns);
+
+/**
+ * Periodic work: respawn when the backoff has passed (and no rollback is
+ * pending), and save the config as the good one once Majestic has run on it
+ * for `stable_ms`.
+ */
+void majestic_supervisor_tick(majestic_supervisor_t *supervisor, uint64_t now_ns);
+
+/**
+ * Report the outcome of a pending rollback and let restarts resume. A failed
+ * restore is tried again after the next run of quick exits.
+ */
+void majestic_supervisor_rollback_done(majestic_supervisor_t *supervisor, bool restored);
+
+/**
+ * Terminate the child (SIGTERM, then SIGKILL after two seconds) and reap it.
+ */
+void majestic_supervisor_stop(majestic_supervisor_t *supervisor);
+
+/**
+ * Render restart and downtime counters for the local stats socket.
+ *
+ * @return length written (truncated to `out_size - 1`).
+ */
+size_t majestic_supervisor_format(const majestic_supervisor_t *supervisor, char *out, size_t out_size);
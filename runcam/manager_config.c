@@ -0,0 +1,614 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "third_party/libyaml-0.2.5/include/yaml.h"
+
+#include "manager_config.h"
+
+static yaml_node_t *mapping_lookup(yaml_document_t *document, yaml_node_t *mapping, const char *key) {
+    if (!mapping || mapping->type != YAML_MAPPING_NODE) {
+        return NULL;
+    }
+
+    for (yaml_node_pair_t *pair = mapping->data.mapping.pairs.start; pair < mapping->data.mapping.pairs.top; ++pair) {
+        yaml_node_t *key_node = yaml_document_get_node(document, pair->key);
+
+        if (key_node && key_node->type == YAML_SCALAR_NODE &&
+            strcmp((const char *)key_node->data.scalar.value, key) == 0) {
+            return yaml_document_get_node(document, pair->value);
+        }
+    }
+
+    return NULL;
+}
+
+// Resolve a dotted path ("zoom.max") below `node` to a scalar string, or NULL.
+static const char *lookup_scalar(yaml_document_t *document, yaml_node_t *node, const char *key_path) {
+    char segment[64];
+    const char *cursor = key_path;
+
+    while (node) {
+        const char *dot = strchr(cursor, '.');
+        const size_t length = dot ? (size_t)(dot - cursor) : strlen(cursor);
+
+        if (length == 0 || length >= sizeof(segment)) {
+            return NULL;
+        }
+
+        memcpy(segment, cursor, length);
+        segment[length] = '\0';
+        node = mapping_lookup(document, node, segment);
+
+        if (!dot) {
+            break;
+        }
+
+        cursor = dot + 1;
+    }
+
+    if (!node || node->type != YAML_SCALAR_NODE) {
+        return NULL;
+    }
+
+    return (const char *)node->data.scalar.value;
+}
+
+static void read_string(yaml_document_t *document, yaml_node_t *node, const char *key_path, char *out, size_t out_size) {
+    const char *value = lookup_scalar(document, node, key_path);
+
+    if (value && strlen(value) < out_size) {
+        memcpy(out, value, strlen(value) + 1);
+    }
+}
+
+static void read_double(yaml_document_t *document, yaml_node_t *node, const char *key_path, double *out) {
+    const char *value = lookup_scalar(document, node, key_path);
+    char *end = NULL;
+
+    if (!value) {
+        return;
+    }
+
+    const double parsed = strtod(value, &end);
+
+    if (end && end != value && *end == '\0') {
+        *out = parsed;
+    } else {
+        fprintf(stderr, "Ignoring invalid number for %s: %s\n", key_path, value);
+    }
+}
+
+static void read_uint32(yaml_document_t *document, yaml_node_t *node, const char *key_path, uint32_t *out) {
+    const char *value = lookup_scalar(document, node, key_path);
+    char *end = NULL;
+
+    if (!value) {
+        return;
+    }
+
+    const unsigned long parsed = strtoul(value, &end, 10);
+
+    if (end && end != value && *end == '\0' && parsed <= UINT32_MAX) {
+        *out = (uint32_t)parsed;
+    } else {
+        fprintf(stderr, "Ignoring invalid integer for %s: %s\n", key_path, value);
+    }
+}
+
+void manager_config_defaults(manager_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    snprintf(config->majestic_config_path, sizeof(config->majestic_config_path), "%s", "/etc/majestic.yaml");
+    config->majestic_sync_delay_ms = 10000;
+    command_registry_init(&config->commands);
+    snprintf(config->serial.device, sizeof(config->serial.device), "%s", "/dev/ttyS2");
+    config->serial.baud = 57600;
+    config->zoom.max = 8.0;
+    config->zoom.step = 2.0;
+    config->zoom.alignment = 2;
+    snprintf(config->zoom.state_path, sizeof(config->zoom.state_path), "%s", "/tmp/majestic_manager.state");
+    snprintf(config->zoom.state_flash_path, sizeof(config->zoom.state_flash_path), "%s", "/etc/majestic_manager.state");
+    snprintf(config->stats.socket_path, sizeof(config->stats.socket_path), "%s", "/tmp/majestic_manager.sock");
+    config->stats.interval_ms = 5000;
+    snprintf(config->recorder.path, sizeof(config->recorder.path), "%s", "/tmp/majestic_manager.rec");
+    config->recorder.size = 1024 * 1024;
+    adaptive_bitrate_config_defaults(&config->adaptive.controller);
+    stream_probe_config_defaults(&config->probe.settings);
+    majestic_supervisor_config_defaults(&config->supervisor.settings);
+    image_capture_config_defaults(&config->capture.settings);
+    osd_feed_config_defaults(&config->osd.settings);
+}
+
+static void read_int32(yaml_document_t *document, yaml_node_t *node, const char *key_path, int32_t *out) {
+    const char *value = lookup_scalar(document, node, key_path);
+    char *end = NULL;
+
+    if (!value) {
+        return;
+    }
+
+    const long parsed = strtol(value, &end, 10);
+
+    if (end && end != value && *end == '\0' && parsed >= INT32_MIN && parsed <= INT32_MAX) {
+        *out = (int32_t)parsed;
+    } else {
+        fprintf(stderr, "Ignoring invalid integer for %s: %s\n", key_path, value);
+    }
+}
+
+static void read_bool(yaml_document_t *document, yaml_node_t *node, const char *key_path, bool *out) {
+    const char *value = lookup_scalar(document, node, key_path);
+
+    if (!value) {
+        return;
+    }
+
+    if (strcmp(value, "true") == 0 || strcmp(value, "yes") == 0 || strcmp(value, "on") == 0) {
+        *out = true;
+    } else if (strcmp(value, "false") == 0 || strcmp(value, "no") == 0 || strcmp(value, "off") == 0) {
+        *out = false;
+    } else {
+        fprintf(stderr, "Ignoring invalid boolean for %s: %s\n", key_path, value);
+    }
+}
+
+static void insert_profile(manager_config_t *config, const encoder_profile_t *profile) {
+    size_t position = config->profile_count;
+
+    while (position > 0 && config->profiles[position - 1].min_zoom > profile->min_zoom) {
+        config->profiles[position] = config->profiles[position - 1];
+        --position;
+    }
+
+    config->profiles[position] = *profile;
+    ++config->profile_count;
+}
+
+static void read_profiles(yaml_document_t *document, manager_config_t *config) {
+    yaml_node_t *profiles = mapping_lookup(document, yaml_document_get_root_node(document), "profiles");
+
+    if (!profiles) {
+        return;
+    }
+
+    if (profiles->type != YAML_SEQUENCE_NODE) {
+        fprintf(stderr, "Ignoring profiles: expected a list.\n");
+        return;
+    }
+
+    for (yaml_node_item_t *item = profiles->data.sequence.items.start; item < profiles->data.sequence.items.top; ++item) {
+        yaml_node_t *node = yaml_document_get_node(document, *item);
+        encoder_profile_t profile = {
+            .min_zoom = 0.0,
+            .min_qp = -1,
+            .max_qp = -1
+        };
+
+        if (config->profile_count >= MANAGER_CONFIG_MAX_PROFILES) {
+            fprintf(stderr, "Ignoring profiles beyond the first %d.\n", MANAGER_CONFIG_MAX_PROFILES);
+            return;
+        }
+
+        read_double(document, node, "zoom", &profile.min_zoom);
+        read_uint32(document, node, "bitrate", &profile.bitrate);
+        read_uint32(document, node, "fps", &profile.fps);
+        read_double(document, node, "gopSize", &profile.gop_size);
+        read_int32(document, node, "minQp", &profile.min_qp);
+        read_int32(document, node, "maxQp", &profile.max_qp);
+
+        if (profile.min_zoom < 1.0) {
+            fprintf(stderr, "Ignoring profile without a zoom factor >= 1.\n");
+            continue;
+        }
+
+        insert_profile(config, &profile);
+    }
+}
+
+static void read_adaptive(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    adaptive_bitrate_config_t *controller = &config->adaptive.controller;
+    uint32_t txbuf_low = controller->txbuf_low;
+
+    read_bool(document, root, "adaptive.enabled", &config->adaptive.enabled);
+    read_uint32(document, root, "adaptive.minBitrate", &controller->min_kbps);
+    read_uint32(document, root, "adaptive.maxBitrate", &controller->max_kbps);
+    read_uint32(document, root, "adaptive.step", &controller->step_kbps);
+    read_double(document, root, "adaptive.decrease", &controller->decrease_factor);
+    read_int32(document, root, "adaptive.minMargin", &controller->min_margin_db);
+    read_uint32(document, root, "adaptive.txbufLow", &txbuf_low);
+    read_uint32(document, root, "adaptive.maxRxErrors", &controller->max_rx_errors);
+    read_uint32(document, root, "adaptive.holdMs", &controller->hold_ms);
+    read_uint32(document, root, "adaptive.recoverMs", &controller->recover_ms);
+    read_uint32(document, root, "adaptive.lowFps", &controller->low_fps);
+    read_uint32(document, root, "adaptive.lowFpsBelow", &controller->low_fps_below_kbps);
+    controller->txbuf_low = (uint8_t)(txbuf_low > 100 ? 100 : txbuf_low);
+}
+
+static void read_probe(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    stream_probe_config_t *settings = &config->probe.settings;
+
+    read_bool(document, root, "probe.enabled", &config->probe.enabled);
+    read_string(document, root, "probe.path", settings->path, sizeof(settings->path));
+    read_uint32(document, root, "probe.timeoutMs", &settings->timeout_ms);
+    read_uint32(document, root, "probe.settleMs", &settings->settle_ms);
+}
+
+static void read_supervisor(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    majestic_supervisor_config_t *settings = &config->supervisor.settings;
+
+    read_bool(document, root, "supervisor.enabled", &config->supervisor.enabled);
+    read_string(document, root, "supervisor.command", settings->command, sizeof(settings->command));
+    read_uint32(document, root, "supervisor.stableMs", &settings->stable_ms);
+    read_uint32(document, root, "supervisor.minBackoffMs", &settings->min_backoff_ms);
+    read_uint32(document, root, "supervisor.maxBackoffMs", &settings->max_backoff_ms);
+    read_uint32(document, root, "supervisor.rollbackAfter", &settings->rollback_after);
+
+    if (settings->max_backoff_ms < settings->min_backoff_ms) {
+        settings->max_backoff_ms = settings->min_backoff_ms;
+    }
+}
+
+static void read_capture(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    image_capture_config_t *settings = &config->capture.settings;
+
+    read_bool(document, root, "capture.enabled", &config->capture.enabled);
+    read_string(document, root, "capture.path", settings->path, sizeof(settings->path));
+    read_string(document, root, "capture.url", settings->target, sizeof(settings->target));
+    read_uint32(document, root, "capture.bufferSize", &settings->buffer_size);
+    read_uint32(document, root, "capture.syncMs", &settings->sync_ms);
+
+    if (settings->buffer_size < 64 * 1024) {
+        settings->buffer_size = 64 * 1024;
+    }
+}
+
+static void read_osd(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    osd_feed_config_t *settings = &config->osd.settings;
+
+    read_bool(document, root, "osd.enabled", &config->osd.enabled);
+    read_string(document, root, "osd.template", settings->template, sizeof(settings->template));
+    read_uint32(document, root, "osd.region", &settings->region);
+    read_int32(document, root, "osd.posX", &settings->pos_x);
+    read_int32(document, root, "osd.posY", &settings->pos_y);
+    read_uint32(document, root, "osd.intervalMs", &settings->interval_ms);
+    read_uint32(document, root, "osd.refreshMs", &settings->refresh_ms);
+
+    // Majestic redraws the overlay per frame; faster updates only cost CPU.
+    if (settings->interval_ms < 50) {
+        settings->interval_ms = 50;
+    }
+}
+
+// Split "a.b.c.d:port" into an endpoint's IPv4 address and port.
+static int parse_udp_address(const char *text, mavlink_router_endpoint_config_t *endpoint) {
+    const char *colon = strrchr(text, ':');
+    char *end = NULL;
+    struct in_addr parsed;
+
+    if (!colon || (size_t)(colon - text) >= sizeof(endpoint->address)) {
+        return -1;
+    }
+
+    const unsigned long port = strtoul(colon + 1, &end, 10);
+
+    if (!end || end == colon + 1 || *end != '\0' || port == 0 || port > 65535) {
+        return -1;
+    }
+
+    memcpy(endpoint->address, text, (size_t)(colon - text));
+    endpoint->address[colon - text] = '\0';
+    endpoint->port = (uint16_t)port;
+    return inet_pton(AF_INET, endpoint->address, &parsed) == 1 ? 0 : -1;
+}
+
+static int read_endpoint(yaml_document_t *document, yaml_node_t *node, size_t index,
+                         mavlink_router_endpoint_config_t *endpoint) {
+    const char *udp = lookup_scalar(document, node, "udp");
+    const char *mode = lookup_scalar(document, node, "mode");
+
+    memset(endpoint, 0, sizeof(*endpoint));
+    snprintf(endpoint->name, sizeof(endpoint->name), "endpoint%zu", index);
+    read_string(document, node, "name", endpoint->name, sizeof(endpoint->name));
+
+    if (udp) {
+        if (parse_udp_address(udp, endpoint) != 0) {
+            fprintf(stderr, "Ignoring endpoint %s: expected udp: <ipv4>:<port>, got %s.\n", endpoint->name, udp);
+            return -1;
+        }
+
+        if (!mode || strcmp(mode, "client") == 0) {
+            endpoint->type = MAVLINK_ROUTER_UDP_CLIENT;
+        } else if (strcmp(mode, "server") == 0) {
+            endpoint->type = MAVLINK_ROUTER_UDP_SERVER;
+        } else {
+            fprintf(stderr, "Ignoring endpoint %s: unknown mode %s.\n", endpoint->name, mode);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    endpoint->type = MAVLINK_ROUTER_SERIAL;
+    endpoint->baud = 57600;
+    read_string(document, node, "serial", endpoint->address, sizeof(endpoint->address));
+    read_uint32(document, node, "baud", &endpoint->baud);
+
+    if (endpoint->address[0] == '\0') {
+        fprintf(stderr, "Ignoring endpoint %s: needs a udp or serial key.\n", endpoint->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void read_router(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    yaml_node_t *endpoints = mapping_lookup(document, mapping_lookup(document, root, "router"), "endpoints");
+
+    if (!endpoints) {
+        return;
+    }
+
+    if (endpoints->type != YAML_SEQUENCE_NODE) {
+        fprintf(stderr, "Ignoring router.endpoints: expected a list.\n");
+        return;
+    }
+
+    for (yaml_node_item_t *item = endpoints->data.sequence.items.start; item < endpoints->data.sequence.items.top; ++item) {
+        const size_t index = config->router.endpoint_count;
+
+        if (index >= MAVLINK_ROUTER_MAX_ENDPOINTS) {
+            fprintf(stderr, "Ignoring router endpoints beyond the first %d.\n", MAVLINK_ROUTER_MAX_ENDPOINTS);
+            return;
+        }
+
+        if (read_endpoint(document, yaml_document_get_node(document, *item), index, &config->router.endpoints[index]) == 0) {
+            ++config->router.endpoint_count;
+        }
+    }
+}
+
+// commands:
+//   night_mode:            # name sent in STATUSTEXT
+//     image.saturation: 0  # Majestic key: value, or "$1" for an argument
+static int read_command(yaml_document_t *document, const char *name, yaml_node_t *changes, command_t *command) {
+    memset(command, 0, sizeof(*command));
+    command->kind = COMMAND_CHANGES;
+
+    if (strlen(name) >= sizeof(command->name)) {
+        fprintf(stderr, "Ignoring command %s: name too long.\n", name);
+        return -1;
+    }
+
+    strcpy(command->name, name);
+
+    if (!changes || changes->type != YAML_MAPPING_NODE) {
+        fprintf(stderr, "Ignoring command %s: expected a map of Majestic keys.\n", name);
+        return -1;
+    }
+
+    for (yaml_node_pair_t *pair = changes->data.mapping.pairs.start; pair < changes->data.mapping.pairs.top; ++pair) {
+        yaml_node_t *key = yaml_document_get_node(document, pair->key);
+        yaml_node_t *value = yaml_document_get_node(document, pair->value);
+
+        if (!key || !value || key->type != YAML_SCALAR_NODE || value->type != YAML_SCALAR_NODE) {
+            fprintf(stderr, "Ignoring command %s: values must be plain scalars.\n", name);
+            return -1;
+        }
+
+        if (command->change_count >= COMMAND_MAX_CHANGES ||
+            key->data.scalar.length >= MAJESTIC_CONFIG_KEY_MAX_LEN ||
+            value->data.scalar.length >= MAJESTIC_CONFIG_VALUE_MAX_LEN) {
+            fprintf(stderr, "Ignoring command %s: too many or too long changes.\n", name);
+            return -1;
+        }
+
+        majestic_config_change_t *change = &command->changes[command->change_count++];
+        memcpy(change->key, key->data.scalar.value, key->data.scalar.length + 1);
+        memcpy(change->value, value->data.scalar.value, value->data.scalar.length + 1);
+    }
+
+    return 0;
+}
+
+static void read_commands(yaml_document_t *document, yaml_node_t *root, manager_config_t *config) {
+    yaml_node_t *commands = mapping_lookup(document, root, "commands");
+    command_t command;
+
+    if (!commands) {
+        return;
+    }
+
+    if (commands->type != YAML_MAPPING_NODE) {
+        fprintf(stderr, "Ignoring commands: expected a map.\n");
+        return;
+    }
+
+    for (yaml_node_pair_t *pair = commands->data.mapping.pairs.start; pair < commands->data.mapping.pairs.top; ++pair) {
+        yaml_node_t *name = yaml_document_get_node(document, pair->key);
+
+        if (!name || name->type != YAML_SCALAR_NODE) {
+            continue;
+        }
+
+        if (read_command(document, (const char *)name->data.scalar.value,
+                         yaml_document_get_node(document, pair->value), &command) == 0) {
+            (void)command_registry_add(&config->commands, &command);
+        }
+    }
+}
+
+static void apply_document(yaml_document_t *document, manager_config_t *config) {
+    yaml_node_t *root = yaml_document_get_root_node(document);
+
+    read_string(document, root, "majestic.config", config->majestic_config_path, sizeof(config->majestic_config_path));
+    read_string(document, root, "majestic.flash", config->majestic_flash_path, sizeof(config->majestic_flash_path));
+    read_uint32(document, root, "majestic.syncDelay", &config->majestic_sync_delay_ms);
+    read_string(document, root, "serial.device", config->serial.device, sizeof(config->serial.device));
+    read_uint32(document, root, "serial.baud", &config->serial.baud);
+    read_double(document, root, "zoom.max", &config->zoom.max);
+    read_double(document, root, "zoom.step", &config->zoom.step);
+    read_uint32(document, root, "zoom.alignment", &config->zoom.alignment);
+    read_string(document, root, "zoom.state", config->zoom.state_path, sizeof(config->zoom.state_path));
+    read_string(document, root, "zoom.stateFlash", config->zoom.state_flash_path,
+                sizeof(config->zoom.state_flash_path));
+    read_string(document, root, "stats.socket", config->stats.socket_path, sizeof(config->stats.socket_path));
+    read_uint32(document, root, "stats.interval", &config->stats.interval_ms);
+    read_string(document, root, "recorder.path", config->recorder.path, sizeof(config->recorder.path));
+    read_uint32(document, root, "recorder.size", &config->recorder.size);
+    read_profiles(document, config);
+    read_adaptive(document, root, config);
+    read_probe(document, root, config);
+    read_supervisor(document, root, config);
+    read_capture(document, root, config);
+    read_osd(document, root, config);
+    read_router(document, root, config);
+    read_commands(document, root, config);
+}
+
+int manager_config_load(const char *path, manager_config_t *config) {
+    manager_config_defaults(config);
+
+    FILE *input = fopen(path, "rb");
+
+    if (!input) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+
+        fprintf(stderr, "%s not found; using built-in defaults.\n", path);
+        return 0;
+    }
+
+    yaml_parser_t parser;
+    yaml_document_t document;
+
+    if (!yaml_parser_initialize(&parser)) {
+        fprintf(stderr, "Failed to initialize YAML parser.\n");
+        fclose(input);
+        return -1;
+    }
+
+    yaml_parser_set_input_file(&parser, input);
+
+    if (!yaml_parser_load(&parser, &document)) {
+        fprintf(stderr, "YAML parser error while reading %s: %s (line %zu)\n",
+                path,
+                parser.problem ? parser.problem : "unknown",
+                (size_t)parser.problem_mark.line + 1);
+        yaml_parser_delete(&parser);
+        fclose(input);
+        return -1;
+    }
+
+    yaml_parser_delete(&parser);
+    fclose(input);
+
+    apply_document(&document, config);
+    yaml_document_delete(&document);
+    return 0;
+}
+
+int manager_config_read_baseline(const char *majestic_config_path, encoder_profile_t *baseline) {
+    char value[MAJESTIC_CONFIG_VALUE_MAX_LEN];
+    int found = 0;
+
+    memset(baseline, 0, sizeof(*baseline));
+    baseline->min_qp = -1;
+    baseline->max_qp = -1;
+
+    if (majestic_config_get(majestic_config_path, "video1.bitrate", value, sizeof(value)) == 0) {
+        baseline->bitrate = (uint32_t)strtoul(value, NULL, 10);
+        ++found;
+    }
+
+    if (majestic_config_get(majestic_config_path, "video1.fps", value, sizeof(value)) == 0) {
+        baseline->fps = (uint32_t)strtoul(value, NULL, 10);
+        ++found;
+    }
+
+    if (majestic_config_get(majestic_config_path, "video1.gopSize", value, sizeof(value)) == 0) {
+        baseline->gop_size = strtod(value, NULL);
+        ++found;
+    }
+
+    if (majestic_config_get(majestic_config_path, "video1.minQp", value, sizeof(value)) == 0) {
+        baseline->min_qp = (int32_t)strtol(value, NULL, 10);
+        ++found;
+    }
+
+    if (majestic_config_get(majestic_config_path, "video1.maxQp", value, sizeof(value)) == 0) {
+        baseline->max_qp = (int32_t)strtol(value, NULL, 10);
+        ++found;
+    }
+
+    return found > 0 ? 0 : -1;
+}
+
+void manager_config_resolve_profile(const manager_config_t *config, int index, const encoder_profile_t *baseline,
+                                    encoder_profile_t *out) {
+    *out = *baseline;
+
+    if (index < 0 || (size_t)index >= config->profile_count) {
+        return;
+    }
+
+    const encoder_profile_t *profile = &config->profiles[index];
+
+    out->min_zoom = profile->min_zoom;
+    out->bitrate = profile->bitrate > 0 ? profile->bitrate : baseline->bitrate;
+    out->fps = profile->fps > 0 ? profile->fps : baseline->fps;
+    out->gop_size = profile->gop_size > 0.0 ? profile->gop_size : baseline->gop_size;
+    out->min_qp = profile->min_qp >= 0 ? profile->min_qp : baseline->min_qp;
+    out->max_qp = profile->max_qp >= 0 ? profile->max_qp : baseline->max_qp;
+}
+
+int manager_config_stage_number(majestic_config_txn_t *txn, const char *key, const char *format, double value) {
+    char text[MAJESTIC_CONFIG_VALUE_MAX_LEN];
+
+    snprintf(text, sizeof(text), format, value);
+    return majestic_config_set(txn, key, text);
+}
+
+int manager_config_stage_profile(majestic_config_txn_t *txn, const encoder_profile_t *profile) {
+    int status = 0;
+
+    if (profile->bitrate > 0) {
+        status |= manager_config_stage_number(txn, "video1.bitrate", "%.0f", profile->bitrate);
+    }
+
+    if (profile->fps > 0) {
+        status |= manager_config_stage_number(txn, "video1.fps", "%.0f", profile->fps);
+    }
+
+    if (profile->gop_size > 0.0) {
+        status |= manager_config_stage_number(txn, "video1.gopSize", "%g", profile->gop_size);
+    }
+
+    if (profile->min_qp >= 0) {
+        status |= manager_config_stage_number(txn, "video1.minQp", "%.0f", profile->min_qp);
+    }
+
+    if (profile->max_qp >= 0) {
+        status |= manager_config_stage_number(txn, "video1.maxQp", "%.0f", profile->max_qp);
+    }
+
+    return status != 0 ? -1 : 0;
+}
+
+int manager_config_select_profile(const manager_config_t *config, double zoom) {
+    int selected = -1;
+
+    for (size_t i = 0; i < config->profile_count; ++i) {
+        if (config->profiles[i].min_zoom > zoom + 1e-6) {
+            break;
+        }
+
+        selected = (int)i;
+    }
+
+    return selected;
+}
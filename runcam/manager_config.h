@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adaptive_bitrate.h"
+#include "command_registry.h"
+#include "image_capture.h"
+#include "majestic_config.h"
+#include "majestic_supervisor.h"
+#include "mavlink_router.h"
+#include "osd_feed.h"
+#include "stream_probe.h"
+
+#define MANAGER_CONFIG_PATH_MAX 256
+#define MANAGER_CONFIG_MAX_PROFILES 8
+
+/**
+ * Encoder settings for video1 bound to a zoom range. A profile applies from
+ * `min_zoom` up to the next profile's `min_zoom`. Zero (or -1 for the QP
+ * limits) means the profile does not set the key, and the baseline value
+ * Majestic had before any profile is used instead.
+ */
+typedef struct encoder_profile {
+    double min_zoom;
+    uint32_t bitrate;  // kbps
+    uint32_t fps;
+    double gop_size;   // seconds between IDR frames
+    int32_t min_qp;
+    int32_t max_qp;
+} encoder_profile_t;
+
+/**
+ * Runtime settings of the manager itself, read from a small YAML file
+ * (/etc/majestic_manager.yaml by default). Every field has a built-in default,
+ * so a missing file or key keeps the previous hard-coded behaviour.
+ */
+typedef struct manager_config {
+    char majestic_config_path[MANAGER_CONFIG_PATH_MAX]; // working copy Majestic reads
+    char majestic_flash_path[MANAGER_CONFIG_PATH_MAX];  // durable copy, empty when they are the same file
+    uint32_t majestic_sync_delay_ms; // quiet time before config changes reach flash
+    struct {
+        char device[MANAGER_CONFIG_PATH_MAX]; // flight controller UART
+        uint32_t baud;
+    } serial;
+    struct {
+        double max;         // largest zoom factor
+        double step;        // zoom factor multiplier per zoom_in/zoom_out
+        uint32_t alignment; // crop alignment in pixels
+        char state_path[MANAGER_CONFIG_PATH_MAX]; // zoom kept across restarts (tmpfs), empty disables
+        char state_flash_path[MANAGER_CONFIG_PATH_MAX]; // durable copy, synced like majestic.flash
+    } zoom;
+    encoder_profile_t profiles[MANAGER_CONFIG_MAX_PROFILES]; // sorted by min_zoom
+    size_t profile_count;
+    struct {
+        char socket_path[MANAGER_CONFIG_PATH_MAX]; // empty disables the socket
+        uint32_t interval_ms; // NAMED_VALUE export period, 0 disables
+    } stats;
+    struct {
+        char path[MANAGER_CONFIG_PATH_MAX]; // raw link ring file, empty disables
+        uint32_t size;                      // bytes of link data kept
+    } recorder;
+    struct {
+        bool enabled; // drive video1.bitrate from RADIO_STATUS
+        adaptive_bitrate_config_t controller;
+    } adaptive;
+    struct {
+        mavlink_router_endpoint_config_t endpoints[MAVLINK_ROUTER_MAX_ENDPOINTS]; // used by --router
+        size_t endpoint_count;
+    } router;
+    struct {
+        bool enabled; // after a reload, wait for the RTSP stream instead of the process
+        stream_probe_config_t settings;
+    } probe;
+    struct {
+        bool enabled; // run Majestic as a child and restart it when it exits
+        majestic_supervisor_config_t settings;
+    } supervisor;
+    struct {
+        bool enabled; // answer MAV_CMD_IMAGE_START_CAPTURE with geotagged stills
+        image_capture_config_t settings;
+    } capture;
+    struct {
+        bool enabled; // push live telemetry into Majestic's OSD
+        osd_feed_config_t settings;
+    } osd;
+    command_registry_t commands; // built-ins plus the `commands:` section
+} manager_config_t;
+
+void manager_config_defaults(manager_config_t *config);
+
+/**
+ * Fill `config` with defaults and override them from the YAML file.
+ *
+ * @return 0 on success (including a missing file), -1 if the file exists but
+ *         cannot be parsed (details logged to stderr; defaults stay in place).
+ */
+int manager_config_load(const char *path, manager_config_t *config);
+
+/**
+ * Find the encoder profile covering a zoom factor.
+ *
+ * @return profile index, or -1 if no profile covers the factor.
+ */
+int manager_config_select_profile(const manager_config_t *config, double zoom);
+
+/**
+ * Read the video1 encoder keys profiles manage from the Majestic config.
+ * Keys the config lacks stay unset (0, or -1 for the QP limits).
+ *
+ * @return 0 on success, -1 if the config cannot be read.
+ */
+int manager_config_read_baseline(const char *majestic_config_path, encoder_profile_t *baseline);
+
+/**
+ * The full encoder settings for profile `index`: its own values over
+ * `baseline`. Index -1 (below the first profile) yields the baseline, so the
+ * encoder depends only on the zoom level, not on the profiles passed before.
+ */
+void manager_config_resolve_profile(const manager_config_t *config, int index, const encoder_profile_t *baseline,
+                                    encoder_profile_t *out);
+
+/**
+ * Stage `key` with `value` rendered through the printf `format` (e.g. "%.0f").
+ *
+ * @return 0 on success, -1 if the value is too long or the transaction is full.
+ */
+int manager_config_stage_number(majestic_config_txn_t *txn, const char *key, const char *format, double value);
+
+/**
+ * Stage every key `profile` sets into `txn`.
+ *
+ * @return 0 on success, -1 if the transaction is full.
+ */
+int manager_config_stage_profile(majestic_config_txn_t *txn, const encoder_profile_t *profile);
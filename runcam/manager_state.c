@@ -0,0 +1,109 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "manager_state.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+bool manager_state_equal(const manager_state_t *a, const manager_state_t *b) {
+    if (a->zoom != b->zoom || a->has_baseline != b->has_baseline) {
+        return false;
+    }
+
+    return !a->has_baseline ||
+           (a->baseline.bitrate == b->baseline.bitrate && a->baseline.fps == b->baseline.fps &&
+            a->baseline.gop_size == b->baseline.gop_size && a->baseline.min_qp == b->baseline.min_qp &&
+            a->baseline.max_qp == b->baseline.max_qp);
+}
+
+int manager_state_load(const char *path, manager_state_t *state) {
+    FILE *input = fopen(path, "r");
+    char line[128];
+    manager_state_t loaded = { .zoom = 0.0 };
+    int found = 0;
+
+    if (!input) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), input)) {
+        char *end;
+        encoder_profile_t *baseline = &loaded.baseline;
+
+        if (strncmp(line, "baseline:", 9) == 0) {
+            loaded.has_baseline = sscanf(line + 9, "%u %u %lf %d %d", &baseline->bitrate, &baseline->fps,
+                                         &baseline->gop_size, &baseline->min_qp, &baseline->max_qp) == 5;
+            continue;
+        }
+
+        if (strncmp(line, "zoom:", 5) != 0) {
+            continue;
+        }
+
+        loaded.zoom = strtod(line + 5, &end);
+        found = end != line + 5 && loaded.zoom > 0.0;
+    }
+
+    fclose(input);
+
+    if (!found) {
+        return -1;
+    }
+
+    *state = loaded;
+    return 0;
+}
+
+// Written with plain write(2): this runs after every zoom change, and stdio
+// would allocate a FILE each time.
+int manager_state_save(const char *path, const manager_state_t *state) {
+    char temp_path[PATH_MAX];
+    char line[128];
+
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+        fprintf(stderr, "State path too long: %s\n", path);
+        return -1;
+    }
+
+    int length = snprintf(line, sizeof(line), "zoom: %.6f\n", state->zoom);
+
+    if (state->has_baseline) {
+        const encoder_profile_t *baseline = &state->baseline;
+
+        length += snprintf(line + length, sizeof(line) - (size_t)length, "baseline: %u %u %g %d %d\n",
+                           baseline->bitrate, baseline->fps, baseline->gop_size, baseline->min_qp, baseline->max_qp);
+    }
+
+    const int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", temp_path, strerror(errno));
+        return -1;
+    }
+
+    ssize_t written;
+
+    do {
+        written = write(fd, line, (size_t)length);
+    } while (written < 0 && errno == EINTR);
+
+    if (close(fd) != 0 || written != length) {
+        fprintf(stderr, "Failed to write %s\n", temp_path);
+        unlink(temp_path);
+        return -1;
+    }
+
+    if (rename(temp_path, path) != 0) {
+        fprintf(stderr, "Failed to replace %s: %s\n", path, strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "manager_config.h"
+
+/**
+ * State the manager carries across restarts. The encoder profile is not
+ * stored: it follows from the zoom factor and the profile table, and
+ * re-staging it on startup is free once unchanged values are pruned. The
+ * baseline is, though: once a profile has been written, the Majestic config
+ * no longer shows what the keys it omits should return to.
+ */
+typedef struct manager_state {
+    double zoom; // last zoom factor Majestic accepted
+    bool has_baseline;
+    encoder_profile_t baseline; // video1 encoder keys before any profile
+} manager_state_t;
+
+bool manager_state_equal(const manager_state_t *a, const manager_state_t *b);
+
+/**
+ * Read a state file written by manager_state_save().
+ *
+ * @return 0 on success, -1 if the file is missing or malformed (`state`
+ *         is left untouched).
+ */
+int manager_state_load(const char *path, manager_state_t *state);
+
+/**
+ * Write the state to a temporary file next to `path` and rename it into
+ * place, so a crash never leaves a torn file behind.
+ *
+ * @return 0 on success, -1 on error (details logged to stderr).
+ */
+int manager_state_save(const char *path, const manager_state_t *state);
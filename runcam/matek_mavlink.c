@@ -1,41 +1,107 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/serial.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 
-// MAVLink's generated enums use values beyond ISO C's int range, which triggers
-// -Wpedantic on both clang and GCC. Temporarily silence that warning while the
-// header is included, then restore prior settings immediately afterward.
-#if defined(__clang__)
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wpedantic"
-#elif defined(__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wpedantic"
-#endif
-
-#include "third_party/c_library_v2/common/mavlink.h"
-
-// Restore the prior warning configuration immediately after the include so the
-// rest of this translation unit is still built with full -Wpedantic checking.
-#if defined(__clang__)
-#pragma clang diagnostic pop
-#elif defined(__GNUC__)
-#pragma GCC diagnostic pop
-#endif
-
+#include "latency_trace.h"
 #include "matek_mavlink.h"
+#include "mavlink_scanner.h"
+#include "ring_buffer.h"
 
-static const char *const MATEK_DEVICE = "/dev/ttyS2";
-static const speed_t SERIAL_SPEED = B57600;
 static const uint8_t SYSTEM_ID = 2;
-static const uint8_t COMPONENT_ID = 191;
-static mavlink_status_t parser_status;
+// Announce ourselves as camera #1 so ground stations run the MAVLink camera
+// protocol against this component.
+static const uint8_t COMPONENT_ID = MAV_COMP_ID_CAMERA;
+// Upper bound on read(2) calls per wakeup so a flooding link cannot starve
+// the heartbeat timer; poll(2) is level-triggered and picks up the rest.
+static const int MAX_READS_PER_RECEIVE = 16;
+
+typedef struct baud_rate {
+    uint32_t baud;
+    speed_t speed;
+} baud_rate_t;
+
+static const baud_rate_t BAUD_RATES[] = {
+    { 9600, B9600 },
+    { 19200, B19200 },
+    { 38400, B38400 },
+    { 57600, B57600 },
+    { 115200, B115200 },
+    { 230400, B230400 },
+    { 460800, B460800 },
+    { 500000, B500000 },
+    { 921600, B921600 },
+    { 1000000, B1000000 },
+    { 1500000, B1500000 },
+    { 2000000, B2000000 },
+};
+
+typedef struct matek_handler_entry {
+    uint32_t msgid;
+    matek_message_handler_t handler;
+    void *context;
+} matek_handler_entry_t;
+
+static uint8_t receive_storage[1024];
+static ring_buffer_t receive_ring = {
+    .data = receive_storage,
+    .capacity = sizeof(receive_storage),
+    .head = 0,
+    .tail = 0
+};
+// Outgoing bytes the UART could not take yet. Bursts (camera information
+// replies, acks, heartbeats) queue here instead of spinning on EAGAIN and are
+// flushed when poll(2) reports the descriptor writable.
+static uint8_t transmit_storage[4096];
+static ring_buffer_t transmit_ring = {
+    .data = transmit_storage,
+    .capacity = sizeof(transmit_storage),
+    .head = 0,
+    .tail = 0
+};
+static uint64_t last_receive_ns = 0;
+static matek_output_hook_t output_hook = NULL;
+static void *output_hook_context = NULL;
+static matek_receive_hook_t receive_hook = NULL;
+static void *receive_hook_context = NULL;
+static matek_handler_entry_t handlers[MATEK_MAX_HANDLERS];
+static size_t handler_count = 0;
+
+static int lookup_speed(uint32_t baud, speed_t *speed) {
+    for (size_t i = 0; i < sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]); ++i) {
+        if (BAUD_RATES[i].baud == baud) {
+            *speed = BAUD_RATES[i].speed;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+// Ask the UART driver to push received bytes to the tty layer immediately
+// instead of batching them. Drivers without TIOCSSERIAL (ptys, USB serial)
+// simply keep their default.
+static void enable_low_latency(int fd) {
+    struct serial_struct serial;
+
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+        return;
+    }
+
+    serial.flags |= ASYNC_LOW_LATENCY;
+
+    if (ioctl(fd, TIOCSSERIAL, &serial) != 0) {
+        fprintf(stderr, "Unable to enable low-latency UART mode: %s\n", strerror(errno));
+    }
+}
 
-static int configure_serial(int fd) {
+static int configure_serial(int fd, speed_t speed) {
     struct termios tty;
 
     if (tcgetattr(fd, &tty) != 0) {
@@ -44,15 +110,18 @@ static int configure_serial(int fd) {
     }
 
     cfmakeraw(&tty);
-    cfsetispeed(&tty, SERIAL_SPEED);
-    cfsetospeed(&tty, SERIAL_SPEED);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
 
     tty.c_cflag |= (CLOCAL | CREAD);
     tty.c_cflag &= ~CSIZE;
     tty.c_cflag |= CS8;
     tty.c_cflag &= ~(PARENB | PARODD | CSTOPB);
     tty.c_cflag &= ~CRTSCTS;
-    tty.c_cc[VMIN] = 0;
+    // Return as soon as one byte is available with no inter-byte timer. The
+    // descriptor is non-blocking for the event loop, so this only matters to
+    // anyone reading it in blocking mode, but it never adds latency.
+    tty.c_cc[VMIN] = 1;
     tty.c_cc[VTIME] = 0;
 
     if (tcsetattr(fd, TCSANOW, &tty) != 0) {
@@ -60,119 +129,258 @@ static int configure_serial(int fd) {
         return -1;
     }
 
-    if (tcflush(fd, TCIFLUSH) != 0) {
+    if (tcflush(fd, TCIOFLUSH) != 0) {
         fprintf(stderr, "tcflush failed: %s\n", strerror(errno));
         return -1;
     }
 
+    enable_low_latency(fd);
     return 0;
 }
 
-static int write_all(int fd, const uint8_t *data, size_t length) {
-    size_t offset = 0;
+static void notify_output(int fd, bool pending) {
+    if (output_hook) {
+        output_hook(fd, pending, output_hook_context);
+    }
+}
+
+static int flush_transmit(int fd) {
+    const uint8_t *segments[2];
+    size_t lengths[2];
+
+    while (ring_buffer_size(&transmit_ring) > 0) {
+        (void)ring_buffer_peek(&transmit_ring, segments, lengths);
 
-    while (offset < length) {
-        const ssize_t written = write(fd, data + offset, length - offset);
+        const ssize_t written = write(fd, segments[0], lengths[0]);
 
         if (written < 0) {
-            if (errno == EINTR || errno == EAGAIN) {
-                // Retry on signal interruption or when serial port reports "try again".
+            if (errno == EINTR) {
                 continue;
             }
 
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+
+            fprintf(stderr, "Failed to write to Matek link: %s\n", strerror(errno));
             return -1;
         }
 
-        offset += (size_t)written;
+        ring_buffer_consume(&transmit_ring, (size_t)written);
     }
 
     return 0;
 }
 
-int open_matek_device(void) {
-    const int fd = open(MATEK_DEVICE, O_RDWR | O_NOCTTY | O_SYNC);
+int matek_flush(int fd) {
+    if (flush_transmit(fd) != 0) {
+        return -1;
+    }
+
+    if (!matek_output_pending()) {
+        notify_output(fd, false);
+    }
+
+    return 0;
+}
+
+bool matek_output_pending(void) {
+    return ring_buffer_size(&transmit_ring) > 0;
+}
+
+void matek_set_output_hook(matek_output_hook_t hook, void *context) {
+    output_hook = hook;
+    output_hook_context = context;
+}
+
+void matek_set_receive_hook(matek_receive_hook_t hook, void *context) {
+    receive_hook = hook;
+    receive_hook_context = context;
+}
+
+int open_matek_device(const char *device, uint32_t baud) {
+    speed_t speed;
+
+    if (lookup_speed(baud, &speed) != 0) {
+        fprintf(stderr, "Unsupported baud rate %u for %s\n", baud, device);
+        return -1;
+    }
+
+    const int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
 
     if (fd < 0) {
-        fprintf(stderr, "Unable to open %s: %s\n", MATEK_DEVICE, strerror(errno));
+        fprintf(stderr, "Unable to open %s: %s\n", device, strerror(errno));
         return -1;
     }
 
-    if (configure_serial(fd) != 0) {
+    if (configure_serial(fd, speed) != 0) {
         close(fd);
         return -1;
     }
 
+    // A fresh link must not inherit a half-parsed frame or stale replies
+    // from the previous one.
+    ring_buffer_clear(&receive_ring);
+    ring_buffer_clear(&transmit_ring);
+    mavlink_reset_channel_status(MAVLINK_COMM_0);
+
     return fd;
 }
 
+uint8_t matek_system_id(void) {
+    return SYSTEM_ID;
+}
+
+uint8_t matek_component_id(void) {
+    return COMPONENT_ID;
+}
+
+int matek_send_message(int fd, const mavlink_message_t *message) {
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const uint16_t length = mavlink_msg_to_send_buffer(buffer, message);
+    const bool was_pending = matek_output_pending();
+
+    // Never reorder: while older bytes are queued, new ones go behind them.
+    if (ring_buffer_space(&transmit_ring) < length) {
+        fprintf(stderr, "Matek transmit buffer full; dropping MAVLink message %u\n", (unsigned)message->msgid);
+        return -1;
+    }
+
+    ring_buffer_write(&transmit_ring, buffer, length);
+
+    if (was_pending) {
+        return 0;
+    }
+
+    if (flush_transmit(fd) != 0) {
+        return -1;
+    }
+
+    if (matek_output_pending()) {
+        notify_output(fd, true);
+    }
+
+    return 0;
+}
+
 int send_heartbeat(int fd) {
     mavlink_message_t message;
-    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
 
     mavlink_msg_heartbeat_pack(
         SYSTEM_ID,
         COMPONENT_ID,
         &message,
-        MAV_TYPE_ONBOARD_CONTROLLER,
+        MAV_TYPE_CAMERA,
         MAV_AUTOPILOT_INVALID,
         0,
         0,
         MAV_STATE_ACTIVE);
 
-    const uint16_t length = mavlink_msg_to_send_buffer(buffer, &message);
+    return matek_send_message(fd, &message);
+}
 
-    if (write_all(fd, buffer, length) != 0) {
-        fprintf(stderr, "Failed to write heartbeat: %s\n", strerror(errno));
+int matek_register_handler(uint32_t msgid, matek_message_handler_t handler, void *context) {
+    if (!handler || handler_count >= MATEK_MAX_HANDLERS) {
         return -1;
     }
 
+    handlers[handler_count].msgid = msgid;
+    handlers[handler_count].handler = handler;
+    handlers[handler_count].context = context;
+    handler_count++;
     return 0;
 }
 
-int receive_statustext(int fd, matek_statustext_t *message) {
-    if (message == NULL) {
-        errno = EINVAL;
-        return -1;
+static bool has_handler(uint32_t msgid, void *context) {
+    (void)context;
+
+    for (size_t i = 0; i < handler_count; ++i) {
+        if (handlers[i].msgid == msgid) {
+            return true;
+        }
     }
 
-    uint8_t buffer[128];
-    const ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+    return false;
+}
 
-    if (bytes_read < 0) {
-        // Non-fatal: interrupted read or no bytes available yet on non-blocking fd.
-        if (errno == EINTR || errno == EAGAIN) {
-            return 0;
-        }
+static void dispatch_message(const mavlink_message_t *message, void *context) {
+    (void)context;
 
-        fprintf(stderr, "Failed to read from Matek link: %s\n", strerror(errno));
-        return -1;
+    for (size_t i = 0; i < handler_count; ++i) {
+        if (handlers[i].msgid == message->msgid) {
+            handlers[i].handler(message, handlers[i].context);
+        }
     }
+}
 
-    if (bytes_read == 0) {
-        return 0;
+static mavlink_scanner_t scanner = {
+    .wanted = has_handler,
+    .on_message = dispatch_message,
+    .context = NULL
+};
+
+// Scan the buffered bytes for complete frames. Telemetry nobody registered
+// for is stepped over without CRC work; an incomplete trailing frame stays in
+// the ring until the rest of it arrives. The `fresh` bytes just read sit at
+// the end of the linearized data, so the receive hook gets one chunk.
+static int parse_buffered(size_t fresh) {
+    const uint64_t before = scanner.stats.frames_dispatched;
+    const uint8_t *data = ring_buffer_linearize(&receive_ring);
+    const size_t buffered = ring_buffer_size(&receive_ring);
+
+    if (receive_hook) {
+        receive_hook(data + buffered - fresh, fresh, last_receive_ns, receive_hook_context);
     }
 
-    mavlink_message_t parsed;
-    int found = 0;
+    const size_t consumed = mavlink_scanner_feed(&scanner, data, buffered);
 
-    for (ssize_t i = 0; i < bytes_read; ++i) {
-        if (mavlink_parse_char(MAVLINK_COMM_0, buffer[i], &parsed, &parser_status)) {
-            if (parsed.msgid == MAVLINK_MSG_ID_STATUSTEXT) {
-                mavlink_statustext_t decoded;
-                mavlink_msg_statustext_decode(&parsed, &decoded);
+    ring_buffer_consume(&receive_ring, consumed);
+    return (int)(scanner.stats.frames_dispatched - before);
+}
 
-                message->severity = decoded.severity;
-                message->id = decoded.id;
-                message->chunk_seq = decoded.chunk_seq;
+int matek_receive(int fd) {
+    int dispatched = 0;
 
-                memcpy(message->text, decoded.text, MATEK_STATUSTEXT_MAX_LEN);
-                message->text[MATEK_STATUSTEXT_MAX_LEN] = '\0';
+    for (int reads = 0; reads < MAX_READS_PER_RECEIVE; ++reads) {
+        const ssize_t bytes_read = ring_buffer_read_fd(&receive_ring, fd);
 
-                found = 1;
+        if (bytes_read < 0) {
+            // Non-fatal: interrupted read or the kernel buffer is drained.
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;
             }
+
+            fprintf(stderr, "Failed to read from Matek link: %s\n", strerror(errno));
+            return -1;
+        }
+
+        if (bytes_read == 0) {
+            break;
         }
+
+        last_receive_ns = latency_trace_now();
+        dispatched += parse_buffered((size_t)bytes_read);
     }
 
-    return found;
+    return dispatched;
+}
+
+uint64_t matek_receive_time_ns(void) {
+    return last_receive_ns;
+}
+
+void matek_decode_statustext(const mavlink_message_t *message, matek_statustext_t *out) {
+    mavlink_statustext_t decoded;
+    mavlink_msg_statustext_decode(message, &decoded);
+
+    out->severity = decoded.severity;
+    out->id = decoded.id;
+    out->chunk_seq = decoded.chunk_seq;
+
+    memcpy(out->text, decoded.text, MATEK_STATUSTEXT_MAX_LEN);
+    out->text[MATEK_STATUSTEXT_MAX_LEN] = '\0';
 }
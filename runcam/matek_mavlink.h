@@ -1,8 +1,13 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "mavlink_include.h"
+
 #define MATEK_STATUSTEXT_MAX_LEN 50
+#define MATEK_MAX_HANDLERS 16
 
 typedef struct matek_statustext {
     uint8_t severity;
@@ -11,6 +16,83 @@ typedef struct matek_statustext {
     char text[MATEK_STATUSTEXT_MAX_LEN + 1]; // +1 to append '\0' after copying MAVLink's payload
 } matek_statustext_t;
 
-int open_matek_device(void);
+/**
+ * Callback invoked for every decoded message whose msgid it was registered for.
+ */
+typedef void (*matek_message_handler_t)(const mavlink_message_t *message, void *context);
+
+/**
+ * Called when queued output appears (`pending` true) or has been fully
+ * written (`pending` false), so the owner can toggle POLLOUT interest.
+ */
+typedef void (*matek_output_hook_t)(int fd, bool pending, void *context);
+
+/**
+ * Sees every chunk read from the link before it is parsed, e.g. to record the
+ * raw stream. `data` is only valid for the duration of the call.
+ */
+typedef void (*matek_receive_hook_t)(const uint8_t *data, size_t length, uint64_t received_ns, void *context);
+
+/**
+ * Open and configure the flight controller UART: raw 8N1 at `baud` (9600 up
+ * to 2000000), non-blocking, with the driver's low-latency mode when supported.
+ *
+ * @return descriptor, or -1 on error (details logged to stderr).
+ */
+int open_matek_device(const char *device, uint32_t baud);
+
 int send_heartbeat(int fd);
-int receive_statustext(int fd, matek_statustext_t *message);
+
+/**
+ * MAVLink identity this manager uses for every message it sends.
+ */
+uint8_t matek_system_id(void);
+uint8_t matek_component_id(void);
+
+/**
+ * Serialize an already packed message and write it to the link. Whatever the
+ * UART cannot take right away is queued and written by matek_flush().
+ *
+ * @return 0 on success, -1 on error or a full transmit queue (details logged).
+ */
+int matek_send_message(int fd, const mavlink_message_t *message);
+
+/**
+ * Write queued output; call when the descriptor polls writable.
+ *
+ * @return 0 on success (output may remain queued), -1 on a write error.
+ */
+int matek_flush(int fd);
+
+bool matek_output_pending(void);
+
+void matek_set_output_hook(matek_output_hook_t hook, void *context);
+
+void matek_set_receive_hook(matek_receive_hook_t hook, void *context);
+
+/**
+ * Register a handler for a MAVLink message id. Several handlers may share an id;
+ * they run in registration order.
+ *
+ * @return 0 on success, -1 when the handler table is full.
+ */
+int matek_register_handler(uint32_t msgid, matek_message_handler_t handler, void *context);
+
+/**
+ * Drain everything the kernel has buffered for `fd` into the receive ring,
+ * decode every complete frame and dispatch each one to its handlers.
+ *
+ * @return number of messages dispatched (0 if none), -1 on a fatal read error.
+ */
+int matek_receive(int fd);
+
+/**
+ * CLOCK_MONOTONIC time (ns) of the read that delivered the bytes currently
+ * being dispatched; handlers use it to timestamp message arrival.
+ */
+uint64_t matek_receive_time_ns(void);
+
+/**
+ * Decode a STATUSTEXT message into a NUL-terminated matek_statustext_t.
+ */
+void matek_decode_statustext(const mavlink_message_t *message, matek_statustext_t *out);
@@ -0,0 +1,22 @@
+#pragma once
+
+// MAVLink's generated enums use values beyond ISO C's int range, which triggers
+// -Wpedantic on both clang and GCC. Temporarily silence that warning while the
+// header is included, then restore prior settings immediately afterward.
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpedantic"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+#include "third_party/c_library_v2/common/mavlink.h"
+
+// Restore the prior warning configuration immediately after the include so the
+// rest of the including translation unit is still built with full -Wpedantic checking.
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
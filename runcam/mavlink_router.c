@@ -0,0 +1,489 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "matek_mavlink.h"
+#include "mavlink_router.h"
+
+// Bounded so a flooding endpoint cannot starve the others.
+static const int MAX_READS_PER_SERVICE = 8;
+
+static const char *type_name(mavlink_router_endpoint_type_t type) {
+    switch (type) {
+    case MAVLINK_ROUTER_SERIAL:
+        return "serial";
+    case MAVLINK_ROUTER_UDP_SERVER:
+        return "udp-server";
+    case MAVLINK_ROUTER_UDP_CLIENT:
+        return "udp-client";
+    }
+
+    return "unknown";
+}
+
+static int open_udp(mavlink_router_endpoint_t *endpoint) {
+    const mavlink_router_endpoint_config_t *config = &endpoint->config;
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port)
+    };
+
+    if (inet_pton(AF_INET, config->address, &address.sin_addr) != 1) {
+        fprintf(stderr, "Invalid address for endpoint %s: %s\n", config->name, config->address);
+        return -1;
+    }
+
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        fprintf(stderr, "socket failed for endpoint %s: %s\n", config->name, strerror(errno));
+        return -1;
+    }
+
+    if (config->type == MAVLINK_ROUTER_UDP_SERVER) {
+        const int reuse = 1;
+
+        (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(fd, (const struct sockaddr *)&address, sizeof(address)) != 0) {
+            fprintf(stderr, "Unable to bind %s:%u for endpoint %s: %s\n",
+                    config->address, config->port, config->name, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    } else {
+        // Connected, so replies from the remote are received on this socket
+        // and sendmmsg(2) needs no per-message address.
+        if (connect(fd, (const struct sockaddr *)&address, sizeof(address)) != 0) {
+            fprintf(stderr, "Unable to connect endpoint %s to %s:%u: %s\n",
+                    config->name, config->address, config->port, strerror(errno));
+            close(fd);
+            return -1;
+        }
+
+        endpoint->peer = address;
+        endpoint->has_peer = true;
+    }
+
+    return fd;
+}
+
+static int open_endpoint(mavlink_router_endpoint_t *endpoint, const mavlink_router_endpoint_config_t *config) {
+    memset(endpoint, 0, sizeof(*endpoint));
+    endpoint->config = *config;
+    (void)ring_buffer_init(&endpoint->rx, endpoint->rx_storage, sizeof(endpoint->rx_storage));
+    (void)ring_buffer_init(&endpoint->tx, endpoint->tx_storage, sizeof(endpoint->tx_storage));
+
+    endpoint->fd = config->type == MAVLINK_ROUTER_SERIAL
+        ? open_matek_device(config->address, config->baud)
+        : open_udp(endpoint);
+
+    return endpoint->fd < 0 ? -1 : 0;
+}
+
+static void route_frame(const mavlink_frame_t *frame, void *context);
+
+int mavlink_router_open(mavlink_router_t *router, const mavlink_router_endpoint_config_t *configs, size_t count) {
+    memset(router, 0, sizeof(*router));
+    mavlink_scanner_init(&router->scanner, NULL, NULL, router);
+    mavlink_scanner_set_frame_handler(&router->scanner, route_frame);
+
+    if (count > MAVLINK_ROUTER_MAX_ENDPOINTS) {
+        fprintf(stderr, "Too many router endpoints (%zu, at most %d).\n", count, MAVLINK_ROUTER_MAX_ENDPOINTS);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (open_endpoint(&router->endpoints[i], &configs[i]) != 0) {
+            mavlink_router_close(router);
+            return -1;
+        }
+
+        router->endpoint_count = i + 1;
+    }
+
+    return 0;
+}
+
+void mavlink_router_close(mavlink_router_t *router) {
+    for (size_t i = 0; i < router->endpoint_count; ++i) {
+        if (router->endpoints[i].fd >= 0) {
+            close(router->endpoints[i].fd);
+            router->endpoints[i].fd = -1;
+        }
+    }
+
+    router->endpoint_count = 0;
+    router->loop = NULL;
+}
+
+static void learn_route(mavlink_router_t *router, uint8_t sysid, uint8_t compid, size_t endpoint) {
+    for (size_t i = 0; i < router->route_count; ++i) {
+        mavlink_router_route_t *route = &router->routes[i];
+
+        if (route->sysid == sysid && route->compid == compid) {
+            // A system may move between links (e.g. a GCS roaming networks).
+            route->endpoint = (uint8_t)endpoint;
+            return;
+        }
+    }
+
+    if (router->route_count < MAVLINK_ROUTER_MAX_ROUTES) {
+        router->routes[router->route_count++] = (mavlink_router_route_t){
+            .sysid = sysid,
+            .compid = compid,
+            .endpoint = (uint8_t)endpoint
+        };
+    }
+}
+
+// Bitmask of endpoints a frame must go to, never including its source.
+static uint32_t destinations(const mavlink_router_t *router, const mavlink_frame_t *frame, size_t source) {
+    const uint32_t everyone = ((1u << router->endpoint_count) - 1u) & ~(1u << source);
+
+    if (frame->target_system == 0) {
+        return everyone;
+    }
+
+    uint32_t mask = 0;
+    bool known = false;
+
+    for (size_t i = 0; i < router->route_count; ++i) {
+        const mavlink_router_route_t *route = &router->routes[i];
+
+        if (route->sysid == frame->target_system &&
+            (frame->target_component == 0 || route->compid == frame->target_component)) {
+            mask |= 1u << route->endpoint;
+            known = true;
+        }
+    }
+
+    // Until the target has spoken, flood so it can be discovered at all.
+    return known ? mask & ~(1u << source) : everyone;
+}
+
+static void flush_udp(mavlink_router_endpoint_t *endpoint) {
+    struct mmsghdr headers[MAVLINK_ROUTER_MAX_PENDING];
+    const bool addressed = endpoint->config.type == MAVLINK_ROUTER_UDP_SERVER;
+    size_t sent = 0;
+
+    memset(headers, 0, sizeof(headers[0]) * endpoint->pending_count);
+
+    for (size_t i = 0; i < endpoint->pending_count; ++i) {
+        headers[i].msg_hdr.msg_iov = &endpoint->pending[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+
+        if (addressed) {
+            headers[i].msg_hdr.msg_name = &endpoint->peer;
+            headers[i].msg_hdr.msg_namelen = sizeof(endpoint->peer);
+        }
+    }
+
+    while (sent < endpoint->pending_count) {
+        const int result = sendmmsg(endpoint->fd, headers + sent,
+                                    (unsigned int)(endpoint->pending_count - sent), MSG_DONTWAIT);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // EAGAIN: socket buffer full; ECONNREFUSED: nobody listening at
+            // the remote yet. Telemetry is lossy by nature; drop the rest.
+            break;
+        }
+
+        sent += (size_t)result;
+    }
+
+    endpoint->stats.tx_frames += sent;
+    endpoint->stats.tx_dropped += endpoint->pending_count - sent;
+}
+
+// Queue frames behind output the UART has not taken yet, copying only then.
+static void queue_serial(mavlink_router_endpoint_t *endpoint, size_t first) {
+    for (size_t i = first; i < endpoint->pending_count; ++i) {
+        const struct iovec *iov = &endpoint->pending[i];
+
+        if (ring_buffer_space(&endpoint->tx) < iov->iov_len) {
+            endpoint->stats.tx_dropped++;
+            continue;
+        }
+
+        (void)ring_buffer_write(&endpoint->tx, iov->iov_base, iov->iov_len);
+        endpoint->stats.tx_frames++;
+    }
+}
+
+static void flush_serial(mavlink_router_t *router, mavlink_router_endpoint_t *endpoint) {
+    size_t first_unsent = 0;
+
+    if (ring_buffer_size(&endpoint->tx) == 0) {
+        ssize_t written = writev(endpoint->fd, endpoint->pending, (int)endpoint->pending_count);
+
+        if (written < 0) {
+            written = 0;
+        }
+
+        // Frames written whole are done; the partly written one keeps its tail.
+        while (first_unsent < endpoint->pending_count &&
+               (size_t)written >= endpoint->pending[first_unsent].iov_len) {
+            written -= (ssize_t)endpoint->pending[first_unsent].iov_len;
+            endpoint->stats.tx_frames++;
+            ++first_unsent;
+        }
+
+        if (first_unsent < endpoint->pending_count && written > 0) {
+            struct iovec *partial = &endpoint->pending[first_unsent];
+
+            partial->iov_base = (uint8_t *)partial->iov_base + written;
+            partial->iov_len -= (size_t)written;
+        }
+    }
+
+    queue_serial(endpoint, first_unsent);
+
+    if (ring_buffer_size(&endpoint->tx) > 0 && router->loop) {
+        event_loop_modify(router->loop, endpoint->fd, POLLIN | POLLOUT);
+    }
+}
+
+static void flush_endpoint(mavlink_router_t *router, mavlink_router_endpoint_t *endpoint) {
+    if (endpoint->pending_count == 0) {
+        return;
+    }
+
+    if (endpoint->config.type == MAVLINK_ROUTER_SERIAL) {
+        flush_serial(router, endpoint);
+    } else {
+        flush_udp(endpoint);
+    }
+
+    endpoint->pending_count = 0;
+}
+
+static void flush_all(mavlink_router_t *router) {
+    for (size_t i = 0; i < router->endpoint_count; ++i) {
+        flush_endpoint(router, &router->endpoints[i]);
+    }
+}
+
+static void queue_frame(mavlink_router_t *router, mavlink_router_endpoint_t *endpoint, const mavlink_frame_t *frame) {
+    if (endpoint->config.type == MAVLINK_ROUTER_UDP_SERVER && !endpoint->has_peer) {
+        return; // nobody has connected to this server endpoint yet
+    }
+
+    if (endpoint->pending_count == MAVLINK_ROUTER_MAX_PENDING) {
+        flush_endpoint(router, endpoint);
+    }
+
+    endpoint->pending[endpoint->pending_count++] = (struct iovec){
+        .iov_base = (void *)frame->data,
+        .iov_len = frame->length
+    };
+}
+
+static void route_frame(const mavlink_frame_t *frame, void *context) {
+    mavlink_router_t *router = context;
+    const size_t source = router->source;
+
+    router->endpoints[source].stats.rx_frames++;
+    learn_route(router, frame->sysid, frame->compid, source);
+
+    const uint32_t mask = destinations(router, frame, source);
+
+    for (size_t i = 0; i < router->endpoint_count; ++i) {
+        if (mask & (1u << i)) {
+            queue_frame(router, &router->endpoints[i], frame);
+        }
+    }
+}
+
+static int service_udp(mavlink_router_t *router, mavlink_router_endpoint_t *endpoint) {
+    struct iovec iov[MAVLINK_ROUTER_BATCH];
+    struct mmsghdr headers[MAVLINK_ROUTER_BATCH];
+    struct sockaddr_in senders[MAVLINK_ROUTER_BATCH];
+
+    memset(headers, 0, sizeof(headers));
+
+    for (size_t i = 0; i < MAVLINK_ROUTER_BATCH; ++i) {
+        iov[i].iov_base = router->datagrams[i];
+        iov[i].iov_len = sizeof(router->datagrams[i]);
+        headers[i].msg_hdr.msg_name = &senders[i];
+        headers[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+        headers[i].msg_hdr.msg_iov = &iov[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int received = recvmmsg(endpoint->fd, headers, MAVLINK_ROUTER_BATCH, MSG_DONTWAIT, NULL);
+
+    if (received < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) {
+            return 0;
+        }
+
+        fprintf(stderr, "recvmmsg failed on endpoint %s: %s\n", endpoint->config.name, strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < received; ++i) {
+        if (endpoint->config.type == MAVLINK_ROUTER_UDP_SERVER) {
+            endpoint->peer = senders[i];
+            endpoint->has_peer = true;
+        }
+
+        // A datagram carries whole frames; a truncated tail is dropped.
+        (void)mavlink_scanner_feed(&router->scanner, router->datagrams[i], headers[i].msg_len);
+    }
+
+    // Every queued iovec points into the datagram buffers: send before reuse.
+    flush_all(router);
+    return received;
+}
+
+static int service_serial(mavlink_router_t *router, mavlink_router_endpoint_t *endpoint) {
+    for (int reads = 0; reads < MAX_READS_PER_SERVICE; ++reads) {
+        const ssize_t bytes_read = ring_buffer_read_fd(&endpoint->rx, endpoint->fd);
+
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            fprintf(stderr, "Failed to read from endpoint %s: %s\n", endpoint->config.name, strerror(errno));
+            return -1;
+        }
+
+        if (bytes_read == 0) {
+            break;
+        }
+
+        const uint8_t *data = ring_buffer_linearize(&endpoint->rx);
+        const size_t consumed = mavlink_scanner_feed(&router->scanner, data, ring_buffer_size(&endpoint->rx));
+
+        // Frames are referenced in the ring: send them before consuming.
+        flush_all(router);
+        ring_buffer_consume(&endpoint->rx, consumed);
+    }
+
+    return 0;
+}
+
+int mavlink_router_service(mavlink_router_t *router, size_t index) {
+    mavlink_router_endpoint_t *endpoint = &router->endpoints[index];
+    const uint64_t before = endpoint->stats.rx_frames;
+
+    router->source = index;
+
+    const int status = endpoint->config.type == MAVLINK_ROUTER_SERIAL
+        ? service_serial(router, endpoint)
+        : service_udp(router, endpoint);
+
+    return status < 0 ? -1 : (int)(endpoint->stats.rx_frames - before);
+}
+
+static int write_serial_backlog(mavlink_router_t *router, mavlink_router_endpoint_t *endpoint) {
+    const uint8_t *segments[2];
+    size_t lengths[2];
+    struct iovec iov[2];
+    const int count = ring_buffer_peek(&endpoint->tx, segments, lengths);
+
+    for (int i = 0; i < count; ++i) {
+        iov[i].iov_base = (void *)segments[i];
+        iov[i].iov_len = lengths[i];
+    }
+
+    const ssize_t written = count > 0 ? writev(endpoint->fd, iov, count) : 0;
+
+    if (written < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+
+        fprintf(stderr, "Failed to write to endpoint %s: %s\n", endpoint->config.name, strerror(errno));
+        return -1;
+    }
+
+    ring_buffer_consume(&endpoint->tx, (size_t)written);
+
+    if (ring_buffer_size(&endpoint->tx) == 0) {
+        event_loop_modify(router->loop, endpoint->fd, POLLIN);
+    }
+
+    return 0;
+}
+
+static void handle_endpoint_ready(int fd, short revents, void *context) {
+    mavlink_router_t *router = context;
+
+    for (size_t i = 0; i < router->endpoint_count; ++i) {
+        mavlink_router_endpoint_t *endpoint = &router->endpoints[i];
+
+        if (endpoint->fd != fd) {
+            continue;
+        }
+
+        if ((revents & POLLOUT) && write_serial_backlog(router, endpoint) != 0) {
+            event_loop_stop(router->loop);
+            return;
+        }
+
+        if ((revents & (POLLERR | POLLHUP | POLLNVAL)) && endpoint->config.type == MAVLINK_ROUTER_SERIAL) {
+            fprintf(stderr, "Endpoint %s closed.\n", endpoint->config.name);
+            event_loop_stop(router->loop);
+            return;
+        }
+
+        if ((revents & POLLIN) && mavlink_router_service(router, i) < 0) {
+            event_loop_stop(router->loop);
+        }
+
+        return;
+    }
+}
+
+int mavlink_router_attach(mavlink_router_t *router, event_loop_t *loop) {
+    router->loop = loop;
+
+    for (size_t i = 0; i < router->endpoint_count; ++i) {
+        if (event_loop_add(loop, router->endpoints[i].fd, POLLIN, handle_endpoint_ready, router) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void mavlink_router_report(const mavlink_router_t *router, FILE *stream) {
+    for (size_t i = 0; i < router->endpoint_count; ++i) {
+        const mavlink_router_endpoint_t *endpoint = &router->endpoints[i];
+
+        fprintf(stream, "endpoint %s (%s) rx=%llu tx=%llu dropped=%llu\n",
+                endpoint->config.name,
+                type_name(endpoint->config.type),
+                (unsigned long long)endpoint->stats.rx_frames,
+                (unsigned long long)endpoint->stats.tx_frames,
+                (unsigned long long)endpoint->stats.tx_dropped);
+    }
+
+    for (size_t i = 0; i < router->route_count; ++i) {
+        const mavlink_router_route_t *route = &router->routes[i];
+
+        fprintf(stream, "route %u/%u via %s\n",
+                route->sysid, route->compid, router->endpoints[route->endpoint].config.name);
+    }
+
+    fprintf(stream, "crc_errors=%llu discarded_bytes=%llu\n",
+            (unsigned long long)router->scanner.stats.crc_errors,
+            (unsigned long long)router->scanner.stats.bytes_discarded);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+#include "event_loop.h"
+#include "mavlink_scanner.h"
+#include "ring_buffer.h"
+
+#define MAVLINK_ROUTER_MAX_ENDPOINTS 8
+#define MAVLINK_ROUTER_MAX_ROUTES 64
+#define MAVLINK_ROUTER_NAME_MAX 32
+#define MAVLINK_ROUTER_ADDRESS_MAX 256
+// Datagrams taken per recvmmsg(2) call.
+#define MAVLINK_ROUTER_BATCH 16
+#define MAVLINK_ROUTER_DATAGRAM_MAX 2048
+// Frames queued per output before a forced sendmmsg(2)/writev(2).
+#define MAVLINK_ROUTER_MAX_PENDING 64
+#define MAVLINK_ROUTER_SERIAL_BUFFER 4096
+
+typedef enum mavlink_router_endpoint_type {
+    MAVLINK_ROUTER_SERIAL,
+    MAVLINK_ROUTER_UDP_SERVER, // bind locally, reply to whoever sent last
+    MAVLINK_ROUTER_UDP_CLIENT  // send to a fixed remote address
+} mavlink_router_endpoint_type_t;
+
+typedef struct mavlink_router_endpoint_config {
+    char name[MAVLINK_ROUTER_NAME_MAX];
+    mavlink_router_endpoint_type_t type;
+    char address[MAVLINK_ROUTER_ADDRESS_MAX]; // UART device, or IPv4 address for UDP
+    uint16_t port;                            // UDP only
+    uint32_t baud;                            // serial only
+} mavlink_router_endpoint_config_t;
+
+typedef struct mavlink_router_endpoint_stats {
+    uint64_t rx_frames;
+    uint64_t tx_frames;
+    uint64_t tx_dropped; // frames lost to a full socket or UART buffer
+} mavlink_router_endpoint_stats_t;
+
+typedef struct mavlink_router_endpoint {
+    mavlink_router_endpoint_config_t config;
+    int fd;
+    struct sockaddr_in peer; // client: remote address; server: last sender
+    bool has_peer;
+    ring_buffer_t rx;        // serial only: bytes not yet forming a frame
+    ring_buffer_t tx;        // serial only: output the UART could not take
+    uint8_t rx_storage[MAVLINK_ROUTER_SERIAL_BUFFER];
+    uint8_t tx_storage[MAVLINK_ROUTER_SERIAL_BUFFER];
+    // Frames routed here during the current input batch. The iovecs point
+    // into the receive buffers, so fan-out never copies a frame.
+    struct iovec pending[MAVLINK_ROUTER_MAX_PENDING];
+    size_t pending_count;
+    mavlink_router_endpoint_stats_t stats;
+} mavlink_router_endpoint_t;
+
+typedef struct mavlink_router_route {
+    uint8_t sysid;
+    uint8_t compid;
+    uint8_t endpoint;
+} mavlink_router_route_t;
+
+/**
+ * MAVLink router bridging serial and UDP endpoints, in the spirit of
+ * mavlink-router. Every frame is forwarded to each other endpoint that has
+ * seen its target system (and component), or to all of them for broadcasts
+ * and targets nobody has announced yet. Routes are learned from the source
+ * ids of received frames. UDP input is read with recvmmsg(2) and each output
+ * gets one sendmmsg(2) (or writev(2) for a UART) per input batch, with the
+ * frames referenced in place.
+ */
+typedef struct mavlink_router {
+    mavlink_router_endpoint_t endpoints[MAVLINK_ROUTER_MAX_ENDPOINTS];
+    size_t endpoint_count;
+    mavlink_router_route_t routes[MAVLINK_ROUTER_MAX_ROUTES];
+    size_t route_count;
+    mavlink_scanner_t scanner;
+    event_loop_t *loop; // set by mavlink_router_attach()
+    size_t source; // endpoint whose input is being scanned
+    uint8_t datagrams[MAVLINK_ROUTER_BATCH][MAVLINK_ROUTER_DATAGRAM_MAX];
+} mavlink_router_t;
+
+/**
+ * Open every endpoint. Serial devices are configured like the flight
+ * controller link, UDP sockets are non-blocking.
+ *
+ * @return 0 on success, -1 if any endpoint fails to open (details logged;
+ *         endpoints opened so far are closed again).
+ */
+int mavlink_router_open(mavlink_router_t *router, const mavlink_router_endpoint_config_t *configs, size_t count);
+
+void mavlink_router_close(mavlink_router_t *router);
+
+/**
+ * Register every endpoint descriptor with `loop`.
+ *
+ * @return 0 on success, -1 when the loop's source table is full.
+ */
+int mavlink_router_attach(mavlink_router_t *router, event_loop_t *loop);
+
+/**
+ * Read whatever is pending on endpoint `index` and forward it.
+ *
+ * @return number of frames received, -1 on a fatal read error.
+ */
+int mavlink_router_service(mavlink_router_t *router, size_t index);
+
+/**
+ * Print per-endpoint counters and the learned route table to `stream`.
+ */
+void mavlink_router_report(const mavlink_router_t *router, FILE *stream);
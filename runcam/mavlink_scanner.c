@@ -0,0 +1,193 @@
+#include <string.h>
+
+#include "mavlink_scanner.h"
+
+// Offsets within a frame, counted from the magic byte.
+#define V1_HEADER_LEN (MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1)
+#define V2_HEADER_LEN MAVLINK_NUM_HEADER_BYTES
+
+void mavlink_scanner_init(
+    mavlink_scanner_t *scanner,
+    mavlink_scanner_wanted_t wanted,
+    mavlink_scanner_message_t on_message,
+    void *context) {
+    memset(scanner, 0, sizeof(*scanner));
+    scanner->wanted = wanted;
+    scanner->on_message = on_message;
+    scanner->context = context;
+}
+
+// Position of the next v1 or v2 magic byte at or after `from`, or `length`.
+static size_t next_magic(const uint8_t *data, size_t from, size_t length) {
+    const uint8_t *v2 = memchr(data + from, MAVLINK_STX, length - from);
+    const size_t v2_end = v2 ? (size_t)(v2 - data) : length;
+    const uint8_t *v1 = memchr(data + from, MAVLINK_STX_MAVLINK1, v2_end - from);
+
+    return v1 ? (size_t)(v1 - data) : v2_end;
+}
+
+void mavlink_scanner_set_frame_handler(mavlink_scanner_t *scanner, mavlink_scanner_frame_t on_frame) {
+    scanner->on_frame = on_frame;
+}
+
+// Check the CRC of a complete frame against its message's CRC extra.
+static bool check_frame(const uint8_t *frame, bool v2, const mavlink_msg_entry_t *entry, uint16_t *crc_out) {
+    const size_t header_len = v2 ? V2_HEADER_LEN : V1_HEADER_LEN;
+    const uint8_t payload_len = frame[1];
+    uint16_t crc = crc_calculate(frame + 1, (uint16_t)(header_len - 1 + payload_len));
+    crc_accumulate(entry->crc_extra, &crc);
+
+    const uint8_t *ck = frame + header_len + payload_len;
+
+    if (ck[0] != (crc & 0xFF) || ck[1] != (crc >> 8)) {
+        return false;
+    }
+
+    *crc_out = crc;
+    return true;
+}
+
+// Unpack a CRC-checked frame into `message`.
+static void decode_frame(const uint8_t *frame, bool v2, uint32_t msgid, uint16_t crc,
+                         const mavlink_msg_entry_t *entry, mavlink_message_t *message) {
+    const size_t header_len = v2 ? V2_HEADER_LEN : V1_HEADER_LEN;
+    const uint8_t payload_len = frame[1];
+    const uint8_t *ck = frame + header_len + payload_len;
+
+    message->magic = frame[0];
+    message->len = payload_len;
+    message->msgid = msgid;
+    message->checksum = crc;
+    message->ck[0] = ck[0];
+    message->ck[1] = ck[1];
+
+    if (v2) {
+        message->incompat_flags = frame[2];
+        message->compat_flags = frame[3];
+        message->seq = frame[4];
+        message->sysid = frame[5];
+        message->compid = frame[6];
+
+        if (message->incompat_flags & MAVLINK_IFLAG_SIGNED) {
+            memcpy(message->signature, ck + MAVLINK_NUM_CHECKSUM_BYTES, MAVLINK_SIGNATURE_BLOCK_LEN);
+        }
+    } else {
+        message->incompat_flags = 0;
+        message->compat_flags = 0;
+        message->seq = frame[2];
+        message->sysid = frame[3];
+        message->compid = frame[4];
+    }
+
+    // Zero-fill so v2 payloads truncated by the sender decode like the stock parser.
+    uint8_t *payload = (uint8_t *)_MAV_PAYLOAD_NON_CONST(message);
+    memcpy(payload, frame + header_len, payload_len);
+
+    if (payload_len < entry->max_msg_len) {
+        memset(payload + payload_len, 0, entry->max_msg_len - payload_len);
+    }
+}
+
+// Payload byte at `offset`, or 0 where a v2 sender truncated trailing zeros.
+static uint8_t payload_byte(const uint8_t *frame, bool v2, uint8_t offset) {
+    const size_t header_len = v2 ? V2_HEADER_LEN : V1_HEADER_LEN;
+
+    return offset < frame[1] ? frame[header_len + offset] : 0;
+}
+
+static void describe_frame(const uint8_t *frame, size_t frame_len, bool v2, uint32_t msgid,
+                           const mavlink_msg_entry_t *entry, mavlink_frame_t *out) {
+    out->data = frame;
+    out->length = frame_len;
+    out->msgid = msgid;
+    out->sysid = v2 ? frame[5] : frame[3];
+    out->compid = v2 ? frame[6] : frame[4];
+    out->target_system = 0;
+    out->target_component = 0;
+    out->checked = entry != NULL;
+
+    if (entry && (entry->flags & MAV_MSG_ENTRY_FLAG_HAVE_TARGET_SYSTEM)) {
+        out->target_system = payload_byte(frame, v2, entry->target_system_ofs);
+    }
+
+    if (entry && (entry->flags & MAV_MSG_ENTRY_FLAG_HAVE_TARGET_COMPONENT)) {
+        out->target_component = payload_byte(frame, v2, entry->target_component_ofs);
+    }
+}
+
+size_t mavlink_scanner_feed(mavlink_scanner_t *scanner, const uint8_t *data, size_t length) {
+    size_t position = 0;
+    mavlink_message_t message;
+    mavlink_frame_t raw;
+
+    while (position < length) {
+        const size_t magic = next_magic(data, position, length);
+
+        scanner->stats.bytes_discarded += magic - position;
+        position = magic;
+
+        if (position == length) {
+            break;
+        }
+
+        const uint8_t *frame = data + position;
+        const size_t available = length - position;
+        const bool v2 = frame[0] == MAVLINK_STX;
+        const size_t header_len = v2 ? V2_HEADER_LEN : V1_HEADER_LEN;
+
+        if (available < header_len) {
+            break;
+        }
+
+        // Unknown incompatibility flags mean this is not a frame we can
+        // parse (or not a frame at all); resync on the next byte.
+        if (v2 && (frame[2] & ~MAVLINK_IFLAG_SIGNED) != 0) {
+            scanner->stats.bytes_discarded++;
+            position++;
+            continue;
+        }
+
+        const uint32_t msgid = v2
+            ? (uint32_t)frame[7] | ((uint32_t)frame[8] << 8) | ((uint32_t)frame[9] << 16)
+            : frame[5];
+        const size_t signature_len = v2 && (frame[2] & MAVLINK_IFLAG_SIGNED) ? MAVLINK_SIGNATURE_BLOCK_LEN : 0;
+        const size_t frame_len = header_len + frame[1] + MAVLINK_NUM_CHECKSUM_BYTES + signature_len;
+
+        if (available < frame_len) {
+            break;
+        }
+
+        if (scanner->wanted && !scanner->wanted(msgid, scanner->context)) {
+            // Trust the header: a false magic byte in line noise can hide a
+            // real frame here, just as a bad CRC does for the stock parser.
+            scanner->stats.frames_skipped++;
+            position += frame_len;
+            continue;
+        }
+
+        const mavlink_msg_entry_t *entry = mavlink_get_msg_entry(msgid);
+        uint16_t crc = 0;
+
+        if (entry ? !check_frame(frame, v2, entry, &crc) : !scanner->on_frame) {
+            // Either corrupt or a false magic byte inside other data.
+            scanner->stats.crc_errors++;
+            scanner->stats.bytes_discarded++;
+            position++;
+            continue;
+        }
+
+        scanner->stats.frames_dispatched++;
+
+        if (scanner->on_frame) {
+            describe_frame(frame, frame_len, v2, msgid, entry, &raw);
+            scanner->on_frame(&raw, scanner->context);
+        } else {
+            decode_frame(frame, v2, msgid, crc, entry, &message);
+            scanner->on_message(&message, scanner->context);
+        }
+
+        position += frame_len;
+    }
+
+    return position;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mavlink_include.h"
+
+typedef struct mavlink_scanner_stats {
+    uint64_t frames_dispatched; // frames handed to on_message or on_frame
+    uint64_t frames_skipped;    // frames of unwanted ids stepped over unchecked
+    uint64_t crc_errors;        // wanted frames that failed validation
+    uint64_t bytes_discarded;   // bytes outside any frame (noise, resync)
+} mavlink_scanner_stats_t;
+
+/**
+ * Whether frames with this message id should be validated and delivered.
+ * A NULL callback wants every frame.
+ */
+typedef bool (*mavlink_scanner_wanted_t)(uint32_t msgid, void *context);
+
+typedef void (*mavlink_scanner_message_t)(const mavlink_message_t *message, void *context);
+
+/**
+ * A complete frame left in place in the caller's buffer, with the header
+ * fields a router needs. Targets are 0 (broadcast) when the message has none.
+ */
+typedef struct mavlink_frame {
+    const uint8_t *data;
+    size_t length;
+    uint32_t msgid;
+    uint8_t sysid;
+    uint8_t compid;
+    uint8_t target_system;
+    uint8_t target_component;
+    bool checked; // false for ids this dialect does not know (no CRC extra)
+} mavlink_frame_t;
+
+typedef void (*mavlink_scanner_frame_t)(const mavlink_frame_t *frame, void *context);
+
+/**
+ * Frame scanner for MAVLink v1/v2 streams. Magic bytes are located with
+ * memchr and the message id is read straight from the header, so frames
+ * nobody subscribed to are stepped over without touching the payload or
+ * computing a CRC. Only wanted frames get full validation and decoding.
+ */
+typedef struct mavlink_scanner {
+    mavlink_scanner_wanted_t wanted;
+    mavlink_scanner_message_t on_message;
+    mavlink_scanner_frame_t on_frame;
+    void *context;
+    mavlink_scanner_stats_t stats;
+} mavlink_scanner_t;
+
+void mavlink_scanner_init(
+    mavlink_scanner_t *scanner,
+    mavlink_scanner_wanted_t wanted,
+    mavlink_scanner_message_t on_message,
+    void *context);
+
+/**
+ * Deliver wanted frames undecoded instead of through on_message. Frames of
+ * known ids are still CRC-checked; frames of unknown ids cannot be, and are
+ * passed on unchecked so a forwarder does not drop other dialects' traffic.
+ */
+void mavlink_scanner_set_frame_handler(mavlink_scanner_t *scanner, mavlink_scanner_frame_t on_frame);
+
+/**
+ * Scan a contiguous buffer, delivering every complete wanted frame.
+ *
+ * @return number of bytes consumed. The remainder is the start of an
+ *         incomplete frame; keep it and present it again with more data.
+ */
+size_t mavlink_scanner_feed(mavlink_scanner_t *scanner, const uint8_t *data, size_t length);
@@ -0,0 +1,70 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory_stats.h"
+
+// Value in kB of a "Name:   1234 kB" line of /proc/self/status, or 0.
+static uint32_t status_field_kb(const char *status, const char *name) {
+    const char *line = strstr(status, name);
+
+    return line ? (uint32_t)strtoul(line + strlen(name), NULL, 10) : 0;
+}
+
+void memory_stats_read(memory_stats_t *stats) {
+    char status[2048];
+    ssize_t length;
+    const int fd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+
+    memset(stats, 0, sizeof(*stats));
+    yaml_arena_get_stats(&stats->yaml);
+
+    if (fd < 0) {
+        return;
+    }
+
+    do {
+        length = read(fd, status, sizeof(status) - 1);
+    } while (length < 0 && errno == EINTR);
+
+    close(fd);
+
+    if (length <= 0) {
+        return;
+    }
+
+    status[length] = '\0';
+    stats->rss_kb = status_field_kb(status, "\nVmRSS:");
+    stats->peak_rss_kb = status_field_kb(status, "\nVmHWM:");
+}
+
+size_t memory_stats_format(char *out, size_t out_size) {
+    memory_stats_t stats;
+
+    if (out_size == 0) {
+        return 0;
+    }
+
+    memory_stats_read(&stats);
+
+    const int written = snprintf(
+        out,
+        out_size,
+        "memory rss_kb=%u peak_rss_kb=%u yaml_used=%zu yaml_peak=%zu yaml_capacity=%zu yaml_heap_fallbacks=%u\n",
+        stats.rss_kb,
+        stats.peak_rss_kb,
+        stats.yaml.used,
+        stats.yaml.peak,
+        stats.yaml.capacity,
+        stats.yaml.heap_fallbacks);
+
+    if (written < 0) {
+        out[0] = '\0';
+        return 0;
+    }
+
+    return (size_t)written < out_size ? (size_t)written : out_size - 1;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "yaml_arena.h"
+
+typedef struct memory_stats {
+    uint32_t rss_kb;      // VmRSS: resident now
+    uint32_t peak_rss_kb; // VmHWM: resident high-water mark
+    yaml_arena_stats_t yaml;
+} memory_stats_t;
+
+/**
+ * Sample the process RSS from /proc/self/status (0 when unavailable) and the
+ * YAML arena counters. Uses no heap.
+ */
+void memory_stats_read(memory_stats_t *stats);
+
+/**
+ * Render the current memory stats as text for the local stats socket.
+ *
+ * @return length written (truncated to `out_size - 1`).
+ */
+size_t memory_stats_format(char *out, size_t out_size);
@@ -0,0 +1,414 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "majestic_config.h"
+#include "majestic_http.h"
+#include "matek_mavlink.h"
+#include "osd_feed.h"
+#include "spsc_queue.h"
+
+#define NS_PER_MS 1000000ULL
+#define OSD_QUEUE_CAPACITY 4
+#define OSD_TARGET_MAX 640
+
+static const char *const MAJESTIC_HTTP_HOST = "127.0.0.1";
+static const uint16_t DEFAULT_WEB_PORT = 80;
+// The overlay is cosmetic; never let a hung Majestic hold the sender long.
+static const int HTTP_TIMEOUT_MS = 500;
+static const uint32_t TELEMETRY_MESSAGES[] = {
+    MAVLINK_MSG_ID_GLOBAL_POSITION_INT,
+    MAVLINK_MSG_ID_VFR_HUD,
+    MAVLINK_MSG_ID_SYS_STATUS,
+    MAVLINK_MSG_ID_GPS_RAW_INT
+};
+
+typedef struct osd_text {
+    char text[OSD_FEED_TEXT_MAX];
+} osd_text_t;
+
+static osd_feed_config_t feed_config;
+static majestic_http_conn_t http_conn;
+static osd_text_t text_storage[OSD_QUEUE_CAPACITY];
+static spsc_queue_t text_queue;
+static int text_event_fd = -1;
+static pthread_t sender_thread;
+static bool sender_running = false;
+static atomic_bool stop_requested;
+static atomic_bool push_failed; // the sender asks for the text to be sent again
+
+// Main-thread state.
+static osd_telemetry_t telemetry = { .battery = -1 };
+static char last_queued[OSD_FEED_TEXT_MAX];
+static bool has_queued = false;
+static uint64_t last_queued_ns = 0;
+static uint32_t queued_count = 0;
+static uint32_t unchanged_count = 0;
+
+// Sender-thread counters, read by the main thread.
+static atomic_uint sent_count;
+static atomic_uint coalesced_count;
+static atomic_uint failed_count;
+
+void osd_feed_config_defaults(osd_feed_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    snprintf(config->template, sizeof(config->template), "%s",
+             "ALT {alt}m SPD {speed}km/h BAT {volt}V {bat}%% SAT {sats}");
+    config->region = 1;
+    config->pos_x = -1;
+    config->pos_y = -1;
+    config->interval_ms = 200;
+    config->refresh_ms = 5000;
+}
+
+static const char *fix_name(uint8_t fix_type) {
+    switch (fix_type) {
+    case GPS_FIX_TYPE_2D_FIX:
+        return "2D";
+    case GPS_FIX_TYPE_3D_FIX:
+    case GPS_FIX_TYPE_STATIC:
+    case GPS_FIX_TYPE_PPP:
+        return "3D";
+    case GPS_FIX_TYPE_DGPS:
+        return "DGPS";
+    case GPS_FIX_TYPE_RTK_FLOAT:
+    case GPS_FIX_TYPE_RTK_FIXED:
+        return "RTK";
+    default:
+        return "NO";
+    }
+}
+
+// Format one placeholder. Returns false for names it does not know.
+static bool render_value(const char *name, size_t name_length, const osd_telemetry_t *values, char *out,
+                         size_t out_size) {
+#define IS(literal) (name_length == sizeof(literal) - 1 && memcmp(name, literal, name_length) == 0)
+    bool known = true;
+
+    if (IS("alt")) {
+        known = values->has_altitude;
+        snprintf(out, out_size, "%ld", lroundf(values->altitude_m));
+    } else if (IS("speed")) {
+        known = values->has_speed;
+        snprintf(out, out_size, "%ld", lroundf(values->speed_ms * 3.6f));
+    } else if (IS("volt")) {
+        known = values->has_voltage;
+        snprintf(out, out_size, "%.1f", (double)values->voltage);
+    } else if (IS("bat")) {
+        known = values->battery >= 0;
+        snprintf(out, out_size, "%d", values->battery);
+    } else if (IS("sats")) {
+        known = values->has_gps && values->satellites != UINT8_MAX;
+        snprintf(out, out_size, "%u", values->satellites);
+    } else if (IS("fix")) {
+        known = values->has_gps;
+        snprintf(out, out_size, "%s", fix_name(values->fix_type));
+    } else if (IS("lat")) {
+        known = values->has_position;
+        snprintf(out, out_size, "%.5f", values->lat / 1e7);
+    } else if (IS("lon")) {
+        known = values->has_position;
+        snprintf(out, out_size, "%.5f", values->lon / 1e7);
+    } else {
+        return false;
+    }
+
+    if (!known) {
+        snprintf(out, out_size, "--");
+    }
+
+    return true;
+#undef IS
+}
+
+size_t osd_feed_render(const char *template, const osd_telemetry_t *values, char *out, size_t out_size) {
+    size_t length = 0;
+
+    if (out_size == 0) {
+        return 0;
+    }
+
+    for (const char *c = template; *c && length + 1 < out_size;) {
+        const char *close = *c == '{' ? strchr(c, '}') : NULL;
+        char value[32];
+
+        if (close && render_value(c + 1, (size_t)(close - c - 1), values, value, sizeof(value))) {
+            const size_t value_length = strlen(value);
+            const size_t copied = value_length < out_size - 1 - length ? value_length : out_size - 1 - length;
+
+            memcpy(out + length, value, copied);
+            length += copied;
+            c = close + 1;
+            continue;
+        }
+
+        out[length++] = *c++;
+    }
+
+    out[length] = '\0';
+    return length;
+}
+
+void osd_feed_handle_message(const mavlink_message_t *message, void *context) {
+    (void)context;
+
+    switch (message->msgid) {
+    case MAVLINK_MSG_ID_GLOBAL_POSITION_INT: {
+        mavlink_global_position_int_t position;
+
+        mavlink_msg_global_position_int_decode(message, &position);
+        telemetry.has_altitude = true;
+        telemetry.altitude_m = (float)position.relative_alt / 1000.0f;
+        // 0/0 is what autopilots send before the first fix.
+        telemetry.has_position = position.lat != 0 || position.lon != 0;
+        telemetry.lat = position.lat;
+        telemetry.lon = position.lon;
+        break;
+    }
+    case MAVLINK_MSG_ID_VFR_HUD:
+        telemetry.has_speed = true;
+        telemetry.speed_ms = mavlink_msg_vfr_hud_get_groundspeed(message);
+        break;
+    case MAVLINK_MSG_ID_SYS_STATUS: {
+        const uint16_t millivolts = mavlink_msg_sys_status_get_voltage_battery(message);
+
+        telemetry.has_voltage = millivolts != UINT16_MAX;
+        telemetry.voltage = (float)millivolts / 1000.0f;
+        telemetry.battery = mavlink_msg_sys_status_get_battery_remaining(message);
+        break;
+    }
+    case MAVLINK_MSG_ID_GPS_RAW_INT:
+        telemetry.has_gps = true;
+        telemetry.fix_type = mavlink_msg_gps_raw_int_get_fix_type(message);
+        telemetry.satellites = mavlink_msg_gps_raw_int_get_satellites_visible(message);
+        break;
+    default:
+        break;
+    }
+}
+
+static void signal_event(int fd) {
+    const uint64_t one = 1;
+
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+}
+
+static void clear_event(int fd) {
+    uint64_t value = 0;
+
+    while (read(fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+    }
+}
+
+static int build_target(const char *text, char *target, size_t target_size) {
+    int length = snprintf(target, target_size, "/api/osd/%u?", feed_config.region);
+
+    if (feed_config.pos_x >= 0 && length > 0 && (size_t)length < target_size) {
+        length += snprintf(target + length, target_size - (size_t)length, "posx=%d&", feed_config.pos_x);
+    }
+
+    if (feed_config.pos_y >= 0 && length > 0 && (size_t)length < target_size) {
+        length += snprintf(target + length, target_size - (size_t)length, "posy=%d&", feed_config.pos_y);
+    }
+
+    if (length <= 0 || (size_t)length + 5 >= target_size) {
+        return -1;
+    }
+
+    memcpy(target + length, "text=", 6);
+    return majestic_http_append_encoded(target, target_size, text);
+}
+
+static void *sender_main(void *argument) {
+    osd_text_t latest;
+    osd_text_t next;
+    char target[OSD_TARGET_MAX];
+    bool failing = false;
+    (void)argument;
+
+    while (!atomic_load(&stop_requested)) {
+        struct pollfd pfd = { .fd = text_event_fd, .events = POLLIN, .revents = 0 };
+
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            break;
+        }
+
+        clear_event(text_event_fd);
+
+        // Only the newest text matters; older ones are never sent.
+        bool has_text = false;
+
+        while (spsc_queue_pop(&text_queue, &next)) {
+            if (has_text) {
+                atomic_fetch_add(&coalesced_count, 1);
+            }
+
+            latest = next;
+            has_text = true;
+        }
+
+        if (!has_text || atomic_load(&stop_requested)) {
+            continue;
+        }
+
+        const int status = build_target(latest.text, target, sizeof(target)) == 0
+            ? majestic_http_get(&http_conn, target, NULL, 0)
+            : -1;
+
+        if (status == 200) {
+            atomic_fetch_add(&sent_count, 1);
+            failing = false;
+            continue;
+        }
+
+        // Log the first failure of a run only; the main loop retries.
+        if (!failing) {
+            fprintf(stderr, "OSD update failed (status %d); retrying on the next tick.\n", status);
+        }
+
+        failing = true;
+        atomic_fetch_add(&failed_count, 1);
+        atomic_store(&push_failed, true);
+    }
+
+    return NULL;
+}
+
+static uint16_t read_port(const char *config_path) {
+    char value[16];
+
+    if (majestic_config_get(config_path, "system.webPort", value, sizeof(value)) == 0) {
+        char *end = NULL;
+        const unsigned long parsed = strtoul(value, &end, 10);
+
+        if (end && *end == '\0' && parsed > 0 && parsed <= 65535) {
+            return (uint16_t)parsed;
+        }
+    }
+
+    return DEFAULT_WEB_PORT;
+}
+
+int osd_feed_start(const osd_feed_config_t *config, const char *majestic_config_path) {
+    feed_config = *config;
+    majestic_http_init(&http_conn, MAJESTIC_HTTP_HOST, read_port(majestic_config_path), HTTP_TIMEOUT_MS);
+
+    if (spsc_queue_init(&text_queue, text_storage, sizeof(text_storage[0]), OSD_QUEUE_CAPACITY) != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(TELEMETRY_MESSAGES) / sizeof(TELEMETRY_MESSAGES[0]); ++i) {
+        if (matek_register_handler(TELEMETRY_MESSAGES[i], osd_feed_handle_message, NULL) != 0) {
+            fprintf(stderr, "Unable to register OSD telemetry handlers.\n");
+            return -1;
+        }
+    }
+
+    text_event_fd = eventfd(0, EFD_CLOEXEC);
+
+    if (text_event_fd < 0) {
+        fprintf(stderr, "eventfd failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    atomic_store(&stop_requested, false);
+    atomic_store(&push_failed, false);
+
+    const int error = pthread_create(&sender_thread, NULL, sender_main, NULL);
+
+    if (error != 0) {
+        fprintf(stderr, "Failed to start OSD feed: %s\n", strerror(error));
+        osd_feed_stop();
+        return -1;
+    }
+
+    sender_running = true;
+    return 0;
+}
+
+void osd_feed_stop(void) {
+    if (sender_running) {
+        atomic_store(&stop_requested, true);
+        signal_event(text_event_fd);
+        pthread_join(sender_thread, NULL);
+        sender_running = false;
+    }
+
+    if (text_event_fd >= 0) {
+        close(text_event_fd);
+        text_event_fd = -1;
+    }
+
+    majestic_http_close(&http_conn);
+}
+
+bool osd_feed_tick(uint64_t now_ns) {
+    char text[OSD_FEED_TEXT_MAX];
+
+    if (!sender_running) {
+        return false;
+    }
+
+    osd_feed_render(feed_config.template, &telemetry, text, sizeof(text));
+
+    // A restarted Majestic has lost the text, hence the periodic refresh.
+    const bool retry = atomic_exchange(&push_failed, false);
+    const bool refresh_due = feed_config.refresh_ms > 0 &&
+                             now_ns - last_queued_ns >= (uint64_t)feed_config.refresh_ms * NS_PER_MS;
+
+    if (has_queued && !retry && !refresh_due && strcmp(text, last_queued) == 0) {
+        ++unchanged_count;
+        return false;
+    }
+
+    osd_text_t queued;
+    memcpy(queued.text, text, sizeof(queued.text));
+
+    if (!spsc_queue_push(&text_queue, &queued)) {
+        // The sender is stuck on Majestic; try again on the next tick.
+        if (retry) {
+            atomic_store(&push_failed, true);
+        }
+
+        return false;
+    }
+
+    memcpy(last_queued, text, sizeof(last_queued));
+    has_queued = true;
+    last_queued_ns = now_ns;
+    ++queued_count;
+    signal_event(text_event_fd);
+    return true;
+}
+
+void osd_feed_get_stats(osd_feed_stats_t *stats) {
+    stats->queued = queued_count;
+    stats->unchanged = unchanged_count;
+    stats->sent = atomic_load(&sent_count);
+    stats->coalesced = atomic_load(&coalesced_count);
+    stats->failed = atomic_load(&failed_count);
+}
+
+size_t osd_feed_format(char *out, size_t out_size) {
+    osd_feed_stats_t stats;
+
+    osd_feed_get_stats(&stats);
+
+    const int written = snprintf(out, out_size, "osd queued=%u unchanged=%u sent=%u coalesced=%u failed=%u\n",
+                                 stats.queued, stats.unchanged, stats.sent, stats.coalesced, stats.failed);
+
+    if (written < 0) {
+        return 0;
+    }
+
+    return (size_t)written < out_size ? (size_t)written : out_size - 1;
+}
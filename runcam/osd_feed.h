@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mavlink_include.h"
+
+#define OSD_FEED_TEXT_MAX 160
+
+typedef struct osd_feed_config {
+    char template[OSD_FEED_TEXT_MAX]; // text with {alt}, {speed}, ... placeholders
+    uint32_t region;      // Majestic OSD region the text goes to
+    int32_t pos_x;        // region position, -1 keeps Majestic's
+    int32_t pos_y;
+    uint32_t interval_ms; // shortest time between two updates
+    uint32_t refresh_ms;  // unchanged text is sent again this often, 0 never
+} osd_feed_config_t;
+
+void osd_feed_config_defaults(osd_feed_config_t *config);
+
+/**
+ * Latest values for the overlay, filled from MAVLink by
+ * osd_feed_handle_message().
+ */
+typedef struct osd_telemetry {
+    bool has_altitude;
+    float altitude_m;  // above home
+    bool has_speed;
+    float speed_ms;    // ground speed
+    bool has_voltage;
+    float voltage;
+    int8_t battery;    // remaining percent, -1 unknown
+    bool has_gps;
+    uint8_t fix_type;  // GPS_FIX_TYPE
+    uint8_t satellites;
+    bool has_position;
+    int32_t lat;       // degE7
+    int32_t lon;
+} osd_telemetry_t;
+
+/**
+ * Expand `template`: {alt} (m above home), {speed} (km/h), {volt} (V),
+ * {bat} (%), {sats}, {fix} and {lat}/{lon}, each at the precision it is
+ * shown with, so a change below that precision renders the same text.
+ * Unknown values show as "--"; other text is copied unchanged. Majestic runs
+ * the text through strftime, so a literal percent sign is written "%%".
+ *
+ * @return length of the text, truncated to fit `out`.
+ */
+size_t osd_feed_render(const char *template, const osd_telemetry_t *telemetry, char *out, size_t out_size);
+
+/**
+ * Start the thread that pushes text to Majestic's runtime OSD API
+ * (`/api/osd/<region>`) over a persistent connection, never through the
+ * config file, and register osd_feed_handle_message() for the telemetry
+ * messages. Must be called with the signals the main loop consumes already
+ * blocked.
+ *
+ * @return 0 on success, -1 on failure (details logged to stderr).
+ */
+int osd_feed_start(const osd_feed_config_t *config, const char *majestic_config_path);
+
+void osd_feed_stop(void);
+
+/**
+ * Note GLOBAL_POSITION_INT, VFR_HUD, SYS_STATUS or GPS_RAW_INT in the
+ * telemetry (main thread only).
+ */
+void osd_feed_handle_message(const mavlink_message_t *message, void *context);
+
+/**
+ * Render the overlay and hand it to the sender if it changed, or if the
+ * refresh period ran out or the last push failed (main thread only). Call
+ * every `interval_ms`; whatever arrived in between is coalesced into one
+ * update.
+ *
+ * @return true if an update was queued.
+ */
+bool osd_feed_tick(uint64_t now_ns);
+
+typedef struct osd_feed_stats {
+    uint32_t queued;    // texts handed to the sender
+    uint32_t unchanged; // ticks that rendered the text already shown
+    uint32_t sent;      // requests Majestic answered with 200
+    uint32_t coalesced; // queued texts replaced by a newer one before sending
+    uint32_t failed;
+} osd_feed_stats_t;
+
+void osd_feed_get_stats(osd_feed_stats_t *stats);
+
+/**
+ * Format the counters as one line for the stats socket.
+ *
+ * @return bytes written (excluding the NUL).
+ */
+size_t osd_feed_format(char *out, size_t out_size);
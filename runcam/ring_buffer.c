@@ -0,0 +1,148 @@
+#include <string.h>
+#include <sys/uio.h>
+
+#include "ring_buffer.h"
+
+int ring_buffer_init(ring_buffer_t *ring, uint8_t *storage, size_t capacity) {
+    if (!ring || !storage || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+
+    ring->data = storage;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+    return 0;
+}
+
+void ring_buffer_clear(ring_buffer_t *ring) {
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+size_t ring_buffer_size(const ring_buffer_t *ring) {
+    return ring->tail - ring->head;
+}
+
+size_t ring_buffer_space(const ring_buffer_t *ring) {
+    return ring->capacity - ring_buffer_size(ring);
+}
+
+// Describe the free space as up to two contiguous writable regions.
+static int free_segments(const ring_buffer_t *ring, struct iovec iov[2]) {
+    const size_t space = ring_buffer_space(ring);
+
+    if (space == 0) {
+        return 0;
+    }
+
+    const size_t mask = ring->capacity - 1;
+    const size_t start = ring->tail & mask;
+    const size_t first = ring->capacity - start < space ? ring->capacity - start : space;
+
+    iov[0].iov_base = ring->data + start;
+    iov[0].iov_len = first;
+
+    if (first == space) {
+        return 1;
+    }
+
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = space - first;
+    return 2;
+}
+
+size_t ring_buffer_write(ring_buffer_t *ring, const uint8_t *data, size_t length) {
+    struct iovec iov[2];
+    const int count = free_segments(ring, iov);
+    size_t written = 0;
+
+    for (int i = 0; i < count && written < length; ++i) {
+        size_t chunk = length - written;
+
+        if (chunk > iov[i].iov_len) {
+            chunk = iov[i].iov_len;
+        }
+
+        memcpy(iov[i].iov_base, data + written, chunk);
+        written += chunk;
+    }
+
+    ring->tail += written;
+    return written;
+}
+
+ssize_t ring_buffer_read_fd(ring_buffer_t *ring, int fd) {
+    struct iovec iov[2];
+    const int count = free_segments(ring, iov);
+
+    if (count == 0) {
+        return 0;
+    }
+
+    const ssize_t bytes_read = readv(fd, iov, count);
+
+    if (bytes_read > 0) {
+        ring->tail += (size_t)bytes_read;
+    }
+
+    return bytes_read;
+}
+
+int ring_buffer_peek(const ring_buffer_t *ring, const uint8_t *segments[2], size_t lengths[2]) {
+    const size_t size = ring_buffer_size(ring);
+
+    if (size == 0) {
+        return 0;
+    }
+
+    const size_t mask = ring->capacity - 1;
+    const size_t start = ring->head & mask;
+    const size_t first = ring->capacity - start < size ? ring->capacity - start : size;
+
+    segments[0] = ring->data + start;
+    lengths[0] = first;
+
+    if (first == size) {
+        return 1;
+    }
+
+    segments[1] = ring->data;
+    lengths[1] = size - first;
+    return 2;
+}
+
+static void reverse_bytes(uint8_t *data, size_t length) {
+    for (size_t i = 0, j = length; i + 1 < j; ++i, --j) {
+        const uint8_t byte = data[i];
+        data[i] = data[j - 1];
+        data[j - 1] = byte;
+    }
+}
+
+const uint8_t *ring_buffer_linearize(ring_buffer_t *ring) {
+    const size_t size = ring_buffer_size(ring);
+    const size_t start = ring->head & (ring->capacity - 1);
+
+    if (start + size > ring->capacity) {
+        // Rotate left by `start` with three reversals; no scratch storage.
+        reverse_bytes(ring->data, start);
+        reverse_bytes(ring->data + start, ring->capacity - start);
+        reverse_bytes(ring->data, ring->capacity);
+        ring->head = 0;
+        ring->tail = size;
+        return ring->data;
+    }
+
+    return ring->data + start;
+}
+
+uint8_t ring_buffer_at(const ring_buffer_t *ring, size_t offset) {
+    return ring->data[(ring->head + offset) & (ring->capacity - 1)];
+}
+
+void ring_buffer_consume(ring_buffer_t *ring, size_t length) {
+    const size_t size = ring_buffer_size(ring);
+
+    ring->head += length < size ? length : size;
+}
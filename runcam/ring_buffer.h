@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Single-threaded byte ring over caller-provided storage. The capacity must be
+ * a power of two so positions can wrap with a mask instead of a division.
+ */
+typedef struct ring_buffer {
+    uint8_t *data;
+    size_t capacity;
+    size_t head; // next byte to read (monotonic, masked on access)
+    size_t tail; // next byte to write (monotonic, masked on access)
+} ring_buffer_t;
+
+/**
+ * @return 0 on success, -1 if capacity is not a non-zero power of two.
+ */
+int ring_buffer_init(ring_buffer_t *ring, uint8_t *storage, size_t capacity);
+
+void ring_buffer_clear(ring_buffer_t *ring);
+
+size_t ring_buffer_size(const ring_buffer_t *ring);
+
+size_t ring_buffer_space(const ring_buffer_t *ring);
+
+/**
+ * Append up to `length` bytes.
+ *
+ * @return number of bytes actually stored (short when the ring is full).
+ */
+size_t ring_buffer_write(ring_buffer_t *ring, const uint8_t *data, size_t length);
+
+/**
+ * read(2) straight into the free space of the ring with a single readv(2),
+ * so wrapped free space is filled without an intermediate copy.
+ *
+ * @return bytes read, 0 on EOF or a full ring, -1 on error (errno preserved).
+ */
+ssize_t ring_buffer_read_fd(ring_buffer_t *ring, int fd);
+
+/**
+ * Expose the readable bytes as at most two contiguous segments.
+ *
+ * @return number of segments filled (0, 1 or 2).
+ */
+int ring_buffer_peek(const ring_buffer_t *ring, const uint8_t *segments[2], size_t lengths[2]);
+
+/**
+ * Rotate the storage in place so every readable byte is contiguous, for
+ * parsers that scan with memchr/memcmp. Costs one pass over the storage when
+ * the data wraps and nothing otherwise.
+ *
+ * @return pointer to the first readable byte (ring_buffer_size() bytes long).
+ */
+const uint8_t *ring_buffer_linearize(ring_buffer_t *ring);
+
+/**
+ * Copy the byte at `offset` from the read position without consuming it.
+ * The caller must ensure `offset < ring_buffer_size()`.
+ */
+uint8_t ring_buffer_at(const ring_buffer_t *ring, size_t offset);
+
+void ring_buffer_consume(ring_buffer_t *ring, size_t length);
@@ -0,0 +1,46 @@
+#include <string.h>
+
+#include "spsc_queue.h"
+
+int spsc_queue_init(spsc_queue_t *queue, void *storage, size_t element_size, size_t capacity) {
+    if (!queue || !storage || element_size == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+
+    queue->storage = storage;
+    queue->element_size = element_size;
+    queue->capacity = capacity;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 0;
+}
+
+bool spsc_queue_push(spsc_queue_t *queue, const void *element) {
+    const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (tail - head >= queue->capacity) {
+        return false;
+    }
+
+    memcpy(queue->storage + (tail & (queue->capacity - 1)) * queue->element_size, element, queue->element_size);
+
+    // Publish the element only after its bytes are in place.
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool spsc_queue_pop(spsc_queue_t *queue, void *element) {
+    const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    const size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    memcpy(element, queue->storage + (head & (queue->capacity - 1)) * queue->element_size, queue->element_size);
+
+    // Hand the slot back to the producer only after it has been copied out.
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Lock-free single-producer/single-consumer queue of fixed-size elements over
+ * caller-provided storage. Exactly one thread may push and exactly one other
+ * thread may pop; the capacity must be a power of two.
+ */
+typedef struct spsc_queue {
+    uint8_t *storage;
+    size_t element_size;
+    size_t capacity;
+    _Atomic size_t head; // advanced by the consumer
+    _Atomic size_t tail; // advanced by the producer
+} spsc_queue_t;
+
+/**
+ * @return 0 on success, -1 if the capacity is not a non-zero power of two.
+ */
+int spsc_queue_init(spsc_queue_t *queue, void *storage, size_t element_size, size_t capacity);
+
+/**
+ * Producer side: copy `element` into the queue.
+ *
+ * @return false when the queue is full.
+ */
+bool spsc_queue_push(spsc_queue_t *queue, const void *element);
+
+/**
+ * Consumer side: copy the oldest element into `element`.
+ *
+ * @return false when the queue is empty.
+ */
+bool spsc_queue_pop(spsc_queue_t *queue, void *element);
@@ -0,0 +1,76 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "latency_trace.h"
+#include "memory_stats.h"
+#include "stats_socket.h"
+
+static stats_socket_report_hook_t report_hook = NULL;
+static void *report_hook_context = NULL;
+
+void stats_socket_set_report_hook(stats_socket_report_hook_t hook, void *context) {
+    report_hook = hook;
+    report_hook_context = context;
+}
+
+int stats_socket_open(const char *path) {
+    struct sockaddr_un address;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Stats socket path is too long: %s\n", path);
+        return -1;
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create stats socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path, strlen(path) + 1);
+
+    // A previous instance may have left its socket file behind.
+    unlink(path);
+
+    if (bind(fd, (const struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        fprintf(stderr, "Unable to listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void stats_socket_serve(int listen_fd) {
+    char report[1536];
+    int client;
+
+    while ((client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) {
+        size_t length = latency_trace_format(report, sizeof(report));
+        length += memory_stats_format(report + length, sizeof(report) - length);
+
+        if (report_hook) {
+            length += report_hook(report + length, sizeof(report) - length, report_hook_context);
+        }
+
+        // The report fits in the socket buffer, so a single non-blocking
+        // send never stalls the event loop; a slow reader just gets less.
+        (void)send(client, report, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+        close(client);
+    }
+}
+
+void stats_socket_close(int listen_fd, const char *path) {
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(path);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Appends extra lines to the report.
+ *
+ * @return length written (truncated to `out_size - 1`).
+ */
+typedef size_t (*stats_socket_report_hook_t)(char *out, size_t out_size, void *context);
+
+/**
+ * Local UNIX stream socket that serves a plain-text stats report (latency
+ * histograms and memory use) to anyone who connects (e.g. `socat - UNIX-CONNECT:/tmp/majestic_manager.sock`).
+ *
+ * @return listening descriptor (non-blocking), or -1 on error (details logged).
+ */
+int stats_socket_open(const char *path);
+
+/**
+ * Accept every pending connection, write the report and close it. Call when
+ * the listening descriptor polls readable.
+ */
+void stats_socket_serve(int listen_fd);
+
+void stats_socket_close(int listen_fd, const char *path);
+
+/**
+ * Install (or clear with NULL) a hook that appends to every report.
+ */
+void stats_socket_set_report_hook(stats_socket_report_hook_t hook, void *context);
@@ -0,0 +1,104 @@
+#include <string.h>
+
+#include "statustext_assembler.h"
+
+void statustext_assembler_init(statustext_assembler_t *assembler) {
+    memset(assembler, 0, sizeof(*assembler));
+}
+
+static statustext_slot_t *find_slot(statustext_assembler_t *assembler, uint8_t sysid, uint8_t compid, uint16_t id) {
+    for (size_t i = 0; i < STATUSTEXT_ASSEMBLER_SLOTS; ++i) {
+        statustext_slot_t *slot = &assembler->slots[i];
+
+        if (slot->used && slot->sysid == sysid && slot->compid == compid && slot->id == id) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static void drop_slot(statustext_assembler_t *assembler, statustext_slot_t *slot) {
+    slot->used = false;
+    ++assembler->stats.dropped;
+}
+
+// A free slot, else a stale one, else the least recently updated one.
+static statustext_slot_t *claim_slot(statustext_assembler_t *assembler, uint64_t now_ns) {
+    statustext_slot_t *oldest = &assembler->slots[0];
+
+    for (size_t i = 0; i < STATUSTEXT_ASSEMBLER_SLOTS; ++i) {
+        statustext_slot_t *slot = &assembler->slots[i];
+
+        if (!slot->used) {
+            return slot;
+        }
+
+        if (now_ns - slot->updated_ns > STATUSTEXT_ASSEMBLER_TIMEOUT_NS) {
+            drop_slot(assembler, slot);
+            return slot;
+        }
+
+        if (slot->updated_ns < oldest->updated_ns) {
+            oldest = slot;
+        }
+    }
+
+    drop_slot(assembler, oldest);
+    return oldest;
+}
+
+bool statustext_assembler_push(statustext_assembler_t *assembler, uint8_t sysid, uint8_t compid,
+                               const matek_statustext_t *chunk, uint64_t now_ns, char *out) {
+    const size_t length = strlen(chunk->text);
+
+    if (chunk->id == 0) {
+        memcpy(out, chunk->text, length + 1);
+        ++assembler->stats.completed;
+        return true;
+    }
+
+    statustext_slot_t *slot = find_slot(assembler, sysid, compid, chunk->id);
+
+    // A gap (or a restart of the same id) invalidates what was collected.
+    if (slot && chunk->chunk_seq != slot->next_chunk) {
+        drop_slot(assembler, slot);
+        slot = NULL;
+
+        if (chunk->chunk_seq != 0) {
+            return false;
+        }
+    }
+
+    if (!slot) {
+        // The start of this text was never seen.
+        if (chunk->chunk_seq != 0) {
+            ++assembler->stats.dropped;
+            return false;
+        }
+
+        slot = claim_slot(assembler, now_ns);
+        slot->used = true;
+        slot->sysid = sysid;
+        slot->compid = compid;
+        slot->id = chunk->id;
+        slot->next_chunk = 0;
+        slot->length = 0;
+    }
+
+    memcpy(slot->text + slot->length, chunk->text, length);
+    slot->length += length;
+    slot->updated_ns = now_ns;
+    ++slot->next_chunk;
+
+    // A short chunk ends the text; so does running out of room.
+    if (length == MATEK_STATUSTEXT_MAX_LEN && slot->next_chunk < STATUSTEXT_ASSEMBLER_MAX_CHUNKS) {
+        return false;
+    }
+
+    memcpy(out, slot->text, slot->length);
+    out[slot->length] = '\0';
+    slot->used = false;
+    ++assembler->stats.completed;
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "matek_mavlink.h"
+
+#define STATUSTEXT_ASSEMBLER_SLOTS 4
+#define STATUSTEXT_ASSEMBLER_MAX_CHUNKS 5
+#define STATUSTEXT_ASSEMBLER_MAX_LEN (STATUSTEXT_ASSEMBLER_MAX_CHUNKS * MATEK_STATUSTEXT_MAX_LEN)
+#define STATUSTEXT_ASSEMBLER_TIMEOUT_NS 2000000000ULL
+
+// One text being reassembled from its chunks.
+typedef struct statustext_slot {
+    bool used;
+    uint8_t sysid;
+    uint8_t compid;
+    uint16_t id;
+    uint8_t next_chunk;
+    uint64_t updated_ns;
+    size_t length;
+    char text[STATUSTEXT_ASSEMBLER_MAX_LEN + 1];
+} statustext_slot_t;
+
+/**
+ * Reassembles long STATUSTEXT messages. MAVLink 2 splits a text into
+ * 50-byte chunks that share a non-zero `id` and count up in `chunk_seq`; the
+ * chunk holding a NUL ends the text. Texts are collected in a fixed pool of
+ * slots keyed by sender and id. A slot is dropped when a chunk goes missing,
+ * and the oldest slot is reused when all are busy or have gone stale.
+ */
+typedef struct statustext_assembler {
+    statustext_slot_t slots[STATUSTEXT_ASSEMBLER_SLOTS];
+    struct {
+        uint32_t completed; // texts delivered (single or multi chunk)
+        uint32_t dropped;   // partial texts abandoned
+    } stats;
+} statustext_assembler_t;
+
+void statustext_assembler_init(statustext_assembler_t *assembler);
+
+/**
+ * Feed one chunk. A single-chunk text (id 0) is complete immediately.
+ *
+ * @param out Receives the NUL-terminated text when it is complete; holds at
+ *            least STATUSTEXT_ASSEMBLER_MAX_LEN + 1 bytes.
+ * @return true when `out` holds a complete text.
+ */
+bool statustext_assembler_push(statustext_assembler_t *assembler, uint8_t sysid, uint8_t compid,
+                               const matek_statustext_t *chunk, uint64_t now_ns, char *out);
@@ -0,0 +1,220 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "latency_trace.h"
+#include "stream_probe.h"
+
+#define NS_PER_MS 1000000ULL
+// Pause between handshakes while the stream is down.
+static const long RETRY_NS = 20L * 1000L * 1000L;
+// Upper bound for a single handshake, so a hung server is retried.
+static const int ATTEMPT_TIMEOUT_MS = 1000;
+
+void stream_probe_config_defaults(stream_probe_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    snprintf(config->path, sizeof(config->path), "%s", "/stream=1");
+    config->timeout_ms = 10000;
+    config->settle_ms = 300;
+}
+
+void stream_probe_init(stream_probe_t *probe, const stream_probe_config_t *config, const char *host, uint16_t port) {
+    memset(probe, 0, sizeof(*probe));
+    probe->config = *config;
+    snprintf(probe->host, sizeof(probe->host), "%s", host);
+    probe->port = port;
+}
+
+static int remaining_ms(uint64_t deadline_ns) {
+    const uint64_t now_ns = latency_trace_now();
+
+    return now_ns >= deadline_ns ? 0 : (int)((deadline_ns - now_ns + NS_PER_MS - 1) / NS_PER_MS);
+}
+
+static bool wait_for(int fd, short events, uint64_t deadline_ns) {
+    struct pollfd pfd = {
+        .fd = fd,
+        .events = events,
+        .revents = 0
+    };
+
+    int ready;
+
+    do {
+        ready = poll(&pfd, 1, remaining_ms(deadline_ns));
+    } while (ready < 0 && errno == EINTR);
+
+    return ready > 0;
+}
+
+static int connect_probe(const stream_probe_t *probe, uint64_t deadline_ns) {
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(probe->port);
+
+    if (inet_pton(AF_INET, probe->host, &address.sin_addr) != 1) {
+        return -1;
+    }
+
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    const int enabled = 1;
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+
+    if (connect(fd, (const struct sockaddr *)&address, sizeof(address)) != 0) {
+        int error = errno;
+        socklen_t error_length = sizeof(error);
+
+        if (error != EINPROGRESS || !wait_for(fd, POLLOUT, deadline_ns) ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0 || error != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+// Send one request and read its response into probe->buffer (headers and
+// body, NUL-terminated).
+// Returns the RTSP status code, or -1 on a transport error or timeout.
+static int exchange(stream_probe_t *probe, int fd, const char *method, const char *extra_headers,
+                    uint64_t deadline_ns) {
+    char request[256];
+    const int request_length = snprintf(request, sizeof(request), "%s rtsp://%s:%u%s RTSP/1.0\r\nCSeq: %u\r\n%s\r\n",
+                                        method, probe->host, probe->port, probe->config.path, ++probe->cseq,
+                                        extra_headers);
+
+    if (request_length <= 0 || (size_t)request_length >= sizeof(request) ||
+        send(fd, request, (size_t)request_length, MSG_NOSIGNAL) != request_length) {
+        return -1;
+    }
+
+    size_t header_length = 0;
+    size_t content_length = 0;
+
+    probe->length = 0;
+
+    while (header_length == 0 || probe->length < header_length + content_length) {
+        if (probe->length + 1 >= sizeof(probe->buffer)) {
+            return -1;
+        }
+
+        const ssize_t received = recv(fd, probe->buffer + probe->length, sizeof(probe->buffer) - 1 - probe->length, 0);
+
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+            return -1;
+        }
+
+        if (received < 0) {
+            if (!wait_for(fd, POLLIN, deadline_ns)) {
+                return -1;
+            }
+            continue;
+        }
+
+        probe->length += (size_t)received;
+        probe->buffer[probe->length] = '\0';
+
+        if (header_length == 0) {
+            const char *end = strstr(probe->buffer, "\r\n\r\n");
+
+            if (!end) {
+                continue;
+            }
+
+            header_length = (size_t)(end - probe->buffer) + 4;
+
+            for (const char *line = strstr(probe->buffer, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+                if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+                    content_length = (size_t)strtoul(line + 17, NULL, 10);
+                }
+            }
+        }
+    }
+
+    int status = 0;
+
+    if (sscanf(probe->buffer, "RTSP/%*d.%*d %d", &status) != 1) {
+        return -1;
+    }
+
+    return status;
+}
+
+int stream_probe_check(stream_probe_t *probe, int timeout_ms) {
+    const uint64_t deadline_ns = latency_trace_now() + (uint64_t)timeout_ms * NS_PER_MS;
+    const int fd = connect_probe(probe, deadline_ns);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    const bool serving = exchange(probe, fd, "OPTIONS", "", deadline_ns) == 200 &&
+                         exchange(probe, fd, "DESCRIBE", "Accept: application/sdp\r\n", deadline_ns) == 200 &&
+                         strstr(probe->buffer, "m=video") != NULL;
+
+    close(fd);
+    return serving ? 0 : -1;
+}
+
+int stream_probe_wait(stream_probe_t *probe, uint64_t since_ns, uint64_t *ready_ns) {
+    const uint64_t deadline_ns = since_ns + (uint64_t)probe->config.timeout_ms * NS_PER_MS;
+    const uint64_t settle_ns = (uint64_t)probe->config.settle_ms * NS_PER_MS;
+    const struct timespec pause = {
+        .tv_sec = 0,
+        .tv_nsec = RETRY_NS
+    };
+    uint64_t first_pass_ns = 0;
+    bool seen_down = false;
+
+    while (1) {
+        const int budget_ms = remaining_ms(deadline_ns);
+
+        if (budget_ms == 0) {
+            fprintf(stderr, "Stream rtsp://%s:%u%s not serving %u ms after the reload.\n",
+                    probe->host, probe->port, probe->config.path, probe->config.timeout_ms);
+            return -1;
+        }
+
+        const bool passed = stream_probe_check(probe, budget_ms < ATTEMPT_TIMEOUT_MS ? budget_ms : ATTEMPT_TIMEOUT_MS) == 0;
+        const uint64_t now_ns = latency_trace_now();
+
+        if (passed && seen_down) {
+            *ready_ns = now_ns;
+            return 0;
+        }
+
+        if (passed) {
+            if (first_pass_ns == 0) {
+                first_pass_ns = now_ns;
+            }
+
+            if (now_ns - since_ns >= settle_ns) {
+                *ready_ns = first_pass_ns;
+                return STREAM_PROBE_UNINTERRUPTED;
+            }
+        } else {
+            seen_down = true;
+        }
+
+        nanosleep(&pause, NULL);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#define STREAM_PROBE_PATH_MAX 64
+#define STREAM_PROBE_BUFFER_SIZE 2048
+// stream_probe_wait() saw no outage: the reload may not have touched the stream.
+#define STREAM_PROBE_UNINTERRUPTED 1
+
+typedef struct stream_probe_config {
+    char path[STREAM_PROBE_PATH_MAX]; // RTSP stream path, e.g. "/stream=1"
+    uint32_t timeout_ms; // longest wait for the stream after a reload
+    uint32_t settle_ms;  // how long a stream that never dropped is watched
+} stream_probe_config_t;
+
+void stream_probe_config_defaults(stream_probe_config_t *config);
+
+/**
+ * Checks that Majestic is actually serving video, not just running: one RTSP
+ * OPTIONS + DESCRIBE exchange on a fresh connection, passing when DESCRIBE
+ * answers 200 with an SDP that has a video track.
+ */
+typedef struct stream_probe {
+    stream_probe_config_t config;
+    char host[64];
+    uint16_t port;
+    uint32_t cseq;
+    char buffer[STREAM_PROBE_BUFFER_SIZE];
+    size_t length;
+} stream_probe_t;
+
+void stream_probe_init(stream_probe_t *probe, const stream_probe_config_t *config, const char *host, uint16_t port);
+
+/**
+ * Run one handshake, giving up after `timeout_ms`.
+ *
+ * @return 0 when the stream is served, -1 otherwise.
+ */
+int stream_probe_check(stream_probe_t *probe, int timeout_ms);
+
+/**
+ * Wait for the stream to come back after Majestic was signalled at
+ * `since_ns`. A handshake that passes after one failed marks the stream as
+ * back. If every handshake passes for `settle_ms`, no outage was observed:
+ * the stream may never have dropped, or came back before the first
+ * handshake, so there is no gap to measure.
+ *
+ * @param ready_ns Receives the CLOCK_MONOTONIC time the stream served again,
+ *                 or of the first pass when no outage was observed.
+ * @return 0 once the stream is back, STREAM_PROBE_UNINTERRUPTED if it never
+ *         failed within `settle_ms`, -1 if it was not back within
+ *         `timeout_ms` (details logged to stderr).
+ */
+int stream_probe_wait(stream_probe_t *probe, uint64_t since_ns, uint64_t *ready_ns);
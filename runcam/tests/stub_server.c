@@ -0,0 +1,78 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "stub_server.h"
+
+static void serve_connection(stub_server_t *server, int fd) {
+    char request[2048];
+    size_t length = 0;
+
+    while (1) {
+        const ssize_t received = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+
+        if (received <= 0) {
+            return;
+        }
+
+        length += (size_t)received;
+        request[length] = '\0';
+
+        char *end_of_headers;
+
+        while ((end_of_headers = strstr(request, "\r\n\r\n")) != NULL) {
+            if (!server->respond(fd, request, server->context)) {
+                return;
+            }
+
+            const size_t consumed = (size_t)(end_of_headers + 4 - request);
+            memmove(request, request + consumed, length - consumed + 1);
+            length -= consumed;
+        }
+    }
+}
+
+static void *accept_main(void *argument) {
+    stub_server_t *server = argument;
+
+    while (1) {
+        const int fd = accept(server->listen_fd, NULL, NULL);
+
+        if (fd < 0) {
+            return NULL;
+        }
+
+        atomic_fetch_add(&server->accepted, 1);
+        serve_connection(server, fd);
+        close(fd);
+    }
+}
+
+void stub_server_start(stub_server_t *server, stub_server_respond_t respond, void *context) {
+    struct sockaddr_in address;
+    socklen_t address_length = sizeof(address);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    server->respond = respond;
+    server->context = context;
+    atomic_store(&server->accepted, 0);
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(server->listen_fd >= 0);
+    assert(bind(server->listen_fd, (struct sockaddr *)&address, sizeof(address)) == 0);
+    assert(listen(server->listen_fd, 4) == 0);
+    assert(getsockname(server->listen_fd, (struct sockaddr *)&address, &address_length) == 0);
+    server->port = ntohs(address.sin_port);
+
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, accept_main, server) == 0);
+    pthread_detach(thread);
+}
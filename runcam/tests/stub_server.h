@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Answer one request whose headers (up to and including the blank line) start
+ * at `request`. Write the response to `fd`, or nothing to stay silent.
+ *
+ * @return false to close the connection after this request.
+ */
+typedef bool (*stub_server_respond_t)(int fd, const char *request, void *context);
+
+/**
+ * Loopback TCP server on an ephemeral port standing in for Majestic's web or
+ * RTSP server in tests. One thread accepts connections one at a time and
+ * hands every request on them to `respond`.
+ */
+typedef struct stub_server {
+    int listen_fd;
+    uint16_t port;
+    atomic_int accepted; // connections accepted so far
+    stub_server_respond_t respond;
+    void *context;
+} stub_server_t;
+
+/**
+ * Bind, listen and start the accept thread. Asserts on failure.
+ */
+void stub_server_start(stub_server_t *server, stub_server_respond_t respond, void *context);
@@ -0,0 +1,157 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../adaptive_bitrate.h"
+
+#define TRACE_PATH "tests/data/radio_status_trace.csv"
+#define MAX_CHANGES 64
+
+typedef struct change {
+    uint64_t time_ms;
+    uint32_t kbps;
+    int flags;
+} change_t;
+
+static change_t changes[MAX_CHANGES];
+static size_t change_count;
+
+static adaptive_bitrate_config_t test_config(void) {
+    adaptive_bitrate_config_t config;
+
+    adaptive_bitrate_config_defaults(&config);
+    config.low_fps = 30;
+    config.low_fps_below_kbps = 1024;
+    return config;
+}
+
+// Replay the trace and record every change the controller asks for.
+static void replay(adaptive_bitrate_t *controller) {
+    FILE *trace = fopen(TRACE_PATH, "r");
+    char line[128];
+
+    assert(trace);
+    change_count = 0;
+
+    while (fgets(line, sizeof(line), trace)) {
+        unsigned rssi, remrssi, noise, remnoise, txbuf, rxerrors;
+        uint64_t time_ms;
+
+        if (line[0] == '#') {
+            continue;
+        }
+
+        assert(sscanf(line, "%" SCNu64 ",%u,%u,%u,%u,%u,%u",
+                      &time_ms, &rssi, &remrssi, &noise, &remnoise, &txbuf, &rxerrors) == 7);
+
+        const adaptive_bitrate_sample_t sample = {
+            .rssi = (uint8_t)rssi,
+            .remrssi = (uint8_t)remrssi,
+            .noise = (uint8_t)noise,
+            .remnoise = (uint8_t)remnoise,
+            .txbuf = (uint8_t)txbuf,
+            .rxerrors = (uint16_t)rxerrors
+        };
+        const int flags = adaptive_bitrate_update(controller, &sample, time_ms);
+
+        if (flags != 0) {
+            assert(change_count < MAX_CHANGES);
+            changes[change_count++] = (change_t){ time_ms, controller->bitrate_kbps, flags };
+        }
+    }
+
+    fclose(trace);
+}
+
+static void test_backs_off_and_converges(void) {
+    const adaptive_bitrate_config_t config = test_config();
+    adaptive_bitrate_t controller;
+    size_t fps_flips = 0;
+    uint32_t lowest = UINT32_MAX;
+
+    assert(adaptive_bitrate_init(&controller, &config, 4096) == 0);
+    replay(&controller);
+    assert(change_count > 0);
+
+    for (size_t i = 0; i < change_count; ++i) {
+        // Rate limit: never two changes within the hold time.
+        if (i > 0) {
+            assert(changes[i].time_ms - changes[i - 1].time_ms >= config.hold_ms);
+        }
+
+        if (changes[i].kbps < lowest) {
+            lowest = changes[i].kbps;
+        }
+
+        if (changes[i].flags & ADAPTIVE_FPS_CHANGED) {
+            ++fps_flips;
+        }
+    }
+
+    // The clean first 30 s cause no change; the fade is answered at once.
+    assert(changes[0].time_ms == 30000);
+    assert(changes[0].kbps < 4096);
+
+    // The fade drives the rate to the floor within ten seconds.
+    size_t at_floor = 0;
+
+    while (at_floor + 1 < change_count && changes[at_floor + 1].time_ms <= 40000) {
+        ++at_floor;
+    }
+
+    assert(changes[at_floor].kbps == config.min_kbps);
+    assert(lowest == config.min_kbps);
+
+    // After the fade the rate only climbs: no oscillation, blip included.
+    for (size_t i = 1; i < change_count; ++i) {
+        if (changes[i].time_ms > 50000) {
+            assert(changes[i].kbps > changes[i - 1].kbps);
+        }
+    }
+
+    // It converges back to the ceiling and then stays put.
+    assert(controller.bitrate_kbps == config.max_kbps);
+    assert(changes[change_count - 1].time_ms < 130000);
+
+    // One drop into the low-fps tier and one return, not a flurry of restarts.
+    assert(fps_flips == 2);
+    assert(!controller.low_fps_active);
+}
+
+static void test_ceiling_limits_recovery(void) {
+    const adaptive_bitrate_config_t config = test_config();
+    adaptive_bitrate_t controller;
+
+    assert(adaptive_bitrate_init(&controller, &config, 4096) == 0);
+    adaptive_bitrate_set_ceiling(&controller, 2048);
+    assert(controller.bitrate_kbps == 2048);
+
+    replay(&controller);
+    assert(controller.bitrate_kbps == 2048);
+
+    adaptive_bitrate_set_ceiling(&controller, 0);
+    assert(controller.ceiling_kbps == config.max_kbps);
+}
+
+static void test_rejects_invalid_config(void) {
+    adaptive_bitrate_config_t config = test_config();
+    adaptive_bitrate_t controller;
+
+    config.decrease_factor = 1.0;
+    assert(adaptive_bitrate_init(&controller, &config, 1000) != 0);
+
+    config = test_config();
+    config.min_kbps = config.max_kbps + 1;
+    assert(adaptive_bitrate_init(&controller, &config, 1000) != 0);
+}
+
+int main(void) {
+    test_backs_off_and_converges();
+    test_ceiling_limits_recovery();
+    test_rejects_invalid_config();
+
+    printf("test_adaptive_bitrate: ok\n");
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../command_registry.h"
+#include "../statustext_assembler.h"
+
+#define SECOND_NS 1000000000ULL
+
+static command_t make_command(const char *name, const char *key, const char *value) {
+    command_t command;
+
+    memset(&command, 0, sizeof(command));
+    snprintf(command.name, sizeof(command.name), "%s", name);
+    command.kind = COMMAND_CHANGES;
+
+    if (key) {
+        snprintf(command.changes[0].key, sizeof(command.changes[0].key), "%s", key);
+        snprintf(command.changes[0].value, sizeof(command.changes[0].value), "%s", value);
+        command.change_count = 1;
+    }
+
+    return command;
+}
+
+static void test_builtins_and_lookup(void) {
+    command_registry_t registry;
+
+    command_registry_init(&registry);
+    assert(command_registry_find(&registry, "zoom_in")->kind == COMMAND_ZOOM_IN);
+    assert(command_registry_find(&registry, "zoom_out")->kind == COMMAND_ZOOM_OUT);
+    assert(command_registry_find(&registry, "zoom")->min_args == 1);
+    assert(command_registry_find(&registry, "set")->min_args == 2);
+    assert(command_registry_find(&registry, "zoom_i") == NULL);
+    assert(command_registry_find(&registry, "") == NULL);
+}
+
+static void test_fills_the_table_through_collisions(void) {
+    command_registry_t registry;
+    char name[16];
+
+    command_registry_init(&registry);
+
+    const size_t builtins = registry.count;
+    for (size_t i = builtins; i < COMMAND_REGISTRY_MAX_COMMANDS; ++i) {
+        snprintf(name, sizeof(name), "cmd%zu", i);
+        const command_t command = make_command(name, NULL, NULL);
+        assert(command_registry_add(&registry, &command) == 0);
+    }
+
+    const command_t extra = make_command("one_too_many", NULL, NULL);
+    assert(command_registry_add(&registry, &extra) == -1);
+
+    // Every command is still reachable, whatever slot probing put it in.
+    for (size_t i = builtins; i < COMMAND_REGISTRY_MAX_COMMANDS; ++i) {
+        snprintf(name, sizeof(name), "cmd%zu", i);
+        const command_t *found = command_registry_find(&registry, name);
+        assert(found && strcmp(found->name, name) == 0);
+    }
+}
+
+static void test_rejects_duplicates_and_bad_names(void) {
+    command_registry_t registry;
+    const command_t duplicate = make_command("zoom", "image.contrast", "50");
+    const command_t spaced = make_command("night mode", NULL, NULL);
+    const command_t empty = make_command("", NULL, NULL);
+
+    command_registry_init(&registry);
+    assert(command_registry_add(&registry, &duplicate) == -1);
+    assert(command_registry_add(&registry, &spaced) == -1);
+    assert(command_registry_add(&registry, &empty) == -1);
+    assert(command_registry_find(&registry, "zoom")->kind == COMMAND_ZOOM);
+}
+
+static void test_parses_words(void) {
+    command_call_t call;
+
+    assert(command_parse("  set  video1.bitrate\t800 ", &call) == 0);
+    assert(strcmp(call.name, "set") == 0);
+    assert(call.arg_count == 2);
+    assert(strcmp(call.args[0], "video1.bitrate") == 0);
+    assert(strcmp(call.args[1], "800") == 0);
+
+    assert(command_parse("zoom_in", &call) == 0);
+    assert(strcmp(call.name, "zoom_in") == 0 && call.arg_count == 0);
+
+    assert(command_parse("   ", &call) == -1);
+    assert(command_parse("a 1 2 3 4 5", &call) == -1);
+}
+
+static void test_substitutes_arguments(void) {
+    command_registry_t registry;
+    command_call_t call;
+    majestic_config_txn_t txn;
+    command_t command = make_command("bitrate", "video0.bitrate", "$1");
+
+    snprintf(command.changes[1].key, sizeof(command.changes[1].key), "%s", "video0.rcMode");
+    snprintf(command.changes[1].value, sizeof(command.changes[1].value), "%s", "cbr");
+    command.change_count = 2;
+
+    command_registry_init(&registry);
+    assert(command_registry_add(&registry, &command) == 0);
+
+    const command_t *added = command_registry_find(&registry, "bitrate");
+    assert(added->min_args == 1);
+
+    assert(command_parse("bitrate", &call) == 0);
+    majestic_config_begin(&txn, "/tmp/unused.yaml");
+    assert(command_stage_changes(added, &call, &txn) == -1);
+
+    assert(command_parse("bitrate 2048", &call) == 0);
+    majestic_config_begin(&txn, "/tmp/unused.yaml");
+    assert(command_stage_changes(added, &call, &txn) == 0);
+    assert(txn.change_count == 2);
+    assert(strcmp(txn.changes[0].value, "2048") == 0);
+    assert(strcmp(txn.changes[1].value, "cbr") == 0);
+}
+
+static matek_statustext_t chunk(uint16_t id, uint8_t seq, const char *text) {
+    matek_statustext_t message;
+
+    memset(&message, 0, sizeof(message));
+    message.id = id;
+    message.chunk_seq = seq;
+    snprintf(message.text, sizeof(message.text), "%s", text);
+    return message;
+}
+
+// A full 50-character chunk of one repeated letter.
+static matek_statustext_t full_chunk(uint16_t id, uint8_t seq, char letter) {
+    char text[MATEK_STATUSTEXT_MAX_LEN + 1];
+
+    memset(text, letter, MATEK_STATUSTEXT_MAX_LEN);
+    text[MATEK_STATUSTEXT_MAX_LEN] = '\0';
+    return chunk(id, seq, text);
+}
+
+static void test_reassembles_chunks(void) {
+    statustext_assembler_t assembler;
+    char text[STATUSTEXT_ASSEMBLER_MAX_LEN + 1];
+    matek_statustext_t message;
+
+    statustext_assembler_init(&assembler);
+
+    message = chunk(0, 0, "zoom_in");
+    assert(statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    assert(strcmp(text, "zoom_in") == 0);
+
+    // Two senders interleave texts with the same id.
+    message = full_chunk(7, 0, 'a');
+    assert(!statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    message = full_chunk(7, 0, 'b');
+    assert(!statustext_assembler_push(&assembler, 2, 1, &message, 0, text));
+    message = chunk(7, 1, "end");
+    assert(statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    assert(strlen(text) == MATEK_STATUSTEXT_MAX_LEN + 3 && text[0] == 'a');
+    message = chunk(7, 1, "");
+    assert(statustext_assembler_push(&assembler, 2, 1, &message, 0, text));
+    assert(strlen(text) == MATEK_STATUSTEXT_MAX_LEN && text[0] == 'b');
+    assert(assembler.stats.completed == 3 && assembler.stats.dropped == 0);
+
+    // The longest text ends after the last chunk that fits.
+    for (uint8_t seq = 0; seq < STATUSTEXT_ASSEMBLER_MAX_CHUNKS - 1; ++seq) {
+        message = full_chunk(8, seq, 'c');
+        assert(!statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    }
+    message = full_chunk(8, STATUSTEXT_ASSEMBLER_MAX_CHUNKS - 1, 'c');
+    assert(statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    assert(strlen(text) == STATUSTEXT_ASSEMBLER_MAX_LEN);
+}
+
+static void test_drops_gaps_and_stale_texts(void) {
+    statustext_assembler_t assembler;
+    char text[STATUSTEXT_ASSEMBLER_MAX_LEN + 1];
+    matek_statustext_t message;
+
+    statustext_assembler_init(&assembler);
+
+    // A missing chunk drops the text instead of delivering a spliced one.
+    message = full_chunk(3, 0, 'a');
+    assert(!statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    message = chunk(3, 2, "tail");
+    assert(!statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    assert(assembler.stats.dropped == 1);
+    message = chunk(3, 1, "tail");
+    assert(!statustext_assembler_push(&assembler, 1, 1, &message, 0, text));
+    assert(assembler.stats.dropped == 2);
+
+    // With every slot busy, a stale slot is reclaimed for a new text.
+    for (uint16_t id = 10; id < 10 + STATUSTEXT_ASSEMBLER_SLOTS; ++id) {
+        message = full_chunk(id, 0, 'x');
+        assert(!statustext_assembler_push(&assembler, 1, 1, &message, id == 10 ? 0 : 3 * SECOND_NS, text));
+    }
+    message = full_chunk(20, 0, 'y');
+    assert(!statustext_assembler_push(&assembler, 1, 1, &message, 3 * SECOND_NS, text));
+    assert(assembler.stats.dropped == 3);
+    message = chunk(10, 1, "late");
+    assert(!statustext_assembler_push(&assembler, 1, 1, &message, 3 * SECOND_NS, text));
+    message = chunk(20, 1, "ok");
+    assert(statustext_assembler_push(&assembler, 1, 1, &message, 3 * SECOND_NS, text));
+    assert(text[0] == 'y');
+}
+
+int main(void) {
+    test_builtins_and_lookup();
+    test_fills_the_table_through_collisions();
+    test_rejects_duplicates_and_bad_names();
+    test_parses_words();
+    test_substitutes_arguments();
+    test_reassembles_chunks();
+    test_drops_gaps_and_stale_texts();
+    printf("test_command_registry: ok\n");
+    return 0;
+}
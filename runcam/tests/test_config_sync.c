@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../config_sync.h"
+
+#define MS 1000000ULL
+
+static char working_path[256];
+static char flash_path[256];
+
+static void write_file(const char *path, const char *contents) {
+    FILE *file = fopen(path, "wb");
+    assert(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void read_file(const char *path, char *out, size_t size) {
+    FILE *file = fopen(path, "rb");
+    assert(file);
+    const size_t length = fread(out, 1, size - 1, file);
+    out[length] = '\0';
+    fclose(file);
+}
+
+static void test_seeds_missing_working_copy(void) {
+    config_sync_t sync;
+    char contents[64];
+
+    // Neither copy yet (first start): the first sync creates the flash one.
+    unlink(working_path);
+    unlink(flash_path);
+    assert(config_sync_init(&sync, working_path, flash_path, 500) == 0);
+    assert(access(working_path, F_OK) != 0);
+
+    write_file(flash_path, "video1:\n  crop: 0x0x1920x1080\n");
+    assert(config_sync_init(&sync, working_path, flash_path, 500) == 0);
+    read_file(working_path, contents, sizeof(contents));
+    assert(strcmp(contents, "video1:\n  crop: 0x0x1920x1080\n") == 0);
+
+    // An existing working copy may hold changes that never reached flash.
+    write_file(working_path, "video1:\n  crop: 480x270x960x540\n");
+    assert(config_sync_init(&sync, working_path, flash_path, 500) == 0);
+    read_file(working_path, contents, sizeof(contents));
+    assert(strcmp(contents, "video1:\n  crop: 480x270x960x540\n") == 0);
+}
+
+static void test_coalesces_changes_into_one_flash_write(void) {
+    config_sync_t sync;
+    char contents[64];
+
+    write_file(flash_path, "video1:\n  crop: 0x0x1920x1080\n");
+    assert(config_sync_init(&sync, working_path, flash_path, 500) == 0);
+    assert(config_sync_timeout_ms(&sync, 0) == -1);
+
+    // Every change restarts the quiet period.
+    write_file(working_path, "video1:\n  crop: 480x270x960x540\n");
+    config_sync_note_change(&sync, 1000 * MS);
+    write_file(working_path, "video1:\n  crop: 720x405x480x270\n");
+    config_sync_note_change(&sync, 1200 * MS);
+    assert(config_sync_timeout_ms(&sync, 1300 * MS) == 400);
+    assert(config_sync_timeout_ms(&sync, 1700 * MS) == 0);
+
+    assert(config_sync_flush(&sync) == 0);
+    read_file(flash_path, contents, sizeof(contents));
+    assert(strcmp(contents, "video1:\n  crop: 720x405x480x270\n") == 0);
+    assert(sync.stats.changes == 2 && sync.stats.flash_writes == 1);
+    assert(config_sync_timeout_ms(&sync, 1700 * MS) == -1);
+
+    // Nothing pending, and a round trip back to the flash contents, cost no write.
+    assert(config_sync_flush(&sync) == 0);
+    config_sync_note_change(&sync, 2000 * MS);
+    assert(config_sync_flush(&sync) == 0);
+    assert(sync.stats.flash_writes == 1 && sync.stats.unchanged == 1);
+}
+
+static void test_failed_sync_stays_pending(void) {
+    config_sync_t sync;
+
+    assert(config_sync_init(&sync, working_path, "/nonexistent/majestic.yaml", 500) == 0);
+    config_sync_note_change(&sync, 1000 * MS);
+    assert(config_sync_flush(&sync) == -1);
+    assert(config_sync_timeout_ms(&sync, 1500 * MS) == 1000);
+}
+
+static void test_syncs_in_place_without_flash_copy(void) {
+    config_sync_t sync;
+
+    assert(config_sync_init(&sync, working_path, "", 0) == 0);
+    config_sync_note_change(&sync, 1 * MS);
+    assert(config_sync_timeout_ms(&sync, 1 * MS) == 0);
+    assert(config_sync_flush(&sync) == 0);
+    assert(sync.stats.flash_writes == 1);
+}
+
+int main(void) {
+    char directory[] = "/tmp/config_sync_test.XXXXXX";
+    assert(mkdtemp(directory));
+    snprintf(working_path, sizeof(working_path), "%s/majestic.yaml", directory);
+    snprintf(flash_path, sizeof(flash_path), "%s/majestic.flash.yaml", directory);
+
+    test_seeds_missing_working_copy();
+    test_coalesces_changes_into_one_flash_write();
+    test_failed_sync_stays_pending();
+    test_syncs_in_place_without_flash_copy();
+
+    unlink(working_path);
+    unlink(flash_path);
+    rmdir(directory);
+    printf("test_config_sync: ok\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../flight_recorder.h"
+
+#define RING_SIZE 4096
+#define CHUNK_SIZE 100
+#define CHUNK_COUNT 100
+
+static char ring_path[256];
+
+static void fill_chunk(uint8_t *chunk, size_t length, unsigned index) {
+    for (size_t i = 0; i < length; ++i) {
+        chunk[i] = (uint8_t)(index * 31u + i);
+    }
+}
+
+// Check that the ring holds a gap-free run of chunks ending with `last`.
+static size_t verify_latest(const flight_recorder_t *recorder, unsigned last) {
+    uint64_t position = flight_recorder_first(recorder);
+    uint64_t timestamp_ns = 0;
+    const uint8_t *data = NULL;
+    size_t length = 0;
+    size_t count = 0;
+    unsigned expected = 0;
+    uint8_t chunk[CHUNK_SIZE];
+
+    while (flight_recorder_next(recorder, &position, &timestamp_ns, &data, &length)) {
+        const unsigned index = (unsigned)(timestamp_ns / 1000u);
+
+        if (count > 0) {
+            assert(index == expected);
+        }
+
+        fill_chunk(chunk, CHUNK_SIZE, index);
+        assert(length == CHUNK_SIZE);
+        assert(memcmp(data, chunk, CHUNK_SIZE) == 0);
+        expected = index + 1;
+        ++count;
+    }
+
+    assert(count > 0 && expected == last + 1);
+    return count;
+}
+
+static void test_wraps_and_keeps_newest_chunks(void) {
+    flight_recorder_t recorder;
+    uint8_t chunk[CHUNK_SIZE];
+
+    unlink(ring_path);
+    assert(flight_recorder_open(&recorder, ring_path, RING_SIZE) == 0);
+
+    for (unsigned i = 0; i < CHUNK_COUNT; ++i) {
+        fill_chunk(chunk, sizeof(chunk), i);
+        flight_recorder_append(&recorder, (uint64_t)i * 1000u, chunk, sizeof(chunk));
+    }
+
+    // 16-byte record header + 104 padded bytes per chunk.
+    const size_t kept = verify_latest(&recorder, CHUNK_COUNT - 1);
+    assert(kept == RING_SIZE / 120 || kept == RING_SIZE / 120 - 1);
+    assert(recorder.header->records == CHUNK_COUNT);
+    flight_recorder_close(&recorder);
+
+    // Reopening resumes after the existing records instead of wiping them.
+    assert(flight_recorder_open(&recorder, ring_path, RING_SIZE) == 0);
+    fill_chunk(chunk, sizeof(chunk), CHUNK_COUNT);
+    flight_recorder_append(&recorder, (uint64_t)CHUNK_COUNT * 1000u, chunk, sizeof(chunk));
+    verify_latest(&recorder, CHUNK_COUNT);
+    flight_recorder_close(&recorder);
+
+    assert(flight_recorder_open_readonly(&recorder, ring_path) == 0);
+    verify_latest(&recorder, CHUNK_COUNT);
+    flight_recorder_close(&recorder);
+}
+
+static void test_truncates_oversized_chunks(void) {
+    flight_recorder_t recorder;
+    static uint8_t big[RING_SIZE];
+    uint64_t position;
+    uint64_t timestamp_ns;
+    const uint8_t *data;
+    size_t length;
+
+    unlink(ring_path);
+    assert(flight_recorder_open(&recorder, ring_path, RING_SIZE) == 0);
+    flight_recorder_append(&recorder, 1, big, sizeof(big));
+
+    position = flight_recorder_first(&recorder);
+    assert(flight_recorder_next(&recorder, &position, &timestamp_ns, &data, &length));
+    assert(length == RING_SIZE / 4 - sizeof(flight_recorder_record_t));
+    assert(!flight_recorder_next(&recorder, &position, &timestamp_ns, &data, &length));
+    flight_recorder_close(&recorder);
+}
+
+static void test_rejects_foreign_files(void) {
+    flight_recorder_t recorder;
+    static const uint8_t junk[RING_SIZE * 2] = { 1, 2, 3 };
+    FILE *file = fopen(ring_path, "wb");
+
+    assert(file);
+    assert(fwrite(junk, 1, sizeof(junk), file) == sizeof(junk));
+    fclose(file);
+    assert(flight_recorder_open_readonly(&recorder, ring_path) == -1);
+}
+
+static void test_replays_into_a_socket(void) {
+    flight_recorder_t recorder;
+    flight_recorder_replay_t replay;
+    uint8_t expected[10 * 64];
+    uint8_t received[sizeof(expected)];
+    size_t received_length = 0;
+    int pair[2];
+
+    unlink(ring_path);
+    assert(flight_recorder_open(&recorder, ring_path, RING_SIZE) == 0);
+
+    // Ten chunks 20 ms apart, replayed at 10x: about 18 ms of pacing.
+    for (unsigned i = 0; i < 10; ++i) {
+        fill_chunk(expected + i * 64, 64, i);
+        flight_recorder_append(&recorder, 5000000000ULL + i * 20000000ULL, expected + i * 64, 64);
+    }
+
+    flight_recorder_close(&recorder);
+
+    assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair) == 0);
+    assert(flight_recorder_replay_start(&replay, ring_path, 10.0, pair[1]) == 0);
+
+    // Talk back like the manager would; the replay must swallow it.
+    assert(write(pair[0], "ack", 3) == 3);
+
+    while (1) {
+        struct pollfd pfd = { .fd = pair[0], .events = POLLIN, .revents = 0 };
+        assert(poll(&pfd, 1, 2000) == 1);
+
+        const ssize_t bytes = read(pair[0], received + received_length, sizeof(received) - received_length);
+
+        if (bytes == 0) {
+            break;
+        }
+
+        assert(bytes > 0 || errno == EAGAIN);
+
+        if (bytes > 0) {
+            received_length += (size_t)bytes;
+        }
+    }
+
+    flight_recorder_replay_join(&replay);
+    close(pair[0]);
+
+    assert(received_length == sizeof(expected));
+    assert(memcmp(received, expected, sizeof(expected)) == 0);
+    assert(replay.stats.chunks == 10 && replay.stats.bytes == sizeof(expected));
+    assert(replay.stats.recorded_ns == 180000000ULL);
+    assert(replay.stats.elapsed_ns >= 18000000ULL);
+}
+
+int main(void) {
+    char directory[] = "/tmp/flight_recorder_test.XXXXXX";
+    assert(mkdtemp(directory));
+    snprintf(ring_path, sizeof(ring_path), "%s/link.rec", directory);
+
+    test_wraps_and_keeps_newest_chunks();
+    test_truncates_oversized_chunks();
+    test_rejects_foreign_files();
+    test_replays_into_a_socket();
+
+    unlink(ring_path);
+    rmdir(directory);
+    printf("test_flight_recorder: ok\n");
+    return 0;
+}
@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <math.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../image_capture.h"
+#include "../latency_trace.h"
+#include "stub_server.h"
+
+#define JPEG_SIZE (300 * 1024)
+
+// Minimal stand-in for Majestic's web server: keep-alive GETs of a fixed
+// JPEG, or 404 while `failing` is set.
+static struct {
+    atomic_int requests;
+    atomic_bool failing;
+} stub;
+static stub_server_t server;
+static uint8_t jpeg[JPEG_SIZE];
+static char directory[] = "/tmp/image_capture_test.XXXXXX";
+static char config_path[256];
+
+static void send_all(int fd, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+
+    while (length > 0) {
+        const ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+
+        if (sent <= 0) {
+            return;
+        }
+
+        bytes += sent;
+        length -= (size_t)sent;
+    }
+}
+
+static bool respond(int fd, const char *request, void *context) {
+    char header[128];
+    (void)context;
+
+    atomic_fetch_add(&stub.requests, 1);
+
+    if (atomic_load(&stub.failing) || strncmp(request, "GET /image.jpg ", 15) != 0) {
+        snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+        send_all(fd, header, strlen(header));
+    } else {
+        snprintf(header, sizeof(header),
+                 "HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: %d\r\n\r\n", JPEG_SIZE);
+        send_all(fd, header, strlen(header));
+        send_all(fd, jpeg, sizeof(jpeg));
+    }
+
+    return true;
+}
+
+static uint16_t get16(const uint8_t *in) {
+    return (uint16_t)(in[0] | in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *in) {
+    return (uint32_t)get16(in) | (uint32_t)get16(in + 2) << 16;
+}
+
+// Value bytes of `tag` in the IFD at `offset`, or NULL.
+static const uint8_t *find_tag(const uint8_t *tiff, uint32_t offset, uint16_t tag) {
+    const uint16_t count = get16(tiff + offset);
+
+    for (uint16_t i = 0; i < count; ++i) {
+        const uint8_t *entry = tiff + offset + 2 + i * 12;
+        static const size_t TYPE_SIZE[] = { 0, 1, 1, 2, 4, 8 };
+
+        if (get16(entry) == tag) {
+            const size_t length = TYPE_SIZE[get16(entry + 2)] * get32(entry + 4);
+            return length <= 4 ? entry + 8 : tiff + get32(entry + 8);
+        }
+    }
+
+    return NULL;
+}
+
+static void test_exif_carries_position_and_attitude(void) {
+    const image_geotag_t geotag = {
+        .has_position = true,
+        .lat = 473977419,
+        .lon = -1220000000,
+        .alt_mm = 488000,
+        .relative_alt_mm = 12000,
+        .has_attitude = true,
+        .roll = 0.0f,
+        .pitch = -0.5f,
+        .yaw = (float)(-M_PI / 2.0),
+        .time_utc_us = 1700000000ULL * 1000000ULL
+    };
+    uint8_t segment[IMAGE_CAPTURE_EXIF_RESERVE];
+
+    const size_t length = image_capture_build_exif(&geotag, segment, sizeof(segment));
+    assert(length > 0 && length <= sizeof(segment));
+    assert(segment[0] == 0xFF && segment[1] == 0xE1);
+    assert((size_t)(segment[2] << 8 | segment[3]) == length - 2);
+    assert(memcmp(segment + 4, "Exif\0\0II*\0", 10) == 0);
+
+    const uint8_t *tiff = segment + 10;
+    const uint32_t ifd0 = get32(tiff + 4);
+
+    assert(strcmp((const char *)find_tag(tiff, ifd0, 0x010F), "RunCam") == 0);
+    assert(strcmp((const char *)find_tag(tiff, ifd0, 0x0132), "2023:11:14 22:13:20") == 0);
+    assert(strstr((const char *)find_tag(tiff, ifd0, 0x010E), "pitch=-28.6 yaw=270.0") != NULL);
+
+    const uint32_t gps = get32(find_tag(tiff, ifd0, 0x8825));
+    const uint8_t *latitude = find_tag(tiff, gps, 0x0002);
+    const uint8_t *altitude = find_tag(tiff, gps, 0x0006);
+    const uint8_t *direction = find_tag(tiff, gps, 0x0011);
+
+    assert(*find_tag(tiff, gps, 0x0001) == 'N' && *find_tag(tiff, gps, 0x0003) == 'W');
+    assert(get32(latitude) == 47 && get32(latitude + 8) == 23);
+    assert(get32(latitude + 16) == 518708 && get32(latitude + 20) == 10000);
+    assert(get32(find_tag(tiff, gps, 0x0004)) == 122);
+    assert(*find_tag(tiff, gps, 0x0005) == 0 && get32(altitude) == 488000 && get32(altitude + 4) == 1000);
+    assert(get32(direction) == 27000 && get32(direction + 4) == 100);
+    assert(strcmp((const char *)find_tag(tiff, gps, 0x001D), "2023:11:14") == 0);
+
+    // Nothing known yet: identity only, and no room means no segment.
+    const image_geotag_t unknown = { 0 };
+    const size_t bare = image_capture_build_exif(&unknown, segment, sizeof(segment));
+    assert(bare > 0 && bare < length);
+    assert(find_tag(segment + 10, get32(segment + 14), 0x8825) == NULL);
+    assert(image_capture_build_exif(&geotag, segment, 64) == 0);
+}
+
+static bool next_result(image_capture_result_t *result, int timeout_ms) {
+    struct pollfd pfd = { .fd = image_capture_result_fd(), .events = POLLIN, .revents = 0 };
+
+    if (image_capture_poll_result(result)) {
+        return true;
+    }
+
+    return poll(&pfd, 1, timeout_ms) > 0 && image_capture_poll_result(result);
+}
+
+static void check_file(const image_capture_result_t *result) {
+    static uint8_t contents[JPEG_SIZE + IMAGE_CAPTURE_EXIF_RESERVE];
+    FILE *file = fopen(result->file, "rb");
+
+    assert(file);
+    const size_t length = fread(contents, 1, sizeof(contents), file);
+    fclose(file);
+
+    // SOI, the new APP1 segment, then the JPEG from Majestic without its SOI.
+    const size_t exif_length = (size_t)(contents[4] << 8 | contents[5]) + 2;
+    assert(length == result->size && length == JPEG_SIZE + exif_length);
+    assert(contents[0] == 0xFF && contents[1] == 0xD8 && contents[2] == 0xFF && contents[3] == 0xE1);
+    assert(memcmp(contents + 6, "Exif\0\0", 6) == 0);
+    assert(memcmp(contents + 2 + exif_length, jpeg + 2, JPEG_SIZE - 2) == 0);
+}
+
+static void test_burst_reuses_one_connection(void) {
+    image_capture_result_t result;
+    char expected_directory[300];
+    struct tm local;
+    const time_t now = time(NULL);
+
+    localtime_r(&now, &local);
+    snprintf(expected_directory, sizeof(expected_directory), "%s/%04d/", directory, local.tm_year + 1900);
+
+    image_capture_set_position(473977419, 85455000, 488000, 12000);
+    assert(image_capture_request(0, 5) == 0);
+
+    for (int32_t i = 0; i < 5; ++i) {
+        assert(next_result(&result, 2000));
+        assert(result.status == 0 && result.index == i);
+        assert(result.geotag.has_position && !result.geotag.has_attitude);
+        assert(result.requested_ns <= result.fetched_ns && result.fetched_ns <= result.written_ns);
+        assert(strncmp(result.file, expected_directory, strlen(expected_directory)) == 0);
+        check_file(&result);
+    }
+
+    assert(!next_result(&result, 100));
+    assert(atomic_load(&server.accepted) == 1 && atomic_load(&stub.requests) == 5);
+}
+
+static void test_interval_runs_until_cancelled(void) {
+    image_capture_result_t first;
+    image_capture_result_t second;
+    image_capture_result_t late;
+
+    image_capture_set_attitude(0.1f, 0.0f, 1.0f);
+    assert(image_capture_request(150, 0) == 0);
+    assert(next_result(&first, 2000) && next_result(&second, 2000));
+    assert(first.status == 0 && second.status == 0 && second.geotag.has_attitude);
+    assert(second.requested_ns - first.requested_ns >= 140000000ULL);
+
+    assert(image_capture_cancel() == 0);
+
+    // At most the shot already under way still arrives.
+    int late_shots = 0;
+
+    while (next_result(&late, 400)) {
+        ++late_shots;
+    }
+
+    assert(late_shots <= 1);
+}
+
+static void test_failed_fetch_is_reported(void) {
+    image_capture_result_t result;
+
+    atomic_store(&stub.failing, true);
+    assert(image_capture_request(0, 1) == 0);
+    assert(next_result(&result, 2000) && result.status == -1 && result.file[0] == '\0');
+
+    // The slot of the failed shot is free again.
+    atomic_store(&stub.failing, false);
+    assert(image_capture_request(0, 2) == 0);
+    assert(next_result(&result, 2000) && result.status == 0);
+    assert(next_result(&result, 2000) && result.status == 0);
+    check_file(&result);
+}
+
+int main(void) {
+    image_capture_config_t config;
+
+    for (size_t i = 0; i < sizeof(jpeg); ++i) {
+        jpeg[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    memcpy(jpeg, "\xFF\xD8\xFF\xE0", 4);
+    jpeg[JPEG_SIZE - 2] = 0xFF;
+    jpeg[JPEG_SIZE - 1] = 0xD9;
+
+    assert(mkdtemp(directory));
+    stub_server_start(&server, respond, NULL);
+    test_exif_carries_position_and_attitude();
+
+    // Without capture.path the files go to records.path, strftime expanded.
+    snprintf(config_path, sizeof(config_path), "%s/majestic.yaml", directory);
+    FILE *file = fopen(config_path, "wb");
+    assert(file);
+    fprintf(file, "system:\n  webPort: %u\nrecords:\n  path: %s/%%Y\n", server.port, directory);
+    fclose(file);
+
+    image_capture_config_defaults(&config);
+    config.buffer_size = JPEG_SIZE;
+    config.sync_ms = 50;
+    assert(image_capture_start(&config, config_path) == 0);
+
+    test_burst_reuses_one_connection();
+    test_interval_runs_until_cancelled();
+    test_failed_fetch_is_reported();
+    image_capture_stop();
+
+    char command[400];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    assert(system(command) == 0);
+    printf("test_image_capture: ok\n");
+    return 0;
+}
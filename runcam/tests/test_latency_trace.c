@@ -0,0 +1,88 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../latency_trace.h"
+
+#define US 1000ULL
+#define MS 1000000ULL
+
+static void test_histogram_percentiles(void) {
+    latency_histogram_t histogram;
+
+    memset(&histogram, 0, sizeof(histogram));
+    assert(latency_histogram_percentile_us(&histogram, 0.5) == 0);
+
+    // 90 fast samples (~100 us) and 10 slow ones (~40 ms).
+    for (int i = 0; i < 90; ++i) {
+        latency_histogram_record(&histogram, 100 * US);
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        latency_histogram_record(&histogram, 40 * MS);
+    }
+
+    assert(histogram.count == 100);
+    assert(histogram.max_us == 40000);
+
+    // Percentiles report the bucket's upper bound (power of two), capped at max.
+    const uint64_t p50 = latency_histogram_percentile_us(&histogram, 0.50);
+    const uint64_t p99 = latency_histogram_percentile_us(&histogram, 0.99);
+
+    assert(p50 >= 100 && p50 < 256);
+    assert(p99 >= 32768 && p99 <= 40000);
+    assert(latency_histogram_percentile_us(&histogram, 1.0) == 40000);
+}
+
+static void test_traces_command_stages(void) {
+    const uint64_t base = 1000 * MS;
+    const majestic_apply_timing_t timing = {
+        .written_ns = base + 3 * MS,
+        .signalled_ns = base + 4 * MS,
+        .ready_ns = base + 204 * MS,
+        .reloaded = true
+    };
+    char report[1536];
+
+    latency_trace_command(7, base, base + 50 * US);
+    latency_trace_command(8, base + 1 * MS, base + 1 * MS + 50 * US);
+    // Sequence 9 is never covered by the batch below.
+    latency_trace_command(9, base + 2 * MS, base + 2 * MS);
+
+    latency_trace_complete(7, 8, base + 2 * MS, &timing, base + 205 * MS);
+
+    assert(latency_trace_histogram(LATENCY_STAGE_WRITE)->count == 1);
+    assert(latency_trace_histogram(LATENCY_STAGE_READY)->count == 1);
+    assert(latency_trace_histogram(LATENCY_STAGE_READY)->max_us == 200000);
+    assert(latency_trace_histogram(LATENCY_STAGE_DECODE)->count == 2);
+    assert(latency_trace_histogram(LATENCY_STAGE_TOTAL)->count == 2);
+    assert(latency_trace_histogram(LATENCY_STAGE_TOTAL)->max_us == 205000);
+    assert(latency_trace_reloads() == 1);
+
+    // A batch without traced commands only feeds the apply stages.
+    latency_trace_complete(10, 10, base, &timing, base + 300 * MS);
+    assert(latency_trace_histogram(LATENCY_STAGE_WRITE)->count == 2);
+    assert(latency_trace_histogram(LATENCY_STAGE_TOTAL)->count == 2);
+
+    // Only reloads confirmed by the stream probe feed the video gap.
+    assert(latency_trace_gap_histogram()->count == 0);
+    majestic_apply_timing_t probed = timing;
+    probed.probed = true;
+    probed.ready_ns = base + 904 * MS;
+    latency_trace_complete(11, 11, base, &probed, base + 905 * MS);
+    assert(latency_trace_gap_histogram()->count == 1);
+    assert(latency_trace_gap_histogram()->max_us == 900000);
+
+    latency_trace_format(report, sizeof(report));
+    assert(strstr(report, "total  count=2 ") != NULL);
+    assert(strstr(report, "gap    count=1 ") != NULL);
+    assert(strstr(report, "reloads=3\n") != NULL);
+}
+
+int main(void) {
+    test_histogram_percentiles();
+    test_traces_command_stages();
+
+    printf("test_latency_trace: ok\n");
+    return 0;
+}
@@ -0,0 +1,200 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../majestic_apply.h"
+#include "stub_server.h"
+
+// Minimal stand-in for Majestic's web server: records request targets and
+// answers 200, optionally closing the connection after every response.
+static struct {
+    atomic_int requests;
+    atomic_bool close_after_response;
+    char targets[8][512];
+} stub;
+static stub_server_t server;
+static char config_path[256];
+
+static bool respond(int fd, const char *request, void *context) {
+    static const char RESPONSE[] = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+    const int index = atomic_load(&stub.requests);
+    (void)context;
+
+    if (index < 8) {
+        sscanf(request, "GET %511s", stub.targets[index]);
+    }
+
+    atomic_fetch_add(&stub.requests, 1);
+    (void)send(fd, RESPONSE, sizeof(RESPONSE) - 1, MSG_NOSIGNAL);
+    return !atomic_load(&stub.close_after_response);
+}
+
+static void write_config(void) {
+    FILE *file = fopen(config_path, "wb");
+    assert(file);
+    fprintf(file,
+        "system:\n"
+        "  webPort: %u\n"
+        "video1:\n"
+        "  crop: 0x0x1920x1080\n"
+        "  fps: 30\n"
+        "  bitrate: 650\n"
+        "  codec: h265\n"
+        "  size: 1280x720\n",
+        server.port);
+    fclose(file);
+}
+
+static void wait_for_requests(int expected) {
+    for (int i = 0; i < 200 && atomic_load(&stub.requests) < expected; ++i) {
+        usleep(1000);
+    }
+}
+
+static void test_classifies_keys(void) {
+    assert(majestic_apply_classify("video1.crop") == MAJESTIC_APPLY_RUNTIME);
+    assert(majestic_apply_classify("video1.bitrate") == MAJESTIC_APPLY_RUNTIME);
+    assert(majestic_apply_classify("image.contrast") == MAJESTIC_APPLY_RUNTIME);
+    assert(majestic_apply_classify("video1.fps") == MAJESTIC_APPLY_RESTART);
+    assert(majestic_apply_classify("video1.size") == MAJESTIC_APPLY_RESTART);
+    assert(majestic_apply_classify("imagery.x") == MAJESTIC_APPLY_RESTART);
+}
+
+static void test_settable_keys(void) {
+    assert(majestic_apply_settable("video1.bitrate"));
+    assert(majestic_apply_settable("image.contrast"));
+    assert(!majestic_apply_settable("video1.crop"));
+    assert(!majestic_apply_settable("image."));
+    assert(!majestic_apply_settable("image.contrastX"));
+    assert(!majestic_apply_settable("system.webPort"));
+}
+
+static void test_reads_stream_settings(void) {
+    majestic_stream_settings_t stream;
+
+    majestic_apply_read_stream(config_path, &stream);
+    assert(stream.width == 1280 && stream.height == 720);
+    assert(stream.fps == 30 && stream.bitrate_kbps == 650);
+    assert(strcmp(stream.codec, "h265") == 0);
+}
+
+static void test_runtime_keys_reuse_one_connection(void) {
+    majestic_config_txn_t txn;
+
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.crop", "480x270x960x540") == 0);
+    assert(majestic_apply(&txn, NULL) == 0);
+
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.crop", "720x405x480x270") == 0);
+    assert(majestic_config_set(&txn, "video1.bitrate", "800") == 0);
+    assert(majestic_apply(&txn, NULL) == 0);
+
+    wait_for_requests(2);
+    assert(atomic_load(&stub.requests) == 2);
+    assert(atomic_load(&server.accepted) == 1);
+    assert(strcmp(stub.targets[0], "/api/v1/set?video1.crop=480x270x960x540") == 0);
+    assert(strcmp(stub.targets[1], "/api/v1/set?video1.crop=720x405x480x270&video1.bitrate=800") == 0);
+
+    char value[32];
+    assert(majestic_config_get(config_path, "video1.bitrate", value, sizeof(value)) == 0);
+    assert(strcmp(value, "800") == 0);
+}
+
+static void test_restart_keys_skip_http(void) {
+    const int before = atomic_load(&stub.requests);
+    majestic_config_txn_t txn;
+
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.crop", "0x0x1920x1080") == 0);
+    assert(majestic_config_set(&txn, "video1.fps", "60") == 0);
+
+    // No Majestic process exists here, so the SIGHUP fallback reports failure,
+    // but the file is still updated and nothing went over HTTP.
+    assert(majestic_apply(&txn, NULL) == -1);
+    assert(atomic_load(&stub.requests) == before);
+
+    char value[32];
+    assert(majestic_config_get(config_path, "video1.fps", value, sizeof(value)) == 0);
+    assert(strcmp(value, "60") == 0);
+}
+
+static void test_unchanged_values_skip_write_and_reload(void) {
+    const int before = atomic_load(&stub.requests);
+    majestic_config_txn_t txn;
+    majestic_apply_timing_t timing;
+    struct stat before_write;
+    struct stat after_write;
+
+    assert(stat(config_path, &before_write) == 0);
+    usleep(10000);
+
+    // Everything already matches (fps only differs in spelling): no write,
+    // no HTTP request and, with no Majestic process around, no failed reload.
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.crop", "0x0x1920x1080") == 0);
+    assert(majestic_config_set(&txn, "video1.fps", "60.0") == 0);
+    assert(majestic_apply(&txn, &timing) == 0);
+    assert(!timing.reloaded && timing.signalled_ns == 0);
+    assert(atomic_load(&stub.requests) == before);
+    assert(stat(config_path, &after_write) == 0);
+    assert(after_write.st_mtim.tv_sec == before_write.st_mtim.tv_sec &&
+           after_write.st_mtim.tv_nsec == before_write.st_mtim.tv_nsec);
+
+    // Only the key that changes goes out, so the restart key no longer forces a reload.
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.fps", "60") == 0);
+    assert(majestic_config_set(&txn, "video1.bitrate", "850") == 0);
+    assert(majestic_apply(&txn, &timing) == 0);
+    assert(!timing.reloaded);
+
+    wait_for_requests(before + 1);
+    assert(strcmp(stub.targets[before], "/api/v1/set?video1.bitrate=850") == 0);
+}
+
+static void test_reconnects_after_server_closes_idle_connection(void) {
+    atomic_store(&stub.close_after_response, true);
+    const int before = atomic_load(&stub.requests);
+    majestic_config_txn_t txn;
+
+    for (int i = 0; i < 2; ++i) {
+        majestic_config_begin(&txn, config_path);
+        assert(majestic_config_set(&txn, "video1.bitrate", i == 0 ? "900" : "1000") == 0);
+        assert(majestic_apply(&txn, NULL) == 0);
+        usleep(10000);
+    }
+
+    wait_for_requests(before + 2);
+    assert(atomic_load(&stub.requests) == before + 2);
+}
+
+int main(void) {
+    char directory[] = "/tmp/majestic_apply_test.XXXXXX";
+    assert(mkdtemp(directory));
+    snprintf(config_path, sizeof(config_path), "%s/majestic.yaml", directory);
+
+    stub_server_start(&server, respond, NULL);
+    write_config();
+    majestic_apply_init(config_path);
+
+    test_classifies_keys();
+    test_settable_keys();
+    test_reads_stream_settings();
+    test_runtime_keys_reuse_one_connection();
+    test_restart_keys_skip_http();
+    test_unchanged_values_skip_write_and_reload();
+    test_reconnects_after_server_closes_idle_connection();
+
+    majestic_apply_shutdown();
+    unlink(config_path);
+    rmdir(directory);
+    printf("test_majestic_apply: ok\n");
+    return 0;
+}
@@ -0,0 +1,274 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../majestic_config.h"
+
+static char config_path[256];
+
+static void write_file(const char *contents) {
+    FILE *file = fopen(config_path, "wb");
+    assert(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static const char *read_file(void) {
+    static char buffer[8192];
+    FILE *file = fopen(config_path, "rb");
+    assert(file);
+    const size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+    buffer[length] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+// Replacement files are renamed into place or removed, never left behind.
+static bool has_temporaries(void) {
+    char directory[256];
+    const char *name = strrchr(config_path, '/') + 1;
+    const size_t name_length = strlen(name);
+    bool found = false;
+
+    snprintf(directory, sizeof(directory), "%.*s", (int)(name - config_path), config_path);
+    DIR *dir = opendir(directory);
+    assert(dir);
+
+    for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+        const char *suffix = entry->d_name + name_length;
+
+        if (strncmp(entry->d_name, name, name_length) == 0 && suffix[0] == '.' && strcmp(suffix, ".link") != 0 &&
+            strcmp(suffix, ".good") != 0) {
+            found = true;
+        }
+    }
+
+    closedir(dir);
+    return found;
+}
+
+static void test_updates_existing_crop_in_place(void) {
+    write_file(
+        "# camera config\n"
+        "video0:\n"
+        "  size: 3840x2160\n"
+        "video1:\n"
+        "  crop: 0x0x1920x1080 # zoom level\n"
+        "  bitrate: 650\n");
+
+    assert(majestic_config_set_crop(config_path, "480x270x960x540") == 0);
+    assert(strcmp(read_file(),
+        "# camera config\n"
+        "video0:\n"
+        "  size: 3840x2160\n"
+        "video1:\n"
+        "  crop: 480x270x960x540 # zoom level\n"
+        "  bitrate: 650\n") == 0);
+}
+
+static void test_rewrites_tail_when_length_changes(void) {
+    write_file(
+        "video1:\n"
+        "  crop: 0x0x1920x1080\n"
+        "  bitrate: 650\n");
+
+    assert(majestic_config_set_crop(config_path, "840x472x240x135") == 0);
+    assert(majestic_config_set_crop(config_path, "0x0x96x54") == 0);
+    assert(majestic_config_set_crop(config_path, "720x405x480x270") == 0);
+    assert(strcmp(read_file(),
+        "video1:\n"
+        "  crop: 720x405x480x270\n"
+        "  bitrate: 650\n") == 0);
+}
+
+static void test_reindexes_after_external_edit(void) {
+    write_file(
+        "video1:\n"
+        "  crop: 0x0x1920x1080\n");
+    assert(majestic_config_set_crop(config_path, "480x270x960x540") == 0);
+
+    // Replace the file behind the cache's back with the key at another offset.
+    char replacement_path[300];
+    snprintf(replacement_path, sizeof(replacement_path), "%s.new", config_path);
+    FILE *file = fopen(replacement_path, "wb");
+    assert(file);
+    fputs("image:\n  flip: false\nvideo1:\n  enabled: true\n  crop: 1x1x2x2\n", file);
+    fclose(file);
+    assert(rename(replacement_path, config_path) == 0);
+
+    assert(majestic_config_set_crop(config_path, "0x0x1920x1080") == 0);
+    assert(strcmp(read_file(), "image:\n  flip: false\nvideo1:\n  enabled: true\n  crop: 0x0x1920x1080\n") == 0);
+}
+
+static void test_creates_missing_crop(void) {
+    write_file(
+        "video0:\n"
+        "  enabled: true\n");
+
+    assert(majestic_config_set_crop(config_path, "0x0x1920x1080") == 0);
+    assert(strstr(read_file(), "video1:\n  crop: 0x0x1920x1080\n") != NULL);
+    assert(strstr(read_file(), "video0:\n  enabled: true\n") != NULL);
+}
+
+static void test_commits_batch_with_one_write(void) {
+    write_file(
+        "isp:\n"
+        "  exposure: 8\n"
+        "video1:\n"
+        "  crop: 0x0x1920x1080\n"
+        "  fps: 30\n"
+        "  bitrate: 650\n");
+
+    majestic_config_txn_t txn;
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.bitrate", "1200") == 0);
+    assert(majestic_config_set(&txn, "video1.crop", "480x270x960x540") == 0);
+    assert(majestic_config_set(&txn, "isp.exposure", "16") == 0);
+    assert(majestic_config_set(&txn, "video1.fps", "25") == 0);
+    assert(majestic_config_set(&txn, "video1.fps", "60") == 0);
+    assert(txn.change_count == 4);
+    assert(majestic_config_commit(&txn) == 0);
+    assert(strcmp(read_file(),
+        "isp:\n"
+        "  exposure: 16\n"
+        "video1:\n"
+        "  crop: 480x270x960x540\n"
+        "  fps: 60\n"
+        "  bitrate: 1200\n") == 0);
+}
+
+static void test_commits_batch_with_new_sections(void) {
+    write_file(
+        "video1:\n"
+        "  crop: 0x0x1920x1080\n");
+
+    majestic_config_txn_t txn;
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.crop", "720x405x480x270") == 0);
+    assert(majestic_config_set(&txn, "isp.exposure", "8") == 0);
+    assert(majestic_config_commit(&txn) == 0);
+    assert(strstr(read_file(), "crop: 720x405x480x270\n") != NULL);
+    assert(strstr(read_file(), "isp:\n  exposure: 8\n") != NULL);
+}
+
+static void test_commits_many_new_nested_keys(void) {
+    static char stock[8192];
+    char key[MAJESTIC_CONFIG_KEY_MAX_LEN];
+    char value[16];
+    FILE *file = fopen("majestic.yaml", "rb");
+    assert(file);
+    stock[fread(stock, 1, sizeof(stock) - 1, file)] = '\0';
+    fclose(file);
+    write_file(stock);
+
+    // Each key adds a few nodes, so the DOM's node array grows (and moves)
+    // several times during the batch.
+    majestic_config_txn_t txn;
+    majestic_config_begin(&txn, config_path);
+
+    for (int i = 0; i < MAJESTIC_CONFIG_TXN_MAX_CHANGES; ++i) {
+        snprintf(key, sizeof(key), "%s.extra%d.level%d.value", i % 2 ? "video1" : "added", i / 4, i % 4);
+        snprintf(value, sizeof(value), "%d", i);
+        assert(majestic_config_set(&txn, key, value) == 0);
+    }
+
+    assert(majestic_config_commit(&txn) == 0);
+
+    const char *contents = read_file();
+
+    for (int i = 0; i < MAJESTIC_CONFIG_TXN_MAX_CHANGES; ++i) {
+        snprintf(key, sizeof(key), "level%d:\n      value: %d\n", i % 4, i);
+        assert(strstr(contents, key) != NULL);
+    }
+
+    assert(strstr(contents, "  webPort: 80\n") != NULL);
+}
+
+static void test_replaces_file_behind_symlink(void) {
+    char link_path[300];
+    struct stat info;
+
+    write_file(
+        "video1:\n"
+        "  crop: 0x0x1920x1080\n");
+
+    snprintf(link_path, sizeof(link_path), "%s.link", config_path);
+    unlink(link_path);
+    assert(symlink(config_path, link_path) == 0);
+
+    // Both update paths swap in a new file; the link keeps pointing at it.
+    assert(majestic_config_set_crop(link_path, "480x270x960x540") == 0);
+    assert(strstr(read_file(), "crop: 480x270x960x540\n") != NULL);
+    assert(majestic_config_set_crop(link_path, "480x270x960x540 # emitted") == 0);
+    assert(strstr(read_file(), "480x270x960x540 # emitted") != NULL);
+    assert(lstat(link_path, &info) == 0 && S_ISLNK(info.st_mode));
+    assert(!has_temporaries());
+
+    unlink(strcat(strcpy(link_path, config_path), ".link"));
+}
+
+static void test_restores_good_copy_behind_symlink(void) {
+    char link_path[300];
+    char good_path[300];
+    char value[32];
+    struct stat info;
+
+    write_file("video1:\n  crop: 0x0x96x54\n");
+    snprintf(link_path, sizeof(link_path), "%s.link", config_path);
+    snprintf(good_path, sizeof(good_path), "%s.good", config_path);
+    unlink(link_path);
+    assert(symlink(config_path, link_path) == 0);
+    assert(majestic_config_get(link_path, "video1.crop", value, sizeof(value)) == 0);
+
+    FILE *file = fopen(good_path, "wb");
+    assert(file);
+    fputs("video1:\n  crop: 0x0x1920x1080\n", file);
+    fclose(file);
+
+    assert(majestic_config_restore(link_path, good_path) == 0);
+    assert(strcmp(read_file(), "video1:\n  crop: 0x0x1920x1080\n") == 0);
+    assert(lstat(link_path, &info) == 0 && S_ISLNK(info.st_mode));
+    assert(!has_temporaries());
+
+    // The index follows the restored bytes, not the ones cached before.
+    assert(majestic_config_get(link_path, "video1.crop", value, sizeof(value)) == 0);
+    assert(strcmp(value, "0x0x1920x1080") == 0);
+
+    // A copy that is not YAML leaves the config alone.
+    file = fopen(good_path, "wb");
+    assert(file);
+    fputs("video1: [unterminated\n", file);
+    fclose(file);
+    assert(majestic_config_restore(link_path, good_path) == -1);
+    assert(strcmp(read_file(), "video1:\n  crop: 0x0x1920x1080\n") == 0);
+
+    unlink(good_path);
+    unlink(link_path);
+}
+
+int main(void) {
+    char directory[] = "/tmp/majestic_config_test.XXXXXX";
+    assert(mkdtemp(directory));
+    snprintf(config_path, sizeof(config_path), "%s/majestic.yaml", directory);
+
+    test_updates_existing_crop_in_place();
+    test_rewrites_tail_when_length_changes();
+    test_reindexes_after_external_edit();
+    test_creates_missing_crop();
+    test_commits_batch_with_one_write();
+    test_commits_batch_with_new_sections();
+    test_commits_many_new_nested_keys();
+    test_replaces_file_behind_symlink();
+    test_restores_good_copy_behind_symlink();
+
+    unlink(config_path);
+    rmdir(directory);
+    printf("test_majestic_config: ok\n");
+    return 0;
+}
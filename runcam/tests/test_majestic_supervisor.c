@@ -0,0 +1,178 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../majestic_supervisor.h"
+
+#define MS 1000000ULL
+
+static char directory[] = "/tmp/majestic_supervisor_test.XXXXXX";
+static char config_path[256];
+static char good_path[300];
+static char script_path[256];
+
+static void write_file(const char *path, const char *contents) {
+    FILE *file = fopen(path, "wb");
+    assert(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static bool file_holds(const char *path, const char *contents) {
+    char buffer[256];
+    FILE *file = fopen(path, "rb");
+
+    if (!file) {
+        return false;
+    }
+
+    const size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    buffer[length] = '\0';
+    return strcmp(buffer, contents) == 0;
+}
+
+static void write_script(const char *body) {
+    write_file(script_path, body);
+    assert(chmod(script_path, 0755) == 0);
+}
+
+static majestic_supervisor_config_t test_config(void) {
+    majestic_supervisor_config_t config;
+
+    majestic_supervisor_config_defaults(&config);
+    snprintf(config.command, sizeof(config.command), "%s", script_path);
+    config.stable_ms = 1000;
+    config.min_backoff_ms = 100;
+    config.max_backoff_ms = 400;
+    config.rollback_after = 2;
+    return config;
+}
+
+// Reap with a fake clock once the real child has gone.
+static void wait_for_exit(majestic_supervisor_t *supervisor, uint64_t now_ns) {
+    const struct timespec pause = { .tv_sec = 0, .tv_nsec = 5 * 1000 * 1000 };
+
+    for (int i = 0; i < 400 && supervisor->pid > 0; ++i) {
+        majestic_supervisor_reap(supervisor, now_ns);
+
+        if (supervisor->pid > 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    assert(supervisor->pid == 0);
+}
+
+static void test_crash_loop_backs_off_and_rolls_back(void) {
+    majestic_supervisor_t supervisor;
+    const majestic_supervisor_config_t config = test_config();
+
+    write_script("#!/bin/sh\nexit 3\n");
+    write_file(config_path, "bad: 1\n");
+    write_file(good_path, "good: 1\n");
+
+    assert(majestic_supervisor_init(&supervisor, &config, config_path) == 0);
+    assert(supervisor.good_saved);
+    assert(majestic_supervisor_start(&supervisor, 0) == 0);
+    assert(supervisor.pid > 0);
+
+    wait_for_exit(&supervisor, 100 * MS);
+    assert(supervisor.quick_exits == 1 && supervisor.backoff_ms == 100);
+    majestic_supervisor_tick(&supervisor, 150 * MS);
+    assert(supervisor.pid == 0);
+    majestic_supervisor_tick(&supervisor, 200 * MS);
+    assert(supervisor.pid > 0);
+    assert(supervisor.stats.last_downtime_ns == 100 * MS);
+
+    // The second quick exit in a row asks for the good config back, and
+    // Majestic stays down until the config owner has restored it.
+    wait_for_exit(&supervisor, 300 * MS);
+    assert(supervisor.backoff_ms == 200 && supervisor.rollback_pending && supervisor.stats.rollbacks == 0);
+    assert(file_holds(config_path, "bad: 1\n"));
+    majestic_supervisor_tick(&supervisor, 500 * MS);
+    assert(supervisor.pid == 0);
+
+    write_file(config_path, "good: 1\n");
+    majestic_supervisor_rollback_done(&supervisor, true);
+    assert(!supervisor.rollback_pending && supervisor.stats.rollbacks == 1);
+
+    majestic_supervisor_tick(&supervisor, 500 * MS);
+    wait_for_exit(&supervisor, 600 * MS);
+    majestic_supervisor_tick(&supervisor, 1000 * MS);
+    wait_for_exit(&supervisor, 1100 * MS);
+    assert(supervisor.backoff_ms == 400);
+    assert(supervisor.stats.rollbacks == 1 && supervisor.stats.exits == 4 && supervisor.stats.starts == 4);
+    assert(supervisor.stats.total_downtime_ns == (100 + 200 + 400) * MS);
+    assert(supervisor.stats.max_downtime_ns == 400 * MS);
+}
+
+static void test_stable_run_saves_config_and_restarts_at_once(void) {
+    majestic_supervisor_t supervisor;
+    const majestic_supervisor_config_t config = test_config();
+    char report[256];
+
+    write_script("#!/bin/sh\nexec sleep 30\n");
+    write_file(config_path, "stable: 1\n");
+    unlink(good_path);
+
+    assert(majestic_supervisor_init(&supervisor, &config, config_path) == 0);
+    assert(!supervisor.good_saved);
+    assert(majestic_supervisor_start(&supervisor, 0) == 0);
+
+    // The config must also stay unchanged for stable_ms before it counts.
+    majestic_supervisor_tick(&supervisor, 500 * MS);
+    majestic_supervisor_tick(&supervisor, 1200 * MS);
+    assert(!supervisor.good_saved);
+    majestic_supervisor_tick(&supervisor, 1500 * MS);
+    assert(supervisor.good_saved && file_holds(good_path, "stable: 1\n"));
+
+    // A crash after a healthy run restarts without any backoff.
+    assert(kill(supervisor.pid, SIGKILL) == 0);
+    wait_for_exit(&supervisor, 5000 * MS);
+    assert(supervisor.quick_exits == 0 && supervisor.restart_at_ns == 5000 * MS);
+    majestic_supervisor_tick(&supervisor, 5000 * MS);
+    assert(supervisor.pid > 0 && supervisor.stats.last_downtime_ns == 0);
+
+    const pid_t pid = supervisor.pid;
+    majestic_supervisor_stop(&supervisor);
+    assert(supervisor.pid == 0 && kill(pid, 0) != 0);
+
+    const size_t length = majestic_supervisor_format(&supervisor, report, sizeof(report));
+    assert(length > 0 && report[length - 1] == '\n');
+    assert(strstr(report, "starts=2 exits=1 rollbacks=0") != NULL);
+}
+
+static void test_failed_spawn_retries_later(void) {
+    majestic_supervisor_t supervisor;
+    majestic_supervisor_config_t config = test_config();
+
+    snprintf(config.command, sizeof(config.command), "%s/missing", directory);
+    assert(majestic_supervisor_init(&supervisor, &config, config_path) == 0);
+    assert(majestic_supervisor_start(&supervisor, 0) == -1);
+    assert(supervisor.pid == 0 && supervisor.restart_at_ns == 400 * MS);
+}
+
+int main(void) {
+    assert(mkdtemp(directory));
+    snprintf(config_path, sizeof(config_path), "%s/majestic.yaml", directory);
+    snprintf(good_path, sizeof(good_path), "%s.good", config_path);
+    snprintf(script_path, sizeof(script_path), "%s/fake_majestic", directory);
+
+    test_crash_loop_backs_off_and_rolls_back();
+    test_stable_run_saves_config_and_restarts_at_once();
+    test_failed_spawn_retries_later();
+
+    unlink(config_path);
+    unlink(good_path);
+    unlink(script_path);
+    rmdir(directory);
+    printf("test_majestic_supervisor: ok\n");
+    return 0;
+}
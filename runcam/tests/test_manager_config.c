@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../manager_config.h"
+#include "../manager_state.h"
+
+static char config_path[256];
+static char majestic_path[256];
+
+static void write_file(const char *contents) {
+    FILE *file = fopen(config_path, "wb");
+    assert(file);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void test_missing_file_uses_defaults(void) {
+    manager_config_t config;
+
+    unlink(config_path);
+    assert(manager_config_load(config_path, &config) == 0);
+    assert(strcmp(config.majestic_config_path, "/etc/majestic.yaml") == 0);
+    assert(config.majestic_flash_path[0] == '\0' && config.majestic_sync_delay_ms == 10000);
+    assert(config.zoom.max == 8.0 && config.zoom.step == 2.0);
+    assert(strcmp(config.zoom.state_path, "/tmp/majestic_manager.state") == 0);
+    assert(strcmp(config.zoom.state_flash_path, "/etc/majestic_manager.state") == 0);
+    assert(config.profile_count == 0);
+    assert(!config.probe.enabled && strcmp(config.probe.settings.path, "/stream=1") == 0);
+    assert(!config.supervisor.enabled && config.supervisor.settings.rollback_after == 3);
+    assert(!config.capture.enabled && strcmp(config.capture.settings.target, "/image.jpg") == 0);
+    assert(config.capture.settings.path[0] == '\0');
+    assert(!config.osd.enabled && config.osd.settings.region == 1 && config.osd.settings.pos_x == -1);
+    assert(config.osd.settings.interval_ms == 200 && strstr(config.osd.settings.template, "{alt}") != NULL);
+    assert(manager_config_select_profile(&config, 4.0) == -1);
+}
+
+static void test_loads_sorted_profiles(void) {
+    manager_config_t config;
+
+    write_file(
+        "majestic:\n"
+        "  config: /tmp/majestic.yaml\n"
+        "  flash: /etc/majestic.flash.yaml\n"
+        "  syncDelay: 3000\n"
+        "zoom:\n"
+        "  max: 6\n"
+        "probe:\n"
+        "  enabled: true\n"
+        "  path: /stream=1\n"
+        "  settleMs: 0\n"
+        "capture:\n"
+        "  enabled: true\n"
+        "  path: /mnt/mmcblk0p1/photos\n"
+        "  bufferSize: 1024\n"
+        "osd:\n"
+        "  enabled: true\n"
+        "  template: \"{sats} sats {speed} km/h\"\n"
+        "  region: 3\n"
+        "  posX: 10\n"
+        "  intervalMs: 10\n"
+        "profiles:\n"
+        "  - zoom: 4\n"
+        "    bitrate: 1024\n"
+        "    fps: 30\n"
+        "    minQp: 20\n"
+        "  - zoom: 1\n"
+        "    bitrate: 4096\n"
+        "    gopSize: 0.5\n"
+        "  - bitrate: 99\n");
+
+    assert(manager_config_load(config_path, &config) == 0);
+    assert(strcmp(config.majestic_config_path, "/tmp/majestic.yaml") == 0);
+    assert(strcmp(config.majestic_flash_path, "/etc/majestic.flash.yaml") == 0);
+    assert(config.majestic_sync_delay_ms == 3000);
+    assert(config.zoom.max == 6.0 && config.zoom.step == 2.0);
+    assert(config.probe.enabled && strcmp(config.probe.settings.path, "/stream=1") == 0);
+    assert(config.probe.settings.settle_ms == 0 && config.probe.settings.timeout_ms == 10000);
+    assert(config.capture.enabled && strcmp(config.capture.settings.path, "/mnt/mmcblk0p1/photos") == 0);
+    assert(config.capture.settings.buffer_size == 64 * 1024 && config.capture.settings.sync_ms == 1000);
+    assert(config.osd.enabled && strcmp(config.osd.settings.template, "{sats} sats {speed} km/h") == 0);
+    assert(config.osd.settings.region == 3 && config.osd.settings.pos_x == 10 && config.osd.settings.pos_y == -1);
+    assert(config.osd.settings.interval_ms == 50 && config.osd.settings.refresh_ms == 5000);
+    assert(config.profile_count == 2);
+
+    assert(config.profiles[0].min_zoom == 1.0);
+    assert(config.profiles[0].bitrate == 4096);
+    assert(config.profiles[0].fps == 0);
+    assert(config.profiles[0].gop_size == 0.5);
+    assert(config.profiles[0].min_qp == -1 && config.profiles[0].max_qp == -1);
+
+    assert(config.profiles[1].min_zoom == 4.0);
+    assert(config.profiles[1].bitrate == 1024 && config.profiles[1].fps == 30);
+    assert(config.profiles[1].min_qp == 20);
+
+    assert(manager_config_select_profile(&config, 1.0) == 0);
+    assert(manager_config_select_profile(&config, 3.99) == 0);
+    assert(manager_config_select_profile(&config, 4.0) == 1);
+    assert(manager_config_select_profile(&config, 6.0) == 1);
+}
+
+static void test_loads_router_endpoints(void) {
+    manager_config_t config;
+
+    write_file(
+        "router:\n"
+        "  endpoints:\n"
+        "    - name: fc\n"
+        "      udp: 192.168.1.254:14550\n"
+        "      mode: server\n"
+        "    - udp: 192.168.1.149:14550\n"
+        "    - name: uart\n"
+        "      serial: /dev/ttyS3\n"
+        "      baud: 115200\n"
+        "    - name: bad\n"
+        "      udp: gcs.local:14550\n");
+
+    assert(manager_config_load(config_path, &config) == 0);
+    assert(config.router.endpoint_count == 3);
+
+    assert(strcmp(config.router.endpoints[0].name, "fc") == 0);
+    assert(config.router.endpoints[0].type == MAVLINK_ROUTER_UDP_SERVER);
+    assert(strcmp(config.router.endpoints[0].address, "192.168.1.254") == 0);
+    assert(config.router.endpoints[0].port == 14550);
+
+    assert(strcmp(config.router.endpoints[1].name, "endpoint1") == 0);
+    assert(config.router.endpoints[1].type == MAVLINK_ROUTER_UDP_CLIENT);
+
+    assert(config.router.endpoints[2].type == MAVLINK_ROUTER_SERIAL);
+    assert(strcmp(config.router.endpoints[2].address, "/dev/ttyS3") == 0);
+    assert(config.router.endpoints[2].baud == 115200);
+}
+
+static void test_loads_commands(void) {
+    manager_config_t config;
+
+    write_file(
+        "commands:\n"
+        "  night_mode:\n"
+        "    image.saturation: 0\n"
+        "    isp.exposure: $1\n"
+        "  zoom_in:\n"
+        "    image.contrast: 50\n"
+        "  broken: 5\n");
+
+    assert(manager_config_load(config_path, &config) == 0);
+
+    const command_t *night = command_registry_find(&config.commands, "night_mode");
+    assert(night && night->kind == COMMAND_CHANGES);
+    assert(night->change_count == 2 && night->min_args == 1);
+    assert(strcmp(night->changes[1].key, "isp.exposure") == 0);
+    assert(strcmp(night->changes[1].value, "$1") == 0);
+
+    // Built-ins cannot be redefined and malformed entries are skipped.
+    assert(command_registry_find(&config.commands, "zoom_in")->kind == COMMAND_ZOOM_IN);
+    assert(command_registry_find(&config.commands, "broken") == NULL);
+}
+
+static void test_state_round_trip(void) {
+    manager_state_t state = { .zoom = 4.0 };
+    manager_state_t loaded = { .zoom = 1.0 };
+    char temp_path[300];
+
+    unlink(config_path);
+    assert(manager_state_load(config_path, &loaded) == -1);
+    assert(loaded.zoom == 1.0);
+
+    assert(manager_state_save(config_path, &state) == 0);
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", config_path);
+    assert(access(temp_path, F_OK) != 0);
+    assert(manager_state_load(config_path, &loaded) == 0);
+    assert(loaded.zoom == 4.0 && !loaded.has_baseline);
+
+    // The profile baseline rides along once there is one.
+    state.has_baseline = true;
+    state.baseline = (encoder_profile_t){ .bitrate = 650, .fps = 30, .gop_size = 0.5, .min_qp = -1, .max_qp = 48 };
+    assert(manager_state_save(config_path, &state) == 0);
+    assert(manager_state_load(config_path, &loaded) == 0);
+    assert(manager_state_equal(&loaded, &state));
+
+    // A torn or foreign file keeps whatever the caller had.
+    write_file("zoom: \n");
+    loaded.zoom = 2.0;
+    assert(manager_state_load(config_path, &loaded) == -1);
+    assert(loaded.zoom == 2.0);
+}
+
+static void commit_zoom(const manager_config_t *config, const encoder_profile_t *baseline, double zoom) {
+    encoder_profile_t resolved;
+    majestic_config_txn_t txn;
+
+    manager_config_resolve_profile(config, manager_config_select_profile(config, zoom), baseline, &resolved);
+    majestic_config_begin(&txn, majestic_path);
+    assert(manager_config_stage_profile(&txn, &resolved) == 0);
+    assert(majestic_config_commit(&txn) == 0);
+}
+
+static void expect_video1(const char *key, const char *expected) {
+    char value[64];
+
+    assert(majestic_config_get(majestic_path, key, value, sizeof(value)) == 0);
+    assert(strcmp(value, expected) == 0);
+}
+
+static void test_profiles_return_to_the_baseline(void) {
+    manager_config_t config;
+    encoder_profile_t baseline;
+    FILE *file = fopen(majestic_path, "wb");
+
+    assert(file);
+    fputs("video1:\n  enabled: true\n  bitrate: 650\n  fps: 30\n  gopSize: 0.5\n  minQp: 32\n  maxQp: 48\n", file);
+    fclose(file);
+
+    write_file(
+        "profiles:\n"
+        "  - zoom: 1\n"
+        "    bitrate: 4096\n"
+        "  - zoom: 4\n"
+        "    bitrate: 1024\n"
+        "    gopSize: 2\n"
+        "    minQp: 20\n"
+        "    maxQp: 45\n");
+    assert(manager_config_load(config_path, &config) == 0);
+    assert(manager_config_read_baseline(majestic_path, &baseline) == 0);
+    assert(baseline.bitrate == 650 && baseline.fps == 30 && baseline.gop_size == 0.5);
+    assert(baseline.min_qp == 32 && baseline.max_qp == 48);
+
+    commit_zoom(&config, &baseline, 1.0);
+    commit_zoom(&config, &baseline, 4.0);
+    expect_video1("video1.minQp", "20");
+    expect_video1("video1.gopSize", "2");
+
+    // Back at 1x, every key the 1x profile omits is Majestic's original again.
+    commit_zoom(&config, &baseline, 1.0);
+    expect_video1("video1.bitrate", "4096");
+    expect_video1("video1.fps", "30");
+    expect_video1("video1.gopSize", "0.5");
+    expect_video1("video1.minQp", "32");
+    expect_video1("video1.maxQp", "48");
+
+    // Below the first profile the baseline applies in full.
+    commit_zoom(&config, &baseline, 0.5);
+    expect_video1("video1.bitrate", "650");
+
+    unlink(majestic_path);
+}
+
+int main(void) {
+    char directory[] = "/tmp/manager_config_test.XXXXXX";
+    assert(mkdtemp(directory));
+    snprintf(config_path, sizeof(config_path), "%s/majestic_manager.yaml", directory);
+    snprintf(majestic_path, sizeof(majestic_path), "%s/majestic.yaml", directory);
+
+    test_missing_file_uses_defaults();
+    test_loads_sorted_profiles();
+    test_loads_router_endpoints();
+    test_loads_commands();
+    test_profiles_return_to_the_baseline();
+    test_state_round_trip();
+
+    unlink(config_path);
+    rmdir(directory);
+    printf("test_manager_config: ok\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../matek_mavlink.h"
+
+static int master_fd = -1;
+static char slave_path[128];
+static matek_statustext_t last_statustext;
+static int statustext_count;
+static int hook_pending = -1;
+static uint8_t captured[512];
+static size_t captured_length;
+static int captured_chunks;
+
+static void open_pty(void) {
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    assert(master_fd >= 0);
+    assert(grantpt(master_fd) == 0 && unlockpt(master_fd) == 0);
+    snprintf(slave_path, sizeof(slave_path), "%s", ptsname(master_fd));
+}
+
+static void handle_statustext(const mavlink_message_t *message, void *context) {
+    (void)context;
+    matek_decode_statustext(message, &last_statustext);
+    ++statustext_count;
+}
+
+static void record_output(int fd, bool pending, void *context) {
+    (void)fd;
+    (void)context;
+    hook_pending = pending ? 1 : 0;
+}
+
+static void capture_chunk(const uint8_t *data, size_t length, uint64_t received_ns, void *context) {
+    (void)context;
+    assert(received_ns > 0);
+    assert(captured_length + length <= sizeof(captured));
+    memcpy(captured + captured_length, data, length);
+    captured_length += length;
+    ++captured_chunks;
+}
+
+static void test_configures_requested_baud(void) {
+    struct termios tty;
+
+    const int fd = open_matek_device(slave_path, 921600);
+    assert(fd >= 0);
+    assert(tcgetattr(fd, &tty) == 0);
+    assert(cfgetospeed(&tty) == B921600);
+    assert(tty.c_cc[VMIN] == 1 && tty.c_cc[VTIME] == 0);
+    assert(fcntl(fd, F_GETFL) & O_NONBLOCK);
+    close(fd);
+
+    assert(open_matek_device(slave_path, 12345) == -1);
+}
+
+static void test_receives_frames_written_to_master(void) {
+    mavlink_message_t message;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+
+    const int fd = open_matek_device(slave_path, 1500000);
+    assert(fd >= 0);
+    matek_set_receive_hook(capture_chunk, NULL);
+
+    mavlink_msg_statustext_pack(1, 1, &message, MAV_SEVERITY_INFO, "zoom_in", 0, 0);
+    const uint16_t length = mavlink_msg_to_send_buffer(buffer, &message);
+
+    // Split the frame across two reads; the tail must complete it.
+    assert(write(master_fd, buffer, 7) == 7);
+    usleep(20000);
+    assert(matek_receive(fd) == 0);
+    assert(write(master_fd, buffer + 7, length - 7) == (ssize_t)(length - 7));
+    usleep(20000);
+    assert(matek_receive(fd) == 1);
+    assert(statustext_count == 1);
+    assert(strcmp(last_statustext.text, "zoom_in") == 0);
+
+    // The receive hook saw exactly the raw bytes, one chunk per read.
+    assert(captured_chunks == 2);
+    assert(captured_length == length && memcmp(captured, buffer, length) == 0);
+    matek_set_receive_hook(NULL, NULL);
+    close(fd);
+}
+
+// Fill the pty until writes would block: the rest must queue in order and
+// go out once the other end drains.
+static void test_queues_output_when_link_is_busy(void) {
+    mavlink_message_t message;
+    uint8_t received[65536];
+    size_t received_length = 0;
+    int sent = 0;
+
+    const int fd = open_matek_device(slave_path, 921600);
+    assert(fd >= 0);
+    matek_set_output_hook(record_output, NULL);
+
+    while (!matek_output_pending() && sent < 4000) {
+        mavlink_msg_statustext_pack(2, 100, &message, MAV_SEVERITY_DEBUG, "burst", (uint16_t)sent, 0);
+        assert(matek_send_message(fd, &message) == 0);
+        ++sent;
+    }
+
+    assert(matek_output_pending());
+    assert(hook_pending == 1);
+
+    // A few more go behind the queued bytes.
+    for (int i = 0; i < 5; ++i, ++sent) {
+        mavlink_msg_statustext_pack(2, 100, &message, MAV_SEVERITY_DEBUG, "burst", (uint16_t)sent, 0);
+        assert(matek_send_message(fd, &message) == 0);
+    }
+
+    while (matek_output_pending() || received_length == 0) {
+        const ssize_t n = read(master_fd, received + received_length, sizeof(received) - received_length);
+
+        if (n > 0) {
+            received_length += (size_t)n;
+        } else {
+            assert(n < 0 && errno == EAGAIN);
+        }
+
+        assert(matek_flush(fd) == 0);
+    }
+
+    for (;;) {
+        struct pollfd poll_fd = { .fd = master_fd, .events = POLLIN, .revents = 0 };
+
+        if (poll(&poll_fd, 1, 50) <= 0) {
+            break;
+        }
+
+        const ssize_t n = read(master_fd, received + received_length, sizeof(received) - received_length);
+
+        if (n <= 0) {
+            break;
+        }
+
+        received_length += (size_t)n;
+    }
+
+    assert(hook_pending == 0);
+
+    // Every message arrives exactly once and in order.
+    mavlink_status_t status;
+    memset(&status, 0, sizeof(status));
+    int expected_id = 0;
+
+    for (size_t i = 0; i < received_length; ++i) {
+        if (mavlink_parse_char(MAVLINK_COMM_3, received[i], &message, &status)) {
+            assert(mavlink_msg_statustext_get_id(&message) == expected_id);
+            ++expected_id;
+        }
+    }
+
+    assert(expected_id == sent);
+    matek_set_output_hook(NULL, NULL);
+    close(fd);
+}
+
+int main(void) {
+    open_pty();
+    assert(matek_register_handler(MAVLINK_MSG_ID_STATUSTEXT, handle_statustext, NULL) == 0);
+
+    test_configures_requested_baud();
+    test_receives_frames_written_to_master();
+    test_queues_output_when_link_is_busy();
+
+    close(master_fd);
+    printf("test_matek_serial: ok\n");
+    return 0;
+}
@@ -0,0 +1,212 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../mavlink_router.h"
+
+// Endpoint order inside the router.
+enum { VEHICLE_LINK, GCS1_LINK, GCS2_LINK };
+
+static mavlink_router_t router;
+static int vehicle_fd;
+static int gcs1_fd;
+static int gcs2_fd;
+
+static uint16_t bound_port(int fd) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    assert(getsockname(fd, (struct sockaddr *)&address, &length) == 0);
+    return ntohs(address.sin_port);
+}
+
+static int open_loopback_socket(void) {
+    const struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0
+    };
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    assert(fd >= 0);
+    assert(bind(fd, (const struct sockaddr *)&address, sizeof(address)) == 0);
+    return fd;
+}
+
+static void send_to(int fd, uint16_t port, const uint8_t *data, size_t length) {
+    const struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = htons(port)
+    };
+
+    assert(sendto(fd, data, length, 0, (const struct sockaddr *)&address, sizeof(address)) == (ssize_t)length);
+}
+
+static size_t pack(const mavlink_message_t *message, uint8_t *buffer) {
+    return mavlink_msg_to_send_buffer(buffer, message);
+}
+
+static size_t heartbeat(uint8_t sysid, uint8_t compid, uint8_t *buffer) {
+    mavlink_message_t message;
+
+    mavlink_msg_heartbeat_pack(sysid, compid, &message, MAV_TYPE_FIXED_WING, MAV_AUTOPILOT_ARDUPILOTMEGA, 0, 0, 0);
+    return pack(&message, buffer);
+}
+
+// Datagram received within `timeout_ms`, or 0 bytes.
+static ssize_t receive(int fd, uint8_t *buffer, size_t size, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return 0;
+    }
+
+    return recv(fd, buffer, size, 0);
+}
+
+static void expect_datagram(int fd, const uint8_t *data, size_t length) {
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+
+    assert(receive(fd, buffer, sizeof(buffer), 500) == (ssize_t)length);
+    assert(memcmp(buffer, data, length) == 0);
+}
+
+static void expect_nothing(int fd) {
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+
+    assert(receive(fd, buffer, sizeof(buffer), 50) == 0);
+}
+
+static void service(size_t index, int expected_frames) {
+    struct pollfd pfd = { .fd = router.endpoints[index].fd, .events = POLLIN, .revents = 0 };
+
+    assert(poll(&pfd, 1, 500) == 1);
+    assert(mavlink_router_service(&router, index) == expected_frames);
+}
+
+static void setup(void) {
+    // Reserve a port for the vehicle-facing server endpoint.
+    const int probe = open_loopback_socket();
+    const uint16_t server_port = bound_port(probe);
+    close(probe);
+
+    vehicle_fd = open_loopback_socket();
+    gcs1_fd = open_loopback_socket();
+    gcs2_fd = open_loopback_socket();
+
+    mavlink_router_endpoint_config_t configs[3] = {
+        { .name = "vehicle", .type = MAVLINK_ROUTER_UDP_SERVER, .address = "127.0.0.1", .port = server_port },
+        { .name = "gcs1", .type = MAVLINK_ROUTER_UDP_CLIENT, .address = "127.0.0.1", .port = bound_port(gcs1_fd) },
+        { .name = "gcs2", .type = MAVLINK_ROUTER_UDP_CLIENT, .address = "127.0.0.1", .port = bound_port(gcs2_fd) }
+    };
+
+    assert(mavlink_router_open(&router, configs, 3) == 0);
+    assert(router.endpoint_count == 3);
+}
+
+static void test_fans_out_vehicle_telemetry(void) {
+    uint8_t datagram[2 * MAVLINK_MAX_PACKET_LEN];
+    uint8_t first[MAVLINK_MAX_PACKET_LEN];
+    uint8_t second[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t message;
+
+    const size_t first_length = heartbeat(1, 1, first);
+    mavlink_msg_sys_status_pack(1, 1, &message, 0, 0, 0, 500, 12000, -1, 90, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const size_t second_length = pack(&message, second);
+
+    // Two frames in one datagram leave as two datagrams on every output.
+    memcpy(datagram, first, first_length);
+    memcpy(datagram + first_length, second, second_length);
+    send_to(vehicle_fd, router.endpoints[VEHICLE_LINK].config.port, datagram, first_length + second_length);
+    service(VEHICLE_LINK, 2);
+
+    expect_datagram(gcs1_fd, first, first_length);
+    expect_datagram(gcs1_fd, second, second_length);
+    expect_datagram(gcs2_fd, first, first_length);
+    expect_datagram(gcs2_fd, second, second_length);
+    expect_nothing(vehicle_fd);
+}
+
+static void test_learns_routes_for_targeted_messages(void) {
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t message;
+
+    // Each GCS announces itself; the heartbeat of one reaches the vehicle
+    // (now a known peer of the server endpoint) and the other GCS.
+    size_t length = heartbeat(255, 190, frame);
+    send_to(gcs1_fd, bound_port(router.endpoints[GCS1_LINK].fd), frame, length);
+    service(GCS1_LINK, 1);
+    expect_datagram(vehicle_fd, frame, length);
+    expect_datagram(gcs2_fd, frame, length);
+
+    length = heartbeat(254, 190, frame);
+    send_to(gcs2_fd, bound_port(router.endpoints[GCS2_LINK].fd), frame, length);
+    service(GCS2_LINK, 1);
+    expect_datagram(vehicle_fd, frame, length);
+    expect_datagram(gcs1_fd, frame, length);
+
+    // A command for the vehicle goes to the vehicle only...
+    mavlink_msg_command_long_pack(254, 190, &message, 1, 1, MAV_CMD_DO_SET_MODE, 0, 1, 0, 0, 0, 0, 0, 0);
+    length = pack(&message, frame);
+    send_to(gcs2_fd, bound_port(router.endpoints[GCS2_LINK].fd), frame, length);
+    service(GCS2_LINK, 1);
+    expect_datagram(vehicle_fd, frame, length);
+    expect_nothing(gcs1_fd);
+
+    // ...and its acknowledgement only to the GCS that asked.
+    mavlink_msg_command_ack_pack(1, 1, &message, MAV_CMD_DO_SET_MODE, MAV_RESULT_ACCEPTED, 0, 0, 254, 190);
+    length = pack(&message, frame);
+    send_to(vehicle_fd, router.endpoints[VEHICLE_LINK].config.port, frame, length);
+    service(VEHICLE_LINK, 1);
+    expect_datagram(gcs2_fd, frame, length);
+    expect_nothing(gcs1_fd);
+
+    assert(router.route_count == 3);
+}
+
+static void test_forwards_unknown_ids_and_drops_corrupt_frames(void) {
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    const size_t length = heartbeat(1, 1, frame);
+    const uint64_t crc_errors = router.scanner.stats.crc_errors;
+
+    // An id outside this dialect cannot be CRC-checked, so it is passed on.
+    frame[7] = 150;
+    send_to(vehicle_fd, router.endpoints[VEHICLE_LINK].config.port, frame, length);
+    service(VEHICLE_LINK, 1);
+    expect_datagram(gcs1_fd, frame, length);
+    expect_datagram(gcs2_fd, frame, length);
+
+    // A known id with a bad CRC is not.
+    frame[7] = MAVLINK_MSG_ID_HEARTBEAT;
+    frame[12] ^= 0xFF;
+    send_to(vehicle_fd, router.endpoints[VEHICLE_LINK].config.port, frame, length);
+    service(VEHICLE_LINK, 0);
+    expect_nothing(gcs1_fd);
+    assert(router.scanner.stats.crc_errors > crc_errors);
+}
+
+int main(void) {
+    setup();
+
+    test_fans_out_vehicle_telemetry();
+    test_learns_routes_for_targeted_messages();
+    test_forwards_unknown_ids_and_drops_corrupt_frames();
+
+    assert(router.endpoints[VEHICLE_LINK].stats.rx_frames == 4);
+    assert(router.endpoints[GCS1_LINK].stats.tx_frames == 4);
+
+    mavlink_router_close(&router);
+    close(vehicle_fd);
+    close(gcs1_fd);
+    close(gcs2_fd);
+    printf("test_mavlink_router: ok\n");
+    return 0;
+}
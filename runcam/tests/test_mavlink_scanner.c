@@ -0,0 +1,169 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../mavlink_scanner.h"
+
+#define MAX_MESSAGES 64
+
+static uint8_t stream[8192];
+static size_t stream_length;
+
+typedef struct delivered {
+    mavlink_message_t messages[MAX_MESSAGES];
+    size_t count;
+} delivered_t;
+
+static void append_bytes(const uint8_t *data, size_t length) {
+    assert(stream_length + length <= sizeof(stream));
+    memcpy(stream + stream_length, data, length);
+    stream_length += length;
+}
+
+static void append(const mavlink_message_t *message) {
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    append_bytes(buffer, mavlink_msg_to_send_buffer(buffer, message));
+}
+
+static bool wants_statustext(uint32_t msgid, void *context) {
+    (void)context;
+    return msgid == MAVLINK_MSG_ID_STATUSTEXT || msgid == MAVLINK_MSG_ID_COMMAND_LONG;
+}
+
+static void record(const mavlink_message_t *message, void *context) {
+    delivered_t *delivered = context;
+
+    assert(delivered->count < MAX_MESSAGES);
+    delivered->messages[delivered->count++] = *message;
+}
+
+// Telemetry, line noise (including a stray magic byte), a corrupted frame, a
+// MAVLink 1 frame and the messages we subscribe to.
+static void build_stream(void) {
+    static const uint8_t noise[] = { 0x00, 0x13, 0xFD, 0x13, 0x80, 0x55, 0x21, 0x42 };
+    mavlink_message_t message;
+
+    stream_length = 0;
+    append_bytes(noise, sizeof(noise));
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        mavlink_msg_attitude_pack(1, 1, &message, i, 0.1f, 0.2f, 0.3f, 0.0f, 0.0f, 0.0f);
+        append(&message);
+        mavlink_msg_statustext_pack(1, 1, &message, MAV_SEVERITY_INFO, i % 2 ? "zoom_in" : "zoom_out", 0, 0);
+        append(&message);
+    }
+
+    mavlink_msg_statustext_pack(1, 1, &message, MAV_SEVERITY_INFO, "corrupted", 0, 0);
+    const size_t corrupt_at = stream_length;
+    append(&message);
+    stream[corrupt_at + MAVLINK_NUM_HEADER_BYTES + 2] ^= 0x40;
+
+    mavlink_get_channel_status(MAVLINK_COMM_2)->flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+    mavlink_msg_command_long_pack_chan(255, 190, MAVLINK_COMM_2, &message, 2, 100, MAV_CMD_SET_CAMERA_ZOOM,
+                                       0, ZOOM_TYPE_STEP, 1, 0, 0, 0, 0, 0);
+    append(&message);
+
+    append_bytes(noise, sizeof(noise));
+    mavlink_msg_statustext_pack(1, 1, &message, MAV_SEVERITY_WARNING, "last", 0, 0);
+    append(&message);
+}
+
+// Reference: what the stock byte-at-a-time parser delivers for wanted ids.
+static void parse_stock(delivered_t *delivered) {
+    mavlink_status_t status;
+    mavlink_message_t message;
+
+    memset(&status, 0, sizeof(status));
+    memset(delivered, 0, sizeof(*delivered));
+
+    for (size_t i = 0; i < stream_length; ++i) {
+        if (mavlink_parse_char(MAVLINK_COMM_1, stream[i], &message, &status) &&
+            wants_statustext(message.msgid, NULL)) {
+            record(&message, delivered);
+        }
+    }
+}
+
+// Feed the stream in `chunk`-byte reads, carrying incomplete frames over.
+static void parse_scanner(size_t chunk, delivered_t *delivered, mavlink_scanner_stats_t *stats) {
+    uint8_t pending[2 * MAVLINK_MAX_PACKET_LEN + 64];
+    size_t pending_length = 0;
+    mavlink_scanner_t scanner;
+
+    memset(delivered, 0, sizeof(*delivered));
+    mavlink_scanner_init(&scanner, wants_statustext, record, delivered);
+
+    for (size_t offset = 0; offset < stream_length; offset += chunk) {
+        const size_t length = stream_length - offset < chunk ? stream_length - offset : chunk;
+
+        assert(pending_length + length <= sizeof(pending));
+        memcpy(pending + pending_length, stream + offset, length);
+        pending_length += length;
+
+        const size_t consumed = mavlink_scanner_feed(&scanner, pending, pending_length);
+        memmove(pending, pending + consumed, pending_length - consumed);
+        pending_length -= consumed;
+    }
+
+    *stats = scanner.stats;
+}
+
+static void assert_same(const delivered_t *expected, const delivered_t *actual) {
+    assert(actual->count == expected->count);
+
+    for (size_t i = 0; i < expected->count; ++i) {
+        const mavlink_message_t *a = &expected->messages[i];
+        const mavlink_message_t *b = &actual->messages[i];
+
+        assert(a->msgid == b->msgid && a->len == b->len && a->magic == b->magic);
+        assert(a->sysid == b->sysid && a->compid == b->compid && a->seq == b->seq);
+        assert(memcmp(_MAV_PAYLOAD(a), _MAV_PAYLOAD(b), a->len) == 0);
+    }
+}
+
+static void test_matches_stock_parser_for_any_read_size(void) {
+    delivered_t expected;
+    delivered_t actual;
+    mavlink_scanner_stats_t stats;
+
+    build_stream();
+    parse_stock(&expected);
+    assert(expected.count == 10); // 8 statustexts, the v1 command, "last"
+    assert(expected.messages[8].magic == MAVLINK_STX_MAVLINK1);
+
+    for (size_t chunk = 1; chunk <= 300; chunk += chunk < 16 ? 1 : 37) {
+        parse_scanner(chunk, &actual, &stats);
+        assert_same(&expected, &actual);
+        assert(stats.frames_dispatched == expected.count);
+        assert(stats.frames_skipped >= 8);
+        assert(stats.crc_errors >= 1);
+    }
+}
+
+static void test_keeps_incomplete_frame(void) {
+    mavlink_message_t message;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    delivered_t delivered;
+    mavlink_scanner_t scanner;
+
+    memset(&delivered, 0, sizeof(delivered));
+    mavlink_scanner_init(&scanner, wants_statustext, record, &delivered);
+    mavlink_msg_statustext_pack(1, 1, &message, MAV_SEVERITY_INFO, "zoom_in", 0, 0);
+
+    const uint16_t length = mavlink_msg_to_send_buffer(buffer, &message);
+
+    assert(mavlink_scanner_feed(&scanner, buffer, length - 1) == 0);
+    assert(delivered.count == 0);
+    assert(mavlink_scanner_feed(&scanner, buffer, length) == length);
+    assert(delivered.count == 1);
+}
+
+int main(void) {
+    test_matches_stock_parser_for_any_read_size();
+    test_keeps_incomplete_frame();
+
+    printf("test_mavlink_scanner: ok\n");
+    return 0;
+}
@@ -0,0 +1,232 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../osd_feed.h"
+#include "stub_server.h"
+
+#define MS 1000000ULL
+
+// Minimal stand-in for Majestic's web server that remembers the last OSD
+// request it answered.
+static struct {
+    atomic_int requests;
+    atomic_int delay_ms;  // per response, to make the sender fall behind
+    atomic_bool failing;  // answer 500
+    pthread_mutex_t lock;
+    char last_target[1024];
+} stub = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static stub_server_t server;
+static char directory[] = "/tmp/osd_feed_test.XXXXXX";
+static char config_path[256];
+
+static void sleep_ms(long ms) {
+    const struct timespec delay = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L };
+    nanosleep(&delay, NULL);
+}
+
+static bool respond(int fd, const char *request, void *context) {
+    const char *ok = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    const char *error = "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+    const char *reply = atomic_load(&stub.failing) ? error : ok;
+    (void)context;
+
+    sleep_ms(atomic_load(&stub.delay_ms));
+    pthread_mutex_lock(&stub.lock);
+    sscanf(request, "GET %1023s", stub.last_target);
+    pthread_mutex_unlock(&stub.lock);
+    atomic_fetch_add(&stub.requests, 1);
+    (void)send(fd, reply, strlen(reply), MSG_NOSIGNAL);
+    return true;
+}
+
+static void last_target(char *out, size_t out_size) {
+    pthread_mutex_lock(&stub.lock);
+    snprintf(out, out_size, "%s", stub.last_target);
+    pthread_mutex_unlock(&stub.lock);
+}
+
+// Wait until the stub has answered `count` requests in total.
+static void wait_for_requests(int count) {
+    for (int i = 0; i < 200 && atomic_load(&stub.requests) < count; ++i) {
+        sleep_ms(5);
+    }
+
+    assert(atomic_load(&stub.requests) >= count);
+}
+
+static void send_altitude(int32_t relative_alt_mm) {
+    mavlink_message_t message;
+
+    mavlink_msg_global_position_int_pack(1, 1, &message, 0, 473977419, 85455000, 500000, relative_alt_mm, 0, 0, 0, 0);
+    osd_feed_handle_message(&message, NULL);
+}
+
+static void test_render(void) {
+    osd_telemetry_t telemetry = { .battery = -1 };
+    char text[OSD_FEED_TEXT_MAX];
+
+    osd_feed_render("ALT {alt}m SPD {speed} BAT {volt}V {bat}%% {fix}/{sats} {unknown} {lat}", &telemetry, text,
+                    sizeof(text));
+    assert(strcmp(text, "ALT --m SPD -- BAT --V --%% --/-- {unknown} --") == 0);
+
+    telemetry = (osd_telemetry_t){
+        .has_altitude = true, .altitude_m = -0.4f,
+        .has_speed = true, .speed_ms = 12.5f,
+        .has_voltage = true, .voltage = 16.04f, .battery = 87,
+        .has_gps = true, .fix_type = 3, .satellites = 14,
+        .has_position = true, .lat = 473977419, .lon = -1220000000
+    };
+    osd_feed_render("ALT {alt}m SPD {speed} BAT {volt}V {bat}%% {fix}/{sats} {lat},{lon}", &telemetry, text,
+                    sizeof(text));
+    assert(strcmp(text, "ALT 0m SPD 45 BAT 16.0V 87%% 3D/14 47.39774,-122.00000") == 0);
+
+    // Truncated to the buffer, placeholders included.
+    assert(osd_feed_render("SPD {speed}", &telemetry, text, 7) == 6 && strcmp(text, "SPD 45") == 0);
+    assert(osd_feed_render("SPD {speed}", &telemetry, text, 6) == 5 && strcmp(text, "SPD 4") == 0);
+}
+
+static void test_messages_fill_the_telemetry(void) {
+    mavlink_message_t message;
+    char target[1024];
+
+    mavlink_msg_vfr_hud_pack(1, 1, &message, 20.0f, 10.0f, 90, 50, 100.0f, 0.0f);
+    osd_feed_handle_message(&message, NULL);
+    mavlink_msg_sys_status_pack(1, 1, &message, 0, 0, 0, 0, 15800, -1, 64, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    osd_feed_handle_message(&message, NULL);
+    mavlink_msg_gps_raw_int_pack(1, 1, &message, 0, 3, 0, 0, 0, 0, 0, 0, 0, 11, 0, 0, 0, 0, 0, 0);
+    osd_feed_handle_message(&message, NULL);
+    send_altitude(120400);
+
+    const int before = atomic_load(&stub.requests);
+    assert(osd_feed_tick(10000 * MS));
+    wait_for_requests(before + 1);
+
+    last_target(target, sizeof(target));
+    assert(strcmp(target, "/api/osd/2?posx=16&posy=40&text=ALT%20120m%20SPD%2036km%2Fh%20BAT%2015.8V%2064%25%25%20SAT%2011") == 0);
+}
+
+static void test_only_changes_are_sent(void) {
+    osd_feed_stats_t stats;
+
+    // Below the shown precision the text does not change.
+    send_altitude(120300);
+    assert(!osd_feed_tick(10200 * MS));
+    send_altitude(121000);
+    assert(osd_feed_tick(10400 * MS));
+
+    // Unchanged text is still refreshed, for a Majestic that restarted.
+    assert(!osd_feed_tick(10600 * MS));
+    assert(osd_feed_tick(11400 * MS));
+
+    osd_feed_get_stats(&stats);
+    assert(stats.unchanged == 2);
+}
+
+static void test_slow_majestic_gets_the_latest_text(void) {
+    osd_feed_stats_t before;
+    osd_feed_stats_t after;
+    char target[1024];
+
+    sleep_ms(50); // let the refresh above go out first
+    osd_feed_get_stats(&before);
+    atomic_store(&stub.delay_ms, 60);
+
+    // Ticks far faster than Majestic answers: texts queued while a request is
+    // in flight collapse into one.
+    uint64_t now_ns = 20000 * MS;
+
+    for (int32_t altitude = 200; altitude < 220; ++altitude) {
+        send_altitude(altitude * 1000);
+
+        if (!osd_feed_tick(now_ns)) {
+            sleep_ms(20); // queue full: the sender is behind
+        }
+
+        now_ns += 200 * MS;
+        sleep_ms(5);
+    }
+
+    send_altitude(250000);
+
+    while (!osd_feed_tick(now_ns)) {
+        sleep_ms(10);
+    }
+
+    sleep_ms(300);
+    atomic_store(&stub.delay_ms, 0);
+
+    osd_feed_get_stats(&after);
+    last_target(target, sizeof(target));
+    assert(strstr(target, "ALT%20250m") != NULL);
+    assert(after.coalesced > before.coalesced);
+    assert(after.sent - before.sent < after.queued - before.queued);
+    printf("queued %u, sent %u, coalesced %u\n", after.queued - before.queued, after.sent - before.sent,
+           after.coalesced - before.coalesced);
+}
+
+static void test_failed_push_is_retried(void) {
+    osd_feed_stats_t stats;
+    char report[128];
+
+    int requests = atomic_load(&stub.requests);
+
+    atomic_store(&stub.failing, true);
+    send_altitude(300000);
+    assert(osd_feed_tick(30000 * MS));
+    wait_for_requests(requests + 1);
+    sleep_ms(20);
+
+    // Same text, no refresh due, but the last push failed.
+    requests = atomic_load(&stub.requests);
+    atomic_store(&stub.failing, false);
+    assert(osd_feed_tick(30200 * MS));
+    wait_for_requests(requests + 1);
+    sleep_ms(20);
+    assert(!osd_feed_tick(30400 * MS));
+
+    osd_feed_get_stats(&stats);
+    assert(stats.failed == 1);
+
+    const size_t length = osd_feed_format(report, sizeof(report));
+    assert(length > 0 && report[length - 1] == '\n' && strstr(report, "failed=1") != NULL);
+}
+
+int main(void) {
+    osd_feed_config_t config;
+
+    assert(mkdtemp(directory));
+    stub_server_start(&server, respond, NULL);
+    test_render();
+
+    snprintf(config_path, sizeof(config_path), "%s/majestic.yaml", directory);
+    FILE *file = fopen(config_path, "wb");
+    assert(file);
+    fprintf(file, "system:\n  webPort: %u\n", server.port);
+    fclose(file);
+
+    osd_feed_config_defaults(&config);
+    config.region = 2;
+    config.pos_x = 16;
+    config.pos_y = 40;
+    config.refresh_ms = 1000;
+    assert(osd_feed_start(&config, config_path) == 0);
+
+    test_messages_fill_the_telemetry();
+    test_only_changes_are_sent();
+    test_slow_majestic_gets_the_latest_text();
+    test_failed_push_is_retried();
+    osd_feed_stop();
+
+    unlink(config_path);
+    rmdir(directory);
+    printf("test_osd_feed: ok\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../latency_trace.h"
+#include "../stream_probe.h"
+#include "stub_server.h"
+
+typedef enum stub_mode {
+    STUB_SERVING,     // OPTIONS and DESCRIBE answered, SDP with a video track
+    STUB_UNAVAILABLE, // DESCRIBE answered 503, as while the pipeline restarts
+    STUB_NO_VIDEO,    // SDP without a video track
+    STUB_SILENT       // connections accepted but never answered
+} stub_mode_t;
+
+// Minimal stand-in for Majestic's RTSP server.
+static struct {
+    atomic_int mode;
+    atomic_int describes;
+} stub;
+static stub_server_t server;
+
+static bool respond(int fd, const char *request, void *context) {
+    static const char SDP[] =
+        "v=0\r\no=- 1 1 IN IP4 127.0.0.1\r\ns=Majestic\r\nt=0 0\r\nm=video 0 RTP/AVP 96\r\na=rtpmap:96 H265/90000\r\n";
+    static const char SDP_NO_VIDEO[] = "v=0\r\no=- 1 1 IN IP4 127.0.0.1\r\ns=Majestic\r\nt=0 0\r\n";
+    const int mode = atomic_load(&stub.mode);
+    const char *cseq = strstr(request, "CSeq: ");
+    const unsigned sequence = cseq ? (unsigned)strtoul(cseq + 6, NULL, 10) : 0;
+    char response[512];
+    int length;
+    (void)context;
+
+    if (mode == STUB_SILENT) {
+        return true;
+    }
+
+    if (strncmp(request, "OPTIONS ", 8) == 0) {
+        length = snprintf(response, sizeof(response),
+                          "RTSP/1.0 200 OK\r\nCSeq: %u\r\nPublic: OPTIONS, DESCRIBE, SETUP, PLAY\r\n\r\n", sequence);
+    } else if (mode == STUB_UNAVAILABLE) {
+        length = snprintf(response, sizeof(response), "RTSP/1.0 503 Service Unavailable\r\nCSeq: %u\r\n\r\n", sequence);
+    } else {
+        atomic_fetch_add(&stub.describes, 1);
+
+        const char *sdp = mode == STUB_NO_VIDEO ? SDP_NO_VIDEO : SDP;
+        length = snprintf(response, sizeof(response),
+                          "RTSP/1.0 200 OK\r\nCSeq: %u\r\nContent-Type: application/sdp\r\nContent-Length: %zu\r\n\r\n%s",
+                          sequence, strlen(sdp), sdp);
+    }
+
+    (void)send(fd, response, (size_t)length, MSG_NOSIGNAL);
+    return true;
+}
+
+static stream_probe_config_t test_config(void) {
+    stream_probe_config_t config;
+
+    stream_probe_config_defaults(&config);
+    config.timeout_ms = 2000;
+    config.settle_ms = 100;
+    return config;
+}
+
+static void test_check_needs_a_video_track(void) {
+    stream_probe_t probe;
+    const stream_probe_config_t config = test_config();
+
+    stream_probe_init(&probe, &config, "127.0.0.1", server.port);
+
+    atomic_store(&stub.mode, STUB_SERVING);
+    assert(stream_probe_check(&probe, 500) == 0);
+    assert(strstr(probe.buffer, "m=video") != NULL);
+
+    atomic_store(&stub.mode, STUB_UNAVAILABLE);
+    assert(stream_probe_check(&probe, 500) == -1);
+
+    atomic_store(&stub.mode, STUB_NO_VIDEO);
+    assert(stream_probe_check(&probe, 500) == -1);
+
+    // A server that accepts but never answers costs no more than the timeout.
+    atomic_store(&stub.mode, STUB_SILENT);
+    const uint64_t started_ns = latency_trace_now();
+    assert(stream_probe_check(&probe, 100) == -1);
+    assert(latency_trace_now() - started_ns < 400000000ULL);
+
+    // Nothing listening at all.
+    stream_probe_init(&probe, &config, "127.0.0.1", 1);
+    assert(stream_probe_check(&probe, 100) == -1);
+}
+
+static void *restore_stream(void *argument) {
+    const struct timespec delay = { .tv_sec = 0, .tv_nsec = 150L * 1000L * 1000L };
+    (void)argument;
+
+    nanosleep(&delay, NULL);
+    atomic_store(&stub.mode, STUB_SERVING);
+    return NULL;
+}
+
+static void test_wait_measures_the_gap(void) {
+    stream_probe_t probe;
+    const stream_probe_config_t config = test_config();
+    pthread_t thread;
+    uint64_t ready_ns = 0;
+
+    stream_probe_init(&probe, &config, "127.0.0.1", server.port);
+    atomic_store(&stub.mode, STUB_UNAVAILABLE);
+
+    const uint64_t since_ns = latency_trace_now();
+    assert(pthread_create(&thread, NULL, restore_stream, NULL) == 0);
+    assert(stream_probe_wait(&probe, since_ns, &ready_ns) == 0);
+    pthread_join(thread, NULL);
+
+    const uint64_t gap_ns = ready_ns - since_ns;
+    printf("probed gap: %.1f ms\n", (double)gap_ns / 1e6);
+    assert(gap_ns >= 150000000ULL && gap_ns < 1000000000ULL);
+}
+
+static void test_wait_reports_an_uninterrupted_stream(void) {
+    stream_probe_t probe;
+    const stream_probe_config_t config = test_config();
+    uint64_t ready_ns = 0;
+
+    stream_probe_init(&probe, &config, "127.0.0.1", server.port);
+    atomic_store(&stub.mode, STUB_SERVING);
+
+    const int describes = atomic_load(&stub.describes);
+    const uint64_t since_ns = latency_trace_now();
+    assert(stream_probe_wait(&probe, since_ns, &ready_ns) == STREAM_PROBE_UNINTERRUPTED);
+
+    // No outage seen: the first pass is reported, after the settle period.
+    assert(ready_ns - since_ns < 100000000ULL);
+    assert(latency_trace_now() - since_ns >= 100000000ULL);
+    assert(atomic_load(&stub.describes) - describes >= 2);
+}
+
+static void test_wait_gives_up(void) {
+    stream_probe_t probe;
+    stream_probe_config_t config = test_config();
+    uint64_t ready_ns = 0;
+
+    config.timeout_ms = 200;
+    stream_probe_init(&probe, &config, "127.0.0.1", server.port);
+    atomic_store(&stub.mode, STUB_UNAVAILABLE);
+
+    const uint64_t since_ns = latency_trace_now();
+    assert(stream_probe_wait(&probe, since_ns, &ready_ns) == -1);
+    assert(ready_ns == 0);
+    assert(latency_trace_now() - since_ns < 1000000000ULL);
+}
+
+int main(void) {
+    stub_server_start(&server, respond, NULL);
+    test_check_needs_a_video_track();
+    test_wait_measures_the_gap();
+    test_wait_reports_an_uninterrupted_stream();
+    test_wait_gives_up();
+    printf("test_stream_probe: ok\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../majestic_config.h"
+#include "../memory_stats.h"
+#include "../yaml_arena.h"
+
+static char config_path[256];
+
+// Start from the sample Majestic config shipped next to the sources.
+static void copy_sample_config(void) {
+    char buffer[8192];
+    FILE *input = fopen("majestic.yaml", "rb");
+    FILE *output = fopen(config_path, "wb");
+
+    assert(input && output);
+    const size_t length = fread(buffer, 1, sizeof(buffer), input);
+    assert(length > 0 && fwrite(buffer, 1, length, output) == length);
+    fclose(input);
+    fclose(output);
+}
+
+// A key the sample lacks forces the full parse/emit path every time.
+static void commit_new_key(unsigned value) {
+    majestic_config_txn_t txn;
+    char text[16];
+
+    snprintf(text, sizeof(text), "%u", value);
+    majestic_config_begin(&txn, config_path);
+    assert(majestic_config_set(&txn, "video1.crop", value % 2 ? "480x270x960x540" : "0x0x1920x1080") == 0);
+    assert(majestic_config_set(&txn, "manager.test", value % 2 ? "quoted value" : text) == 0);
+    assert(majestic_config_commit(&txn) == 0);
+}
+
+static void test_document_round_trips_stay_in_the_arena(void) {
+    yaml_arena_stats_t stats;
+
+    copy_sample_config();
+    commit_new_key(0);
+    yaml_arena_get_stats(&stats);
+
+    const size_t first_peak = stats.peak;
+    assert(first_peak > 0 && first_peak < stats.capacity);
+    assert(stats.used == 0 && stats.live_blocks == 0);
+
+    // Repeating the work rewinds to the same footprint: nothing leaks and
+    // nothing fragments.
+    for (unsigned i = 1; i <= 50; ++i) {
+        commit_new_key(i);
+    }
+
+    yaml_arena_get_stats(&stats);
+    assert(stats.used == 0 && stats.live_blocks == 0);
+    assert(stats.peak <= first_peak + first_peak / 8);
+    assert(stats.heap_fallbacks == 0);
+    assert(stats.rewinds >= 51);
+    printf("yaml arena peak: %zu bytes\n", stats.peak);
+}
+
+static void test_reports_memory_use(void) {
+    char report[256];
+    memory_stats_t stats;
+
+    memory_stats_read(&stats);
+    assert(stats.rss_kb > 0 && stats.peak_rss_kb >= stats.rss_kb);
+
+    const size_t length = memory_stats_format(report, sizeof(report));
+    assert(length > 0 && report[length - 1] == '\n');
+    assert(strncmp(report, "memory rss_kb=", 14) == 0);
+    assert(strstr(report, " yaml_peak=") != NULL);
+}
+
+int main(void) {
+    char directory[] = "/tmp/yaml_arena_test.XXXXXX";
+    assert(mkdtemp(directory));
+    snprintf(config_path, sizeof(config_path), "%s/majestic.yaml", directory);
+
+    yaml_arena_install();
+    test_document_round_trips_stay_in_the_arena();
+    test_reports_memory_use();
+    yaml_arena_uninstall();
+
+    unlink(config_path);
+    rmdir(directory);
+    printf("test_yaml_arena: ok\n");
+    return 0;
+}
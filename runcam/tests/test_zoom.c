@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../zoom.h"
+
+static void test_crops_are_centered_and_aligned(void) {
+    zoom_engine_t engine;
+    char crop[48];
+
+    assert(zoom_engine_init(&engine, 1920, 1080, 8.0, 2.0, 8) == 0);
+
+    zoom_rect_t rect = zoom_compute(&engine, 1.0, 0.0, 0.0);
+    zoom_format_crop(&rect, crop, sizeof(crop));
+    assert(strcmp(crop, "0x0x1920x1080") == 0);
+
+    rect = zoom_compute(&engine, 2.0, 0.0, 0.0);
+    zoom_format_crop(&rect, crop, sizeof(crop));
+    assert(strcmp(crop, "480x264x960x544") == 0);
+
+    for (double factor = 1.0; factor <= 8.0; factor += 0.37) {
+        rect = zoom_compute(&engine, factor, 0.0, 0.0);
+        assert(rect.x % 8 == 0 && rect.y % 8 == 0);
+        assert(rect.width % 8 == 0 && rect.height % 8 == 0);
+        assert(rect.x + rect.width <= 1920 && rect.y + rect.height <= 1080);
+    }
+}
+
+static void test_factors_are_clamped(void) {
+    zoom_engine_t engine;
+
+    assert(zoom_engine_init(&engine, 1280, 720, 4.0, 1.5, 2) == 0);
+    assert(zoom_clamp(&engine, 0.5) == 1.0);
+    assert(zoom_clamp(&engine, 10.0) == 4.0);
+
+    const zoom_rect_t full = zoom_compute(&engine, 0.1, 0.0, 0.0);
+    assert(full.width == 1280 && full.height == 720);
+}
+
+static void test_percent_mapping_round_trips(void) {
+    zoom_engine_t engine;
+
+    assert(zoom_engine_init(&engine, 1920, 1080, 8.0, 2.0, 2) == 0);
+    assert(fabs(zoom_factor_from_percent(&engine, 0.0) - 1.0) < 1e-9);
+    assert(fabs(zoom_factor_from_percent(&engine, 100.0) - 8.0) < 1e-9);
+    assert(fabs(zoom_factor_from_percent(&engine, 50.0) - sqrt(8.0)) < 1e-9);
+
+    for (double percent = 0.0; percent <= 100.0; percent += 12.5) {
+        const double factor = zoom_factor_from_percent(&engine, percent);
+        assert(fabs(zoom_percent_from_factor(&engine, factor) - percent) < 1e-6);
+    }
+}
+
+static void test_parses_sizes(void) {
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    assert(zoom_parse_size("3840x2160", &width, &height) == 0);
+    assert(width == 3840 && height == 2160);
+    assert(zoom_parse_size("1920", &width, &height) != 0);
+    assert(zoom_parse_size("0x1080", &width, &height) != 0);
+}
+
+int main(void) {
+    test_crops_are_centered_and_aligned();
+    test_factors_are_clamped();
+    test_percent_mapping_round_trips();
+    test_parses_sizes();
+
+    puts("test_zoom: ok");
+    return 0;
+}
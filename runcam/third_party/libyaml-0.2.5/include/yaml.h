@@ -69,6 +69,26 @@ yaml_get_version_string(void);
 YAML_DECLARE(void)
 yaml_get_version(int *major, int *minor, int *patch);
 
+/**
+ * Allocation hooks (local addition for majestic_manager).
+ *
+ * Every allocation libyaml makes goes through yaml_malloc/yaml_realloc/
+ * yaml_free; these hooks let the application serve them from its own
+ * memory. Passing NULL restores the C library allocator.
+ */
+
+typedef struct yaml_allocator_s {
+    /** Allocate @a size bytes. */
+    void *(*malloc)(size_t size);
+    /** Resize a block returned by malloc/realloc (never NULL). */
+    void *(*realloc)(void *ptr, size_t size);
+    /** Release a block (never NULL). */
+    void (*free)(void *ptr);
+} yaml_allocator_t;
+
+YAML_DECLARE(void)
+yaml_set_allocator(const yaml_allocator_t *allocator);
+
 /** @} */
 
 /**
@@ -23,6 +23,22 @@ yaml_get_version(int *major, int *minor, int *patch)
     *patch = YAML_VERSION_PATCH;
 }
 
+/*
+ * Allocator hooks; NULL means the C library.
+ */
+
+static yaml_allocator_t yaml_allocator;
+static int yaml_allocator_set = 0;
+
+YAML_DECLARE(void)
+yaml_set_allocator(const yaml_allocator_t *allocator)
+{
+    yaml_allocator_set = allocator != NULL;
+
+    if (allocator)
+        yaml_allocator = *allocator;
+}
+
 /*
  * Allocate a dynamic memory block.
  */
@@ -30,6 +46,9 @@ yaml_get_version(int *major, int *minor, int *patch)
 YAML_DECLARE(void *)
 yaml_malloc(size_t size)
 {
+    if (yaml_allocator_set)
+        return yaml_allocator.malloc(size ? size : 1);
+
     return malloc(size ? size : 1);
 }
 
@@ -40,7 +59,13 @@ yaml_malloc(size_t size)
 YAML_DECLARE(void *)
 yaml_realloc(void *ptr, size_t size)
 {
-    return ptr ? realloc(ptr, size ? size : 1) : malloc(size ? size : 1);
+    if (!ptr)
+        return yaml_malloc(size);
+
+    if (yaml_allocator_set)
+        return yaml_allocator.realloc(ptr, size ? size : 1);
+
+    return realloc(ptr, size ? size : 1);
 }
 
 /*
@@ -50,7 +75,13 @@ yaml_realloc(void *ptr, size_t size)
 YAML_DECLARE(void)
 yaml_free(void *ptr)
 {
-    if (ptr) free(ptr);
+    if (!ptr)
+        return;
+
+    if (yaml_allocator_set)
+        yaml_allocator.free(ptr);
+    else
+        free(ptr);
 }
 
 /*
@@ -60,10 +91,19 @@ yaml_free(void *ptr)
 YAML_DECLARE(yaml_char_t *)
 yaml_strdup(const yaml_char_t *str)
 {
+    size_t length;
+    yaml_char_t *copy;
+
     if (!str)
         return NULL;
 
-    return (yaml_char_t *)strdup((char *)str);
+    length = strlen((const char *)str) + 1;
+    copy = YAML_MALLOC(length);
+
+    if (copy)
+        memcpy(copy, str, length);
+
+    return copy;
 }
 
 /*
@@ -0,0 +1,166 @@
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "third_party/libyaml-0.2.5/include/yaml.h"
+
+#include "yaml_arena.h"
+
+#define ARENA_ALIGNMENT alignof(max_align_t)
+#define NO_BLOCK SIZE_MAX
+
+// Each block starts with this header, padded to the arena alignment. Blocks
+// form a stack: `previous` links to the block below so freed blocks at the
+// top can be popped one after another.
+typedef struct block_header {
+    size_t size;     // usable bytes, a multiple of the alignment
+    size_t previous; // offset of the block below, or NO_BLOCK
+    bool freed;
+} block_header_t;
+
+#define BLOCK_HEADER_SIZE ((sizeof(block_header_t) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+static alignas(max_align_t) unsigned char arena[YAML_ARENA_CAPACITY];
+static size_t arena_top = 0;
+static size_t last_block = NO_BLOCK;
+static yaml_arena_stats_t arena_stats = { .capacity = YAML_ARENA_CAPACITY };
+
+static size_t round_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static bool in_arena(const void *ptr) {
+    const unsigned char *const bytes = ptr;
+
+    return bytes >= arena && bytes < arena + sizeof(arena);
+}
+
+static block_header_t *header_at(size_t offset) {
+    return (block_header_t *)(arena + offset);
+}
+
+static size_t offset_of(const void *ptr) {
+    return (size_t)((const unsigned char *)ptr - arena) - BLOCK_HEADER_SIZE;
+}
+
+// Counters are written by whichever thread runs libyaml and read by the
+// stats socket, hence the relaxed atomics.
+static void count(uint32_t *counter) {
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+static void set_top(size_t top) {
+    arena_top = top;
+    __atomic_store_n(&arena_stats.used, top, __ATOMIC_RELAXED);
+
+    if (top > arena_stats.peak) {
+        __atomic_store_n(&arena_stats.peak, top, __ATOMIC_RELAXED);
+    }
+}
+
+static void set_live_blocks(size_t live_blocks) {
+    __atomic_store_n(&arena_stats.live_blocks, live_blocks, __ATOMIC_RELAXED);
+}
+
+static void *arena_malloc(size_t size) {
+    const size_t rounded = round_up(size);
+
+    if (rounded < size || BLOCK_HEADER_SIZE + rounded > sizeof(arena) - arena_top) {
+        count(&arena_stats.heap_fallbacks);
+        return malloc(size);
+    }
+
+    block_header_t *const header = header_at(arena_top);
+
+    header->size = rounded;
+    header->previous = last_block;
+    header->freed = false;
+    last_block = arena_top;
+    set_top(arena_top + BLOCK_HEADER_SIZE + rounded);
+    set_live_blocks(arena_stats.live_blocks + 1);
+    return (unsigned char *)header + BLOCK_HEADER_SIZE;
+}
+
+// A freed block is only marked; the top of the stack then drops past every
+// freed block it reaches, so memory comes back as soon as nothing above it is
+// still in use, and the whole arena empties once nothing is live.
+static void arena_free(void *ptr) {
+    if (!in_arena(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    header_at(offset_of(ptr))->freed = true;
+    set_live_blocks(arena_stats.live_blocks - 1);
+
+    if (arena_stats.live_blocks == 0) {
+        last_block = NO_BLOCK;
+        set_top(0);
+        count(&arena_stats.rewinds);
+        return;
+    }
+
+    size_t top = arena_top;
+
+    while (last_block != NO_BLOCK && header_at(last_block)->freed) {
+        top = last_block;
+        last_block = header_at(last_block)->previous;
+    }
+
+    set_top(top);
+}
+
+static void *arena_realloc(void *ptr, size_t size) {
+    if (!in_arena(ptr)) {
+        return realloc(ptr, size);
+    }
+
+    block_header_t *const header = header_at(offset_of(ptr));
+    const size_t rounded = round_up(size);
+
+    if (rounded >= size && rounded <= header->size) {
+        return ptr;
+    }
+
+    // libyaml grows its buffers by doubling; the newest block grows in place.
+    if (rounded >= size && offset_of(ptr) == last_block && rounded - header->size <= sizeof(arena) - arena_top) {
+        set_top(arena_top + rounded - header->size);
+        header->size = rounded;
+        return ptr;
+    }
+
+    void *const moved = arena_malloc(size);
+
+    if (moved) {
+        memcpy(moved, ptr, header->size);
+        arena_free(ptr);
+    }
+
+    return moved;
+}
+
+void yaml_arena_install(void) {
+    static const yaml_allocator_t allocator = {
+        .malloc = arena_malloc,
+        .realloc = arena_realloc,
+        .free = arena_free
+    };
+
+    yaml_set_allocator(&allocator);
+}
+
+void yaml_arena_uninstall(void) {
+    yaml_set_allocator(NULL);
+}
+
+void yaml_arena_get_stats(yaml_arena_stats_t *stats) {
+    stats->capacity = arena_stats.capacity;
+    stats->used = __atomic_load_n(&arena_stats.used, __ATOMIC_RELAXED);
+    stats->peak = __atomic_load_n(&arena_stats.peak, __ATOMIC_RELAXED);
+    stats->live_blocks = __atomic_load_n(&arena_stats.live_blocks, __ATOMIC_RELAXED);
+    stats->rewinds = __atomic_load_n(&arena_stats.rewinds, __ATOMIC_RELAXED);
+    stats->heap_fallbacks = __atomic_load_n(&arena_stats.heap_fallbacks, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bytes reserved for libyaml. The worst case is a full round trip, where the
+ * parser's 64 KiB of buffers, the document and the emitter's 48 KiB of
+ * buffers are alive together: about 200 KiB on a 64-bit host for the stock
+ * Majestic config, less on the camera (see tests/test_yaml_arena.c).
+ */
+#define YAML_ARENA_CAPACITY (256 * 1024)
+
+typedef struct yaml_arena_stats {
+    size_t capacity;
+    size_t used;             // bytes handed out (with headers) right now
+    size_t peak;             // high-water mark of `used`
+    size_t live_blocks;
+    uint32_t rewinds;        // times the arena emptied and started over
+    uint32_t heap_fallbacks; // requests that did not fit and went to malloc
+} yaml_arena_stats_t;
+
+/**
+ * Route every libyaml allocation through a static bump arena. libyaml frees
+ * everything it allocates once a parser, document or emitter is deleted, so
+ * the arena rewinds to empty after each config transaction and the manager
+ * never touches the heap for YAML work. A request that does not fit falls
+ * back to malloc(3) and is counted, so an oversized config still works.
+ *
+ * The arena is not thread-safe: libyaml must only be used by one thread at a
+ * time, which the config cache already requires.
+ */
+void yaml_arena_install(void);
+
+/**
+ * Restore the C library allocator (the arena must be empty).
+ */
+void yaml_arena_uninstall(void);
+
+void yaml_arena_get_stats(yaml_arena_stats_t *stats);
@@ -0,0 +1,112 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "zoom.h"
+
+int zoom_engine_init(
+    zoom_engine_t *engine,
+    uint32_t frame_width,
+    uint32_t frame_height,
+    double max_factor,
+    double step_factor,
+    uint32_t alignment) {
+
+    if (frame_width == 0 || frame_height == 0 || alignment == 0 ||
+        !(max_factor >= 1.0) || !(step_factor > 1.0) ||
+        frame_width / max_factor < alignment || frame_height / max_factor < alignment) {
+        return -1;
+    }
+
+    engine->frame_width = frame_width;
+    engine->frame_height = frame_height;
+    engine->max_factor = max_factor;
+    engine->step_factor = step_factor;
+    engine->alignment = alignment;
+    return 0;
+}
+
+double zoom_clamp(const zoom_engine_t *engine, double factor) {
+    if (!(factor >= 1.0)) {
+        return 1.0;
+    }
+
+    return factor > engine->max_factor ? engine->max_factor : factor;
+}
+
+static uint32_t align_down(uint32_t value, uint32_t alignment) {
+    return value - value % alignment;
+}
+
+// Round a span to the nearest aligned size, never below one alignment unit
+// and never beyond the frame.
+static uint32_t aligned_span(uint32_t frame, double factor, uint32_t alignment) {
+    const double exact = (double)frame / factor;
+    uint32_t span = (uint32_t)(exact / alignment + 0.5) * alignment;
+
+    if (span < alignment) {
+        span = alignment;
+    }
+
+    return span > frame ? align_down(frame, alignment) : span;
+}
+
+static uint32_t aligned_offset(uint32_t frame, uint32_t span, double pan, uint32_t alignment) {
+    if (pan < -1.0) {
+        pan = -1.0;
+    } else if (pan > 1.0) {
+        pan = 1.0;
+    }
+
+    const double slack = (double)(frame - span);
+    return align_down((uint32_t)(slack * (pan + 1.0) / 2.0), alignment);
+}
+
+zoom_rect_t zoom_compute(const zoom_engine_t *engine, double factor, double pan_x, double pan_y) {
+    const double clamped = zoom_clamp(engine, factor);
+    zoom_rect_t rect;
+
+    rect.width = aligned_span(engine->frame_width, clamped, engine->alignment);
+    rect.height = aligned_span(engine->frame_height, clamped, engine->alignment);
+    rect.x = aligned_offset(engine->frame_width, rect.width, pan_x, engine->alignment);
+    rect.y = aligned_offset(engine->frame_height, rect.height, pan_y, engine->alignment);
+    return rect;
+}
+
+void zoom_format_crop(const zoom_rect_t *rect, char *out, size_t out_size) {
+    snprintf(out, out_size, "%ux%ux%ux%u", rect->x, rect->y, rect->width, rect->height);
+}
+
+double zoom_factor_from_percent(const zoom_engine_t *engine, double percent) {
+    if (!(percent > 0.0)) {
+        return 1.0;
+    }
+
+    if (percent >= 100.0) {
+        return engine->max_factor;
+    }
+
+    return pow(engine->max_factor, percent / 100.0);
+}
+
+double zoom_percent_from_factor(const zoom_engine_t *engine, double factor) {
+    if (engine->max_factor <= 1.0) {
+        return 0.0;
+    }
+
+    return 100.0 * log(zoom_clamp(engine, factor)) / log(engine->max_factor);
+}
+
+int zoom_parse_size(const char *value, uint32_t *width, uint32_t *height) {
+    unsigned parsed_width = 0;
+    unsigned parsed_height = 0;
+    char trailing = '\0';
+
+    if (sscanf(value, "%ux%u%c", &parsed_width, &parsed_height, &trailing) != 2 ||
+        parsed_width == 0 || parsed_height == 0) {
+        return -1;
+    }
+
+    *width = parsed_width;
+    *height = parsed_height;
+    return 0;
+}
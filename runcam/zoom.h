@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Crop rectangle in the coordinate frame Majestic uses for `video1.crop`.
+ */
+typedef struct zoom_rect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} zoom_rect_t;
+
+/**
+ * Geometry and limits for computing crops. Everything is derived once at
+ * startup, so each lookup is a handful of arithmetic operations.
+ */
+typedef struct zoom_engine {
+    uint32_t frame_width;
+    uint32_t frame_height;
+    double max_factor;  // e.g. 8.0 for an 8x digital zoom
+    double step_factor; // multiplier applied per zoom_in/zoom_out step
+    uint32_t alignment; // encoder alignment of x/y/width/height in pixels
+} zoom_engine_t;
+
+/**
+ * @return 0 on success, -1 if the geometry or limits are unusable.
+ */
+int zoom_engine_init(
+    zoom_engine_t *engine,
+    uint32_t frame_width,
+    uint32_t frame_height,
+    double max_factor,
+    double step_factor,
+    uint32_t alignment);
+
+/**
+ * Clamp a zoom factor to [1, max_factor].
+ */
+double zoom_clamp(const zoom_engine_t *engine, double factor);
+
+/**
+ * Compute the aligned crop for a zoom factor. `pan_x`/`pan_y` in [-1, 1] move
+ * the crop from the centre (0) to the left/top (-1) or right/bottom (1) edge.
+ */
+zoom_rect_t zoom_compute(const zoom_engine_t *engine, double factor, double pan_x, double pan_y);
+
+/**
+ * Format a crop as Majestic's "XxYxWxH" string.
+ */
+void zoom_format_crop(const zoom_rect_t *rect, char *out, size_t out_size);
+
+/**
+ * Map the MAVLink 0..100 % zoom range onto zoom factors. The mapping is
+ * logarithmic so equal slider movements give equal magnification ratios.
+ */
+double zoom_factor_from_percent(const zoom_engine_t *engine, double percent);
+
+double zoom_percent_from_factor(const zoom_engine_t *engine, double factor);
+
+/**
+ * Parse a Majestic "WxH" size string.
+ *
+ * @return 0 on success, -1 if the string is not a size.
+ */
+int zoom_parse_size(const char *value, uint32_t *width, uint32_t *height);